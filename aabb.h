@@ -4,6 +4,7 @@
 #include <cmath>
 
 #include "interval.h"
+#include "trace.h"
 
 // an implementation of axis-aligned bounding boxes to be used by the ray tracer's BVH
 // this AABB is defined by 3 intervals along the three axis, figuring out whether a ray intersects
@@ -25,10 +26,22 @@ class Aabb {
 
         bool hit(Ray const & incomingRay, Interval rayLimits) const;
 
+        // the same as hit, but also shrinks rayLimits down to the part of the ray that's inside the box
+        bool clip(Ray const & incomingRay, Interval & rayLimits) const;
+
         // returns a new slightly bigger AABB that's confirmed to be at least a certain size in all dimensions
         // helps in cases where the AABB is encompassing something with 0 in one axis
         Aabb pad(double atLeastSize = 0.0001);
 
+        // the surface area of the box, used to estimate how likely a ray is to hit it when judging BVH quality
+        double surface_area() const;
+
+        // the box partway between this box and the end box, where t is 0 for this box and 1 for the end box
+        Aabb interpolate(Aabb const & end, double t) const;
+
+        bool operator==(Aabb const & right) const;
+        bool operator!=(Aabb const & right) const;
+
         Aabb operator+(Vec3 & right);
 
     private:
@@ -38,24 +51,24 @@ class Aabb {
 
 Aabb operator+(Vec3 & left, Aabb & right);
 
-Aabb::Aabb() : xBounds(), yBounds(), zBounds() { }
+inline Aabb::Aabb() : xBounds(), yBounds(), zBounds() { }
 
-Aabb::Aabb(Interval const & xInterval, Interval const & yInterval, Interval const & zInterval)
+inline Aabb::Aabb(Interval const & xInterval, Interval const & yInterval, Interval const & zInterval)
            : xBounds(xInterval), yBounds(yInterval), zBounds(zInterval) { }
 
-Aabb::Aabb(Point3 const & a, Point3 const & b) {
+inline Aabb::Aabb(Point3 const & a, Point3 const & b) {
     this->xBounds = Interval(fmin(a.x, b.x), fmax(a.x, b.x));
     this->yBounds = Interval(fmin(a.y, b.y), fmax(a.y, b.y));
     this->zBounds = Interval(fmin(a.z, b.z), fmax(a.z, b.z));
 }
 
-Aabb::Aabb(Aabb const & a, Aabb const & b) {
+inline Aabb::Aabb(Aabb const & a, Aabb const & b) {
     this->xBounds = Interval(a.xBounds, b.xBounds);
     this->yBounds = Interval(a.yBounds, b.yBounds);
     this->zBounds = Interval(a.zBounds, b.zBounds);
 }
 
-bool Aabb::hit(Ray const & incomingRay, Interval rayLimits) const {
+inline bool Aabb::hit(Ray const & incomingRay, Interval rayLimits) const {
     // by re-ordering the equation for ray intersecting with a point, we can find t (the scalar at which the ray
     // intersects with a point) using (P(t) - A) / b
     // using that equation for each axis individually, we can identify if the ray intersects with any axis
@@ -74,22 +87,50 @@ bool Aabb::hit(Ray const & incomingRay, Interval rayLimits) const {
     bool intersectedAlongY = intersectedAlongX && intersect_with_bounds(yBounds, incomingRay.dir.y, incomingRay.orig.y, rayLimits);
     bool intersectedAlongZ = intersectedAlongY && intersect_with_bounds(zBounds, incomingRay.dir.z, incomingRay.orig.z, rayLimits);
 
-    LOG(
-        std::clog << "Ray intersected with AABB along x: " << intersectedAlongX
-                  << ", y: " << intersectedAlongY
-                  << ", z: " << intersectedAlongZ << "\n";
-    );
+    TRACE(trace::Level::Intersection, trace::Event::AabbResult, intersectedAlongX, intersectedAlongY, intersectedAlongZ);
 
     return intersectedAlongX && intersectedAlongY && intersectedAlongZ;
 }
 
-Aabb Aabb::pad(double atLeastSize) {
+inline bool Aabb::clip(Ray const & incomingRay, Interval & rayLimits) const {
+    return intersect_with_bounds(xBounds, incomingRay.dir.x, incomingRay.orig.x, rayLimits)
+           && intersect_with_bounds(yBounds, incomingRay.dir.y, incomingRay.orig.y, rayLimits)
+           && intersect_with_bounds(zBounds, incomingRay.dir.z, incomingRay.orig.z, rayLimits);
+}
+
+inline Aabb Aabb::pad(double atLeastSize) {
     return Aabb((this->xBounds.size() <= atLeastSize) ? this->xBounds.expand(0.0001) : this->xBounds,
                 (this->yBounds.size() <= atLeastSize) ? this->yBounds.expand(0.0001) : this->yBounds,
                 (this->zBounds.size() <= atLeastSize) ? this->zBounds.expand(0.0001) : this->zBounds);
 }
 
-bool Aabb::intersect_with_bounds(Interval const & componentBounds, double const rayDirectionComponent,
+inline double Aabb::surface_area() const {
+    double x = this->xBounds.size();
+    double y = this->yBounds.size();
+    double z = this->zBounds.size();
+
+    return 2 * ((x * y) + (y * z) + (z * x));
+}
+
+inline Aabb Aabb::interpolate(Aabb const & end, double t) const {
+    auto lerp = [t](Interval const & a, Interval const & b) {
+        return Interval(a.min + (t * (b.min - a.min)), a.max + (t * (b.max - a.max)));
+    };
+
+    return Aabb(lerp(this->xBounds, end.xBounds), lerp(this->yBounds, end.yBounds), lerp(this->zBounds, end.zBounds));
+}
+
+inline bool Aabb::operator==(Aabb const & right) const {
+    return (this->xBounds.min == right.xBounds.min) && (this->xBounds.max == right.xBounds.max)
+        && (this->yBounds.min == right.yBounds.min) && (this->yBounds.max == right.yBounds.max)
+        && (this->zBounds.min == right.zBounds.min) && (this->zBounds.max == right.zBounds.max);
+}
+
+inline bool Aabb::operator!=(Aabb const & right) const {
+    return !(*this == right);
+}
+
+inline bool Aabb::intersect_with_bounds(Interval const & componentBounds, double const rayDirectionComponent,
                                  double const rayOriginComponent, Interval & rayLimits) const {
     auto invD = 1 / rayDirectionComponent;
 
@@ -99,10 +140,7 @@ bool Aabb::intersect_with_bounds(Interval const & componentBounds, double const
     // the t for the intersection with the upper bound
     auto t1 = (componentBounds.max - rayOriginComponent) * invD;
 
-    LOG(
-        std::clog << "Checking ray intersection with bounds, t0: " << t0 << ", t1: " << t1
-                  << ", rayLimits: " << rayLimits.min << " " << rayLimits.max << "\n";
-    );
+    TRACE(trace::Level::Intersection, trace::Event::AabbSlab, t0, t1, rayLimits.min, rayLimits.max);
 
     if (invD < 0)
         std::swap(t0, t1);
@@ -118,11 +156,11 @@ bool Aabb::intersect_with_bounds(Interval const & componentBounds, double const
     return true;
 }
 
-Aabb Aabb::operator+(Vec3 & right) {
+inline Aabb Aabb::operator+(Vec3 & right) {
     return Aabb(this->xBounds + right.x, this->yBounds + right.y, this->zBounds + right.z);
 }
 
-Aabb operator+(Vec3 & left, Aabb & right) {
+inline Aabb operator+(Vec3 & left, Aabb & right) {
     return right + left;
 }
 
@@ -0,0 +1,250 @@
+#ifndef AFFINE_TRANSFORM_H
+#define AFFINE_TRANSFORM_H
+
+#include <cmath>
+#include <limits>
+#include <ostream>
+
+#include "vec3.h"
+#include "ray.h"
+#include "aabb.h"
+
+// a 3x4 matrix that represents an affine transformation, i.e a 3x3 linear part (rotation, scale, shear)
+// followed by a translation which is the 4th column. Points are treated as having an implicit 4th component of 1
+// so they get translated, while vectors have an implicit 0 so they're only affected by the linear part.
+// transformations are combined with *, where (a * b) applies b first then a, same as with matrices
+class AffineTransform {
+    public:
+        // row major, the last column being the translation
+        double m[3][4];
+
+        // the identity transformation
+        AffineTransform();
+
+        static AffineTransform translate(Vec3 const & offset);
+        // rotations are counter-clockwise and in degrees, use negative angle for clockwise
+        static AffineTransform rotate(Vec3 const & axis, double angle);
+        static AffineTransform rotate_x(double angle);
+        static AffineTransform rotate_y(double angle);
+        static AffineTransform rotate_z(double angle);
+        static AffineTransform scale(Vec3 const & factors);
+
+        AffineTransform operator*(AffineTransform const & right) const;
+
+        AffineTransform inverse() const;
+
+        Point3 transform_point(Point3 const & p) const;
+
+        Vec3 transform_vector(Vec3 const & v) const;
+
+        // multiplies the vector by the transpose of the linear part, normals must be transformed by the inverse
+        // transpose of a transformation, so calling this on the inverse of a transformation transforms normals
+        Vec3 transform_vector_transposed(Vec3 const & v) const;
+
+        // returns the box that encloses the given box after its been transformed
+        Aabb transform_box(Aabb const & box) const;
+
+        // whether the linear part only rotates (i.e doesn't scale or shear), in which case vectors keep their length
+        bool is_rigid() const;
+};
+
+std::ostream & operator<<(std::ostream & out, AffineTransform const & t);
+
+// ------
+
+inline AffineTransform::AffineTransform() : m{{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}} { }
+
+inline AffineTransform AffineTransform::translate(Vec3 const & offset) {
+    auto t = AffineTransform();
+    t.m[0][3] = offset.x;
+    t.m[1][3] = offset.y;
+    t.m[2][3] = offset.z;
+    return t;
+}
+
+// Rodrigues' rotation formula in matrix form:
+//     R = cos(a) I + sin(a) [k]x + (1 - cos(a)) k k^T
+// where k is the unit axis and [k]x is the matrix that does the cross product with k
+inline AffineTransform AffineTransform::rotate(Vec3 const & axis, double angle) {
+    double radians = angle * PI / 180.0;
+    double sinTheta = sin(radians);
+    double cosTheta = cos(radians);
+    double oneMinusCos = 1 - cosTheta;
+
+    Vec3 k = axis.unit();
+
+    auto t = AffineTransform();
+    t.m[0][0] = cosTheta + (k.x * k.x * oneMinusCos);
+    t.m[0][1] = (k.x * k.y * oneMinusCos) - (k.z * sinTheta);
+    t.m[0][2] = (k.x * k.z * oneMinusCos) + (k.y * sinTheta);
+
+    t.m[1][0] = (k.y * k.x * oneMinusCos) + (k.z * sinTheta);
+    t.m[1][1] = cosTheta + (k.y * k.y * oneMinusCos);
+    t.m[1][2] = (k.y * k.z * oneMinusCos) - (k.x * sinTheta);
+
+    t.m[2][0] = (k.z * k.x * oneMinusCos) - (k.y * sinTheta);
+    t.m[2][1] = (k.z * k.y * oneMinusCos) + (k.x * sinTheta);
+    t.m[2][2] = cosTheta + (k.z * k.z * oneMinusCos);
+    return t;
+}
+
+// the single axis rotations are written out rather than going through rotate() so that they're exact,
+// e.g so that a y rotation leaves y completely untouched
+inline AffineTransform AffineTransform::rotate_x(double angle) {
+    double radians = angle * PI / 180.0;
+
+    auto t = AffineTransform();
+    t.m[1][1] = cos(radians);
+    t.m[1][2] = -sin(radians);
+    t.m[2][1] = sin(radians);
+    t.m[2][2] = cos(radians);
+    return t;
+}
+
+inline AffineTransform AffineTransform::rotate_y(double angle) {
+    double radians = angle * PI / 180.0;
+
+    auto t = AffineTransform();
+    t.m[0][0] = cos(radians);
+    t.m[0][2] = sin(radians);
+    t.m[2][0] = -sin(radians);
+    t.m[2][2] = cos(radians);
+    return t;
+}
+
+inline AffineTransform AffineTransform::rotate_z(double angle) {
+    double radians = angle * PI / 180.0;
+
+    auto t = AffineTransform();
+    t.m[0][0] = cos(radians);
+    t.m[0][1] = -sin(radians);
+    t.m[1][0] = sin(radians);
+    t.m[1][1] = cos(radians);
+    return t;
+}
+
+inline AffineTransform AffineTransform::scale(Vec3 const & factors) {
+    auto t = AffineTransform();
+    t.m[0][0] = factors.x;
+    t.m[1][1] = factors.y;
+    t.m[2][2] = factors.z;
+    return t;
+}
+
+// same as multiplying two 4x4 matrices whose last row is (0, 0, 0, 1)
+inline AffineTransform AffineTransform::operator*(AffineTransform const & right) const {
+    auto t = AffineTransform();
+
+    for (int row = 0; row < 3; row++) {
+        for (int column = 0; column < 4; column++) {
+            t.m[row][column] = (this->m[row][0] * right.m[0][column])
+                             + (this->m[row][1] * right.m[1][column])
+                             + (this->m[row][2] * right.m[2][column]);
+        }
+        t.m[row][3] += this->m[row][3];
+    }
+
+    return t;
+}
+
+// the inverse of [L | t] is [L^-1 | -L^-1 t], L^-1 is found using the adjugate (transposed cofactors) divided by
+// the determinant
+inline AffineTransform AffineTransform::inverse() const {
+    auto const & a = this->m;
+
+    double cofactor00 = (a[1][1] * a[2][2]) - (a[1][2] * a[2][1]);
+    double cofactor01 = (a[1][2] * a[2][0]) - (a[1][0] * a[2][2]);
+    double cofactor02 = (a[1][0] * a[2][1]) - (a[1][1] * a[2][0]);
+
+    double determinant = (a[0][0] * cofactor00) + (a[0][1] * cofactor01) + (a[0][2] * cofactor02);
+    double inverseDeterminant = 1 / determinant;
+
+    auto t = AffineTransform();
+    t.m[0][0] = cofactor00 * inverseDeterminant;
+    t.m[0][1] = ((a[0][2] * a[2][1]) - (a[0][1] * a[2][2])) * inverseDeterminant;
+    t.m[0][2] = ((a[0][1] * a[1][2]) - (a[0][2] * a[1][1])) * inverseDeterminant;
+
+    t.m[1][0] = cofactor01 * inverseDeterminant;
+    t.m[1][1] = ((a[0][0] * a[2][2]) - (a[0][2] * a[2][0])) * inverseDeterminant;
+    t.m[1][2] = ((a[0][2] * a[1][0]) - (a[0][0] * a[1][2])) * inverseDeterminant;
+
+    t.m[2][0] = cofactor02 * inverseDeterminant;
+    t.m[2][1] = ((a[0][1] * a[2][0]) - (a[0][0] * a[2][1])) * inverseDeterminant;
+    t.m[2][2] = ((a[0][0] * a[1][1]) - (a[0][1] * a[1][0])) * inverseDeterminant;
+
+    Vec3 inverseTranslation = -t.transform_vector(Vec3(a[0][3], a[1][3], a[2][3]));
+    t.m[0][3] = inverseTranslation.x;
+    t.m[1][3] = inverseTranslation.y;
+    t.m[2][3] = inverseTranslation.z;
+
+    return t;
+}
+
+inline Point3 AffineTransform::transform_point(Point3 const & p) const {
+    return Point3((m[0][0] * p.x) + (m[0][1] * p.y) + (m[0][2] * p.z) + m[0][3],
+                  (m[1][0] * p.x) + (m[1][1] * p.y) + (m[1][2] * p.z) + m[1][3],
+                  (m[2][0] * p.x) + (m[2][1] * p.y) + (m[2][2] * p.z) + m[2][3]);
+}
+
+inline Vec3 AffineTransform::transform_vector(Vec3 const & v) const {
+    return Vec3((m[0][0] * v.x) + (m[0][1] * v.y) + (m[0][2] * v.z),
+                (m[1][0] * v.x) + (m[1][1] * v.y) + (m[1][2] * v.z),
+                (m[2][0] * v.x) + (m[2][1] * v.y) + (m[2][2] * v.z));
+}
+
+inline Vec3 AffineTransform::transform_vector_transposed(Vec3 const & v) const {
+    return Vec3((m[0][0] * v.x) + (m[1][0] * v.y) + (m[2][0] * v.z),
+                (m[0][1] * v.x) + (m[1][1] * v.y) + (m[2][1] * v.z),
+                (m[0][2] * v.x) + (m[1][2] * v.y) + (m[2][2] * v.z));
+}
+
+// transforms all 8 corners of the box and finds the box that fits all of them
+inline Aabb AffineTransform::transform_box(Aabb const & box) const {
+    auto infinity = std::numeric_limits<double>::infinity();
+
+    Point3 min = Point3(infinity, infinity, infinity);
+    Point3 max = Point3(-infinity, -infinity, -infinity);
+
+    for (int i = 0; i < 2; i++) {
+        for (int j = 0; j < 2; j++) {
+            for (int k = 0; k < 2; k++) {
+                // see RotateYTransformer for how this goes through every corner
+                auto corner = Point3(i ? box.xBounds.max : box.xBounds.min,
+                                     j ? box.yBounds.max : box.yBounds.min,
+                                     k ? box.zBounds.max : box.zBounds.min);
+                Point3 transformed = transform_point(corner);
+
+                min = Point3(fmin(min.x, transformed.x), fmin(min.y, transformed.y), fmin(min.z, transformed.z));
+                max = Point3(fmax(max.x, transformed.x), fmax(max.y, transformed.y), fmax(max.z, transformed.z));
+            }
+        }
+    }
+
+    return Aabb(min, max);
+}
+
+// the linear part is a rotation if its columns are all unit length and perpendicular to each other
+inline bool AffineTransform::is_rigid() const {
+    auto const granularity = 1e-9;
+
+    Vec3 columns[3];
+    for (int column = 0; column < 3; column++) {
+        columns[column] = Vec3(m[0][column], m[1][column], m[2][column]);
+    }
+
+    return (fabs(columns[0].length_squared() - 1) < granularity)
+        && (fabs(columns[1].length_squared() - 1) < granularity)
+        && (fabs(columns[2].length_squared() - 1) < granularity)
+        && (fabs(columns[0].dot(columns[1])) < granularity)
+        && (fabs(columns[0].dot(columns[2])) < granularity)
+        && (fabs(columns[1].dot(columns[2])) < granularity);
+}
+
+inline std::ostream & operator<<(std::ostream & out, AffineTransform const & t) {
+    for (int row = 0; row < 3; row++) {
+        out << "[" << t.m[row][0] << " " << t.m[row][1] << " " << t.m[row][2] << " | " << t.m[row][3] << "]";
+    }
+    return out;
+}
+
+#endif
@@ -0,0 +1,378 @@
+// stb_image's functions are defined in this file (see image.h)
+#define STB_IMAGE_IMPLEMENTATION
+#include "image.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "scenes.h"
+
+// microbenchmarks for the intersection, BVH and material kernels, each timed on its own in ns/ray.
+// the rays aren't random: they're captured from rendering the real scenes (a small version of them, starting from a
+// fixed seed, so the same rays are captured on every run as long as the scenes render the same), so the kernels see
+// the same mix of hits, misses and angles as they would in a render. Every kernel is run over its whole set of rays
+// a number of times, and the mean ns/ray is given with its 95% confidence interval across those runs. Usage:
+//     ./bench_kernels [--repeats 20] [--rays 65536]
+
+using BenchClock = std::chrono::steady_clock;
+
+// a ray as it was passed to the world
+class CapturedRay {
+    public:
+        Ray ray;
+        Interval limits;
+};
+
+// a ray that hit something, with what it hit, for the material kernels
+class CapturedHit {
+    public:
+        Ray ray;
+        HitResult result;
+};
+
+// wraps the world to record the rays traced through it while a scene renders. Only maxRays of each kind are kept,
+// picked evenly from all of them (reservoir sampling) once there are more than that, rather than just the first ones,
+// which would all be from the top of the image
+class CapturingHittable : public Hittable {
+    public:
+        size_t maxRays;
+        mutable std::vector<CapturedRay> hitRays;
+        mutable std::vector<CapturedRay> shadowRays;
+        mutable std::vector<CapturedHit> hits;
+
+        CapturingHittable(std::shared_ptr<Hittable> const & target, size_t maxRays) : maxRays(maxRays), _target(target) { }
+
+        virtual bool hit(Ray const & ray, Interval const & rayLimits, HitResult & result) const override {
+            bool didHit = this->_target->hit(ray, rayLimits, result);
+
+            keep(this->hitRays, CapturedRay{ray, rayLimits}, this->_hitRaysSeen);
+            if (didHit) {
+                keep(this->hits, CapturedHit{ray, result}, this->_hitsSeen);
+            }
+
+            return didHit;
+        }
+
+        virtual bool occluded(Ray const & ray, Interval const & rayLimits) const override {
+            keep(this->shadowRays, CapturedRay{ray, rayLimits}, this->_shadowRaysSeen);
+            return this->_target->occluded(ray, rayLimits);
+        }
+
+        virtual Aabb bounding_box() const override {
+            return this->_target->bounding_box();
+        }
+
+    private:
+        std::shared_ptr<Hittable> _target;
+        mutable size_t _hitRaysSeen = 0;
+        mutable size_t _shadowRaysSeen = 0;
+        mutable size_t _hitsSeen = 0;
+        // separate from random_double, so capturing doesn't change the rays the scene traces
+        mutable std::mt19937_64 _generator;
+
+        template <typename T>
+        void keep(std::vector<T> & kept, T const & item, size_t & seen) const {
+            seen++;
+            if (kept.size() < this->maxRays) {
+                kept.push_back(item);
+                return;
+            }
+
+            // the item replaces one that was kept with a chance of maxRays / seen, which keeps every item seen so far
+            // equally likely to be kept
+            size_t replaced = std::uniform_int_distribution<size_t>(0, seen - 1)(this->_generator);
+            if (replaced < this->maxRays) {
+                kept[replaced] = item;
+            }
+        }
+};
+
+// a scene after rendering it, with the rays it traced
+class CapturedScene {
+    public:
+        std::string name;
+        // kept alive for the materials the captured hits point to
+        std::shared_ptr<Scene> scene;
+        std::shared_ptr<Hittable> bvh;
+        std::shared_ptr<CapturingHittable> capture;
+};
+
+CapturedScene capture_scene(std::string const & name, std::function<Scene ()> const & build, size_t maxRays) {
+    seed_random(1);
+
+    // the scenes log what they contain and the camera its progress, none of which is wanted here
+    auto clogBuffer = std::clog.rdbuf(nullptr);
+
+    auto scene = std::make_shared<Scene>(build());
+    scene->camera.imageWidth = 96;
+    scene->camera.aaSamples = 4;
+
+    auto bvh = scene->build_world();
+    auto capture = std::make_shared<CapturingHittable>(bvh, maxRays);
+    scene->camera.render(capture, [](Camera const &) { }, [](Color const &) { });
+
+    std::clog.rdbuf(clogBuffer);
+    std::clog.clear();
+
+    std::cout << "Captured " << capture->hitRays.size() << " rays, " << capture->shadowRays.size() << " shadow rays and "
+              << capture->hits.size() << " hits from " << name << "\n";
+
+    return CapturedScene{name, scene, bvh, capture};
+}
+
+// the two sided 95% critical value of Student's t distribution
+double student_t_95(int degreesOfFreedom) {
+    static double const table[] = { 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042 };
+    if (degreesOfFreedom < 1) {
+        return 0;
+    }
+    if (degreesOfFreedom <= 30) {
+        return table[degreesOfFreedom - 1];
+    }
+    return 1.96;
+}
+
+// summed up and printed at the end so that the compiler can't throw away any of the work
+double checksum = 0;
+int repeats = 20;
+
+// runs kernel(i) for every i below count, repeats times after a warm up, printing the mean ns per call with its 95%
+// confidence interval. kernel returns whether it hit, which is counted up for the hit rate
+template <typename KernelF>
+void time_kernel(std::string const & name, size_t count, KernelF kernel) {
+    if (count == 0) {
+        std::cout << std::left << std::setw(52) << name << "no rays captured\n";
+        return;
+    }
+
+    size_t hits = 0;
+    for (size_t i = 0; i < count; i++) {
+        hits += kernel(i) ? 1 : 0;
+    }
+
+    std::vector<double> nsPerRay;
+    for (int r = 0; r < repeats; r++) {
+        size_t repeatHits = 0;
+        auto start = BenchClock::now();
+        for (size_t i = 0; i < count; i++) {
+            repeatHits += kernel(i) ? 1 : 0;
+        }
+        double elapsed = std::chrono::duration<double, std::nano>(BenchClock::now() - start).count();
+
+        nsPerRay.push_back(elapsed / static_cast<double>(count));
+        checksum += static_cast<double>(repeatHits);
+    }
+
+    double mean = 0;
+    for (double ns : nsPerRay) {
+        mean += ns;
+    }
+    mean /= nsPerRay.size();
+
+    double variance = 0;
+    for (double ns : nsPerRay) {
+        variance += (ns - mean) * (ns - mean);
+    }
+    variance /= std::max<size_t>(1, nsPerRay.size() - 1);
+
+    double halfWidth = student_t_95(static_cast<int>(nsPerRay.size()) - 1) * std::sqrt(variance / nsPerRay.size());
+
+    std::cout << std::left << std::setw(52) << name << std::right << std::fixed << std::setprecision(2)
+              << std::setw(9) << mean << " ns/ray +- " << std::setw(6) << halfWidth << " (95% CI), "
+              << std::setw(7) << count << " rays, " << std::setprecision(1)
+              << std::setw(5) << (100.0 * hits / count) << "% hit\n" << std::defaultfloat;
+}
+
+// the objects of the scene's world that are a T
+template <typename T>
+std::vector<std::shared_ptr<T>> objects_of_type(Scene const & scene) {
+    std::vector<std::shared_ptr<T>> found;
+    for (auto const & object : scene.world.objects) {
+        if (auto typed = std::dynamic_pointer_cast<T>(object)) {
+            found.push_back(typed);
+        }
+    }
+    return found;
+}
+
+char const * material_type_name(MaterialType type) {
+    switch (type) {
+        case MaterialType::Lambertian: return "Lambertian";
+        case MaterialType::Metal: return "Metal";
+        case MaterialType::Dielectric: return "Dielectric";
+        case MaterialType::DiffuseLight: return "DiffuseLight";
+        case MaterialType::IsotropicScatter: return "IsotropicScatter";
+        case MaterialType::Custom:
+        default: return "Custom";
+    }
+}
+
+// a captured ray along with one of the primitives whose bounding box it enters
+template <typename T>
+class PrimitiveTest {
+    public:
+        CapturedRay const * ray;
+        T const * object;
+};
+
+// each ray is tested against every primitive whose bounding box it enters, which are the ones the BVH would test it
+// against (give or take the other primitives in the same leaves). Pairing each ray with any other primitive would
+// mostly time the early out of a ray that's nowhere near it
+template <typename T, typename KernelF>
+void time_primitive(std::string const & name, std::vector<CapturedRay> const & rays, std::vector<std::shared_ptr<T>> const & objects,
+                    KernelF kernel) {
+    if (objects.empty()) {
+        std::cout << std::left << std::setw(52) << name << "no objects in the scene\n";
+        return;
+    }
+
+    std::vector<Aabb> boxes;
+    for (auto const & object : objects) {
+        boxes.push_back(object->bounding_box());
+    }
+
+    std::vector<PrimitiveTest<T>> tests;
+    for (CapturedRay const & captured : rays) {
+        for (size_t i = 0; i < objects.size(); i++) {
+            if (boxes[i].hit(captured.ray, captured.limits)) {
+                tests.push_back(PrimitiveTest<T>{&captured, objects[i].get()});
+            }
+        }
+    }
+
+    time_kernel(name, tests.size(), [&](size_t i) {
+        return kernel(*tests[i].object, *tests[i].ray);
+    });
+}
+
+int main(int argc, char** argv) {
+    size_t maxRays = 1 << 16;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = (i + 1) < argc;
+        if ((strcmp(argv[i], "--repeats") == 0) && hasValue) {
+            repeats = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "--rays") == 0) && hasValue) {
+            maxRays = static_cast<size_t>(atol(argv[++i]));
+        } else {
+            std::cerr << "Unknown argument " << argv[i] << "\n";
+            return 1;
+        }
+    }
+
+    std::cout << "SIMD kernels: " << (simd::enabled() ? "enabled" : "disabled") << "\n";
+
+    CapturedScene spheres = capture_scene("random_spheres", random_spheres, maxRays);
+    CapturedScene cornell = capture_scene("cornell_box", cornell_box, maxRays);
+    CapturedScene smoke = capture_scene("cornell_smoke", cornell_smoke, maxRays);
+    std::cout << "\n";
+
+    auto const & sphereRays = spheres.capture->hitRays;
+    auto const & cornellRays = cornell.capture->hitRays;
+    auto const & cornellShadowRays = cornell.capture->shadowRays;
+
+    // primitives, Sphere and Quad are final so these calls aren't virtual
+    HitResult result;
+    time_primitive("Sphere::hit (random_spheres)", sphereRays, objects_of_type<Sphere>(*spheres.scene),
+                   [&](Sphere const & sphere, CapturedRay const & captured) {
+        return sphere.hit(captured.ray, captured.limits, result);
+    });
+    time_primitive("Sphere::occluded (random_spheres)", sphereRays, objects_of_type<Sphere>(*spheres.scene),
+                   [&](Sphere const & sphere, CapturedRay const & captured) {
+        return sphere.occluded(captured.ray, captured.limits);
+    });
+    time_primitive("Quad::hit (cornell_box)", cornellRays, objects_of_type<Quad>(*cornell.scene),
+                   [&](Quad const & quad, CapturedRay const & captured) {
+        return quad.hit(captured.ray, captured.limits, result);
+    });
+    time_primitive("Quad::occluded (cornell_box shadow rays)", cornellShadowRays, objects_of_type<Quad>(*cornell.scene),
+                   [&](Quad const & quad, CapturedRay const & captured) {
+        return quad.occluded(captured.ray, captured.limits);
+    });
+
+    // bounding boxes, of every object in the scene
+    std::vector<Aabb> boxes;
+    for (auto const & object : spheres.scene->world.objects) {
+        boxes.push_back(object->bounding_box());
+    }
+    time_kernel("Aabb::hit (random_spheres)", sphereRays.size(), [&](size_t i) {
+        return boxes[i % boxes.size()].hit(sphereRays[i].ray, sphereRays[i].limits);
+    });
+    std::cout << "\n";
+
+    // whole worlds, qualified so that only the root's call isn't virtual
+    for (CapturedScene const * captured : { &spheres, &cornell, &smoke }) {
+        auto const & rays = captured->capture->hitRays;
+        auto const & shadowRays = captured->capture->shadowRays;
+
+        auto bvh = std::dynamic_pointer_cast<BvhNode>(captured->bvh);
+        if (bvh != nullptr) {
+            time_kernel("BvhNode::hit (" + captured->name + ")", rays.size(), [&](size_t i) {
+                return bvh->BvhNode::hit(rays[i].ray, rays[i].limits, result);
+            });
+            time_kernel("BvhNode::occluded (" + captured->name + ")", rays.size(), [&](size_t i) {
+                return bvh->BvhNode::occluded(rays[i].ray, rays[i].limits);
+            });
+            time_kernel("BvhNode::occluded (" + captured->name + " shadow rays)", shadowRays.size(), [&](size_t i) {
+                return bvh->BvhNode::occluded(shadowRays[i].ray, shadowRays[i].limits);
+            });
+        }
+
+        HittableList const & list = captured->scene->world;
+        // a flat list of every object is slow enough that fewer rays will do, spread out over all of them rather than
+        // the first ones, since any that were kept without being replaced are still in the order they were traced,
+        // i.e from the top of the image to the bottom
+        size_t listRays = std::min<size_t>(rays.size(), 4096);
+        auto listRay = [&](size_t i) -> CapturedRay const & {
+            return rays[(i * rays.size()) / listRays];
+        };
+        time_kernel("HittableList::hit (" + captured->name + ")", listRays, [&](size_t i) {
+            return list.HittableList::hit(listRay(i).ray, listRay(i).limits, result);
+        });
+        time_kernel("HittableList::occluded (" + captured->name + ")", listRays, [&](size_t i) {
+            return list.HittableList::occluded(listRay(i).ray, listRay(i).limits);
+        });
+    }
+    std::cout << "\n";
+
+    // materials, with the hits split up by the type of material that was hit. The ray is "hit" if it scattered.
+    // the sample kernels include picking their 2 random numbers
+    Color attenuation;
+    Ray scattered;
+    for (MaterialType type : { MaterialType::Lambertian, MaterialType::Metal, MaterialType::Dielectric,
+                               MaterialType::DiffuseLight, MaterialType::IsotropicScatter }) {
+        std::vector<CapturedHit const *> hits;
+        for (CapturedScene const * captured : { &spheres, &cornell, &smoke }) {
+            for (CapturedHit const & hit : captured->capture->hits) {
+                if ((hit.result.material != nullptr) && (hit.result.material->type() == type)) {
+                    hits.push_back(&hit);
+                }
+            }
+        }
+
+        time_kernel(std::string("material_scatter (") + material_type_name(type) + ")", hits.size(), [&](size_t i) {
+            bool didScatter = material_scatter(*hits[i]->result.material, hits[i]->ray, hits[i]->result, attenuation, scattered);
+            checksum += scattered.dir.x;
+            return didScatter;
+        });
+        // what ray_color actually calls, with the numbers from a sampler rather than random_double
+        time_kernel(std::string("material_sample (") + material_type_name(type) + ")", hits.size(), [&](size_t i) {
+            ScatterSample sample;
+            Sample2D u{random_double(), random_double()};
+            bool didScatter = material_sample(*hits[i]->result.material, hits[i]->ray, hits[i]->result, u, sample);
+            checksum += sample.direction.x;
+            return didScatter;
+        });
+    }
+
+    std::cout << "\nchecksum: " << checksum << "\n";
+}
@@ -0,0 +1,55 @@
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include "perlin.h"
+#include "random.h"
+
+// microbenchmark for Perlin noise, one point at a time against batches of points, and turbulence (which batches its
+// octaves). build and run it with and without -DRAY_TRACER_SIMD -mavx to compare the scalar and SIMD blends, see benchmark.sh
+
+using BenchClock = std::chrono::steady_clock;
+
+// runs the function repeats times and prints how long each iteration took on average in nanoseconds
+template <typename F>
+void time_kernel(std::string const & name, size_t iterationsPerRepeat, int repeats, F function) {
+    auto start = BenchClock::now();
+    for (int r = 0; r < repeats; r++) {
+        function();
+    }
+    auto elapsed = std::chrono::duration<double, std::nano>(BenchClock::now() - start).count();
+
+    std::cout << name << ": " << elapsed / (static_cast<double>(iterationsPerRepeat) * repeats) << " ns/op\n";
+}
+
+int main() {
+    std::cout << "SIMD kernels: " << (simd::enabled() ? "enabled" : "disabled") << "\n";
+
+    size_t const count = 1 << 14;
+    int const repeats = 100;
+
+    auto perlin = Perlin();
+    std::vector<Point3> points(count);
+    std::vector<double> out(count);
+    for (size_t i = 0; i < count; i++) {
+        points[i] = Point3(random_double(-100, 100), random_double(-100, 100), random_double(-100, 100));
+    }
+
+    // summed up and printed at the end so that the compiler can't throw away any of the work
+    double checksum = 0;
+
+    time_kernel("noise, one point at a time", count, repeats, [&]() {
+        for (size_t i = 0; i < count; i++) out[i] = perlin.noise(points[i]);
+        checksum += out[count / 2];
+    });
+    time_kernel("noise_batch", count, repeats, [&]() {
+        perlin.noise_batch(points.data(), out.data(), count);
+        checksum += out[count / 2];
+    });
+    time_kernel("turbulence (7 octaves)", count, repeats / 4, [&]() {
+        for (size_t i = 0; i < count; i++) out[i] = perlin.turbulence(points[i]);
+        checksum += out[count / 2];
+    });
+
+    std::cout << "checksum: " << checksum << "\n";
+}
@@ -0,0 +1,130 @@
+// stb_image's functions are defined in this file (see image.h)
+#define STB_IMAGE_IMPLEMENTATION
+#include "image.h"
+
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "vec3.h"
+#include "color.h"
+#include "random.h"
+
+#include "ray.h"
+#include "camera.h"
+#include "sampler.h"
+
+#include "hittable.h"
+#include "material.h"
+#include "sphere.h"
+#include "hittable_list.h"
+#include "bvh_node.h"
+
+// compares how quickly each sampler converges, by rendering a small scene with each of them at a range of sample
+// counts and measuring the error against a reference rendered with many more samples.
+// the scene has depth of field and motion blur, so the lens and time dimensions get used as well as the pixel
+// and bounce ones. Note that RMSE doesn't show what the blue noise sampler is for, which is how the error looks
+// (spread out evenly rather than in clumps) rather than how much of it there is
+
+using BenchClock = std::chrono::steady_clock;
+
+int const imageWidth = 64;
+
+std::shared_ptr<Hittable> sampler_world() {
+    auto world = HittableList();
+
+    world.add(std::make_shared<Sphere>(Point3(0, -1000, 0), 1000, std::make_shared<LambertianMaterial>(Color(0.5, 0.5, 0.5))));
+    world.add(std::make_shared<Sphere>(Point3(0, 1, 0), 1, std::make_shared<LambertianMaterial>(Color(0.7, 0.3, 0.3))));
+    world.add(std::make_shared<Sphere>(Point3(-2.2, 0.5, 1), Point3(-2.2, 1, 1), 0.5,
+                                       std::make_shared<LambertianMaterial>(Color(0.2, 0.6, 0.2))));
+    world.add(std::make_shared<Sphere>(Point3(2.2, 0.7, -1), 0.7, std::make_shared<MetalMaterial>(Color(0.8, 0.8, 0.8), 0.2)));
+
+    return std::make_shared<BvhNode>(world);
+}
+
+Camera sampler_camera(SamplerType samplerType, int samples) {
+    auto camera = Camera();
+    camera.aspectRatio = 4.0 / 3.0;
+    camera.imageWidth = imageWidth;
+    camera.fieldOfView = 30;
+    camera.cameraOrigin = Point3(0, 2, 9);
+    camera.cameraTarget = Point3(0, 1, 0);
+    camera.aperture = 0.3;
+    camera.aaSamples = samples;
+    camera.maxDepth = 10;
+    camera.samplerType = samplerType;
+
+    return camera;
+}
+
+std::vector<Color> render(std::shared_ptr<Hittable> const & world, Camera camera) {
+    seed_random(1);
+    camera.initialize();
+    auto sampler = camera.create_sampler();
+
+    std::vector<Color> pixels;
+    for (int j = 0; j < camera.imageHeight; j++) {
+        for (int i = 0; i < camera.imageWidth; i++) {
+            pixels.push_back(camera.render_pixel(world, i, j, *sampler));
+        }
+    }
+
+    return pixels;
+}
+
+double rmse(std::vector<Color> const & image, std::vector<Color> const & reference) {
+    double squaredError = 0;
+    for (size_t p = 0; p < image.size(); p++) {
+        Color difference = image[p] - reference[p];
+        squaredError += (difference.r * difference.r) + (difference.g * difference.g) + (difference.b * difference.b);
+    }
+
+    return sqrt(squaredError / (3 * image.size()));
+}
+
+int main() {
+    auto world = sampler_world();
+
+    // camera.initialize() logs the settings of every render, which would get in the way of the results
+    std::clog.setstate(std::ios::failbit);
+
+    int const referenceSamples = 4096;
+    auto reference = render(world, sampler_camera(SamplerType::Independent, referenceSamples));
+
+    std::vector<std::pair<std::string, SamplerType>> samplers = {
+        {"independent", SamplerType::Independent},
+        {"stratified", SamplerType::Stratified},
+        {"sobol", SamplerType::Sobol},
+        {"blue noise", SamplerType::BlueNoise}
+    };
+
+    // the blue noise sampler generates its texture the first time it's used, which shouldn't count towards its time
+    auto warmUp = make_sampler(SamplerType::BlueNoise, 1);
+    warmUp->start_sample(0, 0, 0);
+    warmUp->get_1d();
+
+    std::cout << "RMSE against a " << referenceSamples << " spp reference\n"
+              << "efficiency is 1 / (RMSE^2 * seconds), higher is better\n";
+    std::cout << std::left << std::setw(14) << "sampler" << std::setw(6) << "spp" << std::setw(12) << "RMSE"
+              << std::setw(10) << "ms" << "efficiency\n";
+
+    for (auto const & sampler : samplers) {
+        for (int samples : {1, 4, 16, 64, 256}) {
+            auto start = BenchClock::now();
+            auto image = render(world, sampler_camera(sampler.second, samples));
+            double seconds = std::chrono::duration<double>(BenchClock::now() - start).count();
+
+            double error = rmse(image, reference);
+
+            std::cout << std::left << std::setw(14) << sampler.first << std::setw(6) << samples
+                      << std::setw(12) << error << std::setw(10) << seconds * 1000
+                      << 1 / (error * error * seconds) << "\n";
+        }
+    }
+
+    return 0;
+}
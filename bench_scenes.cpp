@@ -0,0 +1,229 @@
+// stb_image's functions are defined in this file (see image.h)
+#define STB_IMAGE_IMPLEMENTATION
+#include "image.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "scenes.h"
+
+// renders every still scene (see scenes.h) and prints how it went as JSON, so that runs can be compared commit to commit.
+// each scene is rendered in its own process, so that its peak memory is its own and it starts with the same random
+// numbers as it would from main.cpp. Usage:
+//     ./bench_scenes [--width 160] [--samples 4] [--scenes 1,5,7] [--output results.json] [--verbose]
+// --width and --samples override every scene's own image width and samples per pixel, 0 leaves them as they are
+
+using BenchClock = std::chrono::steady_clock;
+
+class Options {
+    public:
+        int width = 160;
+        int samples = 4;
+        // empty means every scene
+        std::vector<int> scenes;
+        std::string output;
+        // whether to keep the scenes' own logging and progress on stderr
+        bool verbose = false;
+};
+
+// wraps the world to count the rays traced through it, closest hit rays through hit and shadow rays through occluded
+class CountingHittable : public Hittable {
+    public:
+        mutable uint64_t hitRays = 0;
+        mutable uint64_t occludedRays = 0;
+
+        CountingHittable(std::shared_ptr<Hittable> const & target) : _target(target) { }
+
+        virtual bool hit(Ray const & ray, Interval const & rayLimits, HitResult & result) const override {
+            this->hitRays++;
+            return this->_target->hit(ray, rayLimits, result);
+        }
+
+        virtual bool occluded(Ray const & ray, Interval const & rayLimits) const override {
+            this->occludedRays++;
+            return this->_target->occluded(ray, rayLimits);
+        }
+
+        virtual Aabb bounding_box() const override {
+            return this->_target->bounding_box();
+        }
+
+    private:
+        std::shared_ptr<Hittable> _target;
+};
+
+double milliseconds_since(BenchClock::time_point start) {
+    return std::chrono::duration<double, std::milli>(BenchClock::now() - start).count();
+}
+
+// builds and renders the scene, returning its results as a JSON object
+std::string run_scene(SceneEntry const & entry, Options const & options) {
+    auto buildStart = BenchClock::now();
+    Scene scene = entry.build();
+    double sceneBuildMilliseconds = milliseconds_since(buildStart);
+
+    if (options.width > 0) {
+        scene.camera.imageWidth = options.width;
+    }
+    if (options.samples > 0) {
+        scene.camera.aaSamples = options.samples;
+    }
+
+    auto bvhStart = BenchClock::now();
+    auto world = std::make_shared<CountingHittable>(scene.build_world());
+    double bvhBuildMilliseconds = milliseconds_since(bvhStart);
+
+    // summed up and printed so that the compiler can't throw away any of the work
+    double checksum = 0;
+    auto renderStart = BenchClock::now();
+    scene.camera.render(world, [](Camera const &) { }, [&](Color const & color) {
+        checksum += color.r + color.g + color.b;
+    });
+    double renderMilliseconds = milliseconds_since(renderStart);
+
+    if (scene.rendered) {
+        scene.rendered();
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    uint64_t samples = static_cast<uint64_t>(scene.camera.imageWidth) * scene.camera.imageHeight * scene.camera.aaSamples;
+    uint64_t rays = world->hitRays + world->occludedRays;
+    double renderSeconds = renderMilliseconds / 1000;
+
+    std::ostringstream json;
+    json << "{\"id\": " << entry.id
+         << ", \"name\": \"" << entry.name << "\""
+         << ", \"width\": " << scene.camera.imageWidth
+         << ", \"height\": " << scene.camera.imageHeight
+         << ", \"samples_per_pixel\": " << scene.camera.aaSamples
+         << ", \"scene_build_ms\": " << sceneBuildMilliseconds
+         << ", \"bvh_build_ms\": " << bvhBuildMilliseconds
+         << ", \"render_ms\": " << renderMilliseconds
+         << ", \"rays\": " << rays
+         << ", \"shadow_rays\": " << world->occludedRays
+         << ", \"rays_per_second\": " << rays / renderSeconds
+         << ", \"samples_per_second\": " << samples / renderSeconds
+         // kilobytes on linux
+         << ", \"peak_rss_kb\": " << usage.ru_maxrss
+         << ", \"checksum\": " << checksum << "}";
+    return json.str();
+}
+
+// runs the scene in a child process and reads back what it printed, adding on the wall time of the whole process
+std::string run_scene_process(SceneEntry const & entry, Options const & options) {
+    int pipeEnds[2];
+    if (pipe(pipeEnds) != 0) {
+        return "{\"id\": " + std::to_string(entry.id) + ", \"error\": \"couldn't create a pipe\"}";
+    }
+
+    auto wallStart = BenchClock::now();
+    pid_t child = fork();
+    if (child == 0) {
+        close(pipeEnds[0]);
+        if (!options.verbose) {
+            // the scenes log what they contain and the camera its progress, none of which is wanted here
+            std::clog.rdbuf(nullptr);
+        }
+
+        std::string json = run_scene(entry, options);
+        ssize_t written = write(pipeEnds[1], json.data(), json.size());
+        close(pipeEnds[1]);
+        _exit((written == static_cast<ssize_t>(json.size())) ? 0 : 1);
+    }
+
+    close(pipeEnds[1]);
+    std::string json;
+    char buffer[4096];
+    ssize_t count;
+    while ((count = read(pipeEnds[0], buffer, sizeof(buffer))) > 0) {
+        json.append(buffer, static_cast<size_t>(count));
+    }
+    close(pipeEnds[0]);
+
+    int status = 0;
+    waitpid(child, &status, 0);
+    double wallMilliseconds = milliseconds_since(wallStart);
+
+    if ((child < 0) || !WIFEXITED(status) || (WEXITSTATUS(status) != 0) || json.empty()) {
+        return "{\"id\": " + std::to_string(entry.id) + ", \"name\": \"" + entry.name + "\", \"error\": \"scene failed\"}";
+    }
+
+    // in place of the closing brace
+    json.pop_back();
+    std::ostringstream wall;
+    wall << ", \"wall_ms\": " << wallMilliseconds << "}";
+    return json + wall.str();
+}
+
+std::vector<int> parse_scene_list(std::string const & list) {
+    std::vector<int> scenes;
+    std::istringstream in(list);
+    std::string id;
+    while (std::getline(in, id, ',')) {
+        scenes.push_back(atoi(id.c_str()));
+    }
+    return scenes;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = (i + 1) < argc;
+        if ((strcmp(argv[i], "--width") == 0) && hasValue) {
+            options.width = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "--samples") == 0) && hasValue) {
+            options.samples = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "--scenes") == 0) && hasValue) {
+            options.scenes = parse_scene_list(argv[++i]);
+        } else if ((strcmp(argv[i], "--output") == 0) && hasValue) {
+            options.output = argv[++i];
+        } else if (strcmp(argv[i], "--verbose") == 0) {
+            options.verbose = true;
+        } else {
+            std::cerr << "Unknown argument " << argv[i] << "\n";
+            return 1;
+        }
+    }
+
+    auto totalStart = BenchClock::now();
+    std::ostringstream json;
+    json << "{\n  \"width\": " << options.width << ",\n  \"samples_per_pixel\": " << options.samples
+         << ",\n  \"simd\": " << (simd::enabled() ? "true" : "false") << ",\n  \"scenes\": [";
+
+    bool first = true;
+    for (SceneEntry const & entry : still_scenes()) {
+        bool selected = options.scenes.empty();
+        for (int id : options.scenes) {
+            selected = selected || (id == entry.id);
+        }
+        if (!selected) {
+            continue;
+        }
+
+        std::cerr << "Benchmarking scene " << entry.id << " (" << entry.name << ")\n" << std::flush;
+        json << (first ? "\n    " : ",\n    ") << run_scene_process(entry, options);
+        first = false;
+    }
+
+    json << "\n  ],\n  \"total_wall_ms\": " << milliseconds_since(totalStart) << "\n}\n";
+
+    if (options.output.empty()) {
+        std::cout << json.str();
+    } else {
+        std::ofstream(options.output) << json.str();
+    }
+
+    return 0;
+}
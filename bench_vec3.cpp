@@ -0,0 +1,131 @@
+// stb_image's functions are defined in this file (see image.h)
+#define STB_IMAGE_IMPLEMENTATION
+#include "image.h"
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "vec3.h"
+#include "color.h"
+#include "random.h"
+
+#include "ray.h"
+
+#include "hittable.h"
+#include "material.h"
+#include "sphere.h"
+#include "hittable_list.h"
+#include "bvh_node.h"
+#include "quad.h"
+
+// microbenchmark for the Vec3/Color kernels and the ray_color hot path that uses them.
+// build and run it with and without -DRAY_TRACER_SIMD to compare the scalar and SIMD versions, see benchmark.sh
+
+using BenchClock = std::chrono::steady_clock;
+
+// runs the function repeats times and prints how long each iteration took on average in nanoseconds
+template <typename F>
+void time_kernel(std::string const & name, size_t iterationsPerRepeat, int repeats, F function) {
+    auto start = BenchClock::now();
+    for (int r = 0; r < repeats; r++) {
+        function();
+    }
+    auto elapsed = std::chrono::duration<double, std::nano>(BenchClock::now() - start).count();
+
+    std::cout << name << ": " << elapsed / (static_cast<double>(iterationsPerRepeat) * repeats) << " ns/op\n";
+}
+
+std::shared_ptr<Hittable> simple_lights_world() {
+    auto world = HittableList();
+
+    world.add(std::make_shared<Sphere>(Point3(0, 2, 0), 2, std::make_shared<LambertianMaterial>(Color(0.2, 0.2, 1.0))));
+    world.add(std::make_shared<Sphere>(Point3(-3, 1, 2), 1, std::make_shared<MetalMaterial>(Color(0.7, 0.6, 0.5), 0.1)));
+    world.add(std::make_shared<Sphere>(Point3(2, 1, 3), 1, std::make_shared<DielectricMaterial>(1.5)));
+    world.add(std::make_shared<Quad>(Point3(-10, 0, -10), Vec3(0, 0, 20), Vec3(20, 0, 0),
+                                     std::make_shared<LambertianMaterial>(Color(0.8, 0.8, 0.8))));
+    world.add(std::make_shared<Quad>(Point3(3, 2, -2), Vec3(2, 0, 0), Vec3(0, 2, 0),
+                                     std::make_shared<DiffuseLightMaterial>(Color(4, 4, 4))));
+
+    return std::make_shared<BvhNode>(world);
+}
+
+int main() {
+    std::cout << "SIMD kernels: " << (simd::enabled() ? "enabled" : "disabled") << "\n";
+
+    size_t const count = 1 << 16;
+    int const repeats = 200;
+
+    std::vector<Vec3> a(count), b(count), out(count);
+    std::vector<double> dots(count);
+    std::vector<Color> colorsA(count), colorsB(count), colorsOut(count);
+
+    for (size_t i = 0; i < count; i++) {
+        a[i] = Vec3(random_double(-1, 1), random_double(-1, 1), random_double(-1, 1));
+        b[i] = Vec3(random_double(-1, 1), random_double(-1, 1), random_double(-1, 1));
+        colorsA[i] = Color::random();
+        colorsB[i] = Color::random();
+    }
+
+    // summed up and printed at the end so that the compiler can't throw away any of the work
+    double checksum = 0;
+
+    time_kernel("Vec3 +", count, repeats, [&]() {
+        for (size_t i = 0; i < count; i++) out[i] = a[i] + b[i];
+        checksum += out[count / 2].x;
+    });
+    time_kernel("Vec3 dot", count, repeats, [&]() {
+        for (size_t i = 0; i < count; i++) dots[i] = a[i].dot(b[i]);
+        checksum += dots[count / 2];
+    });
+    time_kernel("Vec3 cross", count, repeats, [&]() {
+        for (size_t i = 0; i < count; i++) out[i] = a[i].cross(b[i]);
+        checksum += out[count / 2].y;
+    });
+    time_kernel("Vec3 unit", count, repeats, [&]() {
+        for (size_t i = 0; i < count; i++) out[i] = a[i].unit();
+        checksum += out[count / 2].z;
+    });
+    time_kernel("Color *", count, repeats, [&]() {
+        for (size_t i = 0; i < count; i++) colorsOut[i] = colorsA[i] * colorsB[i];
+        checksum += colorsOut[count / 2].g;
+    });
+
+    time_kernel("add_vec3s", count, repeats, [&]() {
+        add_vec3s(a.data(), b.data(), out.data(), count);
+        checksum += out[count / 2].x;
+    });
+    time_kernel("dot_vec3s", count, repeats, [&]() {
+        dot_vec3s(a.data(), b.data(), dots.data(), count);
+        checksum += dots[count / 2];
+    });
+    time_kernel("unit_vec3s", count, repeats, [&]() {
+        unit_vec3s(a.data(), out.data(), count);
+        checksum += out[count / 2].z;
+    });
+    time_kernel("mul_colors", count, repeats, [&]() {
+        mul_colors(colorsA.data(), colorsB.data(), colorsOut.data(), count);
+        checksum += colorsOut[count / 2].g;
+    });
+
+    // the ray_color hot path, with a fixed set of rays shot from roughly where the simple lights camera sits
+    auto world = simple_lights_world();
+    size_t const rayCount = 20000;
+    std::vector<Ray> rays(rayCount);
+    for (size_t i = 0; i < rayCount; i++) {
+        auto target = Point3(random_double(-4, 4), random_double(0, 5), random_double(-4, 4));
+        auto origin = Point3(6, 3, 6);
+        rays[i] = Ray(origin, target - origin, random_double());
+    }
+
+    time_kernel("ray_color", rayCount, 5, [&]() {
+        Color total;
+        for (auto const & ray : rays) total = total + ray_color(ray, world, 50, Color(0, 0, 0));
+        checksum += total.r;
+    });
+
+    std::cout << "checksum: " << checksum << "\n";
+
+    return 0;
+}
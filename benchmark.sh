@@ -0,0 +1,7 @@
+SOURCE=`find . -name bench_\*.cpp`
+
+for BENCH in $SOURCE; do
+    NAME=`basename $BENCH .cpp`
+
+    g++ $BENCH -o $NAME -Wall -Wextra -std=c++17 -O2 -pthread $@ && ./$NAME
+done
@@ -1,3 +1,3 @@
-SOURCE=`find . -name \*.cpp -and -not -name test_\*`
+SOURCE=`find . -name \*.cpp -and -not -name test_\* -and -not -name bench_\*`
 
-g++ $SOURCE -o ray-tracer -Wall -Wextra -std=c++17 $@
+g++ $SOURCE -o ray-tracer -Wall -Wextra -std=c++17 -pthread $@
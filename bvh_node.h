@@ -2,105 +2,404 @@
 #define BVH_NODE_H
 
 #include <algorithm>
+#include <memory>
+#include <vector>
 
 #include "interval.h"
 #include "hittable.h"
+#include "hittable_list.h"
+#include "primitive_list.h"
 #include "random.h"
+#include "stats.h"
 
-// represents a node in the BVH tree, which is a hittable AABB that encompasses up to two other child hittable objects
-class BvhNode : public Hittable {
+class BvhBuildOptions {
+    public:
+        // whether nodes whose primitives move a lot while the camera's shutter is open are split into two nodes,
+        // one for the first half of the time range and one for the second, each containing all of the node's
+        // primitives but with boxes that only need to cover where they are during their half
+        bool splitOnTime = false;
+        // a node is split on time when the box around everywhere its primitives go is this many times bigger
+        // (by surface area) than the boxes around where they are at the start and end of its time range
+        double timeSplitThreshold = 2.0;
+        // how many times the time range can be halved, each split makes a copy of the subtree below it
+        int maxTimeSplits = 2;
+
+        // interpolating a node's box costs a bit more than testing a still one, so nodes only use interpolated
+        // boxes when the box around everywhere their primitives go is at least this many times bigger (by
+        // surface area) than the boxes at the start and end of their time range
+        double interpolateThreshold = 1.2;
+};
+
+// represents a node in the BVH tree, which is a hittable AABB that encompasses up to two other children
+// the children are either other BVH nodes, or at the bottom of the tree, primitives in a PrimitiveList
+// which are referenced by their type and index so that intersecting with them doesn't need a virtual call.
+// for motion blur, each node also has a box for where its primitives are at the start and at the end of its
+// time range, and rays are tested against the box in between the two at the ray's time
+class BvhNode final : public Hittable {
     public:
         // a special constructor that will open up the list of hittables and subdivide them into more BVH nodes
-        BvhNode(HittableList const & inputList);
+        BvhNode(HittableList const & inputList, BvhBuildOptions const & options = BvhBuildOptions());
         // startIndex is inclusive, endIndex is exclusive (i.e after the last object by 1)
-        BvhNode(std::vector<std::shared_ptr<Hittable>> const & srcObjects, size_t startIndex, size_t endIndex);
+        BvhNode(std::vector<std::shared_ptr<Hittable>> const & srcObjects, size_t startIndex, size_t endIndex,
+                BvhBuildOptions const & options = BvhBuildOptions());
+        // builds a tree over every primitive in the list
+        BvhNode(std::shared_ptr<PrimitiveList const> const & primitives, BvhBuildOptions const & options = BvhBuildOptions());
 
         virtual bool hit(Ray const & ray, Interval const & rayLimits, HitResult & result) const override;
 
+        virtual bool occluded(Ray const & ray, Interval const & rayLimits) const override;
+
         virtual Aabb bounding_box() const override;
 
+        virtual Aabb bounding_box_at(double time) const override;
+
+        // recalculates the bounding boxes of every node from the bottom of the tree up, for when the primitives
+        // in the tree have moved. This keeps the tree correct, but the more the primitives move the less
+        // efficient it'll get, since the structure of the tree stays the same, see sah_cost
+        void refit();
+
+        // an estimate of how expensive it is to find the intersection of a ray with this tree, using the
+        // surface area heuristic (SAH). The surface area of a node relative to the root is roughly the probability
+        // that a ray which hits the root will also hit the node, and every node a ray hits costs a bounding box
+        // test plus a test for every primitive directly under it
+        double sah_cost() const;
+
+        // the primitives the tree was built over
+        std::shared_ptr<PrimitiveList const> const & primitives() const;
+
     private:
-        std::shared_ptr<Hittable> _leftNode;
-        std::shared_ptr<Hittable> _rightNode;
+        // the primitives referenced by the leaves of the tree, shared by every node in the tree
+        std::shared_ptr<PrimitiveList const> _primitives;
+
+        // when a child node is null, the child is instead the primitive next to it
+        std::shared_ptr<BvhNode> _leftNode;
+        std::shared_ptr<BvhNode> _rightNode;
+        PrimitiveRef _leftPrimitive;
+        PrimitiveRef _rightPrimitive;
+        // whether the node contains only one primitive, in which case it's the left one
+        bool _hasSinglePrimitive = false;
+        // whether the node has been split on time, in which case both child nodes have the same primitives,
+        // the left one for the first half of the time range and the right one for the second half
+        bool _isTimeSplit = false;
+        // whether the primitives move during the time range, see _startBoundingBox.
+        // kept next to the other flags so that still nodes only need the first part of the node to be in cache
+        bool _isMoving = false;
+
+        // the box around everywhere the primitives go during the time range
         Aabb _boundingBox;
 
-        static bool box_x_compare(std::shared_ptr<Hittable> const & a, std::shared_ptr<Hittable> const & b);
-        static bool box_y_compare(std::shared_ptr<Hittable> const & a, std::shared_ptr<Hittable> const & b);
-        static bool box_z_compare(std::shared_ptr<Hittable> const & a, std::shared_ptr<Hittable> const & b);
+        // the part of the shutter's time that this node is for, this is only ever smaller than 0 to 1 under
+        // a node that's been split on time
+        Interval _timeRange = Interval(0, 1);
+        double _inverseTimeRangeSize = 1;
+        // the boxes around the primitives at the start and end of the time range, rays are tested against
+        // the box interpolated between them, unless the primitives don't move at all
+        Aabb _startBoundingBox;
+        Aabb _endBoundingBox;
+
+        // the constructor used for every node in the tree, the refs between startIndex and endIndex get sorted
+        BvhNode(std::shared_ptr<PrimitiveList const> const & primitives, std::vector<PrimitiveRef> & refs,
+                size_t startIndex, size_t endIndex, Interval const & timeRange,
+                BvhBuildOptions const & options, int timeSplitsLeft);
+
+        // only used by refit, since the nodes don't otherwise keep the options they were built with
+        double _interpolateThreshold = 1.2;
+
+        // recalculates this node's boxes from its children's
+        void update_bounding_boxes();
+
+        // whether the primitives between startIndex and endIndex move enough during the time range to be worth
+        // splitting on time
+        static bool should_split_on_time(PrimitiveList const & primitives, std::vector<PrimitiveRef> const & refs,
+                                         size_t startIndex, size_t endIndex, Interval const & timeRange,
+                                         double threshold);
+
+        bool hit_child(std::shared_ptr<BvhNode> const & node, PrimitiveRef const & primitive,
+                       Ray const & ray, Interval const & rayLimits, HitResult & result) const;
+
+        bool child_occluded(std::shared_ptr<BvhNode> const & node, PrimitiveRef const & primitive,
+                            Ray const & ray, Interval const & rayLimits) const;
+
+        Aabb child_bounding_box(std::shared_ptr<BvhNode> const & node, PrimitiveRef const & primitive) const;
+
+        Aabb child_bounding_box_at(std::shared_ptr<BvhNode> const & node, PrimitiveRef const & primitive, double time) const;
+
+        static Interval const & axis_bounds(Aabb const & box, int axis);
+
+        // the sum of the surface area of every node in this subtree, weighted by the cost of hitting that node
+        double weighted_surface_area() const;
 };
 
 // ------
 
-BvhNode::BvhNode(HittableList const & srcHittables) : BvhNode(srcHittables.objects, 0, srcHittables.objects.size()) { }
+inline BvhNode::BvhNode(HittableList const & srcHittables, BvhBuildOptions const & options)
+                 : BvhNode(srcHittables.objects, 0, srcHittables.objects.size(), options) { }
+
+inline BvhNode::BvhNode(std::vector<std::shared_ptr<Hittable>> const & srcObjects, size_t startIndex, size_t endIndex,
+                 BvhBuildOptions const & options)
+                 : BvhNode(std::make_shared<PrimitiveList>(srcObjects, startIndex, endIndex), options) { }
 
-BvhNode::BvhNode(std::vector<std::shared_ptr<Hittable>> const & srcObjects, size_t startIndex, size_t endIndex) {
-    LOG(
-        std::clog << "Creating BVH node from indices " << startIndex << " and " << endIndex << "\n";
-    )
+inline BvhNode::BvhNode(std::shared_ptr<PrimitiveList const> const & primitives, BvhBuildOptions const & options)
+                 : _primitives(primitives) {
+    // the refs get re-ordered as the tree is built, so work on a copy
+    auto refs = primitives->refs;
 
-    auto objects = srcObjects; // create a copy of the array, but one that references the same objects
+    *this = BvhNode(primitives, refs, 0, refs.size(), Interval(0, 1), options, options.splitOnTime ? options.maxTimeSplits : 0);
+}
+
+inline BvhNode::BvhNode(std::shared_ptr<PrimitiveList const> const & primitives, std::vector<PrimitiveRef> & refs,
+                 size_t startIndex, size_t endIndex, Interval const & timeRange,
+                 BvhBuildOptions const & options, int timeSplitsLeft)
+                 : _primitives(primitives), _timeRange(timeRange), _inverseTimeRangeSize(1 / timeRange.size()),
+                   _interpolateThreshold(options.interpolateThreshold) {
+    auto numOfObjectsToSplit = endIndex - startIndex;
+
+    if ((numOfObjectsToSplit > 1) && (timeSplitsLeft > 0)
+        && should_split_on_time(*primitives, refs, startIndex, endIndex, timeRange, options.timeSplitThreshold)) {
+        // both children get every primitive, and share the same range of refs, which each of them sorts in place.
+        // that's fine since the left child's subtree is finished (its leaves copy the refs they end up with) before
+        // the right child starts sorting them again
+        double middleTime = (timeRange.min + timeRange.max) / 2;
+
+        _isTimeSplit = true;
+        _leftNode = std::shared_ptr<BvhNode>(new BvhNode(primitives, refs, startIndex, endIndex,
+                                                         Interval(timeRange.min, middleTime), options, timeSplitsLeft - 1));
+        _rightNode = std::shared_ptr<BvhNode>(new BvhNode(primitives, refs, startIndex, endIndex,
+                                                          Interval(middleTime, timeRange.max), options, timeSplitsLeft - 1));
+
+        update_bounding_boxes();
+        return;
+    }
 
     // choose an axis that we want to sort the objects by before we split them
     int chosenAxis = random_int(0, 2);
-    auto comparator = chosenAxis == 0 ? BvhNode::box_x_compare
-                    : chosenAxis == 1 ? BvhNode::box_y_compare
-                                      : BvhNode::box_z_compare;
+    auto comparator = [&primitives, chosenAxis](PrimitiveRef const & a, PrimitiveRef const & b) {
+        return axis_bounds(primitives->bounding_box(a), chosenAxis).min < axis_bounds(primitives->bounding_box(b), chosenAxis).min;
+    };
 
-    auto numOfObjectsToSplit = endIndex - startIndex;
     if (numOfObjectsToSplit == 1) {
         // there's only one object to be contained by this node
-        _leftNode = _rightNode = srcObjects[startIndex];
+        _leftPrimitive = _rightPrimitive = refs[startIndex];
+        _hasSinglePrimitive = true;
     } else if (numOfObjectsToSplit == 2) {
         // there's two objects to be contained by this node, lets put one on the left and one on the right
         // but lets keep the order cause why not
-        if (comparator(srcObjects[startIndex], srcObjects[startIndex + 1])) {
-            _leftNode = srcObjects[startIndex];
-            _rightNode = srcObjects[startIndex + 1];
+        if (comparator(refs[startIndex], refs[startIndex + 1])) {
+            _leftPrimitive = refs[startIndex];
+            _rightPrimitive = refs[startIndex + 1];
         } else {
-            _leftNode = srcObjects[startIndex + 1];
-            _rightNode = srcObjects[startIndex];
+            _leftPrimitive = refs[startIndex + 1];
+            _rightPrimitive = refs[startIndex];
         }
     } else {
         // there's more than two objects to be contained by this node, so we'll have to create more BVH nodes
         // as children
-        std::sort(objects.begin() + startIndex, objects.begin() + endIndex, comparator);
+        std::sort(refs.begin() + startIndex, refs.begin() + endIndex, comparator);
 
         size_t middleIndex = startIndex + (numOfObjectsToSplit / 2);
-        _leftNode = std::make_shared<BvhNode>(objects, startIndex, middleIndex);
-        _rightNode = std::make_shared<BvhNode>(objects, middleIndex, endIndex);
+        _leftNode = std::shared_ptr<BvhNode>(new BvhNode(primitives, refs, startIndex, middleIndex,
+                                                         timeRange, options, timeSplitsLeft));
+        _rightNode = std::shared_ptr<BvhNode>(new BvhNode(primitives, refs, middleIndex, endIndex,
+                                                          timeRange, options, timeSplitsLeft));
     }
 
-    this->_boundingBox = Aabb(this->_leftNode->bounding_box(), this->_rightNode->bounding_box());
+    update_bounding_boxes();
 }
 
-bool BvhNode::hit(Ray const & ray, Interval const & rayLimits, HitResult & result) const {
-    if (!this->_boundingBox.hit(ray, rayLimits)) {
+inline bool BvhNode::hit(Ray const & ray, Interval const & rayLimits, HitResult & result) const {
+    stats::count_bvh_node();
+
+    // there's only the one call to Aabb::hit, whichever box is being tested, which keeps this function small
+    // enough for the compiler to inline the recursion the same as it would without motion blur
+    Aabb const * box = &this->_boundingBox;
+
+    Aabb interpolatedBox;
+    if (this->_isMoving) {
+        if (this->_isTimeSplit) {
+            // only one of the children is for the moment in time the ray is at
+            return (ray.time < this->_leftNode->_timeRange.max ? this->_leftNode : this->_rightNode)->hit(ray, rayLimits, result);
+        }
+
+        // the ray's time is always within the node's time range, so there's no need to clamp like bounding_box_at
+        double t = (ray.time - this->_timeRange.min) * this->_inverseTimeRangeSize;
+        interpolatedBox = this->_startBoundingBox.interpolate(this->_endBoundingBox, t);
+        box = &interpolatedBox;
+    }
+
+    if (!box->hit(ray, rayLimits)) {
         return false;
     }
 
     // since the left and right nodes can overlap, we must compute both, not just one side
-    bool hitLeft = this->_leftNode->hit(ray, rayLimits, result);
+    bool hitLeft = hit_child(this->_leftNode, this->_leftPrimitive, ray, rayLimits, result);
+    if (this->_hasSinglePrimitive) {
+        return hitLeft;
+    }
+
     // if we hit something in the left subtree, then we can re-use the ray max distance here to save even
     // more time processing the nodes in this subtree
-    bool hitRight = this->_rightNode->hit(ray, Interval(rayLimits.min, hitLeft ? result.t : rayLimits.max), result);
+    bool hitRight = hit_child(this->_rightNode, this->_rightPrimitive,
+                              ray, Interval(rayLimits.min, hitLeft ? result.t : rayLimits.max), result);
 
     return hitLeft || hitRight;
 }
 
-Aabb BvhNode::bounding_box() const {
+// finds which box to test the same way as hit, but since any hit will do, the right side only needs checking
+// if nothing was found on the left
+inline bool BvhNode::occluded(Ray const & ray, Interval const & rayLimits) const {
+    stats::count_bvh_node();
+
+    Aabb const * box = &this->_boundingBox;
+
+    Aabb interpolatedBox;
+    if (this->_isMoving) {
+        if (this->_isTimeSplit) {
+            return (ray.time < this->_leftNode->_timeRange.max ? this->_leftNode : this->_rightNode)->occluded(ray, rayLimits);
+        }
+
+        double t = (ray.time - this->_timeRange.min) * this->_inverseTimeRangeSize;
+        interpolatedBox = this->_startBoundingBox.interpolate(this->_endBoundingBox, t);
+        box = &interpolatedBox;
+    }
+
+    if (!box->hit(ray, rayLimits)) {
+        return false;
+    }
+
+    if (child_occluded(this->_leftNode, this->_leftPrimitive, ray, rayLimits)) {
+        return true;
+    }
+
+    return !this->_hasSinglePrimitive && child_occluded(this->_rightNode, this->_rightPrimitive, ray, rayLimits);
+}
+
+inline Aabb BvhNode::bounding_box() const {
     return this->_boundingBox;
 }
 
-bool BvhNode::box_x_compare(std::shared_ptr<Hittable> const & a, std::shared_ptr<Hittable> const & b) {
-    return a->bounding_box().xBounds.min < b->bounding_box().xBounds.min;
+inline Aabb BvhNode::bounding_box_at(double time) const {
+    if (this->_isTimeSplit) {
+        return (time < this->_leftNode->_timeRange.max ? this->_leftNode : this->_rightNode)->bounding_box_at(time);
+    }
+
+    if (!this->_isMoving) {
+        return this->_boundingBox;
+    }
+
+    double t = Interval(0, 1).clamp((time - this->_timeRange.min) * this->_inverseTimeRangeSize);
+    return this->_startBoundingBox.interpolate(this->_endBoundingBox, t);
+}
+
+inline void BvhNode::refit() {
+    if (this->_leftNode) {
+        this->_leftNode->refit();
+    }
+    if (this->_rightNode) {
+        this->_rightNode->refit();
+    }
+
+    update_bounding_boxes();
+}
+
+inline void BvhNode::update_bounding_boxes() {
+    this->_boundingBox = Aabb(child_bounding_box(this->_leftNode, this->_leftPrimitive),
+                              child_bounding_box(this->_rightNode, this->_rightPrimitive));
+
+    this->_startBoundingBox = Aabb(child_bounding_box_at(this->_leftNode, this->_leftPrimitive, this->_timeRange.min),
+                                   child_bounding_box_at(this->_rightNode, this->_rightPrimitive, this->_timeRange.min));
+    this->_endBoundingBox = Aabb(child_bounding_box_at(this->_leftNode, this->_leftPrimitive, this->_timeRange.max),
+                                 child_bounding_box_at(this->_rightNode, this->_rightPrimitive, this->_timeRange.max));
+
+    // nodes split on time always count as moving, so that hit() only has to check whether a node is moving
+    // before going through the usual path for still nodes
+    double stillArea = (this->_startBoundingBox.surface_area() + this->_endBoundingBox.surface_area()) / 2;
+    this->_isMoving = this->_isTimeSplit
+                   || (this->_boundingBox.surface_area() > stillArea * this->_interpolateThreshold);
+}
+
+inline bool BvhNode::should_split_on_time(PrimitiveList const & primitives, std::vector<PrimitiveRef> const & refs,
+                                   size_t startIndex, size_t endIndex, Interval const & timeRange,
+                                   double threshold) {
+    Aabb startBox;
+    Aabb endBox;
+
+    for (size_t i = startIndex; i < endIndex; i++) {
+        startBox = Aabb(startBox, primitives.bounding_box_at(refs[i], timeRange.min));
+        endBox = Aabb(endBox, primitives.bounding_box_at(refs[i], timeRange.max));
+    }
+
+    double stillArea = (startBox.surface_area() + endBox.surface_area()) / 2;
+    double movingArea = Aabb(startBox, endBox).surface_area();
+
+    return (stillArea > 0) && (movingArea > stillArea * threshold);
+}
+
+inline double BvhNode::sah_cost() const {
+    return weighted_surface_area() / this->_boundingBox.surface_area();
+}
+
+inline std::shared_ptr<PrimitiveList const> const & BvhNode::primitives() const {
+    return this->_primitives;
+}
+
+inline double BvhNode::weighted_surface_area() const {
+    if (this->_isTimeSplit) {
+        // a ray only ever goes into one of the two children, each of which cover half of the rays
+        return (this->_leftNode->weighted_surface_area() + this->_rightNode->weighted_surface_area()) / 2;
+    }
+
+    int primitiveTests = this->_hasSinglePrimitive ? 1 : ((this->_leftNode ? 0 : 1) + (this->_rightNode ? 0 : 1));
+
+    double total = this->_boundingBox.surface_area() * (1 + primitiveTests);
+
+    if (this->_leftNode) {
+        total += this->_leftNode->weighted_surface_area();
+    }
+    if (this->_rightNode) {
+        total += this->_rightNode->weighted_surface_area();
+    }
+
+    return total;
+}
+
+inline bool BvhNode::hit_child(std::shared_ptr<BvhNode> const & node, PrimitiveRef const & primitive,
+                        Ray const & ray, Interval const & rayLimits, HitResult & result) const {
+    if (node) {
+        return node->hit(ray, rayLimits, result);
+    }
+
+    return this->_primitives->hit(primitive, ray, rayLimits, result);
+}
+
+inline bool BvhNode::child_occluded(std::shared_ptr<BvhNode> const & node, PrimitiveRef const & primitive,
+                             Ray const & ray, Interval const & rayLimits) const {
+    if (node) {
+        return node->occluded(ray, rayLimits);
+    }
+
+    return this->_primitives->occluded(primitive, ray, rayLimits);
 }
 
-bool BvhNode::box_y_compare(std::shared_ptr<Hittable> const & a, std::shared_ptr<Hittable> const & b) {
-    return a->bounding_box().yBounds.min < b->bounding_box().yBounds.min;
+inline Aabb BvhNode::child_bounding_box(std::shared_ptr<BvhNode> const & node, PrimitiveRef const & primitive) const {
+    if (node) {
+        return node->bounding_box();
+    }
+
+    return this->_primitives->bounding_box(primitive);
+}
+
+inline Aabb BvhNode::child_bounding_box_at(std::shared_ptr<BvhNode> const & node, PrimitiveRef const & primitive, double time) const {
+    if (node) {
+        return node->bounding_box_at(time);
+    }
+
+    return this->_primitives->bounding_box_at(primitive, time);
 }
 
-bool BvhNode::box_z_compare(std::shared_ptr<Hittable> const & a, std::shared_ptr<Hittable> const & b) {
-    return a->bounding_box().zBounds.min < b->bounding_box().zBounds.min;
+inline Interval const & BvhNode::axis_bounds(Aabb const & box, int axis) {
+    return axis == 0 ? box.xBounds
+         : axis == 1 ? box.yBounds
+                     : box.zBounds;
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -1,10 +1,14 @@
 #ifndef CAMERA_H
 #define CAMERA_H
 
+#include <functional>
+#include <memory>
+
 #include "vec3.h"
 #include "random.h"
-#include "logger.h"
+#include "trace.h"
 #include "ray.h"
+#include "sampler.h"
 
 class Camera {
     public:
@@ -37,7 +41,34 @@ class Camera {
 
         Color backgroundColor = Color(0.7, 0.8, 1.0);
 
-        void render(std::shared_ptr<Hittable> const & world, void (*postInitialize) (Camera const &), void (*writeColorCallback) (Color const &));
+        // when there are lights in here, they're sampled directly at every bounce, see ray_color
+        LightList lights;
+
+        // where the numbers for picking the point in the pixel, the point on the lens, the time and the bounces
+        // come from, see Sampler
+        SamplerType samplerType = SamplerType::Independent;
+        // samplers other than Independent give the same numbers every time for the same seed
+        uint32_t samplerSeed = 0;
+
+        void render(std::shared_ptr<Hittable> const & world,
+                    std::function<void (Camera const &)> const & postInitialize,
+                    std::function<void (Color const &)> const & writeColorCallback);
+
+        // for rendering pixels individually rather than using render(), e.g to split the image up between threads.
+        // initialize() must be called once after setting up the camera and before rendering any pixels
+        void initialize();
+
+        // the anti-aliased color of the pixel at column i and row j, where row 0 is the bottom of the image.
+        // doesn't change the camera so can be called from multiple threads at once
+        Color render_pixel(std::shared_ptr<Hittable> const & world, int i, int j) const;
+
+        // the same as the other render_pixel, using the given sampler rather than creating one for the pixel.
+        // a sampler starts again for every sample, so one from create_sampler can be reused for any number of pixels,
+        // but only by one thread at a time
+        Color render_pixel(std::shared_ptr<Hittable> const & world, int i, int j, Sampler & sampler) const;
+
+        // a sampler of the camera's samplerType, for its aaSamples and samplerSeed
+        std::unique_ptr<Sampler> create_sampler() const;
 
     private:
         // u, v, w are camera axis, which are different from the world axis if the camera is rotated
@@ -71,19 +102,23 @@ class Camera {
         // some other information in the rendering loop, we can traverse the viewport
         // from left to right, and up to down
         Vec3 _lowerLeftCorner;
+        // the angle between the rays going through neighbouring pixels, see RayCone
+        double _pixelSpreadAngle;
 
-        Ray get_ray(int i, int j) const;
-
-        void initialize();
+        Ray get_ray(int i, int j, Sampler & sampler) const;
 };
 
 // ------
 
-void Camera::render(std::shared_ptr<Hittable> const & world, void (*postInitialize) (Camera const &), void (*writeColorCallback) (Color const &)) {
+inline void Camera::render(std::shared_ptr<Hittable> const & world,
+                    std::function<void (Camera const &)> const & postInitialize,
+                    std::function<void (Color const &)> const & writeColorCallback) {
     initialize();
 
     postInitialize(*this);
 
+    auto sampler = create_sampler();
+
     // from top to bottom, left to right
     for (int j = imageHeight - 1; j >= 0; --j) { // from height - 1 -> 0
         std::clog << "\rScanlines remaining: " << j << std::flush;
@@ -92,39 +127,10 @@ void Camera::render(std::shared_ptr<Hittable> const & world, void (*postInitiali
         // std::this_thread::sleep_for(50ms);
 
         for (int i = 0; i < imageWidth; ++i) { // from 0 -> width - 1
-            LOGGER_ENABLED = false;
-            // uncomment the lines below and insert the pixel values for the rectangle you wish to debug
-            // and all log lines will be printed during the calculation of that pixel value
-            // if ((j >= 110) && (j <= 113)) {
-            //     if ((i >= 120) && (i <= 210)) {
-            //         LOGGER_ENABLED = true;
-            //         std::clog << "\n" << "----" << "\n";
-            //     }
-            // }
-
-            LOG(
-                std::clog << "Pixel " << i << " " << j << "\n";
-            )
-
-            // this anti-aliasing implementation relies on taking random samples
-            // of color and average them all to get the color for this pixel
-            Color cumulativeColor = Color(0, 0, 0);
-            for (int s = 0; s < aaSamples; ++s) {
-                LOG(
-                    std::clog << "Pixel sample " << s << "\n";
-                )
-
-                Ray r = get_ray(i, j);
-
-                cumulativeColor = cumulativeColor + ray_color(r, world, maxDepth, backgroundColor);
-            }
-
-
-            auto antiAliasedColor = Color(cumulativeColor.r / aaSamples,
-                                          cumulativeColor.g / aaSamples,
-                                          cumulativeColor.b / aaSamples);
-
-            writeColorCallback(antiAliasedColor);
+            // render_pixel starts tracing the pixel if it's one of the ones being traced (see trace.h), which carries
+            // on until here so that the color written for it is traced too
+            writeColorCallback(render_pixel(world, i, j, *sampler));
+            trace::end_pixel();
         }
     }
 
@@ -132,27 +138,67 @@ void Camera::render(std::shared_ptr<Hittable> const & world, void (*postInitiali
 
 }
 
-Ray Camera::get_ray(int i, int j) const {
+inline Color Camera::render_pixel(std::shared_ptr<Hittable> const & world, int i, int j) const {
+    auto sampler = create_sampler();
+    return render_pixel(world, i, j, *sampler);
+}
+
+inline Color Camera::render_pixel(std::shared_ptr<Hittable> const & world, int i, int j, Sampler & sampler) const {
+    trace::begin_pixel(i, j);
+
+    // this anti-aliasing implementation relies on taking random samples
+    // of color and average them all to get the color for this pixel
+    Color cumulativeColor = Color(0, 0, 0);
+    for (int s = 0; s < aaSamples; ++s) {
+        trace::begin_sample(s);
+
+        sampler.start_sample(i, j, s);
+
+        Ray r = get_ray(i, j, sampler);
+
+        cumulativeColor = cumulativeColor + (lights.empty() ? ray_color(r, world, maxDepth, backgroundColor, sampler)
+                                                            : ray_color(r, world, lights, maxDepth, backgroundColor, sampler));
+    }
+
+    return Color(cumulativeColor.r / aaSamples,
+                 cumulativeColor.g / aaSamples,
+                 cumulativeColor.b / aaSamples);
+}
+
+inline std::unique_ptr<Sampler> Camera::create_sampler() const {
+    return make_sampler(samplerType, aaSamples, samplerSeed);
+}
+
+inline Ray Camera::get_ray(int i, int j, Sampler & sampler) const {
+    // somewhere within the pixel
+    Sample2D pixelOffset = sampler.get_2d();
+
     // a scalar value that is used to shorten the "horizontal" vector to
     // the point on the viewport we are currently rendering
-    double horizontalScalar = (double(i) + random_double(0.0, 0.9)) / (imageWidth - 1);
+    double horizontalScalar = (double(i) + pixelOffset.x) / (imageWidth - 1);
     // a scalar value that is used to shorten the "vertical" vector to
     // the point on the viewport we are currently rendering
-    double verticalScalar = (double(j) + random_double(0.0, 0.9)) / (imageHeight - 1);
+    double verticalScalar = (double(j) + pixelOffset.y) / (imageHeight - 1);
 
     // to simulate depth of field, we have a disk lens from which light is sourced
-    Point3 pointOnLens = _lensRadius * random_point_in_unit_disk();
+    Sample2D lensSample = sampler.get_2d();
+    Point3 pointOnLens = _lensRadius * unit_disk_point(lensSample.x, lensSample.y);
     Point3 pointOnLensOnCamera = (_u * pointOnLens.x) + (_v * pointOnLens.y);
 
     // cameraOrigin may not be zero (if camera moved location), but the direction
     // we would have calculated would be relative to true origin. The - origin
     // at the end makes the direction relative to whatever the camera's location is
-    return Ray(cameraOrigin + pointOnLensOnCamera,
-               _lowerLeftCorner + (horizontalScalar * _horizontal) + (verticalScalar * _vertical) - cameraOrigin - pointOnLensOnCamera,
-               random_double(0, 1)); // randomising the moment in time that we're rendering is good enough for motion blur
+    auto ray = Ray(cameraOrigin + pointOnLensOnCamera,
+                   _lowerLeftCorner + (horizontalScalar * _horizontal) + (verticalScalar * _vertical) - cameraOrigin - pointOnLensOnCamera,
+                   sampler.get_1d()); // randomising the moment in time that we're rendering is good enough for motion blur
+
+    // the cone starts from a point, which ignores the size of the lens
+    ray.cone.spreadAngle = _pixelSpreadAngle;
+
+    return ray;
 }
 
-void Camera::initialize() {
+inline void Camera::initialize() {
     imageHeight = static_cast<int>(imageWidth / aspectRatio);
 
     std::clog << "Image width: " << imageWidth << ", height: " << imageHeight << ", aspect ratio: " << aspectRatio << "\n";
@@ -189,6 +235,8 @@ void Camera::initialize() {
     _vertical = _viewportHeight * _v * _focusDistance;
     _lowerLeftCorner = cameraOrigin - (_horizontal / 2) - (_vertical / 2) - (_w * _focusDistance);
 
+    _pixelSpreadAngle = atan(_viewportHeight / imageHeight);
+
     std::clog << "Horizontal vector: " << _horizontal << "\n"
               << "Vertical vector: " << _vertical << "\n"
               << "Lower left corner: " << _lowerLeftCorner << "\n";
@@ -3,10 +3,12 @@
 
 #include <ostream>
 #include <cassert>
+#include <cstddef>
 
-#include "logger.h"
+#include "trace.h"
 #include "interval.h"
 #include "random.h"
+#include "simd.h"
 
 class Color {
     public:
@@ -37,53 +39,84 @@ Color operator*(double left, Color const & right);
 
 std::ostream & operator<<(std::ostream & out, Color const & c);
 
+// batched versions of the operators above that work on count colors at a time,
+// out may be the same array as one of the inputs
+void add_colors(Color const * a, Color const * b, Color * out, size_t count);
+
+void mul_colors(Color const * a, Color const * b, Color * out, size_t count);
+
+void scale_colors(Color const * a, double constant, Color * out, size_t count);
+
+// the SIMD kernels treat the r, g and b of a Color as an array of three doubles
+static_assert(sizeof(Color) == 3 * sizeof(double), "Color must be made up of exactly three doubles");
+
 void write_color(std::ostream & output, Color const & c);
 
 // ------
 
-Color::Color() : r(0), g(0), b(0) { }
+inline Color::Color() : r(0), g(0), b(0) { }
 
-Color::Color(double red, double green, double blue) : r(red), g(green), b(blue) { }
+inline Color::Color(double red, double green, double blue) : r(red), g(green), b(blue) { }
 
-Color Color::operator+(Color const & right) const {
-    return Color(this->r + right.r, this->g + right.g, this->b + right.b);
+inline Color Color::operator+(Color const & right) const {
+    Color result;
+    simd::add3(&this->r, &right.r, &result.r);
+    return result;
 }
 
-Color Color::operator-(Color const & right) const {
-    return Color(this->r - right.r, this->g - right.g, this->b - right.b);
+inline Color Color::operator-(Color const & right) const {
+    Color result;
+    simd::sub3(&this->r, &right.r, &result.r);
+    return result;
 }
 
-Color Color::operator*(double const constant) const {
-    return Color(constant * this->r, constant * this->g, constant * this->b);
+inline Color Color::operator*(double const constant) const {
+    Color result;
+    simd::scale3(&this->r, constant, &result.r);
+    return result;
 }
 
-Color Color::operator*(Color const & right) const {
-    return Color(this->r * right.r, this->g * right.g, this->b * right.b);
+inline Color Color::operator*(Color const & right) const {
+    Color result;
+    simd::mul3(&this->r, &right.r, &result.r);
+    return result;
 }
 
-Color Color::operator/(double const constant) const {
+inline Color Color::operator/(double const constant) const {
     return Color(this->r / constant, this->g / constant, this->b / constant);
 }
 
-Color Color::random() {
+inline Color Color::random() {
     return Color(random_double(), random_double(), random_double());
 }
 
-Color Color::random(double min, double max) {
+inline Color Color::random(double min, double max) {
     return Color(random_double(min, max), random_double(min, max), random_double(min, max));
 }
 
 // specific overload for when constant is on the left hand side of the operator
 // so technically this is an overload for double
-Color operator*(double left, Color const & right) {
+inline Color operator*(double left, Color const & right) {
     return right * left;
 }
 
-std::ostream & operator<<(std::ostream & out, Color const & c) {
+inline std::ostream & operator<<(std::ostream & out, Color const & c) {
     return out << c.r << " " << c.g << " " << c.b;
 }
 
-void write_color(std::ostream & output, Color const & c) {
+inline void add_colors(Color const * a, Color const * b, Color * out, size_t count) {
+    simd::add_batch(&a->r, &b->r, &out->r, count * 3);
+}
+
+inline void mul_colors(Color const * a, Color const * b, Color * out, size_t count) {
+    simd::mul_batch(&a->r, &b->r, &out->r, count * 3);
+}
+
+inline void scale_colors(Color const * a, double constant, Color * out, size_t count) {
+    simd::scale_batch(&a->r, constant, &out->r, count * 3);
+}
+
+inline void write_color(std::ostream & output, Color const & c) {
     auto intensityLimit = Interval(0.000000, 0.999999);
 
     // don't want to actually get 256 as a color value, we want to stop at 255
@@ -95,10 +128,7 @@ void write_color(std::ostream & output, Color const & c) {
     int G = static_cast<int>(intensityLimit.clamp(sqrt(c.g)) * 256);
     int B = static_cast<int>(intensityLimit.clamp(sqrt(c.b)) * 256);
 
-    LOG(
-        std::clog << "Raw color: " << c.r << " " << c.g << " " << c.b << "\n";
-        std::clog << "Actual color: " << R << " " << G << " " << B << "\n";
-    )
+    TRACE(trace::Level::Pixel, trace::Event::ColorWritten, c.r, c.g, c.b, R, G, B);
 
     output << R << " " << G << " " << B << "\n";
 }
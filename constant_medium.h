@@ -3,6 +3,9 @@
 
 #include "hittable.h"
 #include "material.h"
+#include "instance.h"
+#include "stats.h"
+#include "trace.h"
 
 // a representation of a medium that has constant probability of reflection as the ray travels through it
 // unlike other objects which reflect at the surface only
@@ -17,98 +20,98 @@ class ConstantMedium : public Hittable {
 
         virtual bool hit(Ray const & ray, Interval const & rayLimits, HitResult & result) const override;
 
+        // the medium only occludes a ray if it would've scattered it, so this is just as random as hit
+        virtual bool occluded(Ray const & ray, Interval const & rayLimits) const override;
+
         virtual Aabb bounding_box() const override;
 
     private:
         std::shared_ptr<Hittable> _boundary;
         double _negativeInverseDensity;
         std::shared_ptr<Material> _mediumMaterial;
+
+        // finds the t at which the ray gets scattered within the medium, if it does at all
+        bool scatter_t(Ray const & ray, Interval const & rayLimits, double & scatterT) const;
 };
 
-ConstantMedium::ConstantMedium(std::shared_ptr<Hittable> const & boundary, double const & density, Color const & color)
+inline ConstantMedium::ConstantMedium(std::shared_ptr<Hittable> const & boundary, double const & density, Color const & color)
                                : ConstantMedium(boundary, density, std::make_shared<SolidColorTexture>(color)) { }
 
-ConstantMedium::ConstantMedium(std::shared_ptr<Hittable> const & boundary, double const & density,
+inline ConstantMedium::ConstantMedium(std::shared_ptr<Hittable> const & boundary, double const & density,
                                std::shared_ptr<Texture> const & texture)
-                               : _boundary(boundary), _negativeInverseDensity(-1 / density),
+                               : _boundary(flatten_transformers(boundary)), _negativeInverseDensity(-1 / density),
                                  _mediumMaterial(std::make_shared<IsotropicScatterMaterial>(texture)) { }
 
-// calculating hitting for this objects requires a few considerations. first it needs to actually hit the medium twice,
-// once on entry, and once on exit. then we need to account for the fact that this ray could actually start
-// inside the medium. also, that the point of reflection is not the same as the point of intersection.
-bool ConstantMedium::hit(Ray const & ray, Interval const & rayLimits, HitResult & result) const {
-    HitResult mediumEntryHitResult, mediumExitHitResult;
-
-    if (!this->_boundary->hit(ray, Interval::universe, mediumEntryHitResult)) {
-        LOG(
-            std::clog << "Ray completely missed constant medium " << mediumEntryHitResult.t << "\n";
-        );
+inline bool ConstantMedium::hit(Ray const & ray, Interval const & rayLimits, HitResult & result) const {
+    stats::count_primitive_test(stats::Primitive::Medium);
+
+    double scatterT;
+    if (!scatter_t(ray, rayLimits, scatterT)) {
         return false;
     }
 
-    LOG(
-        std::clog << "Ray hit constant medium first at " << mediumEntryHitResult.t << "\n";
-    );
+    stats::count_primitive_hit(stats::Primitive::Medium);
+
+    result.t = scatterT;
+    result.point = ray.at(result.t);
+    result.material = this->_mediumMaterial.get();
+    // the following fields don't make sense/aren't relevant in this scenario
+    result.isFrontFace = true;
+    result.normal = Vec3(0, 0, 0);
+    result.u = 0;
+    result.v = 0;
+
+    return true;
+}
 
-    // Its always +0.001 rather than - cause we're always wanting to check for the second collision
-    // in the direction of the ray.
-    if (!this->_boundary->hit(ray, Interval(mediumEntryHitResult.t + 0.001, Interval::universe.max), mediumExitHitResult)) {
-        LOG(
-            std::clog << "Ray doesn't hit constant medium again in this direction\n";
-        );
+inline bool ConstantMedium::occluded(Ray const & ray, Interval const & rayLimits) const {
+    stats::count_primitive_test(stats::Primitive::Medium);
+
+    double scatterT;
+    if (!scatter_t(ray, rayLimits, scatterT)) {
         return false;
     }
 
-    LOG(
-        std::clog << "Ray hit constant medium again at " << mediumExitHitResult.t << "\n";
-    );
-
-    // apply the rayLimits
-    if (mediumEntryHitResult.t < rayLimits.min) mediumEntryHitResult.t = rayLimits.min;
-    if (mediumExitHitResult.t > rayLimits.max) mediumExitHitResult.t = rayLimits.max;
-
-    // as a result of the above, if the medium is behind the ray, then the entry point (which would actually
-    // be rayLimit.min in that scenario) will be ahead of the exit point.
-    if (mediumEntryHitResult.t >= mediumExitHitResult.t) {
-        LOG(
-            std::clog << "Ray t values after cropping are min: " << mediumEntryHitResult.t << ", max: "
-                      << mediumExitHitResult.t << ", so it is therefore behind the ray\n";
-        );
+    stats::count_primitive_hit(stats::Primitive::Medium);
+    return true;
+}
+
+inline Aabb ConstantMedium::bounding_box() const {
+    return this->_boundary->bounding_box();
+}
+
+// calculating hitting for this objects requires a few considerations. first it needs to actually hit the medium twice,
+// once on entry, and once on exit, which the boundary's hit_interval finds in one go. then we need to account for the
+// fact that this ray could actually start inside the medium. also, that the point of reflection is not the same as the
+// point of intersection.
+inline bool ConstantMedium::scatter_t(Ray const & ray, Interval const & rayLimits, double & scatterT) const {
+    Interval inside;
+
+    if (!this->_boundary->hit_interval(ray, rayLimits, inside)) {
+        TRACE(trace::Level::Intersection, trace::Event::MediumMissed);
         return false;
     }
 
-    if (mediumEntryHitResult.t < 0)
-        mediumEntryHitResult.t = 0;
+    TRACE(trace::Level::Intersection, trace::Event::MediumInside, inside.min, inside.max);
+
+    if (inside.min < 0)
+        inside.min = 0;
 
     double rayLength = ray.dir.length();
-    double distanceWithinIntersectionPoints = (mediumExitHitResult.t - mediumEntryHitResult.t) * rayLength;
+    double distanceWithinIntersectionPoints = (inside.max - inside.min) * rayLength;
     // find a random number that reflects how far along the medium entry/exit points line did the ray get reflected
     // this is technically flawed in that we could get 0 from the random_double and fall apart
     double distanceTillReflection = this->_negativeInverseDensity * log(random_double());
 
     if (distanceTillReflection > distanceWithinIntersectionPoints) {
-        LOG(
-            std::clog << "Ray traversing constant medium would've reflected at " << distanceTillReflection
-                      << " from the entry point, which is further than distance between points "
-                      << distanceWithinIntersectionPoints << "\n";
-        );
+        // it would've scattered further away than where it leaves the medium
+        TRACE(trace::Level::Intersection, trace::Event::MediumPassedThrough, distanceTillReflection, distanceWithinIntersectionPoints);
         return false;
     }
 
-    result.t = mediumEntryHitResult.t + (distanceTillReflection / rayLength);
-    result.point = ray.at(result.t);
-    result.material = this->_mediumMaterial;
-    // the following fields don't make sense/aren't relevant in this scenario
-    result.isFrontFace = true;
-    result.normal = Vec3(0, 0, 0);
-    result.u = 0;
-    result.v = 0;
+    scatterT = inside.min + (distanceTillReflection / rayLength);
 
     return true;
 }
 
-Aabb ConstantMedium::bounding_box() const {
-    return this->_boundary->bounding_box();
-}
-
 #endif
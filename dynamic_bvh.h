@@ -0,0 +1,143 @@
+#ifndef DYNAMIC_BVH_H
+#define DYNAMIC_BVH_H
+
+#include <chrono>
+#include <memory>
+
+#include "hittable.h"
+#include "primitive_list.h"
+#include "bvh_node.h"
+
+// how much work DynamicBvh::update did for a frame
+class BvhUpdateStats {
+    public:
+        // whether the tree had to be rebuilt, rather than just refitted
+        bool rebuilt = false;
+        double buildMilliseconds = 0;
+        double refitMilliseconds = 0;
+        // the SAH cost of the tree after the update, see BvhNode::sah_cost
+        double cost = 0;
+};
+
+std::ostream & operator<<(std::ostream & out, BvhUpdateStats const & stats);
+
+// a BVH for scenes that are rendered across multiple frames, where objects move between frames.
+// rather than building a new tree every frame, the existing tree is refitted to wherever the primitives moved to,
+// which is much cheaper but leaves the structure of the tree as it was. As objects move further from where they
+// were when the tree was built, the boxes grow and overlap more, so the tree is only rebuilt once its SAH cost
+// grows past the cost it had when it was last built by more than the rebuild threshold.
+class DynamicBvh final : public Hittable {
+    public:
+        // the list must have at least one primitive in it, the tree is built on the first call to update().
+        // a threshold of 1.5 means the tree is rebuilt once its cost grows by 50%
+        DynamicBvh(std::shared_ptr<PrimitiveList> const & primitives, double rebuildThreshold = 1.5);
+
+        // the primitives the tree is built over, move these between frames then call update()
+        PrimitiveList & primitives();
+
+        // refits or rebuilds the tree to match the current position of the primitives, call this once per frame
+        // after moving them and before rendering
+        BvhUpdateStats update();
+
+        // builds a new tree no matter what the cost of the current one is
+        BvhUpdateStats rebuild();
+
+        virtual bool hit(Ray const & ray, Interval const & rayLimits, HitResult & result) const override;
+
+        virtual bool occluded(Ray const & ray, Interval const & rayLimits) const override;
+
+        virtual Aabb bounding_box() const override;
+
+    private:
+        std::shared_ptr<PrimitiveList> _primitives;
+        std::shared_ptr<BvhNode> _tree;
+
+        double _rebuildThreshold;
+        // the cost of the tree right after it was last built
+        double _builtCost = 0;
+
+        static double milliseconds_since(std::chrono::steady_clock::time_point start);
+};
+
+// ------
+
+inline DynamicBvh::DynamicBvh(std::shared_ptr<PrimitiveList> const & primitives, double rebuildThreshold)
+                       : _primitives(primitives), _tree(), _rebuildThreshold(rebuildThreshold) { }
+
+inline PrimitiveList & DynamicBvh::primitives() {
+    return *this->_primitives;
+}
+
+inline BvhUpdateStats DynamicBvh::update() {
+    if (!this->_tree) {
+        return rebuild();
+    }
+
+    auto stats = BvhUpdateStats();
+
+    auto refitStart = std::chrono::steady_clock::now();
+    this->_primitives->update_bounding_box();
+    this->_tree->refit();
+    stats.cost = this->_tree->sah_cost();
+    stats.refitMilliseconds = milliseconds_since(refitStart);
+
+    if (stats.cost > this->_builtCost * this->_rebuildThreshold) {
+        auto rebuildStats = rebuild();
+        stats.rebuilt = true;
+        stats.buildMilliseconds = rebuildStats.buildMilliseconds;
+        stats.cost = rebuildStats.cost;
+    }
+
+    return stats;
+}
+
+inline BvhUpdateStats DynamicBvh::rebuild() {
+    auto stats = BvhUpdateStats();
+    stats.rebuilt = true;
+
+    auto buildStart = std::chrono::steady_clock::now();
+    this->_primitives->update_bounding_box();
+    this->_tree = std::make_shared<BvhNode>(std::shared_ptr<PrimitiveList const>(this->_primitives));
+    stats.buildMilliseconds = milliseconds_since(buildStart);
+
+    this->_builtCost = stats.cost = this->_tree->sah_cost();
+
+    return stats;
+}
+
+// the tree's nodes count themselves (see stats::count_bvh_node) as the ray goes through them, counting here as well
+// would count the root twice
+inline bool DynamicBvh::hit(Ray const & ray, Interval const & rayLimits, HitResult & result) const {
+    if (!this->_tree) {
+        // hasn't been built yet, so just go through every primitive
+        return this->_primitives->hit(ray, rayLimits, result);
+    }
+
+    return this->_tree->hit(ray, rayLimits, result);
+}
+
+inline bool DynamicBvh::occluded(Ray const & ray, Interval const & rayLimits) const {
+    if (!this->_tree) {
+        return this->_primitives->occluded(ray, rayLimits);
+    }
+
+    return this->_tree->occluded(ray, rayLimits);
+}
+
+// note that this isn't up to date with any moved primitives until update() is called
+inline Aabb DynamicBvh::bounding_box() const {
+    return this->_tree ? this->_tree->bounding_box() : this->_primitives->bounding_box();
+}
+
+inline double DynamicBvh::milliseconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+inline std::ostream & operator<<(std::ostream & out, BvhUpdateStats const & stats) {
+    return out << (stats.rebuilt ? "rebuilt" : "refitted")
+               << ", build: " << stats.buildMilliseconds << "ms"
+               << ", refit: " << stats.refitMilliseconds << "ms"
+               << ", SAH cost: " << stats.cost;
+}
+
+#endif
@@ -0,0 +1,440 @@
+#ifndef GRID_MEDIUM_H
+#define GRID_MEDIUM_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "hittable.h"
+#include "material.h"
+#include "random.h"
+#include "stats.h"
+
+// densities sampled on a regular 3D grid of voxels filling a box, e.g smoke or a cloud.
+// the voxels are grouped into bricks of BRICK_SIZE^3, and only bricks that have some density in them are stored, so
+// the empty space around the shape of a cloud doesn't take up any memory. Each brick also records its majorant, the
+// highest density anywhere inside of it, which GridMedium uses to take big steps through thin parts of the grid and
+// skip empty ones entirely
+class DensityGrid {
+    public:
+        // values has the density of each voxel, x changing the fastest then y then z
+        DensityGrid(Aabb const & bounds, int width, int height, int depth, std::vector<float> const & values);
+
+        // samples the density function at the center of every voxel
+        static DensityGrid from_function(Aabb const & bounds, int width, int height, int depth,
+                                         std::function<double (Point3 const &)> const & density);
+
+        // blends between the 8 closest voxel centers, and is 0 outside of the grid
+        double density(Point3 const & p) const;
+
+        // the highest density anywhere inside of the brick
+        double majorant(int brickX, int brickY, int brickZ) const;
+
+        Aabb const & bounds() const;
+
+        // the number of bricks along x, y and z
+        int bricks(int axis) const;
+
+        // the size of a brick along each axis in world space
+        double brick_size(int axis) const;
+
+        // how many bricks have any density in them, and so are stored
+        size_t stored_bricks() const;
+
+        size_t memory_size() const;
+
+        static constexpr int BRICK_SIZE = 8;
+
+    private:
+        Aabb _bounds;
+        double _min[3];
+        int _voxels[3];
+        int _bricks[3];
+        double _voxelSize[3];
+
+        // the index into _brickValues where each brick's voxels start, or -1 for bricks with no density at all
+        std::vector<int32_t> _brickOffsets;
+        std::vector<float> _brickValues;
+        std::vector<float> _majorants;
+
+        // 0 for voxels outside of the grid
+        float voxel(int x, int y, int z) const;
+
+        int brick_index(int brickX, int brickY, int brickZ) const;
+};
+
+// a medium whose density varies throughout a DensityGrid, scattering light the same way as ConstantMedium does.
+// where a ray scatters is found with delta tracking: steps are taken as if the medium had its majorant's density
+// everywhere, and at each step a "real" collision happens with probability density / majorant, otherwise the step was
+// a "null" collision and the ray carries on. Rays only step through one brick at a time using its own majorant, so
+// they take longer steps through thinner parts of the grid, and go straight past empty bricks
+class GridMedium : public Hittable {
+    public:
+        // densityScale multiplies every density in the grid
+        GridMedium(std::shared_ptr<DensityGrid const> const & grid, double densityScale, Color const & albedo);
+        GridMedium(std::shared_ptr<DensityGrid const> const & grid, double densityScale, std::shared_ptr<Texture> const & albedo);
+
+        virtual bool hit(Ray const & ray, Interval const & rayLimits, HitResult & result) const override;
+
+        // the medium only occludes a ray if it would've scattered it, so this is just as random as hit
+        virtual bool occluded(Ray const & ray, Interval const & rayLimits) const override;
+
+        virtual Aabb bounding_box() const override;
+
+        // an estimate of the fraction of light that makes it through the medium along the ray using ratio tracking,
+        // which steps the same way as delta tracking but multiplies in the chance of each step being a null collision
+        // rather than randomly picking one. This is the expected value of !occluded, with much less noise
+        double transmittance(Ray const & ray, Interval const & rayLimits) const;
+
+    private:
+        std::shared_ptr<DensityGrid const> _grid;
+        double _densityScale;
+        std::shared_ptr<Material> _mediumMaterial;
+
+        // finds the t at which the ray gets scattered within the medium, if it does at all
+        bool scatter_t(Ray const & ray, Interval const & rayLimits, double & scatterT) const;
+
+        // walks the bricks that the ray passes through within the limits in order, calling
+        // visit(segmentStart, segmentEnd, majorant) with the range of t inside each one, until visit returns false
+        template <typename VisitF>
+        void traverse(Ray const & ray, Interval const & rayLimits, VisitF visit) const;
+};
+
+// ------
+
+inline DensityGrid::DensityGrid(Aabb const & bounds, int width, int height, int depth, std::vector<float> const & values)
+                         : _bounds(bounds) {
+    Interval const * axes[3] = { &bounds.xBounds, &bounds.yBounds, &bounds.zBounds };
+    int sizes[3] = { width, height, depth };
+
+    for (int axis = 0; axis < 3; axis++) {
+        this->_min[axis] = axes[axis]->min;
+        this->_voxels[axis] = sizes[axis];
+        this->_bricks[axis] = (sizes[axis] + BRICK_SIZE - 1) / BRICK_SIZE;
+        this->_voxelSize[axis] = axes[axis]->size() / sizes[axis];
+    }
+
+    size_t brickCount = static_cast<size_t>(this->_bricks[0]) * this->_bricks[1] * this->_bricks[2];
+    this->_brickOffsets.assign(brickCount, -1);
+    this->_majorants.assign(brickCount, 0);
+
+    auto value_at = [&](int x, int y, int z) {
+        return values[(((static_cast<size_t>(z) * height) + y) * width) + x];
+    };
+
+    // only bricks with some density get stored
+    for (int brickZ = 0; brickZ < this->_bricks[2]; brickZ++) {
+        for (int brickY = 0; brickY < this->_bricks[1]; brickY++) {
+            for (int brickX = 0; brickX < this->_bricks[0]; brickX++) {
+                bool empty = true;
+                for (int z = brickZ * BRICK_SIZE; empty && (z < std::min((brickZ + 1) * BRICK_SIZE, depth)); z++) {
+                    for (int y = brickY * BRICK_SIZE; empty && (y < std::min((brickY + 1) * BRICK_SIZE, height)); y++) {
+                        for (int x = brickX * BRICK_SIZE; empty && (x < std::min((brickX + 1) * BRICK_SIZE, width)); x++) {
+                            empty = value_at(x, y, z) <= 0;
+                        }
+                    }
+                }
+                if (empty) {
+                    continue;
+                }
+
+                this->_brickOffsets[brick_index(brickX, brickY, brickZ)] = static_cast<int32_t>(this->_brickValues.size());
+                for (int z = 0; z < BRICK_SIZE; z++) {
+                    for (int y = 0; y < BRICK_SIZE; y++) {
+                        for (int x = 0; x < BRICK_SIZE; x++) {
+                            int gridX = (brickX * BRICK_SIZE) + x;
+                            int gridY = (brickY * BRICK_SIZE) + y;
+                            int gridZ = (brickZ * BRICK_SIZE) + z;
+                            bool inside = (gridX < width) && (gridY < height) && (gridZ < depth);
+                            this->_brickValues.push_back(inside ? std::max(0.0f, value_at(gridX, gridY, gridZ)) : 0.0f);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // density blends between voxel centers, so a point inside a brick can be affected by the voxels one past either
+    // side of it, which have to be included in its majorant
+    for (int brickZ = 0; brickZ < this->_bricks[2]; brickZ++) {
+        for (int brickY = 0; brickY < this->_bricks[1]; brickY++) {
+            for (int brickX = 0; brickX < this->_bricks[0]; brickX++) {
+                float highest = 0;
+                for (int z = (brickZ * BRICK_SIZE) - 1; z <= (brickZ + 1) * BRICK_SIZE; z++) {
+                    for (int y = (brickY * BRICK_SIZE) - 1; y <= (brickY + 1) * BRICK_SIZE; y++) {
+                        for (int x = (brickX * BRICK_SIZE) - 1; x <= (brickX + 1) * BRICK_SIZE; x++) {
+                            highest = std::max(highest, voxel(x, y, z));
+                        }
+                    }
+                }
+                this->_majorants[brick_index(brickX, brickY, brickZ)] = highest;
+            }
+        }
+    }
+}
+
+inline DensityGrid DensityGrid::from_function(Aabb const & bounds, int width, int height, int depth,
+                                       std::function<double (Point3 const &)> const & density) {
+    auto values = std::vector<float>(static_cast<size_t>(width) * height * depth);
+
+    for (int z = 0; z < depth; z++) {
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                auto center = Point3(bounds.xBounds.min + ((x + 0.5) * bounds.xBounds.size() / width),
+                                     bounds.yBounds.min + ((y + 0.5) * bounds.yBounds.size() / height),
+                                     bounds.zBounds.min + ((z + 0.5) * bounds.zBounds.size() / depth));
+                values[(((static_cast<size_t>(z) * height) + y) * width) + x] = static_cast<float>(density(center));
+            }
+        }
+    }
+
+    return DensityGrid(bounds, width, height, depth, values);
+}
+
+inline double DensityGrid::density(Point3 const & p) const {
+    double position[3] = { p.x, p.y, p.z };
+    int low[3];
+    double weight[3];
+
+    for (int axis = 0; axis < 3; axis++) {
+        // voxel centers are at the halves, e.g the first voxel's center is half a voxel in from the edge
+        double voxelPosition = ((position[axis] - this->_min[axis]) / this->_voxelSize[axis]) - 0.5;
+        double lowPosition = std::floor(voxelPosition);
+        low[axis] = static_cast<int>(lowPosition);
+        weight[axis] = voxelPosition - lowPosition;
+    }
+
+    double blended = 0;
+    for (int corner = 0; corner < 8; corner++) {
+        int dx = (corner >> 2) & 1;
+        int dy = (corner >> 1) & 1;
+        int dz = corner & 1;
+
+        double cornerWeight = (dx ? weight[0] : (1 - weight[0])) * (dy ? weight[1] : (1 - weight[1]))
+                              * (dz ? weight[2] : (1 - weight[2]));
+        blended += cornerWeight * voxel(low[0] + dx, low[1] + dy, low[2] + dz);
+    }
+
+    return blended;
+}
+
+inline double DensityGrid::majorant(int brickX, int brickY, int brickZ) const {
+    return this->_majorants[brick_index(brickX, brickY, brickZ)];
+}
+
+inline Aabb const & DensityGrid::bounds() const {
+    return this->_bounds;
+}
+
+inline int DensityGrid::bricks(int axis) const {
+    return this->_bricks[axis];
+}
+
+inline double DensityGrid::brick_size(int axis) const {
+    return this->_voxelSize[axis] * BRICK_SIZE;
+}
+
+inline size_t DensityGrid::stored_bricks() const {
+    return this->_brickValues.size() / (BRICK_SIZE * BRICK_SIZE * BRICK_SIZE);
+}
+
+inline size_t DensityGrid::memory_size() const {
+    return (this->_brickOffsets.size() * sizeof(int32_t)) + (this->_brickValues.size() * sizeof(float))
+           + (this->_majorants.size() * sizeof(float));
+}
+
+inline float DensityGrid::voxel(int x, int y, int z) const {
+    if ((x < 0) || (y < 0) || (z < 0) || (x >= this->_voxels[0]) || (y >= this->_voxels[1]) || (z >= this->_voxels[2])) {
+        return 0;
+    }
+
+    int32_t offset = this->_brickOffsets[brick_index(x / BRICK_SIZE, y / BRICK_SIZE, z / BRICK_SIZE)];
+    if (offset < 0) {
+        return 0;
+    }
+
+    int withinBrick = ((((z % BRICK_SIZE) * BRICK_SIZE) + (y % BRICK_SIZE)) * BRICK_SIZE) + (x % BRICK_SIZE);
+    return this->_brickValues[static_cast<size_t>(offset) + withinBrick];
+}
+
+inline int DensityGrid::brick_index(int brickX, int brickY, int brickZ) const {
+    return (((brickZ * this->_bricks[1]) + brickY) * this->_bricks[0]) + brickX;
+}
+
+inline GridMedium::GridMedium(std::shared_ptr<DensityGrid const> const & grid, double densityScale, Color const & albedo)
+                       : GridMedium(grid, densityScale, std::make_shared<SolidColorTexture>(albedo)) { }
+
+inline GridMedium::GridMedium(std::shared_ptr<DensityGrid const> const & grid, double densityScale,
+                       std::shared_ptr<Texture> const & albedo)
+                       : _grid(grid), _densityScale(densityScale),
+                         _mediumMaterial(std::make_shared<IsotropicScatterMaterial>(albedo)) { }
+
+inline bool GridMedium::hit(Ray const & ray, Interval const & rayLimits, HitResult & result) const {
+    stats::count_primitive_test(stats::Primitive::Medium);
+
+    double scatterT;
+    if (!scatter_t(ray, rayLimits, scatterT)) {
+        return false;
+    }
+
+    stats::count_primitive_hit(stats::Primitive::Medium);
+
+    result.t = scatterT;
+    result.point = ray.at(result.t);
+    result.material = this->_mediumMaterial.get();
+    // the following fields don't make sense/aren't relevant in this scenario
+    result.isFrontFace = true;
+    result.normal = Vec3(0, 0, 0);
+    result.u = 0;
+    result.v = 0;
+
+    return true;
+}
+
+inline bool GridMedium::occluded(Ray const & ray, Interval const & rayLimits) const {
+    stats::count_primitive_test(stats::Primitive::Medium);
+
+    double scatterT;
+    if (!scatter_t(ray, rayLimits, scatterT)) {
+        return false;
+    }
+
+    stats::count_primitive_hit(stats::Primitive::Medium);
+    return true;
+}
+
+inline Aabb GridMedium::bounding_box() const {
+    return this->_grid->bounds();
+}
+
+inline double GridMedium::transmittance(Ray const & ray, Interval const & rayLimits) const {
+    double rayLength = ray.dir.length();
+    double transmittance = 1.0;
+
+    traverse(ray, rayLimits, [&](double segmentStart, double segmentEnd, double majorant) {
+        if (majorant <= 0) {
+            return true;
+        }
+
+        // the majorant per unit of t rather than per unit of distance
+        double majorantPerT = majorant * this->_densityScale * rayLength;
+        double t = segmentStart;
+        while (true) {
+            t -= std::log(1.0 - random_double()) / majorantPerT;
+            if (t >= segmentEnd) {
+                return true;
+            }
+
+            transmittance *= 1.0 - (this->_grid->density(ray.at(t)) / majorant);
+
+            // once hardly any light is getting through, russian roulette decides whether to stop (which is then
+            // exact rather than an approximation) and boosts the paths that carry on to make up for the ones that didn't
+            if (transmittance < 0.1) {
+                if (random_double() < 0.5) {
+                    transmittance = 0;
+                    return false;
+                }
+                transmittance *= 2;
+            }
+        }
+    });
+
+    return transmittance;
+}
+
+inline bool GridMedium::scatter_t(Ray const & ray, Interval const & rayLimits, double & scatterT) const {
+    double rayLength = ray.dir.length();
+    bool scattered = false;
+
+    traverse(ray, rayLimits, [&](double segmentStart, double segmentEnd, double majorant) {
+        if (majorant <= 0) {
+            // nothing in this brick to scatter off of
+            return true;
+        }
+
+        // the majorant per unit of t rather than per unit of distance
+        double majorantPerT = majorant * this->_densityScale * rayLength;
+        double t = segmentStart;
+        while (true) {
+            // distances between collisions are exponentially distributed, and since that has no memory, stopping at the
+            // end of the brick and starting again in the next one with a different majorant is still correct
+            t -= std::log(1.0 - random_double()) / majorantPerT;
+            if (t >= segmentEnd) {
+                return true;
+            }
+
+            if ((random_double() * majorant) < this->_grid->density(ray.at(t))) {
+                scatterT = t;
+                scattered = true;
+                return false;
+            }
+        }
+    });
+
+    return scattered;
+}
+
+template <typename VisitF>
+void GridMedium::traverse(Ray const & ray, Interval const & rayLimits, VisitF visit) const {
+    Interval limits = rayLimits;
+    if (!this->_grid->bounds().clip(ray, limits)) {
+        return;
+    }
+
+    // 3D DDA (Amanatides and Woo) through the bricks, stepping into whichever neighbouring brick's boundary is closest
+    Aabb const & bounds = this->_grid->bounds();
+    double boundsMin[3] = { bounds.xBounds.min, bounds.yBounds.min, bounds.zBounds.min };
+    double origin[3] = { ray.orig.x, ray.orig.y, ray.orig.z };
+    double direction[3] = { ray.dir.x, ray.dir.y, ray.dir.z };
+    Point3 entry = ray.at(limits.min);
+    double entryPosition[3] = { entry.x, entry.y, entry.z };
+
+    int brick[3];
+    int step[3];
+    // the t at which the ray crosses into the next brick along each axis, and how much t it takes to cross a brick
+    double nextT[3];
+    double deltaT[3];
+
+    for (int axis = 0; axis < 3; axis++) {
+        double brickSize = this->_grid->brick_size(axis);
+        auto position = static_cast<int>(std::floor((entryPosition[axis] - boundsMin[axis]) / brickSize));
+        brick[axis] = std::clamp(position, 0, this->_grid->bricks(axis) - 1);
+
+        if (direction[axis] > 0) {
+            step[axis] = 1;
+            nextT[axis] = (boundsMin[axis] + ((brick[axis] + 1) * brickSize) - origin[axis]) / direction[axis];
+            deltaT[axis] = brickSize / direction[axis];
+        } else if (direction[axis] < 0) {
+            step[axis] = -1;
+            nextT[axis] = (boundsMin[axis] + (brick[axis] * brickSize) - origin[axis]) / direction[axis];
+            deltaT[axis] = -brickSize / direction[axis];
+        } else {
+            step[axis] = 0;
+            nextT[axis] = std::numeric_limits<double>::infinity();
+            deltaT[axis] = std::numeric_limits<double>::infinity();
+        }
+    }
+
+    double t = limits.min;
+    while (t < limits.max) {
+        int axis = (nextT[0] < nextT[1]) ? ((nextT[0] < nextT[2]) ? 0 : 2) : ((nextT[1] < nextT[2]) ? 1 : 2);
+        double segmentEnd = std::min(nextT[axis], limits.max);
+
+        if ((segmentEnd > t) && !visit(t, segmentEnd, this->_grid->majorant(brick[0], brick[1], brick[2]))) {
+            return;
+        }
+
+        t = segmentEnd;
+        brick[axis] += step[axis];
+        if ((brick[axis] < 0) || (brick[axis] >= this->_grid->bricks(axis))) {
+            return;
+        }
+        nextT[axis] += deltaT[axis];
+    }
+}
+
+#endif
@@ -1,6 +1,9 @@
 #ifndef HITTABLE_H
 #define HITTABLE_H
 
+#include <cmath>
+#include <memory>
+
 #include "vec3.h"
 #include "ray.h"
 #include "interval.h"
@@ -15,12 +18,20 @@ class HitResult {
         Vec3 normal;
         // whether we hit the front of the face or the back
         bool isFrontFace;
-        std::shared_ptr<Material> material;
+        // not owned by the result, the object that was hit keeps the material alive,
+        // this avoids reference counting every time a ray hits something
+        Material const * material = nullptr;
         // the scalar that if you multiply by the ray takes you to the point at which the intersection occurred
         double t = -1.0;
         // texture coordinates should be [0-1]
         double u = 0.0;
         double v = 0.0;
+        // roughly how far apart (in world space) two points are whose u or v differ by 1, so that the size of the
+        // area a ray covers can be converted into texture coordinates. 0 if the object doesn't know
+        double uvScale = 0.0;
+        // the width of the area around u, v that the ray covers, in the same units as u and v.
+        // set by ray_color (see RayCone) and used for filtering textures, 0 means as small as possible
+        double uvFootprint = 0.0;
 
         void set_face_normal(Ray const & ray, Vec3 const & normal);
 };
@@ -35,17 +46,80 @@ class Hittable {
         // rayLimits controls how far the ray can go
         virtual bool hit(Ray const & ray, Interval const & rayLimits, HitResult & result) const = 0;
 
+        // whether the ray hits anything at all within the limits, for shadow rays and other visibility checks
+        // that don't care what was hit. Override this to stop at the first intersection found rather than
+        // looking for the closest one, and to skip working out the details of the hit (normal, uv, material).
+        // by default it just calls hit()
+        virtual bool occluded(Ray const & ray, Interval const & rayLimits) const;
+
+        // for hittables that enclose a volume (e.g the boundary of a ConstantMedium), the part of rayLimits during
+        // which the ray is inside of it, returning false if there isn't any. The ray enters at the first hit along its
+        // whole line, and leaves at the next hit after that.
+        // by default that takes two calls to hit(), override this to find both at once, e.g for convex shapes
+        virtual bool hit_interval(Ray const & ray, Interval const & rayLimits, Interval & inside) const;
+
         // override this to define a bounding box for this hittable that can be used for BVH calculations
         virtual Aabb bounding_box() const = 0;
+
+        // override this for hittables that move, to give the bounding box at a single moment in time (between 0
+        // and 1), which the BVH uses to get tighter boxes when rendering motion blur. The BVH interpolates linearly
+        // between the boxes it gets from this, so the box at any moment should fit inside the box interpolated
+        // from any two moments either side of it, which is true of anything moving in a straight line.
+        // by default its the same as bounding_box(), i.e the box around everywhere the object could be
+        virtual Aabb bounding_box_at(double time) const;
+
+        // override these two for hittables that can be used as lights in a LightList.
+        // random_direction returns a direction from the origin towards a random point on the hittable,
+        // and pdf_value the probability density of random_direction returning the given direction,
+        // which is 0 if the direction doesn't point at the hittable
+        virtual double pdf_value(Point3 const & origin, Vec3 const & direction) const;
+        virtual Vec3 random_direction(Point3 const & origin) const;
 };
 
 // ------
 
+inline bool Hittable::occluded(Ray const & ray, Interval const & rayLimits) const {
+    auto result = HitResult();
+    return hit(ray, rayLimits, result);
+}
+
+inline bool Hittable::hit_interval(Ray const & ray, Interval const & rayLimits, Interval & inside) const {
+    HitResult entryHitResult, exitHitResult;
+
+    if (!hit(ray, Interval::universe, entryHitResult)) {
+        return false;
+    }
+
+    // its always +0.001 rather than - cause we're always wanting to check for the second collision
+    // in the direction of the ray
+    if (!hit(ray, Interval(entryHitResult.t + 0.001, Interval::universe.max), exitHitResult)) {
+        return false;
+    }
+
+    inside = Interval(std::fmax(entryHitResult.t, rayLimits.min), std::fmin(exitHitResult.t, rayLimits.max));
+
+    // if the volume is behind the ray, then the entry point (which would actually be rayLimits.min in that scenario)
+    // will be ahead of the exit point
+    return inside.min < inside.max;
+}
+
+inline Aabb Hittable::bounding_box_at(double) const {
+    return bounding_box();
+}
+
+inline double Hittable::pdf_value(Point3 const & /* origin */, Vec3 const & /* direction */) const {
+    return 0;
+}
+
+inline Vec3 Hittable::random_direction(Point3 const & /* origin */) const {
+    return Vec3(1, 0, 0);
+}
+
 // sets the normal field as well as the face based on the direction of the
 // normal.
 // if the normal is in the opposite direction of the ray then the normal
 // is pointing outwards, therefore we hit the front of the face.
-void HitResult::set_face_normal(Ray const & ray, Vec3 const & normal) {
+inline void HitResult::set_face_normal(Ray const & ray, Vec3 const & normal) {
     isFrontFace = ray.dir.dot(normal) < 0;
     this->normal = isFrontFace ? normal : -normal;
 }
@@ -7,12 +7,27 @@
 #include "hittable.h"
 #include "quad.h"
 #include "aabb.h"
+#include "trace.h"
 
 // a container for hittable objects
 class HittableList : public Hittable {
     public:
+        // what's known about the shape the objects make together, which lets hit_interval take shortcuts
+        enum class Shape {
+            // anything, hit_interval looks for the entry and exit with two calls to hit
+            Unknown,
+            // the objects enclose a convex volume, so a line only ever goes in and out of it once, and the entry and
+            // exit are the first and last hits of every object along the ray's whole line, found in one pass
+            Convex,
+            // the objects are the sides of box (see make_box), so the entry and exit are a single slab test
+            Box
+        };
+
         std::vector<std::shared_ptr<Hittable>> objects;
         Aabb boundingBox;
+        Shape shape = Shape::Unknown;
+        // for Shape::Box, the box the objects are the sides of. Not the same as boundingBox, which is padded
+        Aabb box;
 
         HittableList();
         HittableList(std::shared_ptr<Hittable> objects);
@@ -23,6 +38,10 @@ class HittableList : public Hittable {
 
         bool hit(Ray const & ray, Interval const & rayLimits, HitResult & result) const override;
 
+        bool occluded(Ray const & ray, Interval const & rayLimits) const override;
+
+        bool hit_interval(Ray const & ray, Interval const & rayLimits, Interval & inside) const override;
+
         Aabb bounding_box() const override;
 };
 
@@ -32,22 +51,22 @@ std::shared_ptr<HittableList> make_box(Point3 const & a, Point3 const & b, Color
 
 // ------
 
-HittableList::HittableList() : objects(), boundingBox() { }
+inline HittableList::HittableList() : objects(), boundingBox() { }
 
-HittableList::HittableList(std::shared_ptr<Hittable> object) {
+inline HittableList::HittableList(std::shared_ptr<Hittable> object) {
     add(object);
 }
 
-void HittableList::clear() {
+inline void HittableList::clear() {
     this->objects.clear();
 }
 
-void HittableList::add(std::shared_ptr<Hittable> object) {
+inline void HittableList::add(std::shared_ptr<Hittable> object) {
     this->objects.push_back(object);
     this->boundingBox = Aabb(this->boundingBox, object->bounding_box());
 }
 
-bool HittableList::hit(Ray const & ray, Interval const & rayLimits, HitResult & result) const {
+inline bool HittableList::hit(Ray const & ray, Interval const & rayLimits, HitResult & result) const {
     double maxRayLength = rayLimits.max; // essentially our view distance
 
     bool didHitAnything = false;
@@ -65,21 +84,68 @@ bool HittableList::hit(Ray const & ray, Interval const & rayLimits, HitResult &
             maxRayLength = result.t;
 
             didHitAnything = true;
-            LOG(
-                std::clog << "Ray hit object " << object << " with t = " << result.t << ", front face: " << result.isFrontFace << "\n";
-                std::clog << "Normal: " << result.normal.x << " " << result.normal.y << " " << result.normal.z << "\n";
-            )
+            TRACE(trace::Level::Ray, trace::Event::ListHit, &object - this->objects.data(), result.t, result.isFrontFace,
+                  result.normal.x, result.normal.y, result.normal.z);
         }
     }
 
     return didHitAnything;
 }
 
-Aabb HittableList::bounding_box() const {
+// unlike hit, any object will do, so there's no need to go through the rest once one is hit
+inline bool HittableList::occluded(Ray const & ray, Interval const & rayLimits) const {
+    for (std::shared_ptr<Hittable> const & object : this->objects) {
+        if (object->occluded(ray, rayLimits)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+inline bool HittableList::hit_interval(Ray const & ray, Interval const & rayLimits, Interval & inside) const {
+    // where the ray's whole line is inside
+    Interval line;
+
+    switch (this->shape) {
+        case Shape::Box:
+            line = Interval::universe;
+            if (!this->box.clip(ray, line)) {
+                return false;
+            }
+            break;
+
+        case Shape::Convex: {
+            // starts off empty, i.e min is infinity and max is -infinity
+            line = Interval::empty;
+            auto tmpHitResult = HitResult();
+            for (std::shared_ptr<Hittable> const & object : this->objects) {
+                if (object->hit(ray, Interval::universe, tmpHitResult)) {
+                    line.min = std::fmin(line.min, tmpHitResult.t);
+                    line.max = std::fmax(line.max, tmpHitResult.t);
+                }
+            }
+            // missed, or only touched an edge or corner
+            if (!(line.min < line.max)) {
+                return false;
+            }
+            break;
+        }
+
+        case Shape::Unknown:
+        default:
+            return Hittable::hit_interval(ray, rayLimits, inside);
+    }
+
+    inside = Interval(std::fmax(line.min, rayLimits.min), std::fmin(line.max, rayLimits.max));
+    return inside.min < inside.max;
+}
+
+inline Aabb HittableList::bounding_box() const {
     return this->boundingBox;
 }
 
-std::ostream & operator<<(std::ostream & out, HittableList const & list) {
+inline std::ostream & operator<<(std::ostream & out, HittableList const & list) {
     for (auto & obj : list.objects) {
         out << "- " << obj << "\n";
     }
@@ -87,7 +153,7 @@ std::ostream & operator<<(std::ostream & out, HittableList const & list) {
     return out;
 }
 
-std::shared_ptr<HittableList> make_box(Point3 const & a, Point3 const & b, std::shared_ptr<LambertianMaterial> const & material) {
+inline std::shared_ptr<HittableList> make_box(Point3 const & a, Point3 const & b, std::shared_ptr<LambertianMaterial> const & material) {
     auto sides = std::make_shared<HittableList>();
 
     auto minPoint = Point3(fmin(a.x, b.x), fmin(a.y, b.y), fmin(a.z, b.z));
@@ -110,6 +176,9 @@ std::shared_ptr<HittableList> make_box(Point3 const & a, Point3 const & b, std::
     // front
     sides->add(std::make_shared<Quad>(minPoint + zVector, xVector, yVector, material));
 
+    sides->shape = HittableList::Shape::Box;
+    sides->box = Aabb(minPoint, maxPoint);
+
     return sides;
 }
 
@@ -1,88 +1,547 @@
 #ifndef IMAGE_H
 #define IMAGE_H
 
-#define STB_IMAGE_IMPLEMENTATION
+// only declares stb_image's functions, each program defines them in one of its files by defining
+// STB_IMAGE_IMPLEMENTATION before including this
 #define STBI_FAILURE_USERMSG
 
+// stb_image sets a variable that it never reads
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-but-set-variable"
 #include "external/stb_image.h"
+#pragma GCC diagnostic pop
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <string>
+#include <sstream>
 #include <iostream>
+#include <vector>
 
+#include "color.h"
+
+// how the components of each texel are stored in memory, from smallest to most precise
+enum class TexelFormat {
+    // a byte per component, gamma encoded the same way stb_image decodes 8 bit images, and decoded through a lookup table.
+    // 3 bytes per texel, the same as most image files, but values are limited to 0-1
+    Srgb8,
+    // a 16 bit float per component, for images that have values above 1 (e.g HDR environment maps)
+    Half,
+    // a 32 bit float per component
+    Float
+};
+
+std::string texel_format_name(TexelFormat format);
+
+// the format an image file is stored in when one isn't given, Half for HDR files and Srgb8 for everything else
+TexelFormat default_texel_format(std::string const & filename);
+
+// how many bytes each component of a texel takes up
+size_t texel_component_size(TexelFormat format);
+
+// which mip level, including the fraction between two levels, has texels closest in size to footprint (see
+// Image::trilinear) for an image of the given size
+double mip_level(double footprint, int width, int height, int levelCount);
+
+// an image loaded from a file, along with a chain of mipmaps, each half the width and height of the one before,
+// down to a single texel. Looking up a smaller level when a ray covers a large part of the image averages out
+// the texels it covers (rather than picking one of them at random), and keeps lookups within a small part of memory.
+// the texels of every level are stored in square tiles rather than row by row, so texels that are next to each other
+// vertically are also close in memory
 class Image {
 public:
+    // an empty image, every lookup gives the fallback color until load is called
+    Image();
+    // 8 bit images are stored as Srgb8 and HDR images as Half
     Image(std::string const & filename);
+    Image(std::string const & filename, TexelFormat format);
+
+    // replaces the image with the one in the file. Loading different images on different threads at the same time is safe
+    void load(std::string const & filename, TexelFormat format);
 
-    ~Image();
+    // the color of the texel at column x and row y of a level, where row 0 is the top of the image.
+    // coordinates outside of the level are clamped to its edges
+    Color color_at(int x, int y, int level = 0) const;
 
-    double * const color_at(int x, int y) const;
+    // blends the 4 texels closest to u, v in a level, where u and v are [0-1] across the level and v = 0 is the top
+    Color bilinear(double u, double v, int level) const;
+
+    // blends the two levels whose texels are closest in size to footprint, which is the width of the area being
+    // looked up in the same units as u and v. 0 means use the full size image
+    Color trilinear(double u, double v, double footprint) const;
+
+    int level_count() const;
+    int level_width(int level) const;
+    int level_height(int level) const;
+
+    // how much memory the texels of every level take up
+    size_t memory_size() const;
+
+    TexelFormat format() const;
 
     int width = 0;
     int height = 0;
+
 private:
-    // the color values for the image, a [0-1] for each component of a pixel,
-    // so overall there will be width * height * components per pixel parts to this array
-    double * colorData = nullptr;
+    class Level {
+        public:
+            int width;
+            int height;
+            int tilesAcross;
+            TexelFormat format;
+            // the components of every texel grouped into tiles, only the one matching format is used
+            std::vector<uint8_t> srgb8Texels;
+            std::vector<uint16_t> halfTexels;
+            std::vector<float> floatTexels;
+
+            Level(int width, int height, TexelFormat format);
+
+            // the index of the first component of a texel
+            size_t texel_index(int x, int y) const;
 
-    // total number of color components (i.e r, g, b) per row of image, used for color value lookups
-    int componentsPerRow = 0;
+            // the linear value of each component of a texel
+            void get(int x, int y, float * linear) const;
+            void set(int x, int y, float const * linear);
+
+            // see Image::bilinear
+            Color bilinear(double u, double v) const;
+
+            size_t memory_size() const;
+
+        private:
+            template <typename ComponentT>
+            Color bilinear_from(std::vector<ComponentT> const & texels, double u, double v) const;
+    };
+
+    std::vector<Level> _levels;
+
+    TexelFormat _format = TexelFormat::Srgb8;
+
+    // averages every 2x2 block of texels in the last level to make the next one
+    void build_mipmaps();
 
     // for when the image couldn't be loaded
-    static double FALLBACK_COLOR[];
+    static Color const FALLBACK_COLOR;
 
     static int const COMPONENTS_PER_PIXEL = 3;
+    // the width and height of a tile in texels
+    static int const TILE_SIZE = 8;
 };
 
 // ------
 
-double Image::FALLBACK_COLOR[] = {255, 0, 0};
+inline Color const Image::FALLBACK_COLOR = Color(255, 0, 0);
+
+inline Image::Image() { }
+
+inline Image::Image(std::string const & filename) : Image(filename, default_texel_format(filename)) { }
+
+inline Image::Image(std::string const & filename, TexelFormat format) {
+    load(filename, format);
+}
+
+inline void Image::load(std::string const & filename, TexelFormat format) {
+    this->_format = format;
+    this->_levels.clear();
 
-Image::Image(std::string const & filename) {
     int imageBytesPerPixel = 0;
-    float* floatData = stbi_loadf(filename.c_str(), &width, &height, &imageBytesPerPixel, COMPONENTS_PER_PIXEL);
+    bool isHdr = stbi_is_hdr(filename.c_str());
+
+    if ((format == TexelFormat::Srgb8) && !isHdr) {
+        // the bytes in the file are already in the right format, so they're copied as is rather than going through floats
+        stbi_uc* byteData = stbi_load(filename.c_str(), &width, &height, &imageBytesPerPixel, COMPONENTS_PER_PIXEL);
+        if (byteData == nullptr) {
+            std::cerr << "Error loading image " << filename << ", reason: " << stbi_failure_reason() << std::endl;
+            return;
+        }
+
+        this->_levels.emplace_back(width, height, format);
+        Level & fullSize = this->_levels.back();
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                std::copy_n(byteData + (((y * width) + x) * COMPONENTS_PER_PIXEL), COMPONENTS_PER_PIXEL,
+                            fullSize.srgb8Texels.data() + fullSize.texel_index(x, y));
+            }
+        }
+
+        stbi_image_free(byteData);
+    } else {
+        float* floatData = stbi_loadf(filename.c_str(), &width, &height, &imageBytesPerPixel, COMPONENTS_PER_PIXEL);
+        if (floatData == nullptr) {
+            std::cerr << "Error loading image " << filename << ", reason: " << stbi_failure_reason() << std::endl;
+            return;
+        }
 
-    if (floatData == nullptr) {
-        std::cerr << "Error loading image " << filename << ", reason: " << stbi_failure_reason() << std::endl;
-        return;
+        this->_levels.emplace_back(width, height, format);
+        Level & fullSize = this->_levels.back();
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                fullSize.set(x, y, floatData + (((y * width) + x) * COMPONENTS_PER_PIXEL));
+            }
+        }
+
+        stbi_image_free(floatData);
     }
 
-    std::clog << "Loaded image " << filename <<
-              ". Width: " << width << ", height: " << height << ", bytes per pixel: " << imageBytesPerPixel
-              << "\n";
+    build_mipmaps();
+
+    // written in one go so lines from images loading on other threads don't get mixed into it
+    std::ostringstream message;
+    message << "Loaded image " << filename <<
+               ". Width: " << width << ", height: " << height << ", bytes per pixel: " << imageBytesPerPixel
+               << ", mip levels: " << level_count()
+               << ", texel format: " << texel_format_name(format) << ", texel memory: " << memory_size() / 1024 << "KB\n";
+    std::clog << message.str();
+}
 
-    int totalBytes = height * width * COMPONENTS_PER_PIXEL;
+inline std::string texel_format_name(TexelFormat format) {
+    switch (format) {
+        case TexelFormat::Srgb8:
+            return "srgb8";
+        case TexelFormat::Half:
+            return "half";
+        case TexelFormat::Float:
+            return "float";
+    }
+    return "unknown";
+}
 
-    colorData = new double[totalBytes];
+inline TexelFormat default_texel_format(std::string const & filename) {
+    return stbi_is_hdr(filename.c_str()) ? TexelFormat::Half : TexelFormat::Srgb8;
+}
 
-    for (int i = 0; i < totalBytes; i++) {
-        colorData[i] = static_cast<double>(floatData[i]);
+inline size_t texel_component_size(TexelFormat format) {
+    switch (format) {
+        case TexelFormat::Srgb8:
+            return sizeof(uint8_t);
+        case TexelFormat::Half:
+            return sizeof(uint16_t);
+        case TexelFormat::Float:
+            return sizeof(float);
     }
+    return 0;
+}
+
+inline double mip_level(double footprint, int width, int height, int levelCount) {
+    // the footprint in texels of the full size image, each level down halves that
+    double texels = footprint * std::sqrt(static_cast<double>(width) * height);
+    return (texels > 1) ? std::min(std::log2(texels), static_cast<double>(levelCount - 1)) : 0;
+}
+
+// 8 bit components are gamma encoded with 2.2, which is what stbi_loadf uses to linearize them
+inline float const SRGB8_GAMMA = 2.2f;
+
+// the linear value of each of the 256 possible 8 bit components. Filled in at startup rather than on first use,
+// since checking whether a function's static has been initialized on every lookup is measurably slower
+class Srgb8ToLinearTable {
+    public:
+        float values[256];
+
+        Srgb8ToLinearTable() {
+            for (int i = 0; i < 256; i++) {
+                values[i] = std::pow(i / 255.0f, SRGB8_GAMMA);
+            }
+        }
+};
+
+inline Srgb8ToLinearTable const SRGB8_TO_LINEAR;
+
+inline uint8_t linear_to_srgb8(float linear) {
+    float encoded = std::pow(std::min(std::max(linear, 0.0f), 1.0f), 1.0f / SRGB8_GAMMA);
+    return static_cast<uint8_t>(std::lround(encoded * 255.0f));
+}
+
+// IEEE 754 half precision: 1 sign bit, 5 exponent bits and 10 mantissa bits
+inline float half_to_float(uint16_t half) {
+    uint32_t sign = static_cast<uint32_t>(half & 0x8000u) << 16;
+    uint32_t exponent = (half >> 10) & 0x1fu;
+    uint32_t mantissa = half & 0x3ffu;
+
+    uint32_t bits;
+    if (exponent == 0x1fu) {
+        // infinity or NaN
+        bits = sign | 0x7f800000u | (mantissa << 13);
+    } else if (exponent != 0) {
+        bits = sign | ((exponent + (127 - 15)) << 23) | (mantissa << 13);
+    } else if (mantissa == 0) {
+        bits = sign;
+    } else {
+        // subnormal halfs are normal floats, shift the mantissa up until its leading 1 is the implicit bit
+        exponent = 127 - 15 + 1;
+        while ((mantissa & 0x400u) == 0) {
+            mantissa <<= 1;
+            exponent--;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3ffu) << 13);
+    }
+
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+inline uint16_t float_to_half(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    auto sign = static_cast<uint16_t>((bits >> 16) & 0x8000u);
+    uint32_t floatExponent = (bits >> 23) & 0xffu;
+    uint32_t mantissa = bits & 0x7fffffu;
+    int exponent = static_cast<int>(floatExponent) - 127 + 15;
+
+    if (floatExponent == 0xffu) {
+        return sign | 0x7c00u | ((mantissa != 0) ? 0x200u : 0u);
+    }
+    if (exponent >= 0x1f) {
+        // too big, becomes infinity
+        return sign | 0x7c00u;
+    }
+    if (exponent <= 0) {
+        // too small for a normal half, becomes subnormal or 0
+        if (exponent < -10) {
+            return sign;
+        }
+        mantissa |= 0x800000u;
+        int shift = 14 - exponent;
+        uint32_t halfMantissa = mantissa >> shift;
+        // round to nearest
+        halfMantissa += (mantissa >> (shift - 1)) & 1u;
+        return static_cast<uint16_t>(sign | halfMantissa);
+    }
+
+    uint32_t half = sign | (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+    // round to nearest, a carry out of the mantissa correctly moves up to the next exponent
+    half += (mantissa >> 12) & 1u;
+    return static_cast<uint16_t>(half);
+}
 
-    componentsPerRow = COMPONENTS_PER_PIXEL * width;
+// the linear value of a component stored in each of the formats, picked by overloading on the type
+inline float decode_component(uint8_t component) {
+    return SRGB8_TO_LINEAR.values[component];
+}
 
-    STBI_FREE(floatData);
+inline float decode_component(uint16_t component) {
+    return half_to_float(component);
 }
 
-Image::~Image() {
-    delete[] colorData;
+inline float decode_component(float component) {
+    return component;
 }
 
-static int clamp_within(int x, int lowInclusive, int highExclusive) {
+inline int clamp_within(int x, int lowInclusive, int highExclusive) {
     if (x < lowInclusive) return lowInclusive;
     if (x < highExclusive) return x;
     return highExclusive - 1;
 }
 
-double * const Image::color_at(int x, int y) const {
-    if (this->colorData == nullptr) {
+inline Color Image::color_at(int x, int y, int level) const {
+    if (this->_levels.empty()) {
+        return FALLBACK_COLOR;
+    }
+
+    Level const & mip = this->_levels[clamp_within(level, 0, level_count())];
+
+    float texel[COMPONENTS_PER_PIXEL];
+    mip.get(clamp_within(x, 0, mip.width), clamp_within(y, 0, mip.height), texel);
+    return Color(texel[0], texel[1], texel[2]);
+}
+
+inline Color Image::bilinear(double u, double v, int level) const {
+    if (this->_levels.empty()) {
         return FALLBACK_COLOR;
     }
 
-    x = clamp_within(x, 0, width);
-    y = clamp_within(y, 0, height);
+    return this->_levels[clamp_within(level, 0, level_count())].bilinear(u, v);
+}
+
+inline Color Image::trilinear(double u, double v, double footprint) const {
+    if (this->_levels.empty()) {
+        return FALLBACK_COLOR;
+    }
+
+    double level = mip_level(footprint, width, height, level_count());
+
+    int finerLevel = static_cast<int>(level);
+    double coarserWeight = level - finerLevel;
+
+    Color color = this->_levels[finerLevel].bilinear(u, v);
+    if (coarserWeight > 0) {
+        color = ((1 - coarserWeight) * color) + (coarserWeight * this->_levels[finerLevel + 1].bilinear(u, v));
+    }
+
+    return color;
+}
+
+inline int Image::level_count() const {
+    return static_cast<int>(this->_levels.size());
+}
+
+inline int Image::level_width(int level) const {
+    return this->_levels[clamp_within(level, 0, level_count())].width;
+}
+
+inline int Image::level_height(int level) const {
+    return this->_levels[clamp_within(level, 0, level_count())].height;
+}
+
+inline size_t Image::memory_size() const {
+    size_t bytes = 0;
+    for (auto const & level : this->_levels) {
+        bytes += level.memory_size();
+    }
+    return bytes;
+}
+
+inline TexelFormat Image::format() const {
+    return this->_format;
+}
+
+inline void Image::build_mipmaps() {
+    while ((this->_levels.back().width > 1) || (this->_levels.back().height > 1)) {
+        Level const & previous = this->_levels.back();
+        auto next = Level(std::max(1, previous.width / 2), std::max(1, previous.height / 2), this->_format);
+
+        for (int y = 0; y < next.height; y++) {
+            for (int x = 0; x < next.width; x++) {
+                // when the previous level is only 1 texel wide or high, the same texel gets used twice
+                int left = std::min(2 * x, previous.width - 1);
+                int right = std::min((2 * x) + 1, previous.width - 1);
+                int top = std::min(2 * y, previous.height - 1);
+                int bottom = std::min((2 * y) + 1, previous.height - 1);
+
+                // averaged in linear space, so e.g a black and a white texel make a mid grey rather than a dark one
+                float topLeft[COMPONENTS_PER_PIXEL], topRight[COMPONENTS_PER_PIXEL];
+                float bottomLeft[COMPONENTS_PER_PIXEL], bottomRight[COMPONENTS_PER_PIXEL];
+                previous.get(left, top, topLeft);
+                previous.get(right, top, topRight);
+                previous.get(left, bottom, bottomLeft);
+                previous.get(right, bottom, bottomRight);
+
+                float texel[COMPONENTS_PER_PIXEL];
+                for (int c = 0; c < COMPONENTS_PER_PIXEL; c++) {
+                    texel[c] = 0.25f * (topLeft[c] + topRight[c] + bottomLeft[c] + bottomRight[c]);
+                }
+                next.set(x, y, texel);
+            }
+        }
+
+        this->_levels.push_back(std::move(next));
+    }
+}
+
+inline Image::Level::Level(int width, int height, TexelFormat format)
+                   : width(width), height(height), tilesAcross((width + TILE_SIZE - 1) / TILE_SIZE), format(format) {
+    int tilesDown = (height + TILE_SIZE - 1) / TILE_SIZE;
+    size_t components = static_cast<size_t>(this->tilesAcross) * tilesDown * TILE_SIZE * TILE_SIZE * COMPONENTS_PER_PIXEL;
 
-    return colorData + (x * COMPONENTS_PER_PIXEL) + (y * componentsPerRow);
+    switch (format) {
+        case TexelFormat::Srgb8:
+            this->srgb8Texels.resize(components);
+            break;
+        case TexelFormat::Half:
+            this->halfTexels.resize(components);
+            break;
+        case TexelFormat::Float:
+            this->floatTexels.resize(components);
+            break;
+    }
 }
 
+inline size_t Image::Level::texel_index(int x, int y) const {
+    // x and y are never negative, and as unsigned values the divisions become shifts
+    auto column = static_cast<unsigned>(x);
+    auto row = static_cast<unsigned>(y);
+
+    size_t tile = (static_cast<size_t>(row / TILE_SIZE) * this->tilesAcross) + (column / TILE_SIZE);
+    size_t withinTile = ((row % TILE_SIZE) * TILE_SIZE) + (column % TILE_SIZE);
+    return ((tile * TILE_SIZE * TILE_SIZE) + withinTile) * COMPONENTS_PER_PIXEL;
+}
+
+inline void Image::Level::get(int x, int y, float * linear) const {
+    size_t index = texel_index(x, y);
+    for (int c = 0; c < COMPONENTS_PER_PIXEL; c++) {
+        switch (this->format) {
+            case TexelFormat::Srgb8:
+                linear[c] = decode_component(this->srgb8Texels[index + c]);
+                break;
+            case TexelFormat::Half:
+                linear[c] = decode_component(this->halfTexels[index + c]);
+                break;
+            case TexelFormat::Float:
+                linear[c] = decode_component(this->floatTexels[index + c]);
+                break;
+        }
+    }
+}
+
+inline void Image::Level::set(int x, int y, float const * linear) {
+    size_t index = texel_index(x, y);
+    for (int c = 0; c < COMPONENTS_PER_PIXEL; c++) {
+        switch (this->format) {
+            case TexelFormat::Srgb8:
+                this->srgb8Texels[index + c] = linear_to_srgb8(linear[c]);
+                break;
+            case TexelFormat::Half:
+                this->halfTexels[index + c] = float_to_half(linear[c]);
+                break;
+            case TexelFormat::Float:
+                this->floatTexels[index + c] = linear[c];
+                break;
+        }
+    }
+}
+
+inline Color Image::Level::bilinear(double u, double v) const {
+    // switching once per lookup rather than once per component keeps the decoding in bilinear_from inlined
+    switch (this->format) {
+        case TexelFormat::Srgb8:
+            return bilinear_from(this->srgb8Texels, u, v);
+        case TexelFormat::Half:
+            return bilinear_from(this->halfTexels, u, v);
+        case TexelFormat::Float:
+        default:
+            return bilinear_from(this->floatTexels, u, v);
+    }
+}
+
+inline size_t Image::Level::memory_size() const {
+    return (this->srgb8Texels.size() * sizeof(uint8_t)) + (this->halfTexels.size() * sizeof(uint16_t))
+           + (this->floatTexels.size() * sizeof(float));
+}
+
+template <typename ComponentT>
+Color Image::Level::bilinear_from(std::vector<ComponentT> const & texels, double u, double v) const {
+    // texel centers are at the halves, e.g the first texel covers 0 to 1 so its center is at 0.5
+    double x = (u * this->width) - 0.5;
+    double y = (v * this->height) - 0.5;
+
+    int left = static_cast<int>(std::floor(x));
+    int top = static_cast<int>(std::floor(y));
+    float xWeight = static_cast<float>(x - left);
+    float yWeight = static_cast<float>(y - top);
+
+    int right = clamp_within(left + 1, 0, this->width);
+    int bottom = clamp_within(top + 1, 0, this->height);
+    left = clamp_within(left, 0, this->width);
+    top = clamp_within(top, 0, this->height);
+
+    ComponentT const * topLeft = texels.data() + texel_index(left, top);
+    ComponentT const * topRight = texels.data() + texel_index(right, top);
+    ComponentT const * bottomLeft = texels.data() + texel_index(left, bottom);
+    ComponentT const * bottomRight = texels.data() + texel_index(right, bottom);
+
+    float blended[COMPONENTS_PER_PIXEL];
+    for (int c = 0; c < COMPONENTS_PER_PIXEL; c++) {
+        float topLeftValue = decode_component(topLeft[c]);
+        float bottomLeftValue = decode_component(bottomLeft[c]);
+        float topValue = topLeftValue + (xWeight * (decode_component(topRight[c]) - topLeftValue));
+        float bottomValue = bottomLeftValue + (xWeight * (decode_component(bottomRight[c]) - bottomLeftValue));
+        blended[c] = topValue + (yWeight * (bottomValue - topValue));
+    }
+
+    return Color(blended[0], blended[1], blended[2]);
+}
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,152 @@
+#ifndef INSTANCE_H
+#define INSTANCE_H
+
+#include <memory>
+
+#include "hittable.h"
+#include "ray.h"
+#include "aabb.h"
+#include "interval.h"
+#include "affine_transform.h"
+#include "transformer.h"
+
+// wrap around a Hittable to apply any combination of rotation, scale and translation to it.
+// like the other transformers, rather than moving the object it moves the ray into the object's coordinates,
+// but the whole transformation is a single precomputed matrix (and its inverse) rather than a chain of
+// transformers, each with its own virtual call and ray rebuild.
+class Instance final : public Transformer {
+    public:
+        Instance(std::shared_ptr<Hittable> const & target, AffineTransform const & objectToWorld);
+
+        virtual bool hit(Ray const & ray, Interval const & rayLimits, HitResult & result) const override;
+
+        virtual bool occluded(Ray const & ray, Interval const & rayLimits) const override;
+
+        virtual bool hit_interval(Ray const & ray, Interval const & rayLimits, Interval & inside) const override;
+
+        virtual Aabb bounding_box() const override;
+
+        virtual Aabb bounding_box_at(double time) const override;
+
+        // for using an instance of a light in a LightList. Only right for rigid transformations, since scaling or
+        // shearing the target changes how big it looks from the origin
+        virtual double pdf_value(Point3 const & origin, Vec3 const & direction) const override;
+        virtual Vec3 random_direction(Point3 const & origin) const override;
+
+        virtual std::shared_ptr<Hittable> const & target() const override;
+
+        virtual AffineTransform object_to_world() const override;
+
+        // moves the instance somewhere else, without having to create a new one
+        void set_object_to_world(AffineTransform const & objectToWorld);
+
+    private:
+        std::shared_ptr<Hittable> _target;
+        AffineTransform _objectToWorld;
+        AffineTransform _worldToObject;
+        // whether normals need re-normalizing after being transformed, which is only the case if there's scaling
+        bool _isRigid;
+        Aabb _boundingBox;
+
+        Ray to_object_space(Ray const & ray) const;
+};
+
+// if the hittable is a chain of transformers, returns a single Instance that does the same thing as all of them,
+// otherwise returns the hittable as is
+std::shared_ptr<Hittable> flatten_transformers(std::shared_ptr<Hittable> const & hittable);
+
+// ------
+
+inline Instance::Instance(std::shared_ptr<Hittable> const & target, AffineTransform const & objectToWorld) : _target(target) {
+    set_object_to_world(objectToWorld);
+}
+
+// the direction isn't normalised after being transformed, which keeps t the same in both coordinate systems
+inline Ray Instance::to_object_space(Ray const & ray) const {
+    return Ray(this->_worldToObject.transform_point(ray.orig), this->_worldToObject.transform_vector(ray.dir), ray.time);
+}
+
+inline bool Instance::hit(Ray const & ray, Interval const & rayLimits, HitResult & result) const {
+    auto transformedRay = to_object_space(ray);
+
+    if (!this->_target->hit(transformedRay, rayLimits, result)) {
+        return false;
+    }
+
+    result.point = this->_objectToWorld.transform_point(result.point);
+
+    // the normal is transformed by the inverse transpose, which keeps it perpendicular to the surface
+    // even when the object is being scaled unevenly
+    result.normal = this->_worldToObject.transform_vector_transposed(result.normal);
+    if (!this->_isRigid) {
+        result.normal = result.normal.unit();
+    }
+
+    return true;
+}
+
+inline bool Instance::occluded(Ray const & ray, Interval const & rayLimits) const {
+    return this->_target->occluded(to_object_space(ray), rayLimits);
+}
+
+// t is the same in both coordinate systems, so the interval doesn't need transforming back
+inline bool Instance::hit_interval(Ray const & ray, Interval const & rayLimits, Interval & inside) const {
+    return this->_target->hit_interval(to_object_space(ray), rayLimits, inside);
+}
+
+inline Aabb Instance::bounding_box() const {
+    return this->_boundingBox;
+}
+
+inline Aabb Instance::bounding_box_at(double time) const {
+    return this->_objectToWorld.transform_box(this->_target->bounding_box_at(time));
+}
+
+inline double Instance::pdf_value(Point3 const & origin, Vec3 const & direction) const {
+    return this->_target->pdf_value(this->_worldToObject.transform_point(origin), this->_worldToObject.transform_vector(direction));
+}
+
+inline Vec3 Instance::random_direction(Point3 const & origin) const {
+    return this->_objectToWorld.transform_vector(this->_target->random_direction(this->_worldToObject.transform_point(origin)));
+}
+
+inline std::shared_ptr<Hittable> const & Instance::target() const {
+    return this->_target;
+}
+
+inline AffineTransform Instance::object_to_world() const {
+    return this->_objectToWorld;
+}
+
+inline void Instance::set_object_to_world(AffineTransform const & objectToWorld) {
+    this->_objectToWorld = objectToWorld;
+    this->_worldToObject = objectToWorld.inverse();
+    this->_isRigid = objectToWorld.is_rigid();
+    this->_boundingBox = objectToWorld.transform_box(this->_target->bounding_box());
+}
+
+inline std::shared_ptr<Hittable> flatten_transformers(std::shared_ptr<Hittable> const & hittable) {
+    auto transformer = std::dynamic_pointer_cast<Transformer>(hittable);
+    if (!transformer) {
+        return hittable;
+    }
+
+    // nothing to flatten if its just the one Instance
+    if (std::dynamic_pointer_cast<Instance>(hittable) && !std::dynamic_pointer_cast<Transformer>(transformer->target())) {
+        return hittable;
+    }
+
+    // going from the outermost transformer inwards, so each transformation is applied before the previous ones
+    AffineTransform objectToWorld;
+    std::shared_ptr<Hittable> target = hittable;
+
+    while (transformer) {
+        objectToWorld = objectToWorld * transformer->object_to_world();
+        target = transformer->target();
+        transformer = std::dynamic_pointer_cast<Transformer>(target);
+    }
+
+    return std::make_shared<Instance>(target, objectToWorld);
+}
+
+#endif
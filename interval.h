@@ -35,47 +35,47 @@ Interval operator+(double left, Interval const & right);
 
 // ------
 
-Interval const Interval::empty = Interval(std::numeric_limits<double>::infinity(),
+inline Interval const Interval::empty = Interval(std::numeric_limits<double>::infinity(),
                                           -std::numeric_limits<double>::infinity());
-Interval const Interval::universe = Interval(-std::numeric_limits<double>::infinity(),
+inline Interval const Interval::universe = Interval(-std::numeric_limits<double>::infinity(),
                                              std::numeric_limits<double>::infinity());
 
-Interval::Interval() : min(empty.min), max(empty.max) { }
+inline Interval::Interval() : min(empty.min), max(empty.max) { }
 
-Interval::Interval(double mn, double mx) : min(mn), max(mx) { }
+inline Interval::Interval(double mn, double mx) : min(mn), max(mx) { }
 
-Interval::Interval(Interval const & intervalA, Interval const & intervalB)
+inline Interval::Interval(Interval const & intervalA, Interval const & intervalB)
                   : min(fmin(intervalA.min, intervalB.min)), max(fmax(intervalA.max, intervalB.max)) { }
 
-bool Interval::contains(double x) const {
+inline bool Interval::contains(double x) const {
     return (this->min <= x) && (x <= this->max);
 }
 
 // same as contains but exclusive
-bool Interval::surrounds(double x) const {
+inline bool Interval::surrounds(double x) const {
     return (this->min < x) && (x < this->max);
 }
 
-double Interval::clamp(double x) const {
+inline double Interval::clamp(double x) const {
     if (x < min) return min;
     if (x > max) return max;
     return x;
 }
 
-double Interval::size() const {
+inline double Interval::size() const {
     return this->max - this->min;
 }
 
-Interval Interval::expand(double amount) const {
+inline Interval Interval::expand(double amount) const {
     auto halfAmount = amount / 2;
     return Interval(this->min - halfAmount, this->max + halfAmount);
 }
 
-Interval Interval::operator+(double right) {
+inline Interval Interval::operator+(double right) {
     return Interval(this->min + right, this->max + right);
 }
 
-Interval operator+(double left, Interval & right) {
+inline Interval operator+(double left, Interval & right) {
     return right + left;
 }
 
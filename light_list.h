@@ -0,0 +1,167 @@
+#ifndef LIGHT_LIST_H
+#define LIGHT_LIST_H
+
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "hittable.h"
+#include "hittable_list.h"
+#include "material.h"
+#include "sphere.h"
+#include "quad.h"
+#include "primitive_list.h"
+#include "bvh_node.h"
+#include "instance.h"
+#include "affine_transform.h"
+#include "random.h"
+
+// the hittables in a scene that emit light, for sampling them directly (see ray_color) instead of hoping that
+// rays will randomly bounce into them. Each light is equally likely to be picked when sampling a direction
+class LightList {
+    public:
+        std::vector<std::shared_ptr<Hittable>> lights;
+
+        LightList();
+        // finds every sphere and quad in the world that has a DiffuseLightMaterial, looking inside of hittable lists,
+        // primitive lists, BVHs and transformers. Lights inside of anything else (e.g a TopLevelBvh) aren't found,
+        // use add() for those. Lights that are scaled or sheared are skipped, since their pdf_value can't be worked
+        // out from the untransformed light's, they're still lit by rays that happen to bounce into them
+        LightList(HittableList const & world);
+
+        void add(std::shared_ptr<Hittable> const & light);
+
+        bool empty() const;
+
+        // the density of random_direction picking the given direction, i.e the average over all the lights
+        double pdf_value(Point3 const & origin, Vec3 const & direction) const;
+
+        // a direction from the origin towards a random point on a random light
+        Vec3 random_direction(Point3 const & origin) const;
+
+        // the closest of the lights that the ray hits, ignoring everything else in the world
+        bool hit(Ray const & ray, Interval const & rayLimits, HitResult & result) const;
+
+    private:
+        // adds the lights in the object, which is placed in the world by objectToWorld if isTransformed
+        void collect(std::shared_ptr<Hittable> const & object, AffineTransform const & objectToWorld, bool isTransformed);
+
+        void collect(PrimitiveList const & list, AffineTransform const & objectToWorld, bool isTransformed);
+
+        void add_light(std::shared_ptr<Hittable> const & light, AffineTransform const & objectToWorld, bool isTransformed);
+
+        static bool is_light(std::shared_ptr<Material> const & material);
+};
+
+// ------
+
+inline LightList::LightList() : lights() { }
+
+inline LightList::LightList(HittableList const & world) : LightList() {
+    for (auto const & object : world.objects) {
+        collect(object, AffineTransform(), false);
+    }
+}
+
+inline void LightList::add(std::shared_ptr<Hittable> const & light) {
+    this->lights.push_back(light);
+}
+
+inline bool LightList::empty() const {
+    return this->lights.empty();
+}
+
+inline double LightList::pdf_value(Point3 const & origin, Vec3 const & direction) const {
+    double total = 0;
+    for (auto const & light : this->lights) {
+        total += light->pdf_value(origin, direction);
+    }
+
+    return total / this->lights.size();
+}
+
+inline Vec3 LightList::random_direction(Point3 const & origin) const {
+    auto lightIndex = static_cast<size_t>(random_int(0, this->lights.size() - 1));
+    return this->lights[lightIndex]->random_direction(origin);
+}
+
+inline bool LightList::hit(Ray const & ray, Interval const & rayLimits, HitResult & result) const {
+    bool hitAnything = false;
+    double closestSoFar = rayLimits.max;
+
+    for (auto const & light : this->lights) {
+        if (light->hit(ray, Interval(rayLimits.min, closestSoFar), result)) {
+            hitAnything = true;
+            closestSoFar = result.t;
+        }
+    }
+
+    return hitAnything;
+}
+
+inline void LightList::collect(std::shared_ptr<Hittable> const & object, AffineTransform const & objectToWorld,
+                               bool isTransformed) {
+    if (auto sphere = std::dynamic_pointer_cast<Sphere>(object)) {
+        if (is_light(sphere->material)) {
+            add_light(object, objectToWorld, isTransformed);
+        }
+    } else if (auto quad = std::dynamic_pointer_cast<Quad>(object)) {
+        if (is_light(quad->material())) {
+            add_light(object, objectToWorld, isTransformed);
+        }
+    } else if (auto list = std::dynamic_pointer_cast<HittableList>(object)) {
+        for (auto const & innerObject : list->objects) {
+            collect(innerObject, objectToWorld, isTransformed);
+        }
+    } else if (auto primitives = std::dynamic_pointer_cast<PrimitiveList>(object)) {
+        collect(*primitives, objectToWorld, isTransformed);
+    } else if (auto bvh = std::dynamic_pointer_cast<BvhNode>(object)) {
+        collect(*bvh->primitives(), objectToWorld, isTransformed);
+    } else if (auto transformer = std::dynamic_pointer_cast<Transformer>(object)) {
+        collect(transformer->target(), objectToWorld * transformer->object_to_world(), true);
+    }
+}
+
+// the list stores its spheres and quads by value, so the lights among them are copied out
+inline void LightList::collect(PrimitiveList const & list, AffineTransform const & objectToWorld, bool isTransformed) {
+    for (auto const & sphere : list.spheres) {
+        if (is_light(sphere.material)) {
+            add_light(std::make_shared<Sphere>(sphere), objectToWorld, isTransformed);
+        }
+    }
+
+    for (auto const & quad : list.quads) {
+        if (is_light(quad.material())) {
+            add_light(std::make_shared<Quad>(quad), objectToWorld, isTransformed);
+        }
+    }
+
+    for (auto const & instance : list.instances) {
+        collect(instance.target(), objectToWorld * instance.object_to_world(), true);
+    }
+
+    for (auto const & other : list.others) {
+        collect(other, objectToWorld, isTransformed);
+    }
+}
+
+inline void LightList::add_light(std::shared_ptr<Hittable> const & light, AffineTransform const & objectToWorld,
+                                 bool isTransformed) {
+    if (!isTransformed) {
+        add(light);
+        return;
+    }
+
+    if (!objectToWorld.is_rigid()) {
+        std::clog << "Not sampling a light that's scaled or sheared, it's only lit by rays that bounce into it\n";
+        return;
+    }
+
+    add(std::make_shared<Instance>(light, objectToWorld));
+}
+
+inline bool LightList::is_light(std::shared_ptr<Material> const & material) {
+    return material && (material->type() == MaterialType::DiffuseLight);
+}
+
+#endif
@@ -1,25 +1,21 @@
+// stb_image's functions are defined in this file (see image.h)
+#define STB_IMAGE_IMPLEMENTATION
+#include "image.h"
+
+#include <cstring>
 #include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
 #include <thread>
 #include <stdlib.h>
 
-#include "vec3.h"
-#include "color.h"
-#include "random.h"
-
-#include "ray.h"
-
-#include "hittable.h"
-#include "texture.h"
-#include "material.h"
-#include "sphere.h"
-#include "hittable_list.h"
-#include "aabb.h"
-#include "bvh_node.h"
-#include "quad.h"
-#include "constant_medium.h"
-#include "transformer.h"
-
-#include "camera.h"
+#include "scenes.h"
+#include "primitive_list.h"
+#include "dynamic_bvh.h"
+#include "sequence_renderer.h"
+#include "trace.h"
 
 using namespace std::chrono_literals;
 
@@ -31,336 +27,164 @@ void post_initialize(Camera const & camera) {
     std::cout << "P3\n" << camera.imageWidth << " " << camera.imageHeight << "\n255\n";
 }
 
-void random_spheres() {
-    auto world = HittableList();
+void render_scene(Scene scene) {
+    scene.camera.render(scene.build_world(), post_initialize, write_ppm_color);
+
+    if (scene.rendered) {
+        scene.rendered();
+    }
+}
+
+// an animation of a few spheres bouncing around a field of still ones, rendered as a sequence of frames
+// (frame_000.ppm, frame_001.ppm, ...) into the current directory. The BVH is refitted between frames, and only
+// rebuilt when the bouncing spheres have moved far enough to make the refitted tree too slow
+void bouncing_spheres() {
+    auto world = std::make_shared<HittableList>();
+    auto primitives = std::make_shared<PrimitiveList>();
+    auto materials = MaterialTable();
 
-    // ground
+    // the ground never moves, and is so big it would make every other box in the tree look small in comparison,
+    // so it's kept out of the tree that gets refitted
     auto groundTexture = std::make_shared<CheckeredTexture>(0.32, Color(0.2, 0.3, 0.1), Color(0.9, 0.9, 0.9));
-    world.add(std::make_shared<Sphere>(Point3(0.0, -1000, 0),
-                                       1000,
-                                       std::make_shared<LambertianMaterial>(groundTexture)));
+    world->add(std::make_shared<Sphere>(Point3(0.0, -1000, 0), 1000, materials.make<LambertianMaterial>(groundTexture)));
 
     for (int x = -11; x < 11; x++) {
         for (int z = -11; z < 11; z++) {
-            auto randomMaterialChoice = random_double();
             auto sphereCenter = Point3(x + (0.9 * random_double()), 0.2, z + (0.9 * random_double()));
-
-            if ((sphereCenter - Point3(4, 0.2, 0)).length() > 0.9) {
-                std::shared_ptr<Material> randomizedMaterial;
-
-                if (randomMaterialChoice < 0.8) {
-                    // diffuse
-                    randomizedMaterial = std::make_shared<LambertianMaterial>(Color::random());
-                } else if (randomMaterialChoice < 0.95) {
-                    // metal
-                    randomizedMaterial = std::make_shared<MetalMaterial>(Color::random(0.5, 1), random_double(0, 0.5));
-                } else {
-                    // glass
-                    randomizedMaterial = std::make_shared<DielectricMaterial>(1.5);
-                }
-
-                world.add(std::make_shared<Sphere>(sphereCenter,
-                                                   sphereCenter + Point3(0, random_double(0, 0.5), 0),
-                                                   0.2,
-                                                   randomizedMaterial));
-            }
+            primitives->add(Sphere(sphereCenter, 0.2, materials.make<LambertianMaterial>(Color::random())));
         }
     }
 
-    // dielectric bubble
-    // two dielectrics inside each other, with the one inside being "inside out"
-    world.add(std::make_shared<Sphere>(Point3(-8, 1, 0),
-                                       1,
-                                       std::make_shared<DielectricMaterial>(1.5)));
-    world.add(std::make_shared<Sphere>(Point3(-8, 1, 0),
-                                       -0.95,
-                                       std::make_shared<DielectricMaterial>(1.5)));
-
-    // diffuse
-    world.add(std::make_shared<Sphere>(Point3(-4, 1, 0),
-                                       1,
-                                       std::make_shared<LambertianMaterial>(Color(0.4, 0.2, 0.1))));
-
-    // dielectric
-    world.add(std::make_shared<Sphere>(Point3(0, 1, 0),
-                                       1,
-                                       std::make_shared<DielectricMaterial>(1.5)));
-
-    // metallic
-    world.add(std::make_shared<Sphere>(Vec3(4, 1, 0),
-                                       1,
-                                       std::make_shared<MetalMaterial>(Color(0.7, 0.6, 0.5), 0)));
-
-    std::clog << "World contains objects: \n"
-              << world
-              << "\n" << std::flush;
-
-    Camera camera = Camera();
-
-    camera.cameraOrigin = Point3(7, 2, 6);
-    camera.cameraTarget = Point3(0, 0, 0);
-
-    camera.render(std::make_shared<BvhNode>(world), post_initialize, write_ppm_color);
-}
+    // the spheres that move, each one bouncing along the ground in a straight line from one side of the field
+    // to the other
+    class BouncingSphere {
+        public:
+            PrimitiveRef ref;
+            Point3 start;
+            Vec3 velocity;
+            double bounceHeight;
+    };
+
+    std::vector<BouncingSphere> bouncers;
+    for (int i = 0; i < 6; i++) {
+        auto start = Point3(random_double(-10, 10), 0, random_double(-10, 10));
+        auto velocity = Vec3(random_double(-6, 6), 0, random_double(-6, 6));
+
+        auto material = (i % 2 == 0) ? std::static_pointer_cast<Material>(materials.make<MetalMaterial>(Color::random(0.5, 1), 0))
+                                     : std::static_pointer_cast<Material>(materials.make<LambertianMaterial>(Color::random()));
+
+        bouncers.push_back(BouncingSphere{primitives->add(Sphere(start, 0.7, material)), start, velocity, random_double(1, 3)});
+    }
 
-void checkered_spheres() {
-    auto world = HittableList();
+    auto position_at = [](BouncingSphere const & bouncer, double time) {
+        double bounce = fabs(sin(time * PI));
+        return bouncer.start + (time * bouncer.velocity) + Vec3(0, 0.7 + (bouncer.bounceHeight * bounce), 0);
+    };
 
-    auto groundTexture = std::make_shared<CheckeredTexture>(0.32, Color(0.2, 0.3, 0.1), Color(0.9, 0.9, 0.9));
-    world.add(std::make_shared<Sphere>(Point3(0, -10, 0),
-                                       10,
-                                       std::make_shared<LambertianMaterial>(groundTexture)));
-    world.add(std::make_shared<Sphere>(Point3(0, 10, 0),
-                                       10,
-                                       std::make_shared<LambertianMaterial>(groundTexture)));
+    auto movingSpheres = std::make_shared<DynamicBvh>(primitives);
+    world->add(movingSpheres);
 
     Camera camera = Camera();
 
-    camera.cameraOrigin = Point3(13, 2, 3);
-    camera.cameraTarget = Point3(0, 0, 0);
-    camera.fieldOfView = 20;
+    camera.aspectRatio = 16.0 / 9.0;
     camera.imageWidth = 400;
-
-    camera.render(std::make_shared<BvhNode>(world), post_initialize, write_ppm_color);
-}
-
-void earth() {
-    auto earthGlobe = std::make_shared<Sphere>(Point3(0, 0, 0),
-                                               2,
-                                               std::make_shared<LambertianMaterial>(
-                                                    std::make_shared<ImageTexture>("./earthmap.jpg")));
-
-    Camera camera = Camera();
-
-    camera.cameraOrigin = Point3(0, 0, 12);
-    camera.cameraTarget = Point3(0, 0, 0);
+    camera.aaSamples = 10;
     camera.fieldOfView = 20;
-    camera.imageWidth = 600;
-
-    camera.render(std::make_shared<HittableList>(earthGlobe), post_initialize, write_ppm_color);
-}
-
-void two_spheres() {
-    auto world = HittableList();
-
-    // ground
-    auto groundTexture = std::make_shared<CheckeredTexture>(0.32, Color(0.2, 0.3, 0.1), Color(0.9, 0.9, 0.9));
-    world.add(std::make_shared<Sphere>(Point3(0, -10, 0),
-                                       10,
-                                       std::make_shared<LambertianMaterial>(groundTexture)));
-    world.add(std::make_shared<Sphere>(Point3(0, 10, 0),
-                                       10,
-                                       std::make_shared<LambertianMaterial>(groundTexture)));
-
-    std::clog << "World contains objects: \n"
-              << world
-              << "\n" << std::flush;
-
-    Camera camera = Camera();
-
-    camera.cameraOrigin = Point3(7, 2, 6);
-    camera.cameraTarget = Point3(0, 0, 0);
-
-    camera.render(std::make_shared<BvhNode>(world), post_initialize, write_ppm_color);
-}
-
-void quads() {
-    auto world = HittableList();
-
-    world.add(std::make_shared<Quad>(Point3(-3, -2, 5),
-                                     Vec3(0, 0,-4),
-                                     Vec3(0, 4, 0),
-                                     std::make_shared<LambertianMaterial>(Color(1.0, 0.2, 0.2))));
-    world.add(std::make_shared<Quad>(Point3(-2, -2, 0),
-                                     Vec3(4, 0, 0),
-                                     Vec3(0, 4, 0),
-                                     std::make_shared<LambertianMaterial>(Color(0.2, 1.0, 0.2))));
-    world.add(std::make_shared<Quad>(Point3(3, -2, 1),
-                                     Vec3(0, 0, 4),
-                                     Vec3(0, 4, 0),
-                                     std::make_shared<LambertianMaterial>(Color(0.2, 0.2, 1.0))));
-    world.add(std::make_shared<Quad>(Point3(-2, 3, 1),
-                                     Vec3(4, 0, 0),
-                                     Vec3(0, 0, 4),
-                                     std::make_shared<LambertianMaterial>(Color(1.0, 0.5, 0.0))));
-    world.add(std::make_shared<Quad>(Point3(-2, -3, 5),
-                                     Vec3(4, 0, 0),
-                                     Vec3(0, 0, -4),
-                                     std::make_shared<LambertianMaterial>(Color(0.2, 0.8, 0.8))));
-
-    std::clog << "World contains objects: \n"
-              << world
-              << "\n" << std::flush;
-
-    Camera camera = Camera();
-
-    camera.aspectRatio = 1.0;
-    camera.imageWidth = 500;
-    camera.cameraOrigin = Point3(0, 0, 9);
+    camera.cameraOrigin = Point3(13, 2, 3);
     camera.cameraTarget = Point3(0, 0, 0);
 
-    camera.render(std::make_shared<BvhNode>(world), post_initialize, write_ppm_color);
-}
+    double const framesPerSecond = 12;
+    // how much of the time between frames the camera's shutter is open for, which decides how much motion blur
+    // there is
+    double const shutter = 0.5;
 
-void simple_lights() {
-    auto world = HittableList();
-
-    world.add(std::make_shared<Sphere>(Point3(0,2,0),
-                                       2,
-                                       std::make_shared<LambertianMaterial>(Color(0.2, 0.2, 1.0))));
-    // ground
-    auto checkeredTexture = std::make_shared<CheckeredTexture>(0.32, Color(1, 1, 1), Color(0.9, 0.1, 0.9));
-    world.add(std::make_shared<Quad>(Point3(-10, 0, -10),
-                                     Vec3(0, 0, 20),
-                                     Vec3(20, 0, 0),
-                                     std::make_shared<LambertianMaterial>(checkeredTexture)));
-
-    // light
-    world.add(std::make_shared<Quad>(Point3(3, 2, -2),
-                                     Vec3(2, 0, 0),
-                                     Vec3(0, 2, 0),
-                                     std::make_shared<DiffuseLightMaterial>(Color(4, 4, 4))));
-    world.add(std::make_shared<Sphere>(Point3(0, 7, 0),
-                                       2,
-                                       std::make_shared<DiffuseLightMaterial>(Color(5, 0, 0))));
-
-    std::clog << "World contains objects: \n"
-              << world
-              << "\n" << std::flush;
+    double totalBuildMilliseconds = 0;
+    double totalRefitMilliseconds = 0;
 
-    Camera camera = Camera();
+    auto renderer = SequenceRenderer();
+    renderer.frameCount = 24;
+    // the spheres are moved in place, so each frame has to finish before the next one can move them again
+    renderer.framesInFlight = 1;
+    renderer.setupFrame = [&](int frame) {
+        double frameTime = frame / framesPerSecond;
 
-    camera.cameraOrigin = Point3(6, 3, 6);
-    camera.cameraTarget = Point3(0, 2, 0);
-    camera.backgroundColor = Color(0, 0, 0);
+        for (auto const & bouncer : bouncers) {
+            primitives->spheres[bouncer.ref.index].set_center(position_at(bouncer, frameTime),
+                                                              position_at(bouncer, frameTime + (shutter / framesPerSecond)));
+        }
 
-    camera.render(std::make_shared<BvhNode>(world), post_initialize, write_ppm_color);
-}
+        auto stats = movingSpheres->update();
+        totalBuildMilliseconds += stats.buildMilliseconds;
+        totalRefitMilliseconds += stats.refitMilliseconds;
 
-void cornell_box() {
-    auto world = HittableList();
-
-    auto red   = std::make_shared<LambertianMaterial>(Color(0.65, 0.05, 0.05));
-    auto white = std::make_shared<LambertianMaterial>(Color(0.73, 0.73, 0.73));
-    auto green = std::make_shared<LambertianMaterial>(Color(0.12, 0.45, 0.15));
-    auto light = std::make_shared<DiffuseLightMaterial>(Color(15, 15, 15));
-
-    // walls
-    world.add(std::make_shared<Quad>(Point3(555, 0, 0),
-                                     Vec3(0, 555, 0),
-                                     Vec3(0, 0, 555),
-                                     green));
-    world.add(std::make_shared<Quad>(Point3(0, 0, 0),
-                                     Vec3(0, 555, 0),
-                                     Vec3(0, 0, 555),
-                                     red));
-    world.add(std::make_shared<Quad>(Point3(343, 554, 332),
-                                     Vec3(-130, 0, 0),
-                                     Vec3(0, 0, -105),
-                                     light));
-    world.add(std::make_shared<Quad>(Point3(0, 0, 0),
-                                     Vec3(555, 0, 0),
-                                     Vec3(0, 0, 555),
-                                     white));
-    world.add(std::make_shared<Quad>(Point3(555, 555, 555),
-                                     Vec3(-555, 0, 0),
-                                     Vec3(0, 0, -555),
-                                     white));
-    world.add(std::make_shared<Quad>(Point3(0, 0, 555),
-                                     Vec3(555, 0, 0),
-                                     Vec3(0, 555, 0),
-                                     white));
-
-    // boxes
-    std::shared_ptr<Hittable> box1 = make_box(Point3(0, 0, 0), Point3(165, 330, 165), white);
-    box1 = std::make_shared<RotateYTransformer>(box1, 15);
-    box1 = std::make_shared<TranslateTransformer>(box1, Vec3(265, 0, 295));
-    world.add(box1);
-
-    std::shared_ptr<Hittable> box2 = make_box(Point3(0, 0, 0), Point3(165, 165, 165), white);
-    box2 = std::make_shared<RotateYTransformer>(box2, -18);
-    box2 = std::make_shared<TranslateTransformer>(box2, Vec3(130, 0, 65));
-    world.add(box2);
-
-    std::clog << "World contains objects: \n"
-              << world
-              << "\n" << std::flush;
+        std::clog << "Frame " << frame << ": " << stats << "\n" << std::flush;
 
-    Camera camera = Camera();
+        return SequenceFrame{camera, world};
+    };
+    renderer.render();
 
-    camera.aspectRatio = 1.0;
-    camera.imageWidth = 600;
-    camera.fieldOfView = 40;
-    camera.cameraOrigin = Point3(278, 278, -800);
-    camera.cameraTarget = Point3(278, 278, 0);
-    camera.aaSamples = 50;
-    camera.backgroundColor = Color(0, 0, 0);
-
-    camera.render(std::make_shared<BvhNode>(world), post_initialize, write_ppm_color);
+    std::clog << "Total build: " << totalBuildMilliseconds << "ms, total refit: " << totalRefitMilliseconds << "ms\n";
 }
 
-void cornell_smoke() {
-    auto world = HittableList();
-
-    auto red   = std::make_shared<LambertianMaterial>(Color(0.65, 0.05, 0.05));
-    auto white = std::make_shared<LambertianMaterial>(Color(0.73, 0.73, 0.73));
-    auto green = std::make_shared<LambertianMaterial>(Color(0.12, 0.45, 0.15));
-    auto light = std::make_shared<DiffuseLightMaterial>(Color(7, 7, 7));
-
-    // walls
-    world.add(std::make_shared<Quad>(Point3(555, 0, 0),
-                                     Vec3(0, 555, 0),
-                                     Vec3(0, 0, 555),
-                                     green));
-    world.add(std::make_shared<Quad>(Point3(0, 0, 0),
-                                     Vec3(0, 555, 0),
-                                     Vec3(0, 0, 555),
-                                     red));
-    world.add(std::make_shared<Quad>(Point3(113, 554, 127),
-                                     Vec3(330, 0, 0),
-                                     Vec3(0, 0, 305),
-                                     light));
-    world.add(std::make_shared<Quad>(Point3(0, 555, 0),
-                                     Vec3(555, 0, 0),
-                                     Vec3(0, 0, 555),
-                                     white));
-    world.add(std::make_shared<Quad>(Point3(0, 0, 0),
-                                     Vec3(555, 0, 0),
-                                     Vec3(0, 0, 555),
-                                     white));
-    world.add(std::make_shared<Quad>(Point3(0, 0, 555),
-                                     Vec3(555, 0, 0),
-                                     Vec3(0, 555, 0),
-                                     white));
-
-    // boxes
-    std::shared_ptr<Hittable> box1 = make_box(Point3(0, 0, 0), Point3(165, 330, 165), white);
-    box1 = std::make_shared<RotateYTransformer>(box1, 15);
-    box1 = std::make_shared<TranslateTransformer>(box1, Vec3(265, 0, 295));
-    world.add(std::make_shared<ConstantMedium>(box1, 0.01, Color(0, 0, 0)));
-
-    std::shared_ptr<Hittable> box2 = make_box(Point3(0, 0, 0), Point3(165, 165, 165), white);
-    box2 = std::make_shared<RotateYTransformer>(box2, -18);
-    box2 = std::make_shared<TranslateTransformer>(box2, Vec3(130, 0, 65));
-    world.add(std::make_shared<ConstantMedium>(box2, 0.01, Color(1, 1, 1)));
-
-    std::clog << "World contains objects: \n"
-              << world
-              << "\n" << std::flush;
-
-    std::clog << "Universe: " << Interval::universe.min << ", " << Interval::universe.max << "\n";
-
-    Camera camera = Camera();
+// an animation of a field of instanced boxes spinning in place while the camera circles around them, rendered as
+// a sequence of frames (frame_000.ppm, frame_001.ppm, ...) into the current directory.
+// the box and its BVH are shared by every frame, each frame only builds a new top level BVH over the instances
+void spinning_boxes() {
+    auto materials = MaterialTable();
+
+    auto ground = std::make_shared<Quad>(Point3(-1000, 0, -1000), Vec3(2000, 0, 0), Vec3(0, 0, 2000),
+                                         materials.make<LambertianMaterial>(Color(0.48, 0.83, 0.53)));
+
+    auto box = TopLevelBvh::build_bottom_level(*make_box(Point3(-1, -1, -1), Point3(1, 1, 1),
+                                                         materials.make<LambertianMaterial>(Color(0.73, 0.73, 0.73))));
+
+    class SpinningBox {
+        public:
+            Vec3 position;
+            Vec3 axis;
+            // degrees per frame
+            double speed;
+    };
+
+    std::vector<SpinningBox> spinningBoxes;
+    int const boxesPerSide = 15;
+    for (int x = 0; x < boxesPerSide; x++) {
+        for (int z = 0; z < boxesPerSide; z++) {
+            spinningBoxes.push_back(SpinningBox{Vec3(-42 + (x * 6), 2, -42 + (z * 6)),
+                                                Vec3(random_double(-1, 1), random_double(-1, 1), random_double(-1, 1)),
+                                                random_double(-10, 10)});
+        }
+    }
 
-    camera.aspectRatio = 1.0;
-    camera.imageWidth = 600;
-    camera.fieldOfView = 40;
-    camera.cameraOrigin = Point3(278, 278, -800);
-    camera.cameraTarget = Point3(278, 278, 0);
-    camera.aaSamples = 50;
-    camera.backgroundColor = Color(0, 0, 0);
+    int const frames = 36;
 
-    camera.render(std::make_shared<BvhNode>(world), post_initialize, write_ppm_color);
+    auto renderer = SequenceRenderer();
+    renderer.frameCount = frames;
+    renderer.setupFrame = [&](int frame) {
+        auto boxes = std::make_shared<TopLevelBvh>();
+        for (auto const & spinningBox : spinningBoxes) {
+            boxes->add_instance(box, AffineTransform::translate(spinningBox.position)
+                                   * AffineTransform::rotate(spinningBox.axis, spinningBox.speed * frame));
+        }
+        boxes->build();
+
+        auto world = std::make_shared<HittableList>();
+        world->add(ground);
+        world->add(boxes);
+
+        double cameraAngle = 2 * PI * frame / frames;
+
+        auto sequenceFrame = SequenceFrame();
+        sequenceFrame.world = world;
+        sequenceFrame.camera.aspectRatio = 16.0 / 9.0;
+        sequenceFrame.camera.imageWidth = 400;
+        sequenceFrame.camera.aaSamples = 10;
+        sequenceFrame.camera.fieldOfView = 40;
+        sequenceFrame.camera.cameraOrigin = Point3(80 * sin(cameraAngle), 30, 80 * cos(cameraAngle));
+        sequenceFrame.camera.cameraTarget = Point3(0, 0, 0);
+        return sequenceFrame;
+    };
+    renderer.render();
 }
 
 //         ^ y
@@ -370,25 +194,97 @@ void cornell_smoke() {
 //       /
 //      z (i.e positive z is out of the screen towards you)
 
+// the pixels to trace, given as x,y for a single pixel or minX,minY,maxX,maxY for a rectangle of them
+trace::Region parse_trace_region(std::string const & text) {
+    std::vector<int> numbers;
+    std::istringstream in(text);
+    std::string number;
+    while (std::getline(in, number, ',')) {
+        numbers.push_back(atoi(number.c_str()));
+    }
+
+    if (numbers.size() == 2) {
+        return trace::Region(numbers[0], numbers[1], numbers[0], numbers[1]);
+    }
+    if (numbers.size() == 4) {
+        return trace::Region(numbers[0], numbers[1], numbers[2], numbers[3]);
+    }
+
+    std::cerr << "Expected --trace x,y or --trace minX,minY,maxX,maxY\n";
+    return trace::Region();
+}
+
+int print_trace(std::string const & path) {
+    std::vector<trace::Record> records;
+    uint64_t dropped = 0;
+    if (!trace::read(path, records, dropped)) {
+        std::cerr << "Couldn't read a trace from " << path << "\n";
+        return 1;
+    }
+
+    trace::print(std::cout, records, dropped);
+    return 0;
+}
+
+// usage: ./ray-tracer [scene] [--trace x,y[,maxX,maxY]] [--trace-file trace.bin]
+//        ./ray-tracer --print-trace trace.bin
+// --trace records what happens while rendering those pixels (see trace.h), which is printed once the scene is done,
+// or written to --trace-file to be printed later with --print-trace
 int main(int argc, char** argv) {
 
+    if ((argc > 2) && (strcmp(argv[1], "--print-trace") == 0)) {
+        return print_trace(argv[2]);
+    }
+
     int scene = 1;
 
     if (argc > 1) {
         scene = atoi(argv[1]);
     }
 
+    bool tracing = false;
+    std::string traceFile;
+    for (int i = 2; i < argc; i++) {
+        bool hasValue = (i + 1) < argc;
+        if ((strcmp(argv[i], "--trace") == 0) && hasValue) {
+            trace::capture(parse_trace_region(argv[++i]));
+            tracing = true;
+        } else if ((strcmp(argv[i], "--trace-file") == 0) && hasValue) {
+            traceFile = argv[++i];
+        } else {
+            std::cerr << "Unknown argument " << argv[i] << "\n";
+            return 1;
+        }
+    }
+
+    if (tracing && !trace::compiled(trace::Level::Pixel)) {
+        std::cerr << "Built without -DRAY_TRACER_TRACE, so nothing will be traced\n";
+    }
+
     switch (scene) {
-        case 1: random_spheres(); break;
-        case 2: checkered_spheres(); break;
-        case 3: earth(); break;
-        case 4: two_spheres(); break;
-        case 5: quads(); break;
-        case 6: simple_lights(); break;
-        case 7: cornell_box(); break;
-        case 8: cornell_smoke(); break;
+        case 1: render_scene(random_spheres()); break;
+        case 2: render_scene(checkered_spheres()); break;
+        case 3: render_scene(earth()); break;
+        case 4: render_scene(two_spheres()); break;
+        case 5: render_scene(quads()); break;
+        case 6: render_scene(simple_lights()); break;
+        case 7: render_scene(cornell_box()); break;
+        case 8: render_scene(cornell_smoke()); break;
+        case 9: render_scene(instanced_boxes()); break;
+        case 10: bouncing_spheres(); break;
+        case 11: spinning_boxes(); break;
+        case 12: render_scene(earth_cached()); break;
+        case 13: render_scene(perlin_spheres()); break;
+        case 14: render_scene(cornell_cloud()); break;
         default: std::cerr << "No scene selected, not producing any output" << std::endl;
     }
 
+    // only prints anything when built with -DRAY_TRACER_STATS
+    stats::report(std::clog);
+
+    if (tracing) {
+        trace::finish(traceFile);
+    }
+
     return 0;
 }
@@ -1,14 +1,62 @@
 #ifndef MATERIAL_H
 #define MATERIAL_H
 
+#include <memory>
+
 #include "color.h"
-#include "logger.h"
 #include "texture.h"
+#include "texture_program.h"
+#include "onb.h"
+#include "sampler.h"
+#include "stats.h"
+#include "trace.h"
 
 class HitResult;
 
+// a direction picked by a material for the ray to continue in
+class ScatterSample {
+    public:
+        Vec3 direction;
+        // how much light arriving from the direction gets sent back along the incoming ray, i.e the BSDF times the
+        // cosine of the angle between the direction and the normal. For specular samples this is the attenuation
+        Color value;
+        // the probability density of picking this direction, meaningless for specular samples
+        double pdf = 0;
+        // whether the material only ever scatters in this one direction (e.g a mirror, or glass)
+        bool isSpecular = false;
+
+        // what the light coming from the direction gets multiplied by, the value divided by the pdf
+        Color weight() const;
+};
+
+// implements Material::sample on top of Material::scatter and Material::scattering_pdf, for materials that
+// don't have a better way of doing it
+template <typename MaterialT>
+bool sample_using_scatter(MaterialT const & material, Ray const & incomingRay, HitResult const & result,
+                          Sample2D const & u, ScatterSample & sample);
+
+// the materials that come with the ray tracer, any other material is "Custom"
+// this allows calling the built in materials without going through the vtable, see material_scatter
+enum class MaterialType {
+    Lambertian,
+    Metal,
+    Dielectric,
+    DiffuseLight,
+    IsotropicScatter,
+    Custom
+};
+
+static_assert(static_cast<int>(MaterialType::Custom) + 1 == stats::MATERIAL_COUNT, "stats counts scatters for each MaterialType");
+
 class Material {
     public:
+        // for materials defined outside of this file, which will always be called through the vtable
+        Material() : _type(MaterialType::Custom) { }
+
+        virtual ~Material() = default;
+
+        MaterialType type() const { return this->_type; }
+
         // Given a incoming ray and where it hit on a material, return the scattered ray and attentuation
         // attenuation is how much of the reflection's color should affect the final color
         virtual bool scatter(Ray const & incomingRay, HitResult const & result, Color & attenuation, Ray & scatteredRay) const = 0;
@@ -17,6 +65,28 @@ class Material {
         virtual Color emitted(double const & u, double const & v, Point3 const & point) const {
             return Color(0, 0, 0);
         }
+
+        // the probability density of scatter() sending the ray off in the given direction. Materials that scatter
+        // in random directions need this so that light sampling can be mixed with scattering (see ray_color).
+        // 0 means the material is specular (e.g a mirror), i.e it only ever scatters in the one direction,
+        // and so sampling lights is pointless since their direction will never be the one it scatters in
+        virtual double scattering_pdf(HitResult const & /* result */, Vec3 const & /* direction */) const {
+            return 0;
+        }
+
+        // picks a direction for the ray to continue in, along with how likely it was to be picked, so that it can be
+        // weighted correctly when mixing it with other ways of picking directions. Returns false if the ray is absorbed.
+        // u are the numbers to pick the direction with, from the Sampler. The default works it out from scatter and
+        // scattering_pdf, which ignores u and picks at random
+        virtual bool sample(Ray const & incomingRay, HitResult const & result, Sample2D const & u, ScatterSample & sample) const {
+            return sample_using_scatter(*this, incomingRay, result, u, sample);
+        }
+
+    protected:
+        Material(MaterialType type) : _type(type) { }
+
+    private:
+        MaterialType _type;
 };
 
 // Lambertian diffuse material
@@ -24,26 +94,22 @@ class Material {
 // at angles that are closer to the normal
 // technically with diffuse materials the incoming ray could reflect or get absorbed, in this case
 // we just always reflect.
-class LambertianMaterial : public Material {
+class LambertianMaterial final : public Material {
     public:
-        LambertianMaterial(Color const & a) : albedo(std::make_shared<SolidColorTexture>(a)) { }
-        LambertianMaterial(std::shared_ptr<Texture> const & t) : albedo(t) { }
+        // allocates a texture for the color, scenes share one texture between every material of the same color by
+        // passing TextureRegistry::solid instead
+        LambertianMaterial(Color const & a) : LambertianMaterial(std::make_shared<SolidColorTexture>(a)) { }
+        // the texture is compiled (see TextureProgram), so a tree of textures doesn't cost a virtual call for each one
+        LambertianMaterial(std::shared_ptr<Texture> const & t) : Material(MaterialType::Lambertian), albedo(TextureProgram::compile(t)) { }
 
         virtual bool scatter(Ray const & incomingRay, HitResult const & result, Color & attenuation, Ray & scatteredRay) const override {
-            // we're imagining that there is a sphere where the normal vector is
-            // the radius, then we get a random unit vector from there. the vector
-            // from our original hit point to the new point is the direction of the reflection
-            // originally that is: (result.point + result.normal + random_unit_vec3()) - result.point
-            // but that simplifies to whats below
-            auto reflectedRayDirection = result.normal + random_unit_vec3();
+            // the book imagines a sphere where the normal vector is the radius, then gets a random unit vector
+            // from there, i.e result.normal + random_unit_vec3(). That's distributed by cos(theta) / pi, which is
+            // what random_cosine_direction gives directly, without any chance of cancelling out the normal
+            auto reflectedRayDirection = Onb(result.normal).local(random_cosine_direction());
 
-            // in case the randomly generated vector matches the normal and cancels it out
-            if (reflectedRayDirection.is_near_zero())
-                reflectedRayDirection = result.normal;
-
-            LOG(
-                std::clog << "Lambertian reflected ray direction: " << reflectedRayDirection << "\n";
-            )
+            TRACE(trace::Level::Ray, trace::Event::LambertianScattered,
+                  reflectedRayDirection.x, reflectedRayDirection.y, reflectedRayDirection.z);
 
             // here's an alternative diffuse method that is mentioned by the book as well
             // which is based on just randomly reflecting in any direction away the the surface
@@ -54,20 +120,39 @@ class LambertianMaterial : public Material {
             // auto reflectedRay = Ray(result.point, random_in_hemisphere(result.normal));
 
             scatteredRay = Ray(result.point, reflectedRayDirection, incomingRay.time);
-            attenuation = this->albedo->value(result.u, result.v, result.point);
+            attenuation = texture_value(*this->albedo, result.u, result.v, result.uvFootprint, result.point);
 
             return true;
         }
 
+        // the normal plus a random unit vector leads to directions distributed by cos(theta) / pi
+        // where theta is the angle between the direction and the normal
+        virtual double scattering_pdf(HitResult const & result, Vec3 const & direction) const override {
+            double cosineTheta = result.normal.dot(direction.unit());
+            return cosineTheta < 0 ? 0 : cosineTheta / PI;
+        }
+
+        virtual bool sample(Ray const & /* incomingRay */, HitResult const & result, Sample2D const & u, ScatterSample & sample) const override {
+            Vec3 localDirection = cosine_direction(u.x, u.y);
+
+            sample.direction = Onb(result.normal).local(localDirection);
+            // the direction's z is the cosine of its angle with the normal
+            sample.pdf = localDirection.z / PI;
+            sample.value = texture_value(*this->albedo, result.u, result.v, result.uvFootprint, result.point) * sample.pdf;
+            sample.isSpecular = false;
+
+            return sample.pdf > 0;
+        }
+
     public:
         std::shared_ptr<Texture> albedo;
 };
 
 // Shiny metallic material implementation that relies on modelling the ray reflecting across the surface normal.
 // Optionally, with a non-zero fuzz value, the reflection can be "imperfect" causing fuzziness in the reflection
-class MetalMaterial : public Material {
+class MetalMaterial final : public Material {
     public:
-        MetalMaterial(Color const & a, double const f) : albedo(a), fuzz(f < 1 ? f : 1) { }
+        MetalMaterial(Color const & a, double const f) : Material(MaterialType::Metal), albedo(a), fuzz(f < 1 ? f : 1) { }
 
         virtual bool scatter(Ray const & incomingRay, HitResult const & result, Color & attenuation, Ray & scatteredRay) const override {
             auto reflectedRayDirection = incomingRay.dir.unit().reflect(result.normal);
@@ -77,9 +162,8 @@ class MetalMaterial : public Material {
             scatteredRay = Ray(result.point, reflectedRayDirection + (fuzz * random_unit_vec3_in_unit_sphere()), incomingRay.time);
             attenuation = this->albedo;
 
-            LOG(
-                std::clog << "Metallic reflected ray direction " << reflectedRayDirection << "\n";
-            )
+            TRACE(trace::Level::Ray, trace::Event::MetalScattered,
+                  reflectedRayDirection.x, reflectedRayDirection.y, reflectedRayDirection.z);
 
             // depending on the angle that the incoming ray was at, the reflection needs to either be
             // considered or ignored
@@ -93,9 +177,9 @@ class MetalMaterial : public Material {
         double fuzz;
 };
 
-class DielectricMaterial : public Material {
+class DielectricMaterial final : public Material {
     public:
-        DielectricMaterial(double const ri) : refractionIndex(ri) { }
+        DielectricMaterial(double const ri) : Material(MaterialType::Dielectric), refractionIndex(ri) { }
 
         virtual bool scatter(Ray const & incomingRay, HitResult const & result, Color & attenuation, Ray & scatteredRay) const override {
             attenuation = Color(1.0, 1.0, 1.0);
@@ -138,18 +222,19 @@ class DielectricMaterial : public Material {
 
 // representation of a diffuse light source
 // note that its ok for this to have a color value greater than 1 as it increases the intensity of the light
-class DiffuseLightMaterial : public Material {
+class DiffuseLightMaterial final : public Material {
     public:
         DiffuseLightMaterial(Color const & lightColor) : DiffuseLightMaterial(std::make_shared<SolidColorTexture>(lightColor)) { }
 
-        DiffuseLightMaterial(std::shared_ptr<Texture> const & emitTexture) : _emittedTexture(emitTexture) { }
+        DiffuseLightMaterial(std::shared_ptr<Texture> const & emitTexture)
+                             : Material(MaterialType::DiffuseLight), _emittedTexture(TextureProgram::compile(emitTexture)) { }
 
         virtual bool scatter(Ray const & incomingRay, HitResult const & result, Color & attenuation, Ray & scatteredRay) const override {
             return false;
         }
 
-        virtual Color emitted(double const & u, double const & v, Point3 const & point) const {
-            return this->_emittedTexture->value(u, v, point);
+        virtual Color emitted(double const & u, double const & v, Point3 const & point) const override {
+            return texture_value(*this->_emittedTexture, u, v, 0, point);
         }
 
     private:
@@ -157,13 +242,28 @@ class DiffuseLightMaterial : public Material {
 };
 
 // a material that scatters light in any random direction, used primarily to implement fog
-class IsotropicScatterMaterial : public Material {
+class IsotropicScatterMaterial final : public Material {
     public:
-        IsotropicScatterMaterial(std::shared_ptr<Texture> const & texture) : _albedo(texture) { }
+        IsotropicScatterMaterial(std::shared_ptr<Texture> const & texture)
+                                 : Material(MaterialType::IsotropicScatter), _albedo(TextureProgram::compile(texture)) { }
 
         virtual bool scatter(Ray const & incomingRay, HitResult const & result, Color & attenuation, Ray & scatteredRay) const override {
             scatteredRay = Ray(result.point, random_unit_vec3(), incomingRay.time);
-            attenuation = this->_albedo->value(result.u, result.v, result.point);
+            attenuation = texture_value(*this->_albedo, result.u, result.v, result.uvFootprint, result.point);
+
+            return true;
+        }
+
+        // every direction is equally likely, and there's 4 pi steradians in a sphere
+        virtual double scattering_pdf(HitResult const & /* result */, Vec3 const & /* direction */) const override {
+            return 1 / (4 * PI);
+        }
+
+        virtual bool sample(Ray const & /* incomingRay */, HitResult const & result, Sample2D const & u, ScatterSample & sample) const override {
+            sample.direction = uniform_direction(u.x, u.y);
+            sample.pdf = 1 / (4 * PI);
+            sample.value = texture_value(*this->_albedo, result.u, result.v, result.uvFootprint, result.point) * sample.pdf;
+            sample.isSpecular = false;
 
             return true;
         }
@@ -171,4 +271,110 @@ class IsotropicScatterMaterial : public Material {
         std::shared_ptr<Texture> _albedo;
 };
 
-#endif
\ No newline at end of file
+// the equivalent of material.emitted(...) and material.scatter(...), except the built in materials are called
+// directly based on their type rather than through the vtable. Since they're all final, this lets the compiler
+// inline their implementations into the caller (i.e ray_color)
+Color material_emitted(Material const & material, double const & u, double const & v, Point3 const & point);
+
+bool material_scatter(Material const & material, Ray const & incomingRay, HitResult const & result,
+                      Color & attenuation, Ray & scatteredRay);
+
+double material_scattering_pdf(Material const & material, HitResult const & result, Vec3 const & direction);
+
+bool material_sample(Material const & material, Ray const & incomingRay, HitResult const & result,
+                     Sample2D const & u, ScatterSample & sample);
+
+// ------
+
+inline Color ScatterSample::weight() const {
+    return this->isSpecular ? this->value : this->value / this->pdf;
+}
+
+// MaterialT is the actual type of the material where it's known, so that for the built in (final) materials
+// the compiler can call scatter and scattering_pdf directly
+template <typename MaterialT>
+bool sample_using_scatter(MaterialT const & material, Ray const & incomingRay, HitResult const & result,
+                          Sample2D const &, ScatterSample & sample) {
+    Ray scatteredRay;
+    Color attenuation;
+    if (!material.scatter(incomingRay, result, attenuation, scatteredRay)) {
+        return false;
+    }
+
+    sample.direction = scatteredRay.dir;
+    sample.pdf = material.scattering_pdf(result, sample.direction);
+    sample.isSpecular = sample.pdf <= 0;
+    // scatter's attenuation is already what the light gets multiplied by, i.e the value divided by the pdf
+    sample.value = sample.isSpecular ? attenuation : attenuation * sample.pdf;
+
+    return true;
+}
+
+inline Color material_emitted(Material const & material, double const & u, double const & v, Point3 const & point) {
+    switch (material.type()) {
+        case MaterialType::DiffuseLight:
+            return static_cast<DiffuseLightMaterial const &>(material).emitted(u, v, point);
+        case MaterialType::Custom:
+            return material.emitted(u, v, point);
+        default:
+            // none of the other built in materials emit anything
+            return Color(0, 0, 0);
+    }
+}
+
+inline bool material_scatter(Material const & material, Ray const & incomingRay, HitResult const & result,
+                      Color & attenuation, Ray & scatteredRay) {
+    stats::count_scatter(static_cast<int>(material.type()));
+
+    switch (material.type()) {
+        case MaterialType::Lambertian:
+            return static_cast<LambertianMaterial const &>(material).scatter(incomingRay, result, attenuation, scatteredRay);
+        case MaterialType::Metal:
+            return static_cast<MetalMaterial const &>(material).scatter(incomingRay, result, attenuation, scatteredRay);
+        case MaterialType::Dielectric:
+            return static_cast<DielectricMaterial const &>(material).scatter(incomingRay, result, attenuation, scatteredRay);
+        case MaterialType::DiffuseLight:
+            return static_cast<DiffuseLightMaterial const &>(material).scatter(incomingRay, result, attenuation, scatteredRay);
+        case MaterialType::IsotropicScatter:
+            return static_cast<IsotropicScatterMaterial const &>(material).scatter(incomingRay, result, attenuation, scatteredRay);
+        default:
+            return material.scatter(incomingRay, result, attenuation, scatteredRay);
+    }
+}
+
+inline double material_scattering_pdf(Material const & material, HitResult const & result, Vec3 const & direction) {
+    switch (material.type()) {
+        case MaterialType::Lambertian:
+            return static_cast<LambertianMaterial const &>(material).scattering_pdf(result, direction);
+        case MaterialType::IsotropicScatter:
+            return static_cast<IsotropicScatterMaterial const &>(material).scattering_pdf(result, direction);
+        case MaterialType::Custom:
+            return material.scattering_pdf(result, direction);
+        default:
+            // the rest are either specular or don't scatter at all
+            return 0;
+    }
+}
+
+inline bool material_sample(Material const & material, Ray const & incomingRay, HitResult const & result,
+                     Sample2D const & u, ScatterSample & sample) {
+    stats::count_scatter(static_cast<int>(material.type()));
+
+    switch (material.type()) {
+        case MaterialType::Lambertian:
+            return static_cast<LambertianMaterial const &>(material).sample(incomingRay, result, u, sample);
+        case MaterialType::Metal:
+            return sample_using_scatter(static_cast<MetalMaterial const &>(material), incomingRay, result, u, sample);
+        case MaterialType::Dielectric:
+            return sample_using_scatter(static_cast<DielectricMaterial const &>(material), incomingRay, result, u, sample);
+        case MaterialType::DiffuseLight:
+            // lights absorb everything that hits them
+            return false;
+        case MaterialType::IsotropicScatter:
+            return static_cast<IsotropicScatterMaterial const &>(material).sample(incomingRay, result, u, sample);
+        default:
+            return material.sample(incomingRay, result, u, sample);
+    }
+}
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef MATERIAL_TABLE_H
+#define MATERIAL_TABLE_H
+
+#include <memory>
+#include <variant>
+#include <vector>
+
+#include "material.h"
+
+// any one of the built in materials, stored by value
+using MaterialVariant = std::variant<LambertianMaterial,
+                                     MetalMaterial,
+                                     DielectricMaterial,
+                                     DiffuseLightMaterial,
+                                     IsotropicScatterMaterial>;
+
+// a table that stores the built in materials by value, next to each other in memory,
+// rather than every material in the scene being its own separate allocation.
+// the materials are stored in fixed size chunks so that they never move once created, and the pointers handed out
+// share ownership of the storage, so the materials stay alive even after the table itself is gone.
+// combined with material_scatter, shading then involves neither a vtable lookup nor chasing pointers around the heap
+class MaterialTable {
+    public:
+        MaterialTable();
+
+        // creates a material of type T inside the table, T must be one of the types in MaterialVariant
+        template <typename T, typename... Args>
+        std::shared_ptr<T> make(Args &&... args);
+
+        size_t size() const;
+
+    private:
+        class Storage {
+            public:
+                std::vector<std::unique_ptr<std::vector<MaterialVariant>>> chunks;
+                size_t size = 0;
+        };
+
+        static size_t const CHUNK_SIZE = 256;
+
+        std::shared_ptr<Storage> _storage;
+};
+
+// ------
+
+inline MaterialTable::MaterialTable() : _storage(std::make_shared<Storage>()) { }
+
+template <typename T, typename... Args>
+std::shared_ptr<T> MaterialTable::make(Args &&... args) {
+    if ((this->_storage->size % CHUNK_SIZE) == 0) {
+        // the previous chunk is full, reserving up front means this chunk's materials never get moved around
+        auto chunk = std::make_unique<std::vector<MaterialVariant>>();
+        chunk->reserve(CHUNK_SIZE);
+        this->_storage->chunks.push_back(std::move(chunk));
+    }
+
+    auto & chunk = *this->_storage->chunks.back();
+    chunk.emplace_back(std::in_place_type<T>, std::forward<Args>(args)...);
+    this->_storage->size++;
+
+    // aliasing constructor, the pointer is to the material but the ownership is of the whole storage
+    return std::shared_ptr<T>(this->_storage, &std::get<T>(chunk.back()));
+}
+
+inline size_t MaterialTable::size() const {
+    return this->_storage->size;
+}
+
+#endif
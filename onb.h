@@ -0,0 +1,46 @@
+#ifndef ONB_H
+#define ONB_H
+
+#include <cmath>
+
+#include "vec3.h"
+
+// an orthonormal basis, three unit vectors at right angles to each other, with w pointing along the given direction.
+// directions generated relative to the z axis (e.g by random_cosine_direction) can be turned into directions
+// relative to w with local(), which is how we sample around a surface normal
+class Onb {
+    public:
+        Vec3 u;
+        Vec3 v;
+        Vec3 w;
+
+        // the direction must already be a unit vector
+        Onb(Vec3 const & direction);
+
+        // the vector made up of a along u, b along v and c along w
+        Vec3 local(double a, double b, double c) const;
+
+        Vec3 local(Vec3 const & a) const;
+};
+
+// ------
+
+// picks u and v without any branches or normalising, see "Building an Orthonormal Basis, Revisited" (Duff et al.)
+inline Onb::Onb(Vec3 const & direction) : w(direction) {
+    double sign = std::copysign(1.0, direction.z);
+    double a = -1.0 / (sign + direction.z);
+    double b = direction.x * direction.y * a;
+
+    this->u = Vec3(1.0 + (sign * direction.x * direction.x * a), sign * b, -sign * direction.x);
+    this->v = Vec3(b, sign + (direction.y * direction.y * a), -direction.y);
+}
+
+inline Vec3 Onb::local(double a, double b, double c) const {
+    return (a * this->u) + (b * this->v) + (c * this->w);
+}
+
+inline Vec3 Onb::local(Vec3 const & a) const {
+    return local(a.x, a.y, a.z);
+}
+
+#endif
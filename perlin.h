@@ -0,0 +1,233 @@
+#ifndef PERLIN_H
+#define PERLIN_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+#include "simd.h"
+#include "vec3.h"
+
+// Perlin noise (see "Ray tracing the next week"), a smoothly varying value between -1 and 1 over all of space.
+// space is split into a lattice of unit cubes, each corner of which gets a random gradient picked by hashing its
+// coordinates through the permutation tables, and the noise at a point is the blend of those gradients over its cube.
+//
+// the noise is evaluated BATCH_SIZE points at a time: the table lookups are done for each point, then the blending
+// (which is most of the math) is done for all of them together, using AVX when compiled with -DRAY_TRACER_SIMD -mavx.
+// the scalar and SIMD versions do the same operations in the same order, so they give exactly the same results
+class Perlin {
+    public:
+        // the tables are filled in from their own generator rather than random_double, so noise textures look the same
+        // whatever else the scene does with the random numbers, and creating one doesn't change the rest of the scene
+        Perlin(uint32_t seed = 0);
+
+        double noise(Point3 const & p) const;
+
+        // out[i] = noise(points[i])
+        void noise_batch(Point3 const * points, double * out, size_t count) const;
+
+        // the sum of depth octaves of noise, each twice the frequency and half the weight of the one before, which
+        // looks like turbulent flow. All the octaves go through noise_batch together.
+        // depth is clamped to [0, MAX_TURBULENCE_DEPTH], no octaves at all being 0
+        double turbulence(Point3 const & p, int depth = 7) const;
+
+        static constexpr size_t BATCH_SIZE = 4;
+        static constexpr int MAX_TURBULENCE_DEPTH = 16;
+
+    private:
+        static constexpr int POINT_COUNT = 256;
+
+        // the x, y and z of each of the random unit gradients, stored separately so each is contiguous when gathered
+        double _gradientX[POINT_COUNT];
+        double _gradientY[POINT_COUNT];
+        double _gradientZ[POINT_COUNT];
+
+        int _permutationX[POINT_COUNT];
+        int _permutationY[POINT_COUNT];
+        int _permutationZ[POINT_COUNT];
+
+        // the inputs for blending a batch of points, one array element per point
+        class Batch {
+            public:
+                // where each point is within its cube, 0-1 along each axis
+                double u[3][BATCH_SIZE];
+                // the gradient at each of the 8 corners of the cube, corner is (x << 2) | (y << 1) | z
+                double gradients[8][3][BATCH_SIZE];
+        };
+
+        // fills in out[0] to out[count - 1] from the first count points of the batch
+        static void blend(Batch const & batch, double * out, size_t count);
+};
+
+// ------
+
+inline Perlin::Perlin(uint32_t seed) {
+    auto generator = std::mt19937(seed);
+    auto distribution = std::uniform_real_distribution<double>(-1, 1);
+
+    for (int i = 0; i < POINT_COUNT; i++) {
+        // rejection sampling the unit sphere so gradients point in every direction equally
+        Vec3 gradient;
+        do {
+            gradient = Vec3(distribution(generator), distribution(generator), distribution(generator));
+        } while ((gradient.length_squared() > 1) || (gradient.length_squared() < 1e-8));
+        gradient = gradient.unit();
+
+        this->_gradientX[i] = gradient.x;
+        this->_gradientY[i] = gradient.y;
+        this->_gradientZ[i] = gradient.z;
+    }
+
+    for (int * permutation : { this->_permutationX, this->_permutationY, this->_permutationZ }) {
+        for (int i = 0; i < POINT_COUNT; i++) {
+            permutation[i] = i;
+        }
+        std::shuffle(permutation, permutation + POINT_COUNT, generator);
+    }
+}
+
+inline double Perlin::noise(Point3 const & p) const {
+    double result;
+    noise_batch(&p, &result, 1);
+    return result;
+}
+
+inline void Perlin::noise_batch(Point3 const * points, double * out, size_t count) const {
+    // lanes past the end of the points in the last batch may still be blended (it's no slower than skipping them) but
+    // are never written out, so they just need to hold something valid, either these zeros or the previous batch's values
+    Batch batch{};
+
+    for (size_t start = 0; start < count; start += BATCH_SIZE) {
+        size_t batchCount = std::min(BATCH_SIZE, count - start);
+
+        for (size_t lane = 0; lane < batchCount; lane++) {
+            Point3 const & p = points[start + lane];
+
+            double floorX = std::floor(p.x);
+            double floorY = std::floor(p.y);
+            double floorZ = std::floor(p.z);
+            batch.u[0][lane] = p.x - floorX;
+            batch.u[1][lane] = p.y - floorY;
+            batch.u[2][lane] = p.z - floorZ;
+
+            auto i = static_cast<int>(floorX);
+            auto j = static_cast<int>(floorY);
+            auto k = static_cast<int>(floorZ);
+
+            for (int corner = 0; corner < 8; corner++) {
+                int gradient = this->_permutationX[(i + ((corner >> 2) & 1)) & (POINT_COUNT - 1)]
+                               ^ this->_permutationY[(j + ((corner >> 1) & 1)) & (POINT_COUNT - 1)]
+                               ^ this->_permutationZ[(k + (corner & 1)) & (POINT_COUNT - 1)];
+
+                batch.gradients[corner][0][lane] = this->_gradientX[gradient];
+                batch.gradients[corner][1][lane] = this->_gradientY[gradient];
+                batch.gradients[corner][2][lane] = this->_gradientZ[gradient];
+            }
+        }
+
+        blend(batch, out + start, batchCount);
+    }
+}
+
+inline double Perlin::turbulence(Point3 const & p, int depth) const {
+    depth = std::clamp(depth, 0, MAX_TURBULENCE_DEPTH);
+
+    Point3 octaves[MAX_TURBULENCE_DEPTH];
+    double noises[MAX_TURBULENCE_DEPTH];
+
+    Point3 octave = p;
+    for (int i = 0; i < depth; i++) {
+        octaves[i] = octave;
+        octave = 2 * octave;
+    }
+
+    noise_batch(octaves, noises, static_cast<size_t>(depth));
+
+    double accumulated = 0.0;
+    double weight = 1.0;
+    for (int i = 0; i < depth; i++) {
+        accumulated += weight * noises[i];
+        weight *= 0.5;
+    }
+
+    return std::fabs(accumulated);
+}
+
+#if defined(RAY_TRACER_SIMD_ENABLED) && defined(__AVX__)
+
+inline void Perlin::blend(Batch const & batch, double * out, size_t count) {
+    static_assert(BATCH_SIZE == 4, "the AVX version blends 4 doubles at a time");
+
+    __m256d one = _mm256_set1_pd(1.0);
+    __m256d two = _mm256_set1_pd(2.0);
+    __m256d three = _mm256_set1_pd(3.0);
+
+    __m256d u[3];
+    // hermite smoothing, u * u * (3 - 2 * u), so the blend has no visible creases along the edges of the cubes
+    __m256d smoothed[3];
+    for (int axis = 0; axis < 3; axis++) {
+        u[axis] = _mm256_loadu_pd(batch.u[axis]);
+        smoothed[axis] = _mm256_mul_pd(_mm256_mul_pd(u[axis], u[axis]), _mm256_sub_pd(three, _mm256_mul_pd(two, u[axis])));
+    }
+
+    __m256d accumulated = _mm256_setzero_pd();
+    for (int corner = 0; corner < 8; corner++) {
+        __m256d weight = one;
+        __m256d dot = _mm256_setzero_pd();
+
+        for (int axis = 0; axis < 3; axis++) {
+            bool high = ((corner >> (2 - axis)) & 1) != 0;
+
+            // the weight of the corner along this axis, and the offset from the corner to the point
+            __m256d axisWeight = high ? smoothed[axis] : _mm256_sub_pd(one, smoothed[axis]);
+            __m256d offset = high ? _mm256_sub_pd(u[axis], one) : u[axis];
+
+            weight = _mm256_mul_pd(weight, axisWeight);
+            dot = _mm256_add_pd(dot, _mm256_mul_pd(_mm256_loadu_pd(batch.gradients[corner][axis]), offset));
+        }
+
+        accumulated = _mm256_add_pd(accumulated, _mm256_mul_pd(weight, dot));
+    }
+
+    double results[BATCH_SIZE];
+    _mm256_storeu_pd(results, accumulated);
+    std::copy_n(results, count, out);
+}
+
+#else
+
+inline void Perlin::blend(Batch const & batch, double * out, size_t count) {
+    for (size_t lane = 0; lane < count; lane++) {
+        double u[3];
+        double smoothed[3];
+        for (int axis = 0; axis < 3; axis++) {
+            u[axis] = batch.u[axis][lane];
+            smoothed[axis] = (u[axis] * u[axis]) * (3.0 - (2.0 * u[axis]));
+        }
+
+        double accumulated = 0.0;
+        for (int corner = 0; corner < 8; corner++) {
+            double weight = 1.0;
+            double dot = 0.0;
+
+            for (int axis = 0; axis < 3; axis++) {
+                bool high = ((corner >> (2 - axis)) & 1) != 0;
+
+                double axisWeight = high ? smoothed[axis] : (1.0 - smoothed[axis]);
+                double offset = high ? (u[axis] - 1.0) : u[axis];
+
+                weight = weight * axisWeight;
+                dot = dot + (batch.gradients[corner][axis][lane] * offset);
+            }
+
+            accumulated = accumulated + (weight * dot);
+        }
+
+        out[lane] = accumulated;
+    }
+}
+
+#endif
+
+#endif
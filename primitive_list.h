@@ -0,0 +1,259 @@
+#ifndef PRIMITIVE_LIST_H
+#define PRIMITIVE_LIST_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "hittable.h"
+#include "hittable_list.h"
+#include "sphere.h"
+#include "quad.h"
+#include "instance.h"
+#include "aabb.h"
+
+// the primitives that come with the ray tracer, any other hittable is "Custom"
+// instances count as a primitive so that the top level of a two level BVH (see TopLevelBvh) can call them directly
+enum class PrimitiveType : uint32_t {
+    Sphere,
+    Quad,
+    Instance,
+    Custom
+};
+
+// identifies a single primitive inside of a PrimitiveList, by which array it's in and where
+class PrimitiveRef {
+    public:
+        PrimitiveType type = PrimitiveType::Custom;
+        uint32_t index = 0;
+};
+
+// a container for hittable objects that stores the built in primitives by value in an array per type,
+// rather than as a list of pointers to hittables. Intersecting with them is then a direct call (or a switch on
+// the type when going through a PrimitiveRef) instead of a virtual call, and primitives of the same type sit next
+// to each other in memory. Anything that isn't a built in primitive (e.g mediums or user defined hittables)
+// is kept in "others" and still goes through the vtable.
+class PrimitiveList : public Hittable {
+    public:
+        std::vector<Sphere> spheres;
+        std::vector<Quad> quads;
+        std::vector<Instance> instances;
+        std::vector<std::shared_ptr<Hittable>> others;
+
+        // every primitive in the list, in the order they were added
+        std::vector<PrimitiveRef> refs;
+
+        PrimitiveList();
+        PrimitiveList(HittableList const & list);
+        // startIndex is inclusive, endIndex is exclusive (i.e after the last object by 1)
+        PrimitiveList(std::vector<std::shared_ptr<Hittable>> const & objects, size_t startIndex, size_t endIndex);
+
+        // built in primitives are copied into their type's array, chains of transformers are flattened
+        // into a single Instance, and anything else is kept as is
+        PrimitiveRef add(std::shared_ptr<Hittable> const & object);
+        PrimitiveRef add(Sphere const & sphere);
+        PrimitiveRef add(Quad const & quad);
+        PrimitiveRef add(Instance const & instance);
+
+        size_t size() const;
+
+        // recalculates the list's bounding box, for when the primitives in it have been moved
+        void update_bounding_box();
+
+        // intersect with just the one primitive
+        bool hit(PrimitiveRef const & primitive, Ray const & ray, Interval const & rayLimits, HitResult & result) const;
+
+        bool occluded(PrimitiveRef const & primitive, Ray const & ray, Interval const & rayLimits) const;
+
+        Aabb bounding_box(PrimitiveRef const & primitive) const;
+
+        Aabb bounding_box_at(PrimitiveRef const & primitive, double time) const;
+
+        bool hit(Ray const & ray, Interval const & rayLimits, HitResult & result) const override;
+
+        bool occluded(Ray const & ray, Interval const & rayLimits) const override;
+
+        Aabb bounding_box() const override;
+
+    private:
+        Aabb _boundingBox;
+};
+
+// ------
+
+inline PrimitiveList::PrimitiveList() : spheres(), quads(), instances(), others(), refs(), _boundingBox() { }
+
+inline PrimitiveList::PrimitiveList(HittableList const & list) : PrimitiveList(list.objects, 0, list.objects.size()) { }
+
+inline PrimitiveList::PrimitiveList(std::vector<std::shared_ptr<Hittable>> const & objects, size_t startIndex, size_t endIndex)
+                             : PrimitiveList() {
+    for (size_t i = startIndex; i < endIndex; i++) {
+        add(objects[i]);
+    }
+}
+
+inline PrimitiveRef PrimitiveList::add(std::shared_ptr<Hittable> const & object) {
+    if (auto sphere = std::dynamic_pointer_cast<Sphere>(object)) {
+        return add(*sphere);
+    }
+
+    if (auto quad = std::dynamic_pointer_cast<Quad>(object)) {
+        return add(*quad);
+    }
+
+    auto flattened = flatten_transformers(object);
+    if (auto instance = std::dynamic_pointer_cast<Instance>(flattened)) {
+        return add(*instance);
+    }
+
+    this->others.push_back(flattened);
+    this->_boundingBox = Aabb(this->_boundingBox, flattened->bounding_box());
+
+    auto ref = PrimitiveRef{PrimitiveType::Custom, static_cast<uint32_t>(this->others.size() - 1)};
+    this->refs.push_back(ref);
+    return ref;
+}
+
+inline PrimitiveRef PrimitiveList::add(Sphere const & sphere) {
+    this->spheres.push_back(sphere);
+    this->_boundingBox = Aabb(this->_boundingBox, sphere.bounding_box());
+
+    auto ref = PrimitiveRef{PrimitiveType::Sphere, static_cast<uint32_t>(this->spheres.size() - 1)};
+    this->refs.push_back(ref);
+    return ref;
+}
+
+inline PrimitiveRef PrimitiveList::add(Quad const & quad) {
+    this->quads.push_back(quad);
+    this->_boundingBox = Aabb(this->_boundingBox, quad.bounding_box());
+
+    auto ref = PrimitiveRef{PrimitiveType::Quad, static_cast<uint32_t>(this->quads.size() - 1)};
+    this->refs.push_back(ref);
+    return ref;
+}
+
+inline PrimitiveRef PrimitiveList::add(Instance const & instance) {
+    this->instances.push_back(instance);
+    this->_boundingBox = Aabb(this->_boundingBox, instance.bounding_box());
+
+    auto ref = PrimitiveRef{PrimitiveType::Instance, static_cast<uint32_t>(this->instances.size() - 1)};
+    this->refs.push_back(ref);
+    return ref;
+}
+
+inline size_t PrimitiveList::size() const {
+    return this->refs.size();
+}
+
+inline void PrimitiveList::update_bounding_box() {
+    this->_boundingBox = Aabb();
+
+    for (auto const & ref : this->refs) {
+        this->_boundingBox = Aabb(this->_boundingBox, bounding_box(ref));
+    }
+}
+
+inline bool PrimitiveList::hit(PrimitiveRef const & primitive, Ray const & ray, Interval const & rayLimits, HitResult & result) const {
+    switch (primitive.type) {
+        case PrimitiveType::Sphere:
+            return this->spheres[primitive.index].hit(ray, rayLimits, result);
+        case PrimitiveType::Quad:
+            return this->quads[primitive.index].hit(ray, rayLimits, result);
+        case PrimitiveType::Instance:
+            return this->instances[primitive.index].hit(ray, rayLimits, result);
+        default:
+            return this->others[primitive.index]->hit(ray, rayLimits, result);
+    }
+}
+
+inline bool PrimitiveList::occluded(PrimitiveRef const & primitive, Ray const & ray, Interval const & rayLimits) const {
+    switch (primitive.type) {
+        case PrimitiveType::Sphere:
+            return this->spheres[primitive.index].occluded(ray, rayLimits);
+        case PrimitiveType::Quad:
+            return this->quads[primitive.index].occluded(ray, rayLimits);
+        case PrimitiveType::Instance:
+            return this->instances[primitive.index].occluded(ray, rayLimits);
+        default:
+            return this->others[primitive.index]->occluded(ray, rayLimits);
+    }
+}
+
+inline Aabb PrimitiveList::bounding_box(PrimitiveRef const & primitive) const {
+    switch (primitive.type) {
+        case PrimitiveType::Sphere:
+            return this->spheres[primitive.index].bounding_box();
+        case PrimitiveType::Quad:
+            return this->quads[primitive.index].bounding_box();
+        case PrimitiveType::Instance:
+            return this->instances[primitive.index].bounding_box();
+        default:
+            return this->others[primitive.index]->bounding_box();
+    }
+}
+
+inline Aabb PrimitiveList::bounding_box_at(PrimitiveRef const & primitive, double time) const {
+    switch (primitive.type) {
+        case PrimitiveType::Sphere:
+            return this->spheres[primitive.index].bounding_box_at(time);
+        case PrimitiveType::Quad:
+            return this->quads[primitive.index].bounding_box_at(time);
+        case PrimitiveType::Instance:
+            return this->instances[primitive.index].bounding_box_at(time);
+        default:
+            return this->others[primitive.index]->bounding_box_at(time);
+    }
+}
+
+// same as HittableList::hit, but going through each type's array in turn
+inline bool PrimitiveList::hit(Ray const & ray, Interval const & rayLimits, HitResult & result) const {
+    double maxRayLength = rayLimits.max;
+
+    bool didHitAnything = false;
+
+    for (auto const & sphere : this->spheres) {
+        if (sphere.hit(ray, Interval(rayLimits.min, maxRayLength), result)) {
+            maxRayLength = result.t;
+            didHitAnything = true;
+        }
+    }
+
+    for (auto const & quad : this->quads) {
+        if (quad.hit(ray, Interval(rayLimits.min, maxRayLength), result)) {
+            maxRayLength = result.t;
+            didHitAnything = true;
+        }
+    }
+
+    for (auto const & instance : this->instances) {
+        if (instance.hit(ray, Interval(rayLimits.min, maxRayLength), result)) {
+            maxRayLength = result.t;
+            didHitAnything = true;
+        }
+    }
+
+    for (auto const & object : this->others) {
+        if (object->hit(ray, Interval(rayLimits.min, maxRayLength), result)) {
+            maxRayLength = result.t;
+            didHitAnything = true;
+        }
+    }
+
+    return didHitAnything;
+}
+
+inline bool PrimitiveList::occluded(Ray const & ray, Interval const & rayLimits) const {
+    for (auto const & ref : this->refs) {
+        if (occluded(ref, ray, rayLimits)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+inline Aabb PrimitiveList::bounding_box() const {
+    return this->_boundingBox;
+}
+
+#endif
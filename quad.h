@@ -2,22 +2,31 @@
 #define QUAD_H
 
 #include "hittable.h"
-#include "logger.h"
+#include "stats.h"
+#include "trace.h"
 
 // a representation of a four sided geometrical shape
 // Q represents the bottom left corner of the quad, u and v are vectors that take
 // you from Q to the two other adjacent corners, and adding both u and v takes you
 // to the corner opposite Q
 // for a quad/plane, any point in the world (x,y,z) that matches the equation Ax + By + Cy + D = 0 is inside the plane/quad
-class Quad : public Hittable {
+class Quad final : public Hittable {
     public:
 
         Quad(Point3 const & q, Vec3 const & u, Vec3 const & v, std::shared_ptr<Material> const & m);
 
         bool hit(Ray const & ray, Interval const & rayLimits, HitResult & result) const override;
 
+        bool occluded(Ray const & ray, Interval const & rayLimits) const override;
+
         Aabb bounding_box() const override;
 
+        double pdf_value(Point3 const & origin, Vec3 const & direction) const override;
+
+        Vec3 random_direction(Point3 const & origin) const override;
+
+        std::shared_ptr<Material> const & material() const;
+
     private:
         Point3 _q;
         Vec3 _u;
@@ -30,11 +39,14 @@ class Quad : public Hittable {
         // a constant that we use in intersection calculations that we can pre-calculate to save some time
         // see hit's documentation for more info
         Vec3 _w;
+        double _area;
+        // the average of the lengths of the u and v sides
+        double _uvScale;
 };
 
 // ------
 
-Quad::Quad(Point3 const & q, Vec3 const & u, Vec3 const & v, std::shared_ptr<Material> const & m)
+inline Quad::Quad(Point3 const & q, Vec3 const & u, Vec3 const & v, std::shared_ptr<Material> const & m)
            : _q(q), _u(u), _v(v), _material(m), _boundingBox(Aabb(this->_q, this->_q + this->_u + this->_v).pad()) {
     auto uvNormal = this->_u.cross(this->_v);
 
@@ -43,6 +55,9 @@ Quad::Quad(Point3 const & q, Vec3 const & u, Vec3 const & v, std::shared_ptr<Mat
 
     // note this isn't using the unit vector normal
     this->_w = uvNormal / uvNormal.dot(uvNormal);
+
+    this->_area = uvNormal.length();
+    this->_uvScale = std::sqrt(this->_u.length() * this->_v.length());
 }
 
 // Step 1: find the plane equation for the that the quad is on
@@ -73,28 +88,21 @@ Quad::Quad(Point3 const & q, Vec3 const & u, Vec3 const & v, std::shared_ptr<Mat
 //                w = normal / normal . (u x v) = normal / normal . normal
 //                alpha = w . (p x v)
 //                beta = w . (u x p)
-bool Quad::hit(Ray const & ray, Interval const & rayLimits, HitResult & result) const {
-    LOG(
-        std::clog << "Quad intersection check for quad q: " << this->_q << ", u: " << this->_u << ", v: " << this->_v
-                  << ", normal: " << this->_normal << ", w: " << this->_w << "\n";
-    )
+inline bool Quad::hit(Ray const & ray, Interval const & rayLimits, HitResult & result) const {
+    stats::count_primitive_test(stats::Primitive::Quad);
 
     double normalDotRayDirection = this->_normal.dot(ray.dir);
     // some leeway to capture things that are almost parallel but not technically
     if (fabs(normalDotRayDirection) < 0.00000001) {
         // no hit, the ray is parallel to the plane
-        LOG(
-            std::clog << "Ray does not hit quad, normal . ray direction: " << normalDotRayDirection << "\n";
-        )
+        TRACE(trace::Level::Intersection, trace::Event::QuadParallel, normalDotRayDirection);
         return false;
     }
 
     double t = (this->_constantD - this->_normal.dot(ray.orig)) / normalDotRayDirection;
     // make sure we're within the limits of the ray
     if (!rayLimits.contains(t)) {
-        LOG(
-            std::clog << "Ray hits quad at " << t << " but this is not in ray limits: " << rayLimits.min << " " << rayLimits.max << "\n";
-        )
+        TRACE(trace::Level::Intersection, trace::Event::QuadOutsideLimits, t, rayLimits.min, rayLimits.max);
         return false;
     }
 
@@ -108,38 +116,81 @@ bool Quad::hit(Ray const & ray, Interval const & rayLimits, HitResult & result)
     // how many v vectors would it take to reach the intersection point
     double beta = this->_w.dot(this->_u.cross(intersectionPointFromQ));
 
-    LOG(
-        std::clog << "Ray alpha w: " << this->_w << ", intersection point x v: " << intersectionPointFromQ.cross(this->_v) << "\n";
-        std::clog << "Ray beta w: " << this->_w << ", u x intersection point: " << this->_u.cross(intersectionPointFromQ) << "\n";
-    )
-
     if ((alpha < 0) || (alpha > 1) || (beta < 0) || (beta > 1)) {
         // intersected with the plane, but not within the bounds of this quad
-        LOG(
-            std::clog << "Ray hits quad at " << t << ", intersection point: " << planeIntersectionPoint
-                      << " but has a u factor of " << alpha << " and v factor of " << beta << " so is being rejected\n";
-        )
+        TRACE(trace::Level::Intersection, trace::Event::QuadOutsideBounds, t, alpha, beta);
         return false;
     }
 
     result.t = t;
     result.point = planeIntersectionPoint;
-    result.material = this->_material;
+    result.material = this->_material.get();
     result.set_face_normal(ray, this->_normal);
     result.u = alpha;
     result.v = beta;
+    result.uvScale = this->_uvScale;
 
-    LOG(
-        std::clog << "Ray hits quad at " << t << " which is the point " << planeIntersectionPoint
-                  << ", with u factor of " << alpha << " and v factor of "
-                  << beta << " \n";
-    )
+    TRACE(trace::Level::Intersection, trace::Event::QuadHit, t, alpha, beta);
 
+    stats::count_primitive_hit(stats::Primitive::Quad);
     return true;
 }
 
-Aabb Quad::bounding_box() const {
+// the same as hit, but without filling in a result
+inline bool Quad::occluded(Ray const & ray, Interval const & rayLimits) const {
+    stats::count_primitive_test(stats::Primitive::Quad);
+
+    double normalDotRayDirection = this->_normal.dot(ray.dir);
+    if (fabs(normalDotRayDirection) < 0.00000001) {
+        return false;
+    }
+
+    double t = (this->_constantD - this->_normal.dot(ray.orig)) / normalDotRayDirection;
+    if (!rayLimits.contains(t)) {
+        return false;
+    }
+
+    Point3 intersectionPointFromQ = ray.at(t) - this->_q;
+
+    double alpha = this->_w.dot(intersectionPointFromQ.cross(this->_v));
+    double beta = this->_w.dot(this->_u.cross(intersectionPointFromQ));
+
+    if ((alpha < 0) || (alpha > 1) || (beta < 0) || (beta > 1)) {
+        return false;
+    }
+
+    stats::count_primitive_hit(stats::Primitive::Quad);
+    return true;
+}
+
+inline Aabb Quad::bounding_box() const {
     return this->_boundingBox;
 }
 
+// picking a point uniformly on the quad has a density of 1 / area, which needs converting to be per solid angle
+// from the origin's point of view. The further away the quad is, or the more its tilted away from the origin,
+// the smaller it looks and so the more densely the directions towards it are packed:
+//     pdf = distance^2 / (cos(theta) * area)
+// where theta is the angle between the direction and the quad's normal
+inline double Quad::pdf_value(Point3 const & origin, Vec3 const & direction) const {
+    auto result = HitResult();
+    if (!this->hit(Ray(origin, direction), Interval(0.001, std::numeric_limits<double>::infinity()), result)) {
+        return 0;
+    }
+
+    double distanceSquared = result.t * result.t * direction.length_squared();
+    double cosine = fabs(direction.dot(this->_normal) / direction.length());
+
+    return distanceSquared / (cosine * this->_area);
+}
+
+inline Vec3 Quad::random_direction(Point3 const & origin) const {
+    auto pointOnQuad = this->_q + (random_double() * this->_u) + (random_double() * this->_v);
+    return pointOnQuad - origin;
+}
+
+inline std::shared_ptr<Material> const & Quad::material() const {
+    return this->_material;
+}
+
 #endif
@@ -1,12 +1,27 @@
 #ifndef RANDOM_H
 #define RANDOM_H
 
+#include <cmath>
+#include <cstdint>
 #include <random>
 
+#include "vec3.h"
+
+// every thread has its own generator, so that threads don't have to take turns generating numbers.
+// they all start with the same (default) seed, so use seed_random when the numbers from
+// different threads need to be different
+inline std::mt19937 & random_generator() {
+    static thread_local std::mt19937 generator;
+    return generator;
+}
+
+inline void seed_random(uint32_t seed) {
+    random_generator().seed(seed);
+}
+
 inline double random_double() {
-    static std::uniform_real_distribution<double> distribution(0.0, 1.0);
-    static std::mt19937 generator;
-    return distribution(generator);
+    static thread_local std::uniform_real_distribution<double> distribution(0.0, 1.0);
+    return distribution(random_generator());
 }
 
 inline double random_double(double min, double max) {
@@ -17,8 +32,30 @@ inline double random_int(int min, int max) {
     return static_cast<int>(random_double(min, max + 1));
 }
 
-// a unit sphere is a sphere with radius 1, so basically this creates a random
-// unit vector where x, y and z could range between -1 and 1
+// none of these use rejection sampling (i.e generating random points in a box until one falls in the shape), so they
+// always take the same number of random numbers rather than an unbounded number of them.
+// the ones that take u1 and u2 map two numbers in [0, 1) to the shape, so that they can be fed by a Sampler rather
+// than random_double, the random_ versions just call them with random numbers
+
+// a unit vector, with every direction being equally likely.
+// when added to a normal, the result follows a true Lambertian distribution, i.e cos(a) / pi where a is the
+// angle between the result and the normal, see also cosine_direction
+inline Vec3 uniform_direction(double u1, double u2) {
+    // z is uniform between -1 and 1 because the area of a slice of a sphere only depends on its thickness
+    double z = 1 - (2 * u1);
+    double radius = sqrt(fmax(0.0, 1 - (z * z)));
+    double phi = 2 * PI * u2;
+
+    return Vec3(radius * cos(phi), radius * sin(phi), z);
+}
+
+inline Vec3 random_unit_vec3() {
+    double u1 = random_double();
+    double u2 = random_double();
+    return uniform_direction(u1, u2);
+}
+
+// a random point inside of a unit sphere (a sphere of radius 1), so x, y and z could range between -1 and 1
 //
 // from what I understand, for the purpose of generating vectors relative to a normal,
 // the random values produced by this follow a distribution
@@ -26,24 +63,8 @@ inline double random_int(int min, int max) {
 // in other words, this way of generating a random vector is biased towards
 // vectors that are closer to the normal.
 inline Vec3 random_unit_vec3_in_unit_sphere() {
-    while (true) {
-        // the individual dimensions of a unit vector should be in the range [-1, 1]
-        // though note in this case due to how the random generation works its
-        // actually [-1, 1)
-        auto p = Vec3(random_double(-1, 1), random_double(-1, 1), random_double(-1, 1));
-        if (p.length_squared() >= 1) {
-            continue;
-        }
-        return p;
-    }
-}
-
-// when used for generating vectors relative to a normal, this apparently
-// generates unit vectors that follow true Lambertian distribution
-// which improves the likelihood of having vectors that have a larger angle away
-// from said normal
-inline Vec3 random_unit_vec3() {
-    return random_unit_vec3_in_unit_sphere().unit();
+    // the volume within a radius r grows by r^3, so the cube root keeps points from bunching up in the middle
+    return random_unit_vec3() * cbrt(random_double());
 }
 
 // generates a random vector that is in the same direction as the normal
@@ -59,13 +80,35 @@ inline Vec3 random_in_hemisphere(Vec3 const & normal) {
     }
 }
 
-// generates a random point that falls within a disk of radius 1
-Point3 random_point_in_unit_disk() {
-    while (true) {
-        auto p = Point3(random_double(-1, 1), random_double(-1, 1), 0);
-        if (p.length_squared() >= 1.0) continue;
-        return p;
-    }
+// a unit vector around the z axis, distributed by cos(a) / pi where a is the angle from the z axis.
+// use Onb to point it around some other direction (e.g a normal)
+inline Vec3 cosine_direction(double u1, double u2) {
+    // picks a point uniformly on the unit disk and projects it up onto the hemisphere (Malley's method)
+    double phi = 2 * PI * u1;
+    double radius = sqrt(u2);
+
+    return Vec3(radius * cos(phi), radius * sin(phi), sqrt(1 - u2));
+}
+
+inline Vec3 random_cosine_direction() {
+    double u1 = random_double();
+    double u2 = random_double();
+    return cosine_direction(u1, u2);
+}
+
+// a point within a disk of radius 1
+inline Point3 unit_disk_point(double u1, double u2) {
+    // the area within a radius r grows by r^2, hence the square root
+    double radius = sqrt(u1);
+    double theta = 2 * PI * u2;
+
+    return Point3(radius * cos(theta), radius * sin(theta), 0);
+}
+
+inline Point3 random_point_in_unit_disk() {
+    double u1 = random_double();
+    double u2 = random_double();
+    return unit_disk_point(u1, u2);
 }
 
 #endif
\ No newline at end of file
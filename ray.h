@@ -7,11 +7,28 @@
 
 #include "vec3.h"
 
+// a cone around a ray that widens as the ray travels, standing in for the area of the scene that a pixel covers so
+// that textures can be filtered over that area. Bounces keep the same spread angle, i.e they're treated as if they
+// were mirror reflections off of a flat surface. See "Texture Level of Detail Strategies for Real-Time Ray Tracing"
+// (Akenine-Moller et al.)
+class RayCone {
+    public:
+        // the width of the cone at the ray's origin
+        double width = 0;
+        // how much the cone widens by per unit of distance, 0 means textures aren't filtered at all
+        double spreadAngle = 0;
+
+        // the cone of a ray starting from distance along this one
+        RayCone at(double distance) const;
+};
+
 class Ray {
     public:
         Vec3 orig;
         Vec3 dir;
         double time;
+        // only ray_color and the camera look at this, everything else leaves it as it is
+        RayCone cone;
 
         Ray();
 
@@ -22,60 +39,86 @@ class Ray {
 
 #include "hittable.h"
 #include "material.h"
+#include "light_list.h"
+#include "sampler.h"
+#include "stats.h"
+#include "trace.h"
+
+// sampler provides the numbers used to pick the direction of every bounce, see Sampler
+Color ray_color(Ray const & ray, std::shared_ptr<Hittable> const & world, int depth, Color const & backgroundColor,
+                Sampler & sampler);
 
+// the same as the other ray_color, with every bounce picked at random
 Color ray_color(Ray const & ray, std::shared_ptr<Hittable> const & world, int depth, Color const & backgroundColor);
 
+// the same as the other ray_color, but at every surface that scatters randomly, the lights are also sampled
+// directly by shooting a ray towards a random point on one of them (next event estimation), which finds small
+// lights far more often than waiting for a bounce to randomly hit one.
+// scatteringPdf is the density with which the previous bounce picked this ray's direction, 0 if it came from the
+// camera or a specular bounce
+Color ray_color(Ray const & ray, std::shared_ptr<Hittable> const & world, LightList const & lights, int depth,
+                Color const & backgroundColor, Sampler & sampler, double scatteringPdf = 0);
+
+// the weight given to a sample from one sampling strategy when combining it with another, using the power heuristic
+double power_heuristic(double pdf, double otherPdf);
+
+// works out the size of the area around the hit covered by the ray's cone, in texture coordinates (see
+// HitResult::uvFootprint). The more the surface is tilted away from the ray, the more of it the cone covers
+double uv_footprint(Ray const & ray, HitResult const & result);
+
 // ------
 
-Ray::Ray() : orig(), dir(), time(0) { }
+inline RayCone RayCone::at(double distance) const {
+    return RayCone{this->width + (this->spreadAngle * distance), this->spreadAngle};
+}
 
-Ray::Ray(Vec3 const & origin, Vec3 const & direction, double time) : orig(origin), dir(direction), time(time) { }
+inline Ray::Ray() : orig(), dir(), time(0), cone() { }
 
-Vec3 Ray::at(double const t) const {
+inline Ray::Ray(Vec3 const & origin, Vec3 const & direction, double time) : orig(origin), dir(direction), time(time), cone() { }
+
+inline Vec3 Ray::at(double const t) const {
     return orig + t * dir;
 }
 
 // shoot the ray into the world of objects, and find the color emitted at the end of that ray's journey,
 // while keeping track of any materials you hit on the way whose attenuation affects what color is seen in the pixel
-Color ray_color(Ray const & ray, std::shared_ptr<Hittable> const & world, int depth, Color const & backgroundColor) {
-
-    LOG(
-        std::clog << "Bounce number " << depth << "\n";
-    )
-
+inline Color ray_color(Ray const & ray, std::shared_ptr<Hittable> const & world, int depth, Color const & backgroundColor,
+                Sampler & sampler) {
     // when depth is zero we've bounced off of objects too many times
     // this is a safeguard against blowing the stack
     if (depth <= 0) {
         return Color(0, 0, 0);
     }
 
+    stats::count_ray(depth);
+
     double maxRayLength = std::numeric_limits<double>::infinity(); // essentially our view distance
 
     auto hitResult = HitResult();
 
-    LOG(
-        std::clog << "Ray: " << ray.dir << "\n";
-    )
+    TRACE(trace::Level::Ray, trace::Event::RayTraced, depth, ray.dir.x, ray.dir.y, ray.dir.z);
 
     // the 0.00001 is a workaround for fixing "shadow acne"
     // it essentially makes it so that if we collide with something really close, then we ignore it as it might've
     // been a result of a rounding error during the previous collision calculation
     if (world->hit(ray, Interval(0.00001, maxRayLength), hitResult)) {
-        Ray scatteredRay;
-        Color attenuation;
+        ScatterSample sample;
+        hitResult.uvFootprint = uv_footprint(ray, hitResult);
 
         // the color emitted by the object we hit
-        Color emittedColor = hitResult.material->emitted(hitResult.u, hitResult.v, hitResult.point);
+        Color emittedColor = material_emitted(*hitResult.material, hitResult.u, hitResult.v, hitResult.point);
 
         // if this object's material bounces rays, then find out what color results from the bounce
-        // by following the bounce to the original light source, attentuation is how much that original
+        // by following the bounce to the original light source, the sample's weight is how much that original
         // light source's color was affected by this material
-        if (!hitResult.material->scatter(ray, hitResult, attenuation, scatteredRay)) {
+        if (!material_sample(*hitResult.material, ray, hitResult, sampler.get_2d(), sample)) {
             // this material doesn't reflect, so the color we see is whatever light it emits
             return emittedColor;
         }
 
-        Color attenuatedColor = attenuation * ray_color(scatteredRay, world, depth - 1, backgroundColor);
+        auto scatteredRay = Ray(hitResult.point, sample.direction, ray.time);
+        scatteredRay.cone = ray.cone.at(hitResult.t * ray.dir.length());
+        Color attenuatedColor = sample.weight() * ray_color(scatteredRay, world, depth - 1, backgroundColor, sampler);
 
         // how come in the book they add the emitted color to this, but in practice it doesn't seem to make a difference
         return attenuatedColor;
@@ -83,9 +126,7 @@ Color ray_color(Ray const & ray, std::shared_ptr<Hittable> const & world, int de
         // the addition of 1 is to make sure its positive so we don't end up with negative colors
     }
 
-    LOG(
-        std::clog << "Hit nothing so falling back to background color" << "\n";
-    )
+    TRACE(trace::Level::Ray, trace::Event::RayMissed, depth);
 
     return backgroundColor;
 
@@ -99,4 +140,95 @@ Color ray_color(Ray const & ray, std::shared_ptr<Hittable> const & world, int de
 //        (lerpFactor * Color(0.5, 0.7, 1.0));
 }
 
+inline Color ray_color(Ray const & ray, std::shared_ptr<Hittable> const & world, int depth, Color const & backgroundColor) {
+    auto sampler = IndependentSampler();
+    return ray_color(ray, world, depth, backgroundColor, sampler);
+}
+
+// the light reaching a point is found in two ways, either by sampling the lights directly or by following the
+// ray that the material scatters, which means each light gets counted twice. Multiple importance sampling fixes
+// that by weighting each way by how likely it was to find that light compared to the other way, which also
+// favours whichever way is better at the time: sampling the light directly for small lights, and following the
+// scattered ray when it's a big light or a material that scatters in a narrow range of directions
+inline Color ray_color(Ray const & ray, std::shared_ptr<Hittable> const & world, LightList const & lights, int depth,
+                Color const & backgroundColor, Sampler & sampler, double scatteringPdf) {
+    if (depth <= 0) {
+        return Color(0, 0, 0);
+    }
+
+    stats::count_ray(depth);
+    TRACE(trace::Level::Ray, trace::Event::RayTraced, depth, ray.dir.x, ray.dir.y, ray.dir.z);
+
+    auto hitResult = HitResult();
+
+    if (!world->hit(ray, Interval(0.00001, std::numeric_limits<double>::infinity()), hitResult)) {
+        TRACE(trace::Level::Ray, trace::Event::RayMissed, depth);
+        return backgroundColor;
+    }
+
+    Material const & material = *hitResult.material;
+    hitResult.uvFootprint = uv_footprint(ray, hitResult);
+
+    Color emittedColor = material_emitted(material, hitResult.u, hitResult.v, hitResult.point);
+    if (scatteringPdf > 0) {
+        // the previous bounce also sampled the lights directly, so it could've found this one that way too
+        emittedColor = emittedColor * power_heuristic(scatteringPdf, lights.pdf_value(ray.orig, ray.dir));
+    }
+
+    ScatterSample sample;
+    if (!material_sample(material, ray, hitResult, sampler.get_2d(), sample)) {
+        return emittedColor;
+    }
+
+    auto scatteredRay = Ray(hitResult.point, sample.direction, ray.time);
+    scatteredRay.cone = ray.cone.at(hitResult.t * ray.dir.length());
+    Color attenuation = sample.weight();
+    double nextScatteringPdf = sample.isSpecular ? 0 : sample.pdf;
+
+    Color directLight = Color(0, 0, 0);
+    if (nextScatteringPdf > 0) {
+        Vec3 towardsLight = lights.random_direction(hitResult.point);
+        double lightPdf = lights.pdf_value(hitResult.point, towardsLight);
+        // how likely the material was to scatter towards the light, which for the built in materials is also
+        // how much of the light it reflects (i.e attenuation * the pdf is the BSDF times the cosine)
+        double lightScatteringPdf = material_scattering_pdf(material, hitResult, towardsLight);
+
+        // rather than finding the closest thing along the shadow ray, find where the light is and then only
+        // check whether anything at all is in the way, which is a lot cheaper
+        auto shadowRay = Ray(hitResult.point, towardsLight, ray.time);
+        auto lightResult = HitResult();
+        if ((lightPdf > 0) && (lightScatteringPdf > 0)
+            && lights.hit(shadowRay, Interval(0.00001, std::numeric_limits<double>::infinity()), lightResult)) {
+            stats::count_shadow_ray();
+
+            if (!world->occluded(shadowRay, Interval(0.00001, lightResult.t - 0.00001))) {
+                Color lightColor = material_emitted(*lightResult.material, lightResult.u, lightResult.v, lightResult.point);
+
+                directLight = attenuation * lightColor * (lightScatteringPdf / lightPdf) * power_heuristic(lightPdf, lightScatteringPdf);
+            }
+        }
+    }
+
+    return emittedColor + directLight
+         + (attenuation * ray_color(scatteredRay, world, lights, depth - 1, backgroundColor, sampler, nextScatteringPdf));
+}
+
+inline double power_heuristic(double pdf, double otherPdf) {
+    return (pdf * pdf) / ((pdf * pdf) + (otherPdf * otherPdf));
+}
+
+inline double uv_footprint(Ray const & ray, HitResult const & result) {
+    if ((result.uvScale <= 0) || ((ray.cone.width <= 0) && (ray.cone.spreadAngle <= 0))) {
+        return 0;
+    }
+
+    double rayLength = ray.dir.length();
+    double coneWidth = ray.cone.at(result.t * rayLength).width;
+
+    // limited so that surfaces seen edge on don't end up using the smallest mipmap
+    double cosine = fmax(fabs(result.normal.dot(ray.dir)) / rayLength, 0.1);
+
+    return coneWidth / (cosine * result.uvScale);
+}
+
 #endif
@@ -0,0 +1,479 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "random.h"
+
+// a pair of numbers in [0, 1), for sampling things that need two numbers (e.g a point in a pixel or on the lens)
+class Sample2D {
+    public:
+        double x;
+        double y;
+};
+
+enum class SamplerType {
+    // every number is picked at random, independently of all the others
+    Independent,
+    // each sample of a pixel picks from a different stratum (i.e part) of [0, 1), which needs to know how many
+    // samples there are, see make_sampler
+    Stratified,
+    // the Sobol sequence with Owen scrambling, which fills in the gaps left by earlier samples no matter how many
+    // samples are taken
+    Sobol,
+    // a low discrepancy sequence within each pixel, shifted by a different amount for neighbouring pixels so that
+    // the error looks like blue noise (fine grained) rather than clumps
+    BlueNoise
+};
+
+// where the numbers used to pick paths through the scene come from.
+// a pixel is rendered by taking a number of samples, and each sample asks for numbers in the same order: the point
+// in the pixel (2D), the point on the lens (2D), the moment in time (1D), then for every bounce the direction to
+// scatter in (2D). Each request is a "dimension", and a good sampler spreads each dimension evenly over the
+// samples of a pixel, which makes images converge with fewer samples than picking every number at random
+class Sampler {
+    public:
+        virtual ~Sampler() = default;
+
+        // called before each sample of a pixel, which starts again from the first dimension
+        void start_sample(int i, int j, int sampleIndex);
+
+        virtual double get_1d() = 0;
+
+        virtual Sample2D get_2d() = 0;
+
+    protected:
+        Sampler(int samplesPerPixel, uint32_t seed);
+
+        int _samplesPerPixel;
+        uint32_t _seed;
+
+        int _i = 0;
+        int _j = 0;
+        uint32_t _sampleIndex = 0;
+        // a hash of the seed and the pixel, which is different for every pixel
+        uint32_t _pixelSeed = 0;
+        uint32_t _dimension = 0;
+
+        // a different hash for every dimension of the pixel, moving on to the next dimension
+        uint32_t next_dimension_seed();
+};
+
+// creates a sampler of the given type for pixels that take samplesPerPixel samples.
+// samplers that aren't Independent give the same numbers for the same seed and pixel, so change the seed between
+// frames of an animation to keep the noise from staying in place
+std::unique_ptr<Sampler> make_sampler(SamplerType type, int samplesPerPixel, uint32_t seed = 0);
+
+class IndependentSampler final : public Sampler {
+    public:
+        IndependentSampler(int samplesPerPixel = 1, uint32_t seed = 0);
+
+        virtual double get_1d() override;
+
+        virtual Sample2D get_2d() override;
+};
+
+// for a square number of samples the 2D dimensions are split into a grid (jittered sampling), otherwise every
+// sample gets its own row and column (n-rooks). Which sample gets which stratum is shuffled differently for every
+// dimension, so that the dimensions aren't correlated with each other
+class StratifiedSampler final : public Sampler {
+    public:
+        StratifiedSampler(int samplesPerPixel, uint32_t seed = 0);
+
+        virtual double get_1d() override;
+
+        virtual Sample2D get_2d() override;
+
+    private:
+        // the width of the grid, 0 if the number of samples isn't square
+        uint32_t _gridSize;
+};
+
+// uses the first two dimensions of the Sobol sequence for every 2D dimension (and the first for every 1D one),
+// each dimension being shuffled and scrambled with a different seed so that they aren't correlated, see
+// "Practical Hash-based Owen Scrambling" (Burley)
+class SobolSampler final : public Sampler {
+    public:
+        SobolSampler(int samplesPerPixel, uint32_t seed = 0);
+
+        virtual double get_1d() override;
+
+        virtual Sample2D get_2d() override;
+};
+
+// the R2 sequence (and the golden ratio sequence for 1D) within each pixel, see "The Unreasonable Effectiveness of
+// Quasirandom Sequences" (Roberts), shifted (with wrap around) by the value of a blue noise texture at the pixel.
+// Neighbouring pixels end up with very different shifts, so the error between them is spread out evenly.
+// every dimension reads the texture from a different offset, so that they aren't correlated with each other,
+// see "Blue-noise Dithered Sampling" (Georgiev and Fajardo)
+class BlueNoiseSampler final : public Sampler {
+    public:
+        BlueNoiseSampler(int samplesPerPixel, uint32_t seed = 0);
+
+        virtual double get_1d() override;
+
+        virtual Sample2D get_2d() override;
+
+    private:
+        // the width and height of the texture, which is tiled across the image
+        static int const textureSize = 64;
+
+        // the texture, generated the first time it's needed using the void and cluster method (Ulichney).
+        // every value in [0, 1) is in there once, at textureSize^2 evenly spaced steps
+        static std::vector<double> const & texture();
+
+        // the value of the texture at the pixel, with the texture offset by an amount that depends on the seed
+        double texture_at(uint32_t offsetSeed) const;
+
+        // the index within the sequence to use for the next dimension, and that dimension's seed
+        uint32_t next_dimension_index(uint32_t & dimensionSeed);
+};
+
+// hashes and permutations used by the samplers
+
+uint32_t hash_uint32(uint32_t x);
+
+uint32_t hash_combine(uint32_t seed, uint32_t value);
+
+uint32_t reverse_bits(uint32_t x);
+
+// the index'th element of a random permutation of [0, count), a different permutation for each seed. An empty range
+// has no elements to pick from, so 0 is returned for it
+uint32_t permute_index(uint32_t index, uint32_t count, uint32_t seed);
+
+// the largest double that's less than 1, for keeping samples within [0, 1)
+double const oneMinusEpsilon = 0x1.fffffffffffffp-1;
+
+// the golden ratio, and the "plastic" number which is its 2D equivalent, that BlueNoiseSampler's sequences step by
+double const goldenRatio = 1.61803398874989484820;
+double const plasticNumber = 1.32471795724474602596;
+
+// ------
+
+inline Sampler::Sampler(int samplesPerPixel, uint32_t seed) : _samplesPerPixel(samplesPerPixel), _seed(seed) { }
+
+inline void Sampler::start_sample(int i, int j, int sampleIndex) {
+    this->_i = i;
+    this->_j = j;
+    this->_sampleIndex = static_cast<uint32_t>(sampleIndex);
+    this->_pixelSeed = hash_combine(hash_combine(this->_seed, static_cast<uint32_t>(i)), static_cast<uint32_t>(j));
+    this->_dimension = 0;
+}
+
+inline uint32_t Sampler::next_dimension_seed() {
+    return hash_combine(this->_pixelSeed, this->_dimension++);
+}
+
+inline std::unique_ptr<Sampler> make_sampler(SamplerType type, int samplesPerPixel, uint32_t seed) {
+    switch (type) {
+        case SamplerType::Stratified:
+            return std::make_unique<StratifiedSampler>(samplesPerPixel, seed);
+        case SamplerType::Sobol:
+            return std::make_unique<SobolSampler>(samplesPerPixel, seed);
+        case SamplerType::BlueNoise:
+            return std::make_unique<BlueNoiseSampler>(samplesPerPixel, seed);
+        default:
+            return std::make_unique<IndependentSampler>(samplesPerPixel, seed);
+    }
+}
+
+inline IndependentSampler::IndependentSampler(int samplesPerPixel, uint32_t seed) : Sampler(samplesPerPixel, seed) { }
+
+inline double IndependentSampler::get_1d() {
+    return random_double();
+}
+
+inline Sample2D IndependentSampler::get_2d() {
+    double x = random_double();
+    double y = random_double();
+    return Sample2D{x, y};
+}
+
+inline StratifiedSampler::StratifiedSampler(int samplesPerPixel, uint32_t seed) : Sampler(samplesPerPixel, seed), _gridSize(0) {
+    auto gridSize = static_cast<uint32_t>(std::lround(std::sqrt(samplesPerPixel)));
+    if (gridSize * gridSize == static_cast<uint32_t>(samplesPerPixel)) {
+        this->_gridSize = gridSize;
+    }
+}
+
+inline double StratifiedSampler::get_1d() {
+    uint32_t count = this->_samplesPerPixel;
+    uint32_t stratum = permute_index(this->_sampleIndex % count, count, next_dimension_seed());
+
+    return fmin((stratum + random_double()) / count, oneMinusEpsilon);
+}
+
+inline Sample2D StratifiedSampler::get_2d() {
+    uint32_t count = this->_samplesPerPixel;
+    uint32_t seed = next_dimension_seed();
+
+    double jitterX = random_double();
+    double jitterY = random_double();
+
+    if (this->_gridSize > 0) {
+        uint32_t cell = permute_index(this->_sampleIndex % count, count, seed);
+        return Sample2D{fmin(((cell % this->_gridSize) + jitterX) / this->_gridSize, oneMinusEpsilon),
+                        fmin(((cell / this->_gridSize) + jitterY) / this->_gridSize, oneMinusEpsilon)};
+    }
+
+    uint32_t column = permute_index(this->_sampleIndex % count, count, seed);
+    uint32_t row = permute_index(this->_sampleIndex % count, count, hash_uint32(seed));
+    return Sample2D{fmin((column + jitterX) / count, oneMinusEpsilon), fmin((row + jitterY) / count, oneMinusEpsilon)};
+}
+
+// the functions used to generate and scramble the Sobol sequence, all with 32 bits of precision
+namespace sobol {
+    // the first dimension of the Sobol sequence is the van der Corput sequence, i.e the index with its bits reversed
+    inline uint32_t first_dimension(uint32_t index) {
+        return reverse_bits(index);
+    }
+
+    // the second dimension, whose direction numbers are each the previous one xor'ed with itself shifted by one
+    inline uint32_t second_dimension(uint32_t index) {
+        uint32_t result = 0;
+        for (uint32_t direction = 1u << 31; index != 0; index >>= 1, direction ^= direction >> 1) {
+            if (index & 1) {
+                result ^= direction;
+            }
+        }
+        return result;
+    }
+
+    // scrambles the bits of x from the highest to the lowest, each bit being flipped depending on the bits above it
+    // (Laine and Karras)
+    inline uint32_t nested_uniform_scramble(uint32_t x, uint32_t seed) {
+        x = reverse_bits(x);
+
+        x += seed;
+        x ^= x * 0x6c50b47cu;
+        x ^= x * 0xb82f1e52u;
+        x ^= x * 0xc7afe638u;
+        x ^= x * 0x8d22f6e6u;
+
+        return reverse_bits(x);
+    }
+
+    inline double to_double(uint32_t x) {
+        return x * 0x1p-32;
+    }
+}
+
+inline SobolSampler::SobolSampler(int samplesPerPixel, uint32_t seed) : Sampler(samplesPerPixel, seed) { }
+
+inline double SobolSampler::get_1d() {
+    uint32_t seed = next_dimension_seed();
+    // shuffling the order of the points is what decorrelates the dimensions from each other
+    uint32_t index = sobol::nested_uniform_scramble(this->_sampleIndex, seed);
+
+    return sobol::to_double(sobol::nested_uniform_scramble(sobol::first_dimension(index), hash_uint32(seed)));
+}
+
+inline Sample2D SobolSampler::get_2d() {
+    uint32_t seed = next_dimension_seed();
+    uint32_t index = sobol::nested_uniform_scramble(this->_sampleIndex, seed);
+
+    return Sample2D{sobol::to_double(sobol::nested_uniform_scramble(sobol::first_dimension(index), hash_combine(seed, 0))),
+                    sobol::to_double(sobol::nested_uniform_scramble(sobol::second_dimension(index), hash_combine(seed, 1)))};
+}
+
+inline BlueNoiseSampler::BlueNoiseSampler(int samplesPerPixel, uint32_t seed) : Sampler(samplesPerPixel, seed) { }
+
+// every dimension goes through the same points of the sequence, but in a different order so that the dimensions
+// aren't correlated with each other
+inline uint32_t BlueNoiseSampler::next_dimension_index(uint32_t & dimensionSeed) {
+    dimensionSeed = hash_combine(this->_seed, this->_dimension);
+    uint32_t count = this->_samplesPerPixel;
+    return permute_index(this->_sampleIndex % count, count, next_dimension_seed()) + 1;
+}
+
+inline double BlueNoiseSampler::get_1d() {
+    uint32_t dimensionSeed;
+    uint32_t index = next_dimension_index(dimensionSeed);
+
+    double value = texture_at(dimensionSeed) + (index / goldenRatio);
+    return fmin(value - floor(value), oneMinusEpsilon);
+}
+
+inline Sample2D BlueNoiseSampler::get_2d() {
+    uint32_t dimensionSeed;
+    uint32_t index = next_dimension_index(dimensionSeed);
+
+    double x = texture_at(dimensionSeed) + (index / plasticNumber);
+    double y = texture_at(hash_uint32(dimensionSeed)) + (index / (plasticNumber * plasticNumber));
+
+    return Sample2D{fmin(x - floor(x), oneMinusEpsilon), fmin(y - floor(y), oneMinusEpsilon)};
+}
+
+inline double BlueNoiseSampler::texture_at(uint32_t offsetSeed) const {
+    uint32_t hash = hash_uint32(offsetSeed);
+    int x = (this->_i + static_cast<int>(hash % textureSize)) % textureSize;
+    int y = (this->_j + static_cast<int>((hash >> 16) % textureSize)) % textureSize;
+
+    return texture()[(y * textureSize) + x];
+}
+
+inline std::vector<double> const & BlueNoiseSampler::texture() {
+    static std::vector<double> const values = []() {
+        int const size = textureSize;
+        int const pixelCount = size * size;
+
+        // how much a point adds to the "energy" of the pixels around it, a gaussian that wraps around the edges.
+        // a pixel with high energy is in a cluster of points, and one with low energy is in a void between them
+        double const sigma = 1.5;
+        std::vector<double> falloff(pixelCount);
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) {
+                int dx = std::min(x, size - x);
+                int dy = std::min(y, size - y);
+                falloff[(y * size) + x] = exp(-((dx * dx) + (dy * dy)) / (2 * sigma * sigma));
+            }
+        }
+
+        std::vector<bool> isPoint(pixelCount, false);
+        std::vector<double> energy(pixelCount, 0);
+
+        auto update_energy = [&](int pixel, double sign) {
+            int pixelX = pixel % size;
+            int pixelY = pixel / size;
+            for (int y = 0; y < size; y++) {
+                for (int x = 0; x < size; x++) {
+                    int dx = (x - pixelX + size) % size;
+                    int dy = (y - pixelY + size) % size;
+                    energy[(y * size) + x] += sign * falloff[(dy * size) + dx];
+                }
+            }
+        };
+        auto set_point = [&](int pixel, bool value) {
+            isPoint[pixel] = value;
+            update_energy(pixel, value ? 1 : -1);
+        };
+        // the point with the highest energy, or the empty pixel with the lowest
+        auto find_extreme = [&](bool findPoint) {
+            int best = -1;
+            for (int pixel = 0; pixel < pixelCount; pixel++) {
+                if (isPoint[pixel] != findPoint) {
+                    continue;
+                }
+                if ((best < 0) || (findPoint ? energy[pixel] > energy[best] : energy[pixel] < energy[best])) {
+                    best = pixel;
+                }
+            }
+            return best;
+        };
+
+        // start with a tenth of the pixels picked at random, then even them out by moving the point in the
+        // tightest cluster to the largest void until that stops changing anything
+        int const initialPointCount = pixelCount / 10;
+        for (uint32_t i = 0; std::count(isPoint.begin(), isPoint.end(), true) < initialPointCount; i++) {
+            int pixel = static_cast<int>(hash_uint32(i) % pixelCount);
+            if (!isPoint[pixel]) {
+                set_point(pixel, true);
+            }
+        }
+        while (true) {
+            int cluster = find_extreme(true);
+            set_point(cluster, false);
+            int largestVoid = find_extreme(false);
+            if (largestVoid == cluster) {
+                set_point(cluster, true);
+                break;
+            }
+            set_point(largestVoid, true);
+        }
+
+        // the rank of every pixel is the order it's added in, points in the initial pattern are ranked by removing
+        // them from the tightest clusters first, the rest by filling in the largest voids first
+        std::vector<double> ranks(pixelCount);
+        auto initialPoints = isPoint;
+        auto initialEnergy = energy;
+
+        for (int rank = initialPointCount - 1; rank >= 0; rank--) {
+            int cluster = find_extreme(true);
+            set_point(cluster, false);
+            ranks[cluster] = rank;
+        }
+
+        isPoint = initialPoints;
+        energy = initialEnergy;
+        for (int rank = initialPointCount; rank < pixelCount; rank++) {
+            int largestVoid = find_extreme(false);
+            set_point(largestVoid, true);
+            ranks[largestVoid] = rank;
+        }
+
+        for (auto & rank : ranks) {
+            rank = (rank + 0.5) / pixelCount;
+        }
+        return ranks;
+    }();
+
+    return values;
+}
+
+// "lowbias32" from Chris Wellons' hash prospector
+inline uint32_t hash_uint32(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+inline uint32_t hash_combine(uint32_t seed, uint32_t value) {
+    return hash_uint32(seed ^ (value + 0x9e3779b9u + (seed << 6) + (seed >> 2)));
+}
+
+inline uint32_t reverse_bits(uint32_t x) {
+    x = (x << 16) | (x >> 16);
+    x = ((x & 0x00ff00ffu) << 8) | ((x & 0xff00ff00u) >> 8);
+    x = ((x & 0x0f0f0f0fu) << 4) | ((x & 0xf0f0f0f0u) >> 4);
+    x = ((x & 0x33333333u) << 2) | ((x & 0xccccccccu) >> 2);
+    x = ((x & 0x55555555u) << 1) | ((x & 0xaaaaaaaau) >> 1);
+    return x;
+}
+
+// Kensler's permutation from "Correlated Multi-Jittered Sampling", which hashes the index within the smallest
+// power of two that fits count, trying again until it lands within count (which takes less than 2 tries on average)
+inline uint32_t permute_index(uint32_t index, uint32_t count, uint32_t seed) {
+    // otherwise the mask below covers every uint32_t, none of which are less than 0, so it'd never stop trying
+    if (count <= 1) {
+        return 0;
+    }
+
+    uint32_t mask = count - 1;
+    mask |= mask >> 1;
+    mask |= mask >> 2;
+    mask |= mask >> 4;
+    mask |= mask >> 8;
+    mask |= mask >> 16;
+
+    do {
+        index ^= seed;
+        index *= 0xe170893du;
+        index ^= seed >> 16;
+        index ^= (index & mask) >> 4;
+        index ^= seed >> 8;
+        index *= 0x0929eb3fu;
+        index ^= seed >> 23;
+        index ^= (index & mask) >> 1;
+        index *= 1 | (seed >> 27);
+        index *= 0x6935fa69u;
+        index ^= (index & mask) >> 11;
+        index *= 0x74dcb303u;
+        index ^= (index & mask) >> 2;
+        index *= 0x9e501cc3u;
+        index ^= (index & mask) >> 2;
+        index *= 0xc860a3dfu;
+        index &= mask;
+        index ^= index >> 5;
+    } while (index >= count);
+
+    return (index + seed) % count;
+}
+
+#endif
@@ -0,0 +1,642 @@
+#ifndef SCENES_H
+#define SCENES_H
+
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "vec3.h"
+#include "color.h"
+#include "random.h"
+
+#include "ray.h"
+
+#include "hittable.h"
+#include "texture.h"
+#include "texture_cache.h"
+#include "texture_registry.h"
+#include "material.h"
+#include "material_table.h"
+#include "sphere.h"
+#include "hittable_list.h"
+#include "aabb.h"
+#include "bvh_node.h"
+#include "quad.h"
+#include "constant_medium.h"
+#include "grid_medium.h"
+#include "transformer.h"
+#include "instance.h"
+#include "top_level_bvh.h"
+
+#include "camera.h"
+
+// a world and a camera to render it with, for the scenes that are a single image. The scenes that are animations
+// render themselves, see main.cpp
+class Scene {
+    public:
+        HittableList world;
+        Camera camera;
+        // whether to put the world in a BVH before rendering it, scenes with only a few objects are quicker without one
+        bool useBvh = true;
+        // called once the scene has been rendered, e.g to report statistics
+        std::function<void ()> rendered;
+
+        Scene(HittableList const & world, Camera const & camera, bool useBvh = true);
+
+        // the world as it gets rendered, building the BVH if there is one
+        std::shared_ptr<Hittable> build_world() const;
+};
+
+// the number the scene is picked with on the command line, its name and the function that builds it
+class SceneEntry {
+    public:
+        int id;
+        std::string name;
+        std::function<Scene ()> build;
+};
+
+// every scene that's a single image, in the order of their ids
+std::vector<SceneEntry> const & still_scenes();
+
+Scene random_spheres();
+
+Scene checkered_spheres();
+
+Scene earth();
+
+// the same as earth, but with the texture paged in through a texture cache that's much smaller than the texture
+Scene earth_cached();
+
+Scene two_spheres();
+
+// "Perlin noise" from "Ray tracing the next week", with the noise, turbulence and marble textures side by side.
+// none of the textures take up any more memory than their noise tables
+Scene perlin_spheres();
+
+Scene quads();
+
+Scene simple_lights();
+
+Scene cornell_box();
+
+Scene cornell_smoke();
+
+// a cloud floating in the cornell box, its density is turbulent noise that fades out towards the edge of a sphere, so
+// most of the grid around it is empty and never stored
+Scene cornell_cloud();
+
+// a field of thousands of boxes that are all instances of the same box, which only exists once in memory
+Scene instanced_boxes();
+
+// ------
+
+inline Scene::Scene(HittableList const & world, Camera const & camera, bool useBvh)
+             : world(world), camera(camera), useBvh(useBvh) { }
+
+inline std::shared_ptr<Hittable> Scene::build_world() const {
+    if (this->useBvh) {
+        return std::make_shared<BvhNode>(this->world);
+    }
+
+    return std::make_shared<HittableList>(this->world);
+}
+
+inline std::vector<SceneEntry> const & still_scenes() {
+    static std::vector<SceneEntry> const scenes = {
+        { 1, "random_spheres", random_spheres },
+        { 2, "checkered_spheres", checkered_spheres },
+        { 3, "earth", earth },
+        { 4, "two_spheres", two_spheres },
+        { 5, "quads", quads },
+        { 6, "simple_lights", simple_lights },
+        { 7, "cornell_box", cornell_box },
+        { 8, "cornell_smoke", cornell_smoke },
+        { 9, "instanced_boxes", instanced_boxes },
+        { 12, "earth_cached", earth_cached },
+        { 13, "perlin_spheres", perlin_spheres },
+        { 14, "cornell_cloud", cornell_cloud }
+    };
+
+    return scenes;
+}
+
+inline Scene random_spheres() {
+    auto world = HittableList();
+    auto textures = TextureRegistry();
+    auto materials = MaterialTable();
+
+    // ground
+    auto groundTexture = std::make_shared<CheckeredTexture>(0.32, Color(0.2, 0.3, 0.1), Color(0.9, 0.9, 0.9));
+    world.add(std::make_shared<Sphere>(Point3(0.0, -1000, 0),
+                                       1000,
+                                       materials.make<LambertianMaterial>(groundTexture)));
+
+    for (int x = -11; x < 11; x++) {
+        for (int z = -11; z < 11; z++) {
+            auto randomMaterialChoice = random_double();
+            auto sphereCenter = Point3(x + (0.9 * random_double()), 0.2, z + (0.9 * random_double()));
+
+            if ((sphereCenter - Point3(4, 0.2, 0)).length() > 0.9) {
+                std::shared_ptr<Material> randomizedMaterial;
+
+                if (randomMaterialChoice < 0.8) {
+                    // diffuse
+                    randomizedMaterial = materials.make<LambertianMaterial>(textures.solid(Color::random()));
+                } else if (randomMaterialChoice < 0.95) {
+                    // metal
+                    randomizedMaterial = materials.make<MetalMaterial>(Color::random(0.5, 1), random_double(0, 0.5));
+                } else {
+                    // glass
+                    randomizedMaterial = materials.make<DielectricMaterial>(1.5);
+                }
+
+                world.add(std::make_shared<Sphere>(sphereCenter,
+                                                   sphereCenter + Point3(0, random_double(0, 0.5), 0),
+                                                   0.2,
+                                                   randomizedMaterial));
+            }
+        }
+    }
+
+    // dielectric bubble
+    // two dielectrics inside each other, with the one inside being "inside out"
+    world.add(std::make_shared<Sphere>(Point3(-8, 1, 0),
+                                       1,
+                                       materials.make<DielectricMaterial>(1.5)));
+    world.add(std::make_shared<Sphere>(Point3(-8, 1, 0),
+                                       -0.95,
+                                       materials.make<DielectricMaterial>(1.5)));
+
+    // diffuse
+    world.add(std::make_shared<Sphere>(Point3(-4, 1, 0),
+                                       1,
+                                       materials.make<LambertianMaterial>(textures.solid(Color(0.4, 0.2, 0.1)))));
+
+    // dielectric
+    world.add(std::make_shared<Sphere>(Point3(0, 1, 0),
+                                       1,
+                                       materials.make<DielectricMaterial>(1.5)));
+
+    // metallic
+    world.add(std::make_shared<Sphere>(Vec3(4, 1, 0),
+                                       1,
+                                       materials.make<MetalMaterial>(Color(0.7, 0.6, 0.5), 0)));
+
+    std::clog << "World contains objects: \n"
+              << world
+              << "\n" << std::flush;
+
+    Camera camera = Camera();
+
+    camera.cameraOrigin = Point3(7, 2, 6);
+    camera.cameraTarget = Point3(0, 0, 0);
+
+    return Scene(world, camera);
+}
+
+inline Scene checkered_spheres() {
+    auto world = HittableList();
+
+    auto groundTexture = std::make_shared<CheckeredTexture>(0.32, Color(0.2, 0.3, 0.1), Color(0.9, 0.9, 0.9));
+    world.add(std::make_shared<Sphere>(Point3(0, -10, 0),
+                                       10,
+                                       std::make_shared<LambertianMaterial>(groundTexture)));
+    world.add(std::make_shared<Sphere>(Point3(0, 10, 0),
+                                       10,
+                                       std::make_shared<LambertianMaterial>(groundTexture)));
+
+    Camera camera = Camera();
+
+    camera.cameraOrigin = Point3(13, 2, 3);
+    camera.cameraTarget = Point3(0, 0, 0);
+    camera.fieldOfView = 20;
+    camera.imageWidth = 400;
+
+    return Scene(world, camera);
+}
+
+inline Scene earth() {
+    auto textures = TextureRegistry();
+    auto earthGlobe = std::make_shared<Sphere>(Point3(0, 0, 0),
+                                               2,
+                                               std::make_shared<LambertianMaterial>(textures.image("./earthmap.jpg")));
+    auto world = HittableList(earthGlobe);
+
+    // the texture has been decoding in the background while the world was put together
+    textures.resolve();
+    textures.report(std::clog);
+
+    Camera camera = Camera();
+
+    camera.cameraOrigin = Point3(0, 0, 12);
+    camera.cameraTarget = Point3(0, 0, 0);
+    camera.fieldOfView = 20;
+    camera.imageWidth = 600;
+
+    // a BVH around a single sphere would only slow it down
+    return Scene(world, camera, false);
+}
+
+inline Scene earth_cached() {
+    convert_to_tiled_texture("./earthmap.jpg", "./earthmap.rttx", TexelFormat::Srgb8);
+
+    auto textureCache = std::make_shared<TextureCache>(256 * 1024);
+    auto earthGlobe = std::make_shared<Sphere>(Point3(0, 0, 0),
+                                               2,
+                                               std::make_shared<LambertianMaterial>(
+                                                    std::make_shared<CachedImageTexture>(textureCache, "./earthmap.rttx")));
+
+    Camera camera = Camera();
+
+    camera.cameraOrigin = Point3(0, 0, 12);
+    camera.cameraTarget = Point3(0, 0, 0);
+    camera.fieldOfView = 20;
+    camera.imageWidth = 600;
+
+    auto scene = Scene(HittableList(earthGlobe), camera, false);
+    scene.rendered = [textureCache]() {
+        textureCache->report(std::clog);
+    };
+
+    return scene;
+}
+
+inline Scene two_spheres() {
+    auto world = HittableList();
+
+    // ground
+    auto groundTexture = std::make_shared<CheckeredTexture>(0.32, Color(0.2, 0.3, 0.1), Color(0.9, 0.9, 0.9));
+    world.add(std::make_shared<Sphere>(Point3(0, -10, 0),
+                                       10,
+                                       std::make_shared<LambertianMaterial>(groundTexture)));
+    world.add(std::make_shared<Sphere>(Point3(0, 10, 0),
+                                       10,
+                                       std::make_shared<LambertianMaterial>(groundTexture)));
+
+    std::clog << "World contains objects: \n"
+              << world
+              << "\n" << std::flush;
+
+    Camera camera = Camera();
+
+    camera.cameraOrigin = Point3(7, 2, 6);
+    camera.cameraTarget = Point3(0, 0, 0);
+
+    return Scene(world, camera);
+}
+
+inline Scene perlin_spheres() {
+    auto world = HittableList();
+
+    world.add(std::make_shared<Sphere>(Point3(0, -1000, 0),
+                                       1000,
+                                       std::make_shared<LambertianMaterial>(std::make_shared<MarbleTexture>(4))));
+    world.add(std::make_shared<Sphere>(Point3(0, 2, 0),
+                                       2,
+                                       std::make_shared<LambertianMaterial>(std::make_shared<MarbleTexture>(4))));
+    world.add(std::make_shared<Sphere>(Point3(0, 1, 3.5),
+                                       1,
+                                       std::make_shared<LambertianMaterial>(std::make_shared<NoiseTexture>(4))));
+    world.add(std::make_shared<Sphere>(Point3(0, 1, -3.5),
+                                       1,
+                                       std::make_shared<LambertianMaterial>(std::make_shared<TurbulenceTexture>(4))));
+
+    std::clog << "World contains objects: \n"
+              << world
+              << "\n" << std::flush;
+
+    Camera camera = Camera();
+
+    camera.cameraOrigin = Point3(13, 2, 3);
+    camera.cameraTarget = Point3(0, 0, 0);
+    camera.fieldOfView = 30;
+    camera.imageWidth = 400;
+
+    return Scene(world, camera);
+}
+
+inline Scene quads() {
+    auto world = HittableList();
+    auto textures = TextureRegistry();
+
+    world.add(std::make_shared<Quad>(Point3(-3, -2, 5),
+                                     Vec3(0, 0,-4),
+                                     Vec3(0, 4, 0),
+                                     std::make_shared<LambertianMaterial>(textures.solid(Color(1.0, 0.2, 0.2)))));
+    world.add(std::make_shared<Quad>(Point3(-2, -2, 0),
+                                     Vec3(4, 0, 0),
+                                     Vec3(0, 4, 0),
+                                     std::make_shared<LambertianMaterial>(textures.solid(Color(0.2, 1.0, 0.2)))));
+    world.add(std::make_shared<Quad>(Point3(3, -2, 1),
+                                     Vec3(0, 0, 4),
+                                     Vec3(0, 4, 0),
+                                     std::make_shared<LambertianMaterial>(textures.solid(Color(0.2, 0.2, 1.0)))));
+    world.add(std::make_shared<Quad>(Point3(-2, 3, 1),
+                                     Vec3(4, 0, 0),
+                                     Vec3(0, 0, 4),
+                                     std::make_shared<LambertianMaterial>(textures.solid(Color(1.0, 0.5, 0.0)))));
+    world.add(std::make_shared<Quad>(Point3(-2, -3, 5),
+                                     Vec3(4, 0, 0),
+                                     Vec3(0, 0, -4),
+                                     std::make_shared<LambertianMaterial>(textures.solid(Color(0.2, 0.8, 0.8)))));
+
+    std::clog << "World contains objects: \n"
+              << world
+              << "\n" << std::flush;
+
+    Camera camera = Camera();
+
+    camera.aspectRatio = 1.0;
+    camera.imageWidth = 500;
+    camera.cameraOrigin = Point3(0, 0, 9);
+    camera.cameraTarget = Point3(0, 0, 0);
+
+    return Scene(world, camera);
+}
+
+inline Scene simple_lights() {
+    auto world = HittableList();
+    auto textures = TextureRegistry();
+
+    world.add(std::make_shared<Sphere>(Point3(0,2,0),
+                                       2,
+                                       std::make_shared<LambertianMaterial>(textures.solid(Color(0.2, 0.2, 1.0)))));
+    // ground
+    auto checkeredTexture = std::make_shared<CheckeredTexture>(0.32, Color(1, 1, 1), Color(0.9, 0.1, 0.9));
+    world.add(std::make_shared<Quad>(Point3(-10, 0, -10),
+                                     Vec3(0, 0, 20),
+                                     Vec3(20, 0, 0),
+                                     std::make_shared<LambertianMaterial>(checkeredTexture)));
+
+    // light
+    world.add(std::make_shared<Quad>(Point3(3, 2, -2),
+                                     Vec3(2, 0, 0),
+                                     Vec3(0, 2, 0),
+                                     std::make_shared<DiffuseLightMaterial>(textures.solid(Color(4, 4, 4)))));
+    world.add(std::make_shared<Sphere>(Point3(0, 7, 0),
+                                       2,
+                                       std::make_shared<DiffuseLightMaterial>(textures.solid(Color(5, 0, 0)))));
+
+    std::clog << "World contains objects: \n"
+              << world
+              << "\n" << std::flush;
+
+    Camera camera = Camera();
+
+    camera.cameraOrigin = Point3(6, 3, 6);
+    camera.cameraTarget = Point3(0, 2, 0);
+    camera.backgroundColor = Color(0, 0, 0);
+
+    return Scene(world, camera);
+}
+
+inline Scene cornell_box() {
+    auto world = HittableList();
+    auto textures = TextureRegistry();
+    auto materials = MaterialTable();
+
+    auto red   = materials.make<LambertianMaterial>(textures.solid(Color(0.65, 0.05, 0.05)));
+    auto white = materials.make<LambertianMaterial>(textures.solid(Color(0.73, 0.73, 0.73)));
+    auto green = materials.make<LambertianMaterial>(textures.solid(Color(0.12, 0.45, 0.15)));
+    auto light = materials.make<DiffuseLightMaterial>(textures.solid(Color(15, 15, 15)));
+
+    // walls
+    world.add(std::make_shared<Quad>(Point3(555, 0, 0),
+                                     Vec3(0, 555, 0),
+                                     Vec3(0, 0, 555),
+                                     green));
+    world.add(std::make_shared<Quad>(Point3(0, 0, 0),
+                                     Vec3(0, 555, 0),
+                                     Vec3(0, 0, 555),
+                                     red));
+    world.add(std::make_shared<Quad>(Point3(343, 554, 332),
+                                     Vec3(-130, 0, 0),
+                                     Vec3(0, 0, -105),
+                                     light));
+    world.add(std::make_shared<Quad>(Point3(0, 0, 0),
+                                     Vec3(555, 0, 0),
+                                     Vec3(0, 0, 555),
+                                     white));
+    world.add(std::make_shared<Quad>(Point3(555, 555, 555),
+                                     Vec3(-555, 0, 0),
+                                     Vec3(0, 0, -555),
+                                     white));
+    world.add(std::make_shared<Quad>(Point3(0, 0, 555),
+                                     Vec3(555, 0, 0),
+                                     Vec3(0, 555, 0),
+                                     white));
+
+    // boxes
+    std::shared_ptr<Hittable> box1 = make_box(Point3(0, 0, 0), Point3(165, 330, 165), white);
+    box1 = std::make_shared<RotateYTransformer>(box1, 15);
+    box1 = std::make_shared<TranslateTransformer>(box1, Vec3(265, 0, 295));
+    world.add(box1);
+
+    std::shared_ptr<Hittable> box2 = make_box(Point3(0, 0, 0), Point3(165, 165, 165), white);
+    box2 = std::make_shared<RotateYTransformer>(box2, -18);
+    box2 = std::make_shared<TranslateTransformer>(box2, Vec3(130, 0, 65));
+    world.add(box2);
+
+    std::clog << "World contains objects: \n"
+              << world
+              << "\n" << std::flush;
+
+    Camera camera = Camera();
+
+    camera.aspectRatio = 1.0;
+    camera.imageWidth = 600;
+    camera.fieldOfView = 40;
+    camera.cameraOrigin = Point3(278, 278, -800);
+    camera.cameraTarget = Point3(278, 278, 0);
+    // with the light being sampled directly, far fewer samples are needed for the same amount of noise
+    camera.aaSamples = 10;
+    camera.backgroundColor = Color(0, 0, 0);
+    camera.lights = LightList(world);
+
+    return Scene(world, camera);
+}
+
+inline Scene cornell_smoke() {
+    auto world = HittableList();
+    auto textures = TextureRegistry();
+    auto materials = MaterialTable();
+
+    auto red   = materials.make<LambertianMaterial>(textures.solid(Color(0.65, 0.05, 0.05)));
+    auto white = materials.make<LambertianMaterial>(textures.solid(Color(0.73, 0.73, 0.73)));
+    auto green = materials.make<LambertianMaterial>(textures.solid(Color(0.12, 0.45, 0.15)));
+    auto light = materials.make<DiffuseLightMaterial>(textures.solid(Color(7, 7, 7)));
+
+    // walls
+    world.add(std::make_shared<Quad>(Point3(555, 0, 0),
+                                     Vec3(0, 555, 0),
+                                     Vec3(0, 0, 555),
+                                     green));
+    world.add(std::make_shared<Quad>(Point3(0, 0, 0),
+                                     Vec3(0, 555, 0),
+                                     Vec3(0, 0, 555),
+                                     red));
+    world.add(std::make_shared<Quad>(Point3(113, 554, 127),
+                                     Vec3(330, 0, 0),
+                                     Vec3(0, 0, 305),
+                                     light));
+    world.add(std::make_shared<Quad>(Point3(0, 555, 0),
+                                     Vec3(555, 0, 0),
+                                     Vec3(0, 0, 555),
+                                     white));
+    world.add(std::make_shared<Quad>(Point3(0, 0, 0),
+                                     Vec3(555, 0, 0),
+                                     Vec3(0, 0, 555),
+                                     white));
+    world.add(std::make_shared<Quad>(Point3(0, 0, 555),
+                                     Vec3(555, 0, 0),
+                                     Vec3(0, 555, 0),
+                                     white));
+
+    // boxes
+    std::shared_ptr<Hittable> box1 = make_box(Point3(0, 0, 0), Point3(165, 330, 165), white);
+    box1 = std::make_shared<RotateYTransformer>(box1, 15);
+    box1 = std::make_shared<TranslateTransformer>(box1, Vec3(265, 0, 295));
+    world.add(std::make_shared<ConstantMedium>(box1, 0.01, textures.solid(Color(0, 0, 0))));
+
+    std::shared_ptr<Hittable> box2 = make_box(Point3(0, 0, 0), Point3(165, 165, 165), white);
+    box2 = std::make_shared<RotateYTransformer>(box2, -18);
+    box2 = std::make_shared<TranslateTransformer>(box2, Vec3(130, 0, 65));
+    world.add(std::make_shared<ConstantMedium>(box2, 0.01, textures.solid(Color(1, 1, 1))));
+
+    std::clog << "World contains objects: \n"
+              << world
+              << "\n" << std::flush;
+
+    std::clog << "Universe: " << Interval::universe.min << ", " << Interval::universe.max << "\n";
+
+    Camera camera = Camera();
+
+    camera.aspectRatio = 1.0;
+    camera.imageWidth = 600;
+    camera.fieldOfView = 40;
+    camera.cameraOrigin = Point3(278, 278, -800);
+    camera.cameraTarget = Point3(278, 278, 0);
+    camera.aaSamples = 50;
+    camera.backgroundColor = Color(0, 0, 0);
+    camera.lights = LightList(world);
+
+    return Scene(world, camera);
+}
+
+inline Scene cornell_cloud() {
+    auto world = HittableList();
+    auto textures = TextureRegistry();
+    auto materials = MaterialTable();
+
+    auto red   = materials.make<LambertianMaterial>(textures.solid(Color(0.65, 0.05, 0.05)));
+    auto white = materials.make<LambertianMaterial>(textures.solid(Color(0.73, 0.73, 0.73)));
+    auto green = materials.make<LambertianMaterial>(textures.solid(Color(0.12, 0.45, 0.15)));
+    auto light = materials.make<DiffuseLightMaterial>(textures.solid(Color(7, 7, 7)));
+
+    // walls
+    world.add(std::make_shared<Quad>(Point3(555, 0, 0),
+                                     Vec3(0, 555, 0),
+                                     Vec3(0, 0, 555),
+                                     green));
+    world.add(std::make_shared<Quad>(Point3(0, 0, 0),
+                                     Vec3(0, 555, 0),
+                                     Vec3(0, 0, 555),
+                                     red));
+    world.add(std::make_shared<Quad>(Point3(113, 554, 127),
+                                     Vec3(330, 0, 0),
+                                     Vec3(0, 0, 305),
+                                     light));
+    world.add(std::make_shared<Quad>(Point3(0, 555, 0),
+                                     Vec3(555, 0, 0),
+                                     Vec3(0, 0, 555),
+                                     white));
+    world.add(std::make_shared<Quad>(Point3(0, 0, 0),
+                                     Vec3(555, 0, 0),
+                                     Vec3(0, 0, 555),
+                                     white));
+    world.add(std::make_shared<Quad>(Point3(0, 0, 555),
+                                     Vec3(555, 0, 0),
+                                     Vec3(0, 555, 0),
+                                     white));
+
+    // cloud
+    auto center = Point3(278, 260, 278);
+    double radius = 180;
+    auto noise = Perlin(7);
+    auto bounds = Aabb(center - Vec3(radius, radius, radius), center + Vec3(radius, radius, radius));
+    auto grid = std::make_shared<DensityGrid const>(DensityGrid::from_function(bounds, 96, 96, 96, [&](Point3 const & p) {
+        double falloff = 1 - ((p - center).length() / radius);
+        if (falloff <= 0) {
+            return 0.0;
+        }
+        double wisps = noise.turbulence(p / 40, 5);
+        return std::max(0.0, (2.5 * falloff * wisps) - 0.15);
+    }));
+    world.add(std::make_shared<GridMedium>(grid, 0.2, Color(0.8, 0.8, 0.8)));
+
+    std::clog << "World contains objects: \n"
+              << world
+              << "\n" << std::flush;
+
+    std::clog << "Cloud density grid: " << grid->stored_bricks() << " of "
+              << grid->bricks(0) * grid->bricks(1) * grid->bricks(2) << " bricks stored, "
+              << grid->memory_size() / 1024 << "KB\n";
+
+    Camera camera = Camera();
+
+    camera.aspectRatio = 1.0;
+    camera.imageWidth = 300;
+    camera.fieldOfView = 40;
+    camera.cameraOrigin = Point3(278, 278, -800);
+    camera.cameraTarget = Point3(278, 278, 0);
+    camera.aaSamples = 50;
+    camera.backgroundColor = Color(0, 0, 0);
+    camera.lights = LightList(world);
+
+    return Scene(world, camera);
+}
+
+inline Scene instanced_boxes() {
+    auto world = HittableList();
+    auto textures = TextureRegistry();
+    auto materials = MaterialTable();
+
+    auto ground = materials.make<LambertianMaterial>(textures.solid(Color(0.48, 0.83, 0.53)));
+    auto white = materials.make<LambertianMaterial>(textures.solid(Color(0.73, 0.73, 0.73)));
+
+    world.add(std::make_shared<Quad>(Point3(-1000, 0, -1000), Vec3(2000, 0, 0), Vec3(0, 0, 2000), ground));
+
+    // the box every instance refers to, centered on the origin so that rotations and scales happen around its center
+    auto box = TopLevelBvh::build_bottom_level(*make_box(Point3(-1, -1, -1), Point3(1, 1, 1), white));
+
+    auto boxes = std::make_shared<TopLevelBvh>();
+    int const boxesPerSide = 100;
+    for (int x = 0; x < boxesPerSide; x++) {
+        for (int z = 0; z < boxesPerSide; z++) {
+            auto position = Vec3(-200 + (x * 4) + random_double(0, 2), 0, -200 + (z * 4) + random_double(0, 2));
+            auto size = Vec3(random_double(0.5, 1.5), random_double(0.5, 4), random_double(0.5, 1.5));
+
+            boxes->add_instance(box, AffineTransform::translate(position + Vec3(0, size.y, 0))
+                                   * AffineTransform::rotate(Vec3(random_double(-1, 1), 1, random_double(-1, 1)), random_double(0, 45))
+                                   * AffineTransform::scale(size));
+        }
+    }
+    boxes->build();
+    world.add(boxes);
+
+    std::clog << "Instanced " << boxes->instance_count() << " boxes\n" << std::flush;
+
+    Camera camera = Camera();
+
+    camera.aspectRatio = 16.0 / 9.0;
+    camera.imageWidth = 600;
+    camera.fieldOfView = 40;
+    camera.cameraOrigin = Point3(0, 40, -240);
+    camera.cameraTarget = Point3(0, 0, -100);
+
+    return Scene(world, camera);
+}
+
+#endif
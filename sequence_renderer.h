@@ -0,0 +1,188 @@
+#ifndef SEQUENCE_RENDERER_H
+#define SEQUENCE_RENDERER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "color.h"
+#include "hittable.h"
+#include "camera.h"
+#include "random.h"
+#include "thread_pool.h"
+#include "trace.h"
+
+// everything needed to render one frame of a sequence.
+// anything that doesn't change between frames (geometry, textures, BVHs) should be created once and shared
+// between the worlds of every frame, rather than re-created for each frame
+class SequenceFrame {
+    public:
+        Camera camera;
+        std::shared_ptr<Hittable> world;
+};
+
+// renders an animation as a sequence of numbered image files (e.g frame_000.ppm, frame_001.ppm, ...).
+// every frame is split into square tiles, and the tiles of all the frames being rendered are scheduled on the
+// same thread pool, so threads that finish their part of a frame can start on the next frame rather than
+// waiting for the slowest tile of the current one.
+class SequenceRenderer {
+    public:
+        int frameCount = 1;
+        // width and height of a tile in pixels
+        int tileSize = 32;
+        // 0 means one thread per hardware thread
+        size_t threadCount = 0;
+        // how many frames can be rendering at the same time. Set this to 1 if the scene is changed in place
+        // between frames (e.g moving the primitives of a DynamicBvh), since then a frame can't start until the
+        // previous one has finished using the scene. Anything less than 1 is treated as 1, since with no frames
+        // allowed in flight none could ever start
+        int framesInFlight = 2;
+        std::string fileNamePrefix = "frame_";
+
+        // called once per frame in order, on the thread that called render(), to set up that frame's camera and
+        // world. The world must not change while the frame is being rendered
+        std::function<SequenceFrame (int frame)> setupFrame;
+
+        void render();
+
+    private:
+        // the state of a frame while its tiles are being rendered
+        class FrameState {
+            public:
+                int frame;
+                SequenceFrame scene;
+                // the rendered colors, one row after the other starting from the bottom row
+                std::vector<Color> pixels;
+                std::atomic<int> tilesRemaining;
+                std::chrono::steady_clock::time_point startTime;
+        };
+
+        std::mutex _mutex;
+        std::condition_variable _frameFinished;
+        int _framesRendering = 0;
+
+        void render_tile(FrameState & state, int tile, int startI, int startJ);
+
+        void write_frame(FrameState const & state);
+
+        std::string file_name(int frame) const;
+};
+
+// ------
+
+inline void SequenceRenderer::render() {
+    auto pool = ThreadPool(this->threadCount);
+
+    std::clog << "Rendering " << this->frameCount << " frames on " << pool.thread_count() << " threads\n" << std::flush;
+
+    int framesInFlight = std::max(1, this->framesInFlight);
+
+    for (int frame = 0; frame < this->frameCount; frame++) {
+        {
+            std::unique_lock<std::mutex> lock(this->_mutex);
+            this->_frameFinished.wait(lock, [this, framesInFlight]() { return this->_framesRendering < framesInFlight; });
+        }
+
+        auto state = std::make_shared<FrameState>();
+        state->frame = frame;
+        state->scene = this->setupFrame(frame);
+
+        {
+            // initialize() logs the camera's settings, so this is done with the lock held to keep it from being
+            // mixed up with the logs of frames finishing
+            std::lock_guard<std::mutex> lock(this->_mutex);
+            state->scene.camera.initialize();
+            this->_framesRendering++;
+        }
+
+        Camera const & camera = state->scene.camera;
+        state->pixels.resize(camera.imageWidth * camera.imageHeight);
+        state->startTime = std::chrono::steady_clock::now();
+
+        int tilesAcross = (camera.imageWidth + this->tileSize - 1) / this->tileSize;
+        int tilesDown = (camera.imageHeight + this->tileSize - 1) / this->tileSize;
+        state->tilesRemaining = tilesAcross * tilesDown;
+
+        for (int tileJ = 0; tileJ < tilesDown; tileJ++) {
+            for (int tileI = 0; tileI < tilesAcross; tileI++) {
+                int tile = (tileJ * tilesAcross) + tileI;
+
+                pool.submit([this, state, tile, tileI, tileJ]() {
+                    render_tile(*state, tile, tileI * this->tileSize, tileJ * this->tileSize);
+
+                    // whichever thread renders the last tile of a frame writes it out
+                    if (--state->tilesRemaining == 0) {
+                        write_frame(*state);
+
+                        std::lock_guard<std::mutex> lock(this->_mutex);
+                        this->_framesRendering--;
+                        this->_frameFinished.notify_all();
+                    }
+                });
+            }
+        }
+    }
+
+    pool.wait();
+
+    std::clog << "\nDone\n";
+}
+
+inline void SequenceRenderer::render_tile(FrameState & state, int tile, int startI, int startJ) {
+    // seeding by frame and tile means the image doesn't depend on which thread rendered which tile,
+    // and that tiles don't all end up with the same noise
+    seed_random((static_cast<uint32_t>(state.frame) * 2654435761u) ^ static_cast<uint32_t>(tile));
+
+    Camera const & camera = state.scene.camera;
+
+    int endI = std::min(startI + this->tileSize, camera.imageWidth);
+    int endJ = std::min(startJ + this->tileSize, camera.imageHeight);
+
+    auto sampler = camera.create_sampler();
+
+    for (int j = startJ; j < endJ; j++) {
+        for (int i = startI; i < endI; i++) {
+            // the same as Camera::render, render_pixel starts tracing the pixel if it's one of the ones being traced
+            // (see trace.h), so it has to be stopped once the pixel is done
+            state.pixels[(j * camera.imageWidth) + i] = camera.render_pixel(state.scene.world, i, j, *sampler);
+            trace::end_pixel();
+        }
+    }
+}
+
+inline void SequenceRenderer::write_frame(FrameState const & state) {
+    Camera const & camera = state.scene.camera;
+
+    std::ofstream file(file_name(state.frame));
+    file << "P3\n" << camera.imageWidth << " " << camera.imageHeight << "\n255\n";
+
+    // same order as Camera::render, from top to bottom, left to right
+    for (int j = camera.imageHeight - 1; j >= 0; --j) {
+        for (int i = 0; i < camera.imageWidth; ++i) {
+            write_color(file, state.pixels[(j * camera.imageWidth) + i]);
+        }
+    }
+
+    auto milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - state.startTime).count();
+
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    std::clog << "Wrote frame " << state.frame << " to " << file_name(state.frame) << ", "
+              << milliseconds << "ms after it was queued\n" << std::flush;
+}
+
+inline std::string SequenceRenderer::file_name(int frame) const {
+    std::ostringstream name;
+    name << this->fileNamePrefix << std::setfill('0') << std::setw(3) << frame << ".ppm";
+    return name.str();
+}
+
+#endif
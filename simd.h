@@ -0,0 +1,222 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <cstddef>
+
+// optional SIMD kernels for the three component double vectors that make up Vec3 and Color
+// they're only used when compiling with -DRAY_TRACER_SIMD on an x86 target, single vector kernels
+// use SSE2 (which every x86-64 processor has), the batched kernels additionally use AVX when compiled
+// with -mavx. Without RAY_TRACER_SIMD everything falls back to plain scalar code.
+//
+// the kernels work on pointers to three consecutive doubles (i.e &v.x or &c.r) so that they can be shared
+// between Vec3 and Color, both of which are laid out as three doubles with no padding
+#if defined(RAY_TRACER_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+#define RAY_TRACER_SIMD_ENABLED
+#include <immintrin.h>
+#endif
+
+namespace simd {
+    // out = a + b
+    inline void add3(double const * a, double const * b, double * out);
+    // out = a - b
+    inline void sub3(double const * a, double const * b, double * out);
+    // out = a * b (component wise)
+    inline void mul3(double const * a, double const * b, double * out);
+    // out = a * constant
+    inline void scale3(double const * a, double constant, double * out);
+    // returns a . b
+    inline double dot3(double const * a, double const * b);
+    // out = a x b
+    inline void cross3(double const * a, double const * b, double * out);
+
+    // the batched kernels below work on count doubles at a time, since adding/multiplying
+    // arrays of Vec3/Color component wise is the same as doing so for a flat array of doubles
+    inline void add_batch(double const * a, double const * b, double * out, size_t count);
+    inline void mul_batch(double const * a, double const * b, double * out, size_t count);
+    inline void scale_batch(double const * a, double constant, double * out, size_t count);
+
+    // returns whether the SIMD kernels were compiled in, useful for benchmarks and logging
+    constexpr bool enabled();
+}
+
+// ------
+
+#ifdef RAY_TRACER_SIMD_ENABLED
+
+// the x and y components go in one 128 bit register, and z goes on its own in the lower half of another,
+// loading 4 doubles at once would read past the end of the last vector in an array
+
+inline void simd::add3(double const * a, double const * b, double * out) {
+    _mm_storeu_pd(out, _mm_add_pd(_mm_loadu_pd(a), _mm_loadu_pd(b)));
+    _mm_store_sd(out + 2, _mm_add_sd(_mm_load_sd(a + 2), _mm_load_sd(b + 2)));
+}
+
+inline void simd::sub3(double const * a, double const * b, double * out) {
+    _mm_storeu_pd(out, _mm_sub_pd(_mm_loadu_pd(a), _mm_loadu_pd(b)));
+    _mm_store_sd(out + 2, _mm_sub_sd(_mm_load_sd(a + 2), _mm_load_sd(b + 2)));
+}
+
+inline void simd::mul3(double const * a, double const * b, double * out) {
+    _mm_storeu_pd(out, _mm_mul_pd(_mm_loadu_pd(a), _mm_loadu_pd(b)));
+    _mm_store_sd(out + 2, _mm_mul_sd(_mm_load_sd(a + 2), _mm_load_sd(b + 2)));
+}
+
+inline void simd::scale3(double const * a, double constant, double * out) {
+    __m128d c = _mm_set1_pd(constant);
+    _mm_storeu_pd(out, _mm_mul_pd(_mm_loadu_pd(a), c));
+    _mm_store_sd(out + 2, _mm_mul_sd(_mm_load_sd(a + 2), c));
+}
+
+inline double simd::dot3(double const * a, double const * b) {
+    __m128d xy = _mm_mul_pd(_mm_loadu_pd(a), _mm_loadu_pd(b));
+    __m128d z = _mm_mul_sd(_mm_load_sd(a + 2), _mm_load_sd(b + 2));
+    // (x + y) + z, the same order as the scalar version so results match exactly
+    __m128d sum = _mm_add_sd(xy, _mm_unpackhi_pd(xy, xy));
+    return _mm_cvtsd_f64(_mm_add_sd(sum, z));
+}
+
+// the x and y of the cross product are (ay * bz - az * by, az * bx - ax * bz) which can be done in one
+// register by shuffling a into (ay, az), (az, ax) and b into (bz, bx), (by, bz)
+inline void simd::cross3(double const * a, double const * b, double * out) {
+    __m128d aYZ = _mm_loadu_pd(a + 1);
+    __m128d bYZ = _mm_loadu_pd(b + 1);
+    __m128d aZX = _mm_set_pd(a[0], a[2]);
+    __m128d bZX = _mm_set_pd(b[0], b[2]);
+
+    _mm_storeu_pd(out, _mm_sub_pd(_mm_mul_pd(aYZ, bZX), _mm_mul_pd(aZX, bYZ)));
+    out[2] = (a[0] * b[1]) - (a[1] * b[0]);
+}
+
+#ifdef __AVX__
+
+inline void simd::add_batch(double const * a, double const * b, double * out, size_t count) {
+    size_t i = 0;
+    for (; i < count - (count % 4); i += 4) {
+        _mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    }
+    for (; i < count; i++) {
+        out[i] = a[i] + b[i];
+    }
+}
+
+inline void simd::mul_batch(double const * a, double const * b, double * out, size_t count) {
+    size_t i = 0;
+    for (; i < count - (count % 4); i += 4) {
+        _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    }
+    for (; i < count; i++) {
+        out[i] = a[i] * b[i];
+    }
+}
+
+inline void simd::scale_batch(double const * a, double constant, double * out, size_t count) {
+    __m256d c = _mm256_set1_pd(constant);
+    size_t i = 0;
+    for (; i < count - (count % 4); i += 4) {
+        _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_loadu_pd(a + i), c));
+    }
+    for (; i < count; i++) {
+        out[i] = a[i] * constant;
+    }
+}
+
+#else
+
+inline void simd::add_batch(double const * a, double const * b, double * out, size_t count) {
+    size_t i = 0;
+    for (; i < count - (count % 2); i += 2) {
+        _mm_storeu_pd(out + i, _mm_add_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+    }
+    for (; i < count; i++) {
+        out[i] = a[i] + b[i];
+    }
+}
+
+inline void simd::mul_batch(double const * a, double const * b, double * out, size_t count) {
+    size_t i = 0;
+    for (; i < count - (count % 2); i += 2) {
+        _mm_storeu_pd(out + i, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+    }
+    for (; i < count; i++) {
+        out[i] = a[i] * b[i];
+    }
+}
+
+inline void simd::scale_batch(double const * a, double constant, double * out, size_t count) {
+    __m128d c = _mm_set1_pd(constant);
+    size_t i = 0;
+    for (; i < count - (count % 2); i += 2) {
+        _mm_storeu_pd(out + i, _mm_mul_pd(_mm_loadu_pd(a + i), c));
+    }
+    for (; i < count; i++) {
+        out[i] = a[i] * constant;
+    }
+}
+
+#endif
+
+constexpr bool simd::enabled() {
+    return true;
+}
+
+#else
+
+inline void simd::add3(double const * a, double const * b, double * out) {
+    out[0] = a[0] + b[0];
+    out[1] = a[1] + b[1];
+    out[2] = a[2] + b[2];
+}
+
+inline void simd::sub3(double const * a, double const * b, double * out) {
+    out[0] = a[0] - b[0];
+    out[1] = a[1] - b[1];
+    out[2] = a[2] - b[2];
+}
+
+inline void simd::mul3(double const * a, double const * b, double * out) {
+    out[0] = a[0] * b[0];
+    out[1] = a[1] * b[1];
+    out[2] = a[2] * b[2];
+}
+
+inline void simd::scale3(double const * a, double constant, double * out) {
+    out[0] = a[0] * constant;
+    out[1] = a[1] * constant;
+    out[2] = a[2] * constant;
+}
+
+inline double simd::dot3(double const * a, double const * b) {
+    return (a[0] * b[0]) + (a[1] * b[1]) + (a[2] * b[2]);
+}
+
+inline void simd::cross3(double const * a, double const * b, double * out) {
+    out[0] = (a[1] * b[2]) - (a[2] * b[1]);
+    out[1] = (a[2] * b[0]) - (a[0] * b[2]);
+    out[2] = (a[0] * b[1]) - (a[1] * b[0]);
+}
+
+inline void simd::add_batch(double const * a, double const * b, double * out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = a[i] + b[i];
+    }
+}
+
+inline void simd::mul_batch(double const * a, double const * b, double * out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = a[i] * b[i];
+    }
+}
+
+inline void simd::scale_batch(double const * a, double constant, double * out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = a[i] * constant;
+    }
+}
+
+constexpr bool simd::enabled() {
+    return false;
+}
+
+#endif
+
+#endif
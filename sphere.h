@@ -5,8 +5,10 @@
 #include "vec3.h"
 #include "hittable.h"
 #include "aabb.h"
+#include "stats.h"
+#include "trace.h"
 
-class Sphere : public Hittable {
+class Sphere final : public Hittable {
 
 public:
     Point3 center;
@@ -21,20 +23,53 @@ public:
     // for representing a moving sphere, endC is the end position of the center at the end of time
     Sphere(Point3 c, Point3 endC, double r, std::shared_ptr<Material> m);
 
+    // moves the sphere, for use when animating a scene across multiple frames
+    void set_center(Point3 const & c);
+    void set_center(Point3 const & c, Point3 const & endC);
+
     virtual bool hit(Ray const & ray, Interval const & rayLimits, HitResult & result) const override;
 
+    virtual bool occluded(Ray const & ray, Interval const & rayLimits) const override;
+
+    // both roots of the same quadratic as hit
+    virtual bool hit_interval(Ray const & ray, Interval const & rayLimits, Interval & inside) const override;
+
     virtual Aabb bounding_box() const override;
+
+    virtual Aabb bounding_box_at(double time) const override;
+
+    // when used as a light, the sphere is sampled where it is at the start of time
+    virtual double pdf_value(Point3 const & origin, Vec3 const & direction) const override;
+
+    virtual Vec3 random_direction(Point3 const & origin) const override;
+
+private:
+    // u goes around the equator (2 pi r long) and v from pole to pole (pi r long), this is the average of the two
+    double uv_scale() const;
 };
 
 // ------
 
-Sphere::Sphere() { }
-Sphere::Sphere(Point3 c, double r, std::shared_ptr<Material> m) : center(c), radius(r), material(m) {
+inline Sphere::Sphere() { }
+inline Sphere::Sphere(Point3 c, double r, std::shared_ptr<Material> m) : radius(r), material(m) {
+    set_center(c);
+}
+inline Sphere::Sphere(Point3 c, Point3 endC, double r, std::shared_ptr<Material> m) : radius(r), material(m) {
+    set_center(c, endC);
+}
+
+inline void Sphere::set_center(Point3 const & c) {
+    this->center = c;
+    this->motionVector = Vec3(0, 0, 0);
+
     auto radiusVector = Vec3(radius, radius, radius);
     this->boundingBox = Aabb(center - radiusVector, center + radiusVector);
 }
-Sphere::Sphere(Point3 c, Point3 endC, double r, std::shared_ptr<Material> m)
-              : center(c), motionVector(endC - center), radius(r), material(m) {
+
+inline void Sphere::set_center(Point3 const & c, Point3 const & endC) {
+    this->center = c;
+    this->motionVector = endC - c;
+
     auto radiusVector = Vec3(radius, radius, radius);
 
     auto startSphereBoundingBox = Aabb(center - radiusVector, center + radiusVector);
@@ -72,7 +107,9 @@ Sphere::Sphere(Point3 c, Point3 endC, double r, std::shared_ptr<Material> m)
 // the quadtratic formula has the discriminant which allows us to know how many values
 // of t there are for a given instance of the equation. this allows us to tell
 // whether the ray intersects the sphere at multiple points or just one or none.
-bool Sphere::hit(Ray const & ray, Interval const & rayLimits, HitResult & result) const {
+inline bool Sphere::hit(Ray const & ray, Interval const & rayLimits, HitResult & result) const {
+    stats::count_primitive_test(stats::Primitive::Sphere);
+
     // use time to interpolate between start and end position of the sphere
     Point3 currentCenter = this->center + (ray.time * motionVector);
 
@@ -93,44 +130,40 @@ bool Sphere::hit(Ray const & ray, Interval const & rayLimits, HitResult & result
         // the rest of the quadratic formula so we can get the value of t
         auto sqrtOfD = sqrt(discriminant);
         auto root = (-halfB - sqrtOfD) / a;
-        LOG(
-            std::clog << "First root is: " << root << ", min: " << rayLimits.min << ", max: " << rayLimits.max << "\n";
-        )
+        TRACE(trace::Level::Intersection, trace::Event::SphereRoot, root, rayLimits.min, rayLimits.max);
         if (rayLimits.contains(root)) {
             result.t = root;
             result.point = ray.at(result.t);
 
             Vec3 outwardNormal = (result.point - currentCenter) / this->radius;
             result.set_face_normal(ray, outwardNormal);
-            result.material = this->material;
+            result.material = this->material.get();
             result.u = (atan2(-outwardNormal.z, outwardNormal.x) + PI) / (2 * PI);
             result.v = acos(-outwardNormal.y) / PI;
+            result.uvScale = uv_scale();
 
-            LOG(
-                std::clog << "Using first root" << "\n";
-            )
+            TRACE(trace::Level::Intersection, trace::Event::SphereHit, 1, root);
+            stats::count_primitive_hit(stats::Primitive::Sphere);
             return true;
         }
 
         // the previous value of t didn't fit in the ray's "length" limits
         // we try the second value
         root = (-halfB + sqrtOfD) / a;
-        LOG(
-            std::clog << "Second root is: " << root << ", min: " << rayLimits.min << ", max: " << rayLimits.max << "\n";
-        )
+        TRACE(trace::Level::Intersection, trace::Event::SphereRoot, root, rayLimits.min, rayLimits.max);
         if (rayLimits.contains(root)) {
             result.t = root;
             result.point = ray.at(result.t);
 
             Vec3 outwardNormal = (result.point - currentCenter) / this->radius;
             result.set_face_normal(ray, outwardNormal);
-            result.material = this->material;
+            result.material = this->material.get();
             result.u = (atan2(-outwardNormal.z, outwardNormal.x) + PI) / (2 * PI);
             result.v = acos(-outwardNormal.y) / PI;
+            result.uvScale = uv_scale();
 
-            LOG(
-                std::clog << "Using second root" << "\n";
-            )
+            TRACE(trace::Level::Intersection, trace::Event::SphereHit, 2, root);
+            stats::count_primitive_hit(stats::Primitive::Sphere);
             return true;
         }
     }
@@ -138,8 +171,110 @@ bool Sphere::hit(Ray const & ray, Interval const & rayLimits, HitResult & result
     return false;
 }
 
-Aabb Sphere::bounding_box() const {
+// the same as hit, but without working out anything about the point that was hit
+inline bool Sphere::occluded(Ray const & ray, Interval const & rayLimits) const {
+    stats::count_primitive_test(stats::Primitive::Sphere);
+
+    Point3 currentCenter = this->center + (ray.time * motionVector);
+
+    Vec3 aMinusC = ray.orig - currentCenter;
+
+    auto a = ray.dir.length_squared();
+    auto halfB = (aMinusC).dot(ray.dir);
+    auto c = aMinusC.length_squared() - (this->radius * this->radius);
+
+    auto discriminant = (halfB * halfB) - (a * c);
+    if (discriminant < 0) {
+        return false;
+    }
+
+    auto sqrtOfD = sqrt(discriminant);
+    if (!rayLimits.contains((-halfB - sqrtOfD) / a) && !rayLimits.contains((-halfB + sqrtOfD) / a)) {
+        return false;
+    }
+
+    stats::count_primitive_hit(stats::Primitive::Sphere);
+    return true;
+}
+
+inline bool Sphere::hit_interval(Ray const & ray, Interval const & rayLimits, Interval & inside) const {
+    Point3 currentCenter = this->center + (ray.time * motionVector);
+
+    Vec3 aMinusC = ray.orig - currentCenter;
+
+    auto a = ray.dir.length_squared();
+    auto halfB = (aMinusC).dot(ray.dir);
+    auto c = aMinusC.length_squared() - (this->radius * this->radius);
+
+    auto discriminant = (halfB * halfB) - (a * c);
+    if (discriminant <= 0) {
+        return false;
+    }
+
+    auto sqrtOfD = sqrt(discriminant);
+    inside = Interval(std::fmax((-halfB - sqrtOfD) / a, rayLimits.min), std::fmin((-halfB + sqrtOfD) / a, rayLimits.max));
+    return inside.min < inside.max;
+}
+
+inline Aabb Sphere::bounding_box() const {
     return this->boundingBox;
 }
 
+inline Aabb Sphere::bounding_box_at(double time) const {
+    // the same as where the sphere is in hit()
+    Point3 currentCenter = this->center + (time * motionVector);
+
+    auto radiusVector = Vec3(radius, radius, radius);
+    return Aabb(currentCenter - radiusVector, currentCenter + radiusVector);
+}
+
+// from the origin, the sphere covers a cone of directions, the edge of which is at an angle of theta max from the
+// direction to the center where sin(theta max) = radius / distance to the center. Directions are picked uniformly
+// within that cone, whose solid angle is 2 pi (1 - cos(theta max))
+inline double Sphere::pdf_value(Point3 const & origin, Vec3 const & direction) const {
+    auto result = HitResult();
+    if (!this->hit(Ray(origin, direction), Interval(0.001, std::numeric_limits<double>::infinity()), result)) {
+        return 0;
+    }
+
+    double distanceSquared = (this->center - origin).length_squared();
+    double sineSquaredThetaMax = (this->radius * this->radius) / distanceSquared;
+    if (sineSquaredThetaMax >= 1) {
+        // the origin is inside the sphere, which can't be sampled as a cone
+        return 0;
+    }
+
+    double cosineThetaMax = sqrt(1 - sineSquaredThetaMax);
+    return 1 / (2 * PI * (1 - cosineThetaMax));
+}
+
+// picks a direction in the cone by picking its angle around the cone's axis (phi) and how far from the axis it is
+// (cos(theta) is picked uniformly between cos(theta max) and 1, which is what makes the directions uniform over
+// the cone's solid angle), then turns that into a direction around the axis towards the sphere's center
+inline Vec3 Sphere::random_direction(Point3 const & origin) const {
+    Vec3 toCenter = this->center - origin;
+    double distanceSquared = toCenter.length_squared();
+    double sineSquaredThetaMax = (this->radius * this->radius) / distanceSquared;
+    if (sineSquaredThetaMax >= 1) {
+        return random_unit_vec3();
+    }
+
+    double cosineThetaMax = sqrt(1 - sineSquaredThetaMax);
+    double cosineTheta = 1 + (random_double() * (cosineThetaMax - 1));
+    double sineTheta = sqrt(1 - (cosineTheta * cosineTheta));
+    double phi = 2 * PI * random_double();
+
+    // an orthonormal basis around the direction to the center
+    Vec3 w = toCenter.unit();
+    Vec3 a = (fabs(w.x) > 0.9) ? Vec3(0, 1, 0) : Vec3(1, 0, 0);
+    Vec3 v = w.cross(a).unit();
+    Vec3 u = w.cross(v);
+
+    return (cos(phi) * sineTheta * u) + (sin(phi) * sineTheta * v) + (cosineTheta * w);
+}
+
+inline double Sphere::uv_scale() const {
+    return this->radius * PI * std::sqrt(2.0);
+}
+
 #endif
@@ -0,0 +1,307 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+// optional counters for working out why a scene is slow: how many rays are traced at each bounce, how many BVH nodes
+// and primitives each ray is tested against, how often each type of primitive is hit, and how often each type of
+// material scatters. They're only compiled in with -DRAY_TRACER_STATS, otherwise every function below is empty and
+// the calls to them compile away to nothing.
+//
+// each thread counts into its own counters, so counting is just an increment with no locking or sharing of cache
+// lines, and they're all added up when report is called (or when the thread finishes). The counters are relaxed
+// atomics (see Count), so adding them up while other threads are still counting is safe, if not exact
+#ifdef RAY_TRACER_STATS
+#define RAY_TRACER_STATS_ENABLED
+#endif
+
+namespace stats {
+    enum class Primitive {
+        Sphere,
+        Quad,
+        // ConstantMedium and GridMedium, whose hits are scatters inside of them
+        Medium
+    };
+
+    int const PRIMITIVE_COUNT = 3;
+    // one for each MaterialType
+    int const MATERIAL_COUNT = 6;
+    // rays are counted by how many bounces they have left, anything past this is counted with the last one
+    int const MAX_DEPTH = 128;
+
+    // a count that only the thread it belongs to adds to, but which other threads can read at the same time.
+    // there's only ever the one thread writing to it, so adding is a relaxed load and store rather than a fetch_add,
+    // which compiles to the same instructions as incrementing a plain uint64_t
+    class Count {
+        public:
+            constexpr Count() : _value(0) { }
+            Count(Count const & other);
+            Count & operator=(Count const & other);
+
+            void operator++(int);
+            Count & operator+=(uint64_t amount);
+
+            operator uint64_t() const;
+
+        private:
+            std::atomic<uint64_t> _value;
+    };
+
+    class Counters {
+        public:
+            // indexed by the depth the ray was traced at, i.e how many bounces it had left
+            Count raysByDepth[MAX_DEPTH];
+            Count shadowRays;
+            Count bvhNodesVisited;
+            Count primitiveTests[PRIMITIVE_COUNT];
+            Count primitiveHits[PRIMITIVE_COUNT];
+            Count materialScatters[MATERIAL_COUNT];
+
+            void add(Counters const & other);
+
+            uint64_t rays() const;
+    };
+
+    // whether the counters were compiled in
+    constexpr bool enabled();
+
+    // a ray traced through ray_color, which has depth bounces left
+    inline void count_ray(int depth);
+    // a shadow ray traced towards a light
+    inline void count_shadow_ray();
+    // a BVH node whose box a ray was tested against
+    inline void count_bvh_node();
+    // a ray tested against a primitive
+    inline void count_primitive_test(Primitive primitive);
+    // a ray that was tested against a primitive and hit it
+    inline void count_primitive_hit(Primitive primitive);
+    // a material being asked to scatter a ray, materialType is the MaterialType
+    inline void count_scatter(int materialType);
+
+    // the counters from every thread added together, which is only exact if no other threads are still counting, but
+    // is safe to call while they are
+    Counters totals();
+
+    // prints the totals, or nothing if the counters weren't compiled in
+    void report(std::ostream & out);
+}
+
+// ------
+
+#ifdef RAY_TRACER_STATS_ENABLED
+
+namespace stats {
+    // the part of the counters that needs setting up before a thread's first count, so that its counters are added up
+    // by totals and kept once the thread finishes
+    class ThreadRegistration {
+        public:
+            ThreadRegistration();
+            ~ThreadRegistration();
+    };
+
+    class Registry {
+        public:
+            std::mutex mutex;
+            // the counters of every thread that's counted something and is still running
+            std::vector<Counters const *> live;
+            // the counters of every thread that's finished
+            Counters finished{};
+    };
+
+    // constant initialized and trivially destructible, so that using it doesn't go through a thread local wrapper
+    // function the way a thread local with a constructor would
+    inline thread_local Counters threadCounters{};
+    inline thread_local bool threadRegistered = false;
+
+    inline Registry & registry() {
+        static Registry registry;
+        return registry;
+    }
+
+    inline Counters & local() {
+        if (!threadRegistered) {
+            // constructed the first time a thread gets here, and destroyed when the thread finishes
+            static thread_local ThreadRegistration registration;
+            threadRegistered = true;
+        }
+        return threadCounters;
+    }
+}
+
+inline stats::ThreadRegistration::ThreadRegistration() {
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    registry().live.push_back(&threadCounters);
+}
+
+inline stats::ThreadRegistration::~ThreadRegistration() {
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    auto & live = registry().live;
+    live.erase(std::remove(live.begin(), live.end(), &threadCounters), live.end());
+    registry().finished.add(threadCounters);
+}
+
+constexpr bool stats::enabled() {
+    return true;
+}
+
+inline void stats::count_ray(int depth) {
+    local().raysByDepth[std::clamp(depth, 0, MAX_DEPTH - 1)]++;
+}
+
+inline void stats::count_shadow_ray() {
+    local().shadowRays++;
+}
+
+inline void stats::count_bvh_node() {
+    local().bvhNodesVisited++;
+}
+
+inline void stats::count_primitive_test(Primitive primitive) {
+    local().primitiveTests[static_cast<int>(primitive)]++;
+}
+
+inline void stats::count_primitive_hit(Primitive primitive) {
+    local().primitiveHits[static_cast<int>(primitive)]++;
+}
+
+inline void stats::count_scatter(int materialType) {
+    local().materialScatters[materialType]++;
+}
+
+inline stats::Counters stats::totals() {
+    std::lock_guard<std::mutex> lock(registry().mutex);
+
+    Counters totals = registry().finished;
+    for (Counters const * counters : registry().live) {
+        totals.add(*counters);
+    }
+    return totals;
+}
+
+inline void stats::report(std::ostream & out) {
+    Counters counters = totals();
+    uint64_t rays = counters.rays();
+    // anything traced through the world, which is what the BVH and primitive tests are spread over
+    double tracedRays = static_cast<double>(std::max<uint64_t>(1, rays + counters.shadowRays));
+
+    // the camera's rays are the ones with the most bounces left, every other depth is a bounce after that
+    int cameraDepth = 0;
+    for (int depth = 0; depth < MAX_DEPTH; depth++) {
+        if (counters.raysByDepth[depth] > 0) {
+            cameraDepth = depth;
+        }
+    }
+
+    out << "Stats: " << rays << " rays, " << counters.shadowRays << " shadow rays\n";
+    out << "  rays by bounce:";
+    for (int depth = cameraDepth; depth >= 0; depth--) {
+        if (counters.raysByDepth[depth] > 0) {
+            out << " " << (cameraDepth - depth) << ": " << counters.raysByDepth[depth];
+        }
+    }
+    out << "\n";
+
+    uint64_t primitiveTests = 0;
+    for (int i = 0; i < PRIMITIVE_COUNT; i++) {
+        primitiveTests += counters.primitiveTests[i];
+    }
+    out << std::fixed << std::setprecision(2)
+        << "  BVH nodes visited per ray: " << counters.bvhNodesVisited / tracedRays
+        << ", primitive tests per ray: " << primitiveTests / tracedRays << "\n";
+
+    char const * primitiveNames[PRIMITIVE_COUNT] = { "sphere", "quad", "medium" };
+    for (int i = 0; i < PRIMITIVE_COUNT; i++) {
+        if (counters.primitiveTests[i] == 0) {
+            continue;
+        }
+        double hitRatio = static_cast<double>(counters.primitiveHits[i]) / counters.primitiveTests[i];
+        out << "  " << primitiveNames[i] << ": " << counters.primitiveTests[i] << " tests, "
+            << 100 * hitRatio << "% hit, " << 100 * (1 - hitRatio) << "% missed\n";
+    }
+
+    char const * materialNames[MATERIAL_COUNT] = { "lambertian", "metal", "dielectric", "diffuse light", "isotropic", "custom" };
+    out << "  scatters:";
+    for (int i = 0; i < MATERIAL_COUNT; i++) {
+        if (counters.materialScatters[i] > 0) {
+            out << " " << materialNames[i] << ": " << counters.materialScatters[i];
+        }
+    }
+    out << "\n" << std::defaultfloat;
+}
+
+#else
+
+constexpr bool stats::enabled() {
+    return false;
+}
+
+inline void stats::count_ray(int) { }
+
+inline void stats::count_shadow_ray() { }
+
+inline void stats::count_bvh_node() { }
+
+inline void stats::count_primitive_test(Primitive) { }
+
+inline void stats::count_primitive_hit(Primitive) { }
+
+inline void stats::count_scatter(int) { }
+
+inline stats::Counters stats::totals() {
+    return Counters{};
+}
+
+inline void stats::report(std::ostream &) { }
+
+#endif
+
+inline stats::Count::Count(Count const & other) : _value(static_cast<uint64_t>(other)) { }
+
+inline stats::Count & stats::Count::operator=(Count const & other) {
+    this->_value.store(static_cast<uint64_t>(other), std::memory_order_relaxed);
+    return *this;
+}
+
+inline void stats::Count::operator++(int) {
+    *this += 1;
+}
+
+inline stats::Count & stats::Count::operator+=(uint64_t amount) {
+    this->_value.store(this->_value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    return *this;
+}
+
+inline stats::Count::operator uint64_t() const {
+    return this->_value.load(std::memory_order_relaxed);
+}
+
+inline void stats::Counters::add(Counters const & other) {
+    for (int i = 0; i < MAX_DEPTH; i++) {
+        this->raysByDepth[i] += other.raysByDepth[i];
+    }
+    this->shadowRays += other.shadowRays;
+    this->bvhNodesVisited += other.bvhNodesVisited;
+    for (int i = 0; i < PRIMITIVE_COUNT; i++) {
+        this->primitiveTests[i] += other.primitiveTests[i];
+        this->primitiveHits[i] += other.primitiveHits[i];
+    }
+    for (int i = 0; i < MATERIAL_COUNT; i++) {
+        this->materialScatters[i] += other.materialScatters[i];
+    }
+}
+
+inline uint64_t stats::Counters::rays() const {
+    uint64_t rays = 0;
+    for (int i = 0; i < MAX_DEPTH; i++) {
+        rays += this->raysByDepth[i];
+    }
+    return rays;
+}
+
+#endif
@@ -0,0 +1,64 @@
+#include "catch.hpp"
+
+#include "ray.h"
+#include "affine_transform.h"
+#include "random.h"
+
+namespace {
+    AffineTransform random_transform() {
+        return AffineTransform::translate(Vec3(random_double(-10, 10), random_double(-10, 10), random_double(-10, 10)))
+               * AffineTransform::rotate(random_unit_vec3(), random_double(-180, 180))
+               * AffineTransform::scale(Vec3(random_double(0.5, 3), random_double(0.5, 3), random_double(0.5, 3)));
+    }
+
+    void check_near(Vec3 const & actual, Vec3 const & expected) {
+        CHECK(actual.x == Approx(expected.x).margin(1e-9));
+        CHECK(actual.y == Approx(expected.y).margin(1e-9));
+        CHECK(actual.z == Approx(expected.z).margin(1e-9));
+    }
+}
+
+TEST_CASE("A transform combined with its inverse is the identity") {
+    for (int i = 0; i < 100; i++) {
+        auto t = random_transform();
+
+        for (auto const & product : { t * t.inverse(), t.inverse() * t }) {
+            for (int row = 0; row < 3; row++) {
+                for (int column = 0; column < 4; column++) {
+                    CHECK(product.m[row][column] == Approx((row == column) ? 1 : 0).margin(1e-9));
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("Transforms apply the right hand side first") {
+    auto p = Point3(1, 2, 3);
+
+    auto translate = AffineTransform::translate(Vec3(10, 20, 30));
+    auto rotate = AffineTransform::rotate_y(90);
+    auto scale = AffineTransform::scale(Vec3(2, 3, 4));
+
+    // scaled to (2, 6, 12), rotated counter-clockwise around y to (12, 6, -2), then translated
+    check_near((translate * rotate * scale).transform_point(p), Point3(22, 26, 28));
+    check_near(translate.transform_point(rotate.transform_point(scale.transform_point(p))), Point3(22, 26, 28));
+    // translated to (11, 22, 33), rotated to (33, 22, -11), then scaled
+    check_near((scale * rotate * translate).transform_point(p), Point3(66, 66, -44));
+
+    SECTION("Vectors are only affected by the linear part") {
+        check_near((translate * rotate * scale).transform_vector(Vec3(1, 2, 3)), Vec3(12, 6, -2));
+    }
+
+    SECTION("The single axis rotations match rotating around that axis") {
+        for (double angle : { -135.0, -30.0, 0.0, 45.0, 90.0, 200.0 }) {
+            check_near(AffineTransform::rotate_x(angle).transform_point(p), AffineTransform::rotate(Vec3(1, 0, 0), angle).transform_point(p));
+            check_near(AffineTransform::rotate_y(angle).transform_point(p), AffineTransform::rotate(Vec3(0, 1, 0), angle).transform_point(p));
+            check_near(AffineTransform::rotate_z(angle).transform_point(p), AffineTransform::rotate(Vec3(0, 0, 1), angle).transform_point(p));
+        }
+    }
+
+    SECTION("Only rotations and translations are rigid") {
+        CHECK((translate * rotate).is_rigid());
+        CHECK_FALSE((translate * rotate * scale).is_rigid());
+    }
+}
@@ -0,0 +1,119 @@
+#include <limits>
+
+#include "catch.hpp"
+
+#include "ray.h"
+#include "sphere.h"
+#include "quad.h"
+#include "hittable_list.h"
+#include "primitive_list.h"
+#include "transformer.h"
+#include "bvh_node.h"
+
+TEST_CASE("BVH split on time finds the same hits as a flat list") {
+    auto material = std::make_shared<LambertianMaterial>(Color(0.5, 0.5, 0.5));
+
+    // spheres that move much further than their size while the shutter is open, so the box around everywhere they go
+    // is far bigger than the boxes at the start and end, and the root is split on time. They stay above y = 1, so
+    // they're never in the way of the rays aimed at the sphere below
+    auto list = HittableList();
+    for (int i = 0; i < 32; i++) {
+        auto start = Point3(random_double(-10, 10), random_double(2, 10), random_double(-10, 10));
+        auto end = Point3(random_double(-10, 10), random_double(2, 10), random_double(-10, 10));
+        list.add(std::make_shared<Sphere>(start, end, 0.5, material));
+    }
+    // one that goes straight across the middle of the time range, from one side to the other
+    list.add(std::make_shared<Sphere>(Point3(-20, 0, 0), Point3(20, 0, 0), 1, material));
+
+    auto options = BvhBuildOptions();
+    options.splitOnTime = true;
+    auto bvh = BvhNode(list, options);
+
+    auto rayLimits = Interval(0.001, std::numeric_limits<double>::infinity());
+
+    SECTION("Rays at any time") {
+        for (int i = 0; i < 2000; i++) {
+            auto origin = Point3(random_double(-15, 15), random_double(-15, 15), random_double(-15, 15));
+            auto ray = Ray(origin, random_unit_vec3(), random_double());
+
+            HitResult listResult;
+            HitResult bvhResult;
+            bool listHit = list.hit(ray, rayLimits, listResult);
+            bool bvhHit = bvh.hit(ray, rayLimits, bvhResult);
+
+            REQUIRE(bvhHit == listHit);
+            CHECK(bvh.occluded(ray, rayLimits) == listHit);
+            if (listHit) {
+                CHECK(bvhResult.t == Approx(listResult.t));
+            }
+        }
+    }
+
+    SECTION("The sphere crossing the middle is found in both halves of the time range") {
+        // the sphere's center is at x = -20 + 40 * time, each ray is aimed at where it is at that time
+        for (double time : { 0.1, 0.3, 0.49, 0.5, 0.51, 0.7, 0.9 }) {
+            double x = -20 + (40 * time);
+            auto ray = Ray(Point3(x, 0, 50), Vec3(0, 0, -1), time);
+
+            HitResult result;
+            REQUIRE(bvh.hit(ray, rayLimits, result));
+            CHECK(result.t == Approx(49));
+            CHECK(bvh.occluded(ray, rayLimits));
+        }
+    }
+}
+
+TEST_CASE("Primitive lists and BVHs over them find the same hits as a hittable list") {
+    auto red = std::make_shared<LambertianMaterial>(Color(0.65, 0.05, 0.05));
+    auto white = std::make_shared<LambertianMaterial>(Color(0.73, 0.73, 0.73));
+    auto light = std::make_shared<DiffuseLightMaterial>(Color(4, 4, 4));
+    std::shared_ptr<Material> materials[] = { red, white, light };
+
+    // every kind of primitive: spheres, quads and transformed boxes, which become instances
+    auto list = HittableList();
+    for (int i = 0; i < 20; i++) {
+        auto center = Point3(random_double(-10, 10), random_double(-10, 10), random_double(-10, 10));
+        list.add(std::make_shared<Sphere>(center, random_double(0.5, 2), materials[i % 3]));
+    }
+    for (int i = 0; i < 20; i++) {
+        auto corner = Point3(random_double(-10, 10), random_double(-10, 10), random_double(-10, 10));
+        // a quad's box only goes from q to q + u + v, so the sides point in positive directions to stay inside of it
+        auto u = Vec3(random_double(0, 3), random_double(0, 3), random_double(0, 3));
+        auto v = Vec3(random_double(0, 3), random_double(0, 3), random_double(0, 3));
+        list.add(std::make_shared<Quad>(corner, u, v, materials[i % 3]));
+    }
+    for (int i = 0; i < 5; i++) {
+        std::shared_ptr<Hittable> box = make_box(Point3(0, 0, 0), Point3(2, 3, 1), (i % 2 == 0) ? red : white);
+        box = std::make_shared<RotateYTransformer>(box, random_double(0, 360));
+        box = std::make_shared<TranslateTransformer>(box, Vec3(random_double(-10, 10), random_double(-10, 10), random_double(-10, 10)));
+        list.add(box);
+    }
+
+    auto primitives = std::make_shared<PrimitiveList>(list);
+    auto bvh = BvhNode(primitives);
+
+    REQUIRE(primitives->spheres.size() == 20);
+    REQUIRE(primitives->quads.size() == 20);
+    REQUIRE(primitives->instances.size() == 5);
+
+    auto rayLimits = Interval(0.001, std::numeric_limits<double>::infinity());
+    for (int i = 0; i < 2000; i++) {
+        auto origin = Point3(random_double(-15, 15), random_double(-15, 15), random_double(-15, 15));
+        auto ray = Ray(origin, random_unit_vec3());
+
+        HitResult expected;
+        bool listHit = list.hit(ray, rayLimits, expected);
+
+        for (Hittable const * hittable : { static_cast<Hittable const *>(primitives.get()), static_cast<Hittable const *>(&bvh) }) {
+            HitResult actual;
+            REQUIRE(hittable->hit(ray, rayLimits, actual) == listHit);
+            if (listHit) {
+                CHECK(actual.t == Approx(expected.t));
+                CHECK(actual.normal.x == Approx(expected.normal.x).margin(1e-9));
+                CHECK(actual.normal.y == Approx(expected.normal.y).margin(1e-9));
+                CHECK(actual.normal.z == Approx(expected.normal.z).margin(1e-9));
+                CHECK(actual.material == expected.material);
+            }
+        }
+    }
+}
@@ -0,0 +1,110 @@
+#include "catch.hpp"
+
+#include <limits>
+
+#include "ray.h"
+#include "sphere.h"
+#include "primitive_list.h"
+#include "bvh_node.h"
+#include "dynamic_bvh.h"
+#include "random.h"
+
+namespace {
+    std::shared_ptr<PrimitiveList> random_spheres(int count) {
+        auto material = std::make_shared<LambertianMaterial>(Color(0.5, 0.5, 0.5));
+
+        auto primitives = std::make_shared<PrimitiveList>();
+        for (int i = 0; i < count; i++) {
+            primitives->add(Sphere(Point3(random_double(-20, 20), random_double(-20, 20), random_double(-20, 20)),
+                                   random_double(0.5, 1.5), material));
+        }
+        return primitives;
+    }
+
+    // every sphere moves by up to distance in each axis
+    void move_spheres(PrimitiveList & primitives, double distance) {
+        for (auto & sphere : primitives.spheres) {
+            sphere.set_center(sphere.center + Vec3(random_double(-distance, distance), random_double(-distance, distance),
+                                                   random_double(-distance, distance)));
+        }
+    }
+
+    void check_same_hits(Hittable const & actual, Hittable const & expected) {
+        auto rayLimits = Interval(0.001, std::numeric_limits<double>::infinity());
+
+        for (int i = 0; i < 2000; i++) {
+            auto origin = Point3(random_double(-30, 30), random_double(-30, 30), random_double(-30, 30));
+            auto ray = Ray(origin, random_unit_vec3());
+
+            HitResult expectedResult;
+            HitResult actualResult;
+            bool expectedHit = expected.hit(ray, rayLimits, expectedResult);
+            REQUIRE(actual.hit(ray, rayLimits, actualResult) == expectedHit);
+            CHECK(actual.occluded(ray, rayLimits) == expectedHit);
+            if (expectedHit) {
+                CHECK(actualResult.t == Approx(expectedResult.t));
+            }
+        }
+    }
+}
+
+TEST_CASE("A refitted BVH finds the same hits as a newly built one") {
+    auto primitives = random_spheres(200);
+    auto tree = BvhNode(std::shared_ptr<PrimitiveList const>(primitives));
+
+    for (double distance : { 0.1, 2.0, 20.0 }) {
+        move_spheres(*primitives, distance);
+        primitives->update_bounding_box();
+        tree.refit();
+
+        check_same_hits(tree, BvhNode(std::shared_ptr<PrimitiveList const>(primitives)));
+        check_same_hits(tree, *primitives);
+    }
+}
+
+TEST_CASE("A dynamic BVH only rebuilds once its cost grows past the threshold") {
+    // two copies of the same spheres, one that's allowed to get a lot worse before being rebuilt
+    auto primitives = random_spheres(200);
+    auto patientPrimitives = std::make_shared<PrimitiveList>(*primitives);
+
+    auto bvh = DynamicBvh(primitives, 1.5);
+    auto patientBvh = DynamicBvh(patientPrimitives, 1000);
+
+    // the first update builds the tree
+    CHECK(bvh.update().rebuilt);
+    CHECK(patientBvh.update().rebuilt);
+    double builtCost = bvh.rebuild().cost;
+    double patientBuiltCost = patientBvh.rebuild().cost;
+
+    SECTION("Small moves only refit") {
+        for (int frame = 0; frame < 5; frame++) {
+            move_spheres(bvh.primitives(), 0.01);
+
+            auto stats = bvh.update();
+            CHECK_FALSE(stats.rebuilt);
+            CHECK(stats.cost <= builtCost * 1.5);
+            check_same_hits(bvh, bvh.primitives());
+        }
+    }
+
+    SECTION("Scrambling the spheres rebuilds, unless the threshold is never reached") {
+        // move both lists' spheres to the same new places
+        for (size_t i = 0; i < primitives->spheres.size(); i++) {
+            auto center = Point3(random_double(-20, 20), random_double(-20, 20), random_double(-20, 20));
+            primitives->spheres[i].set_center(center);
+            patientPrimitives->spheres[i].set_center(center);
+        }
+
+        auto patientStats = patientBvh.update();
+        REQUIRE_FALSE(patientStats.rebuilt);
+        // the refitted tree is the one that's past the threshold
+        REQUIRE(patientStats.cost > patientBuiltCost * 1.5);
+
+        auto stats = bvh.update();
+        CHECK(stats.rebuilt);
+        CHECK(stats.cost < patientStats.cost);
+
+        check_same_hits(bvh, *primitives);
+        check_same_hits(patientBvh, *patientPrimitives);
+    }
+}
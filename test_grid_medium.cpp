@@ -0,0 +1,50 @@
+#include "catch.hpp"
+
+#include "ray.h"
+#include "grid_medium.h"
+
+TEST_CASE("Grid medium tracking matches the transmittance of a constant density") {
+    auto bounds = Aabb(Point3(0, 0, 0), Point3(4, 4, 4));
+    auto grid = std::make_shared<DensityGrid const>(DensityGrid::from_function(bounds, 16, 16, 16, [](Point3 const &) {
+        return 0.5;
+    }));
+    auto medium = GridMedium(grid, 0.25, Color(1, 1, 1));
+
+    // 4 units of density 0.5 * 0.25 through the middle of the grid, away from its edges where the density fades out
+    auto ray = Ray(Point3(2, 2, -1), Vec3(0, 0, 2));
+    auto limits = Interval(0.5 + (0.25 / 2), 2.5 - (0.25 / 2));
+    double expected = std::exp(-0.5 * 0.25 * 3.5);
+
+    int const trials = 20000;
+    double transmittance = 0;
+    int occluded = 0;
+    for (int i = 0; i < trials; i++) {
+        transmittance += medium.transmittance(ray, limits);
+        occluded += medium.occluded(ray, limits) ? 1 : 0;
+    }
+
+    CHECK(transmittance / trials == Approx(expected).margin(0.02));
+    CHECK(1 - (static_cast<double>(occluded) / trials) == Approx(expected).margin(0.02));
+}
+
+TEST_CASE("Grid medium only stores bricks with density in them") {
+    auto bounds = Aabb(Point3(0, 0, 0), Point3(1, 1, 1));
+    // only the corner at the origin has any density
+    auto grid = DensityGrid::from_function(bounds, 32, 32, 32, [](Point3 const & p) {
+        return ((p.x < 0.2) && (p.y < 0.2) && (p.z < 0.2)) ? 1.0 : 0.0;
+    });
+
+    CHECK(grid.bricks(0) == 4);
+    CHECK(grid.stored_bricks() == 1);
+    CHECK(grid.majorant(0, 0, 0) == 1);
+    CHECK(grid.majorant(3, 3, 3) == 0);
+    CHECK(grid.density(Point3(0.9, 0.9, 0.9)) == 0);
+    CHECK(grid.density(Point3(0.1, 0.1, 0.1)) == Approx(1));
+
+    auto medium = GridMedium(std::make_shared<DensityGrid const>(grid), 100, Color(1, 1, 1));
+    // straight through the empty part of the grid
+    CHECK_FALSE(medium.occluded(Ray(Point3(0.9, 0.9, -1), Vec3(0, 0, 1)), Interval(0, 10)));
+    CHECK(medium.transmittance(Ray(Point3(0.9, 0.9, -1), Vec3(0, 0, 1)), Interval(0, 10)) == 1);
+    // and through the dense corner
+    CHECK(medium.occluded(Ray(Point3(0.1, 0.1, -1), Vec3(0, 0, 1)), Interval(0, 10)));
+}
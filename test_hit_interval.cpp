@@ -0,0 +1,70 @@
+#include "catch.hpp"
+
+#include "ray.h"
+#include "hittable_list.h"
+#include "instance.h"
+#include "random.h"
+#include "sphere.h"
+
+namespace {
+    bool same_interval(Hittable const & a, Hittable const & b, Ray const & ray, Interval const & rayLimits) {
+        Interval insideA, insideB;
+        bool hitA = a.hit_interval(ray, rayLimits, insideA);
+        bool hitB = b.hit_interval(ray, rayLimits, insideB);
+
+        if (hitA != hitB) {
+            // the two hit version (b) looks for the exit 0.001 past the entry, so it misses rays that only clip
+            // the corner of a shape for less than that
+            return hitA && (insideA.size() < 0.001);
+        }
+        return !hitA || ((insideA.min == Approx(insideB.min).margin(1e-6)) && (insideA.max == Approx(insideB.max).margin(1e-6)));
+    }
+}
+
+TEST_CASE("Box and convex hit intervals match the two hit version") {
+    auto material = std::make_shared<LambertianMaterial>(Color(1, 1, 1));
+    auto box = make_box(Point3(-1, -2, -3), Point3(2, 1, 0.5), material);
+    REQUIRE(box->shape == HittableList::Shape::Box);
+
+    auto convex = std::make_shared<HittableList>(*box);
+    convex->shape = HittableList::Shape::Convex;
+    auto unknown = std::make_shared<HittableList>(*box);
+    unknown->shape = HittableList::Shape::Unknown;
+
+    for (int i = 0; i < 2000; i++) {
+        // origins both inside and outside of the box, with limits that start and end inside and outside of it too
+        auto ray = Ray(Point3(random_double(-4, 4), random_double(-4, 4), random_double(-4, 4)), random_unit_vec3());
+        auto limits = Interval(random_double(-2, 2), random_double(2, 8));
+
+        CHECK(same_interval(*box, *unknown, ray, limits));
+        CHECK(same_interval(*convex, *unknown, ray, limits));
+    }
+
+    // a ray starting inside goes from its own start to the side of the box
+    Interval inside;
+    REQUIRE(box->hit_interval(Ray(Point3(0, 0, 0), Vec3(1, 0, 0)), Interval(0, 100), inside));
+    CHECK(inside.min == 0);
+    CHECK(inside.max == Approx(2));
+    // and one facing away misses it
+    CHECK_FALSE(box->hit_interval(Ray(Point3(5, 0, 0), Vec3(1, 0, 0)), Interval(0, 100), inside));
+}
+
+TEST_CASE("Sphere and transformed hit intervals match the two hit version") {
+    auto material = std::make_shared<LambertianMaterial>(Color(1, 1, 1));
+    auto sphere = std::make_shared<Sphere>(Point3(0.5, -0.5, 1), 1.5, material);
+    auto unknown = HittableList(sphere);
+
+    auto box = make_box(Point3(0, 0, 0), Point3(1, 2, 3), material);
+    auto instance = Instance(box, AffineTransform::translate(Vec3(1, 0, -1)) * AffineTransform::rotate_y(30));
+    auto unknownBox = std::make_shared<HittableList>(*box);
+    unknownBox->shape = HittableList::Shape::Unknown;
+    auto unknownInstance = Instance(unknownBox, AffineTransform::translate(Vec3(1, 0, -1)) * AffineTransform::rotate_y(30));
+
+    for (int i = 0; i < 2000; i++) {
+        auto ray = Ray(Point3(random_double(-4, 4), random_double(-4, 4), random_double(-4, 4)), random_unit_vec3());
+        auto limits = Interval(random_double(-2, 2), random_double(2, 8));
+
+        CHECK(same_interval(*sphere, unknown, ray, limits));
+        CHECK(same_interval(instance, unknownInstance, ray, limits));
+    }
+}
@@ -8,7 +8,59 @@ TEST_CASE("Load image and read pixel") {
     CHECK(i.width == 1024);
     CHECK(i.height == 512);
     
-    double * const p = i.color_at(100, 100);
-    CHECK(p != nullptr);
-    std::cerr << "The value at pixel 100, 100 is: " << p[0] << ", " << p[1] << ", " << p[2] << "\n";
-}
\ No newline at end of file
+    Color const p = i.color_at(100, 100);
+    std::cerr << "The value at pixel 100, 100 is: " << p << "\n";
+}
+
+TEST_CASE("Mipmap levels go down to a single texel") {
+    // floats so rounding doesn't build up from level to level
+    auto i = Image("./earthmap.jpg", TexelFormat::Float);
+
+    // 1024x512 halves 10 times to 1x1
+    CHECK(i.level_count() == 11);
+
+    // the last level is the average of every texel
+    Color sum(0, 0, 0);
+    for (int y = 0; y < i.height; y++) {
+        for (int x = 0; x < i.width; x++) {
+            sum = sum + i.color_at(x, y);
+        }
+    }
+    Color average = sum / (i.width * i.height);
+    Color last = i.color_at(0, 0, i.level_count() - 1);
+    CHECK(last.r == Approx(average.r).epsilon(0.001));
+    CHECK(last.g == Approx(average.g).epsilon(0.001));
+    CHECK(last.b == Approx(average.b).epsilon(0.001));
+
+    // a footprint of 0 uses the full size image, and a huge one the last level
+    CHECK(i.trilinear(0.5, 0.5, 0).r == Approx(i.bilinear(0.5, 0.5, 0).r));
+    CHECK(i.trilinear(0.5, 0.5, 100).r == Approx(last.r));
+}
+
+TEST_CASE("Texel formats hold the same image in less memory") {
+    auto srgb8 = Image("./earthmap.jpg", TexelFormat::Srgb8);
+    auto half = Image("./earthmap.jpg", TexelFormat::Half);
+    auto full = Image("./earthmap.jpg", TexelFormat::Float);
+
+    CHECK(srgb8.memory_size() * 2 == half.memory_size());
+    CHECK(half.memory_size() * 2 == full.memory_size());
+
+    for (int level = 0; level < full.level_count(); level += 3) {
+        Color expected = full.color_at(37, 21, level);
+        CHECK(half.color_at(37, 21, level).g == Approx(expected.g).epsilon(0.001));
+        // 8 bits are only precise to about 1/255 of the encoded value
+        CHECK(srgb8.color_at(37, 21, level).g == Approx(expected.g).margin(0.01));
+    }
+}
+
+TEST_CASE("Half floats round trip") {
+    float values[] = { 0.0f, 1.0f, -2.5f, 0.1f, 1000.0f, 65504.0f, 0.0001f };
+    for (float value : values) {
+        CHECK(half_to_float(float_to_half(value)) == Approx(value).epsilon(0.001));
+    }
+
+    // subnormal, only 6e-8 apart
+    CHECK(half_to_float(float_to_half(0.00001f)) == Approx(0.00001f).margin(0.0000001));
+
+    CHECK(std::isinf(half_to_float(float_to_half(1.0e6f))));
+}
@@ -0,0 +1,46 @@
+#include "catch.hpp"
+
+#include <limits>
+
+#include "ray.h"
+#include "hittable_list.h"
+#include "instance.h"
+#include "transformer.h"
+#include "random.h"
+
+TEST_CASE("A flattened chain of transformers finds the same hits as the chain") {
+    auto material = std::make_shared<LambertianMaterial>(Color(0.5, 0.5, 0.5));
+
+    std::shared_ptr<Hittable> box = make_box(Point3(0, 0, 0), Point3(165, 330, 165), material);
+    std::shared_ptr<Hittable> chain = std::make_shared<RotateYTransformer>(box, 15);
+    chain = std::make_shared<TranslateTransformer>(chain, Vec3(265, 0, 295));
+
+    auto flattened = flatten_transformers(chain);
+    REQUIRE(std::dynamic_pointer_cast<Instance>(flattened));
+    CHECK(std::dynamic_pointer_cast<Instance>(flattened)->target() == box);
+
+    auto rayLimits = Interval(0.001, std::numeric_limits<double>::infinity());
+    int hits = 0;
+    for (int i = 0; i < 2000; i++) {
+        // from anywhere around the box, towards somewhere inside of it
+        auto origin = Point3(random_double(-200, 800), random_double(-200, 600), random_double(-200, 800));
+        auto target = Point3(random_double(250, 450), random_double(0, 330), random_double(280, 480));
+        auto ray = Ray(origin, target - origin);
+
+        HitResult expected;
+        HitResult actual;
+        bool chainHit = chain->hit(ray, rayLimits, expected);
+        REQUIRE(flattened->hit(ray, rayLimits, actual) == chainHit);
+        if (chainHit) {
+            hits++;
+            CHECK(actual.t == Approx(expected.t));
+            CHECK(actual.normal.x == Approx(expected.normal.x).margin(1e-9));
+            CHECK(actual.normal.y == Approx(expected.normal.y).margin(1e-9));
+            CHECK(actual.normal.z == Approx(expected.normal.z).margin(1e-9));
+            CHECK(actual.material == expected.material);
+        }
+    }
+
+    // most of the rays should actually hit, otherwise this isn't testing much
+    CHECK(hits > 1000);
+}
@@ -0,0 +1,172 @@
+#include "catch.hpp"
+
+#include "ray.h"
+#include "camera.h"
+#include "hittable_list.h"
+#include "primitive_list.h"
+#include "bvh_node.h"
+#include "instance.h"
+#include "transformer.h"
+#include "light_list.h"
+#include "sphere.h"
+#include "quad.h"
+#include "random.h"
+
+#include <limits>
+
+namespace {
+    Interval const RAY_LIMITS = Interval(0.001, std::numeric_limits<double>::infinity());
+
+    Color mean_color(std::shared_ptr<Hittable> const & world, Camera const & camera) {
+        Color total = Color(0, 0, 0);
+        for (int j = 0; j < camera.imageHeight; j++) {
+            for (int i = 0; i < camera.imageWidth; i++) {
+                total = total + camera.render_pixel(world, i, j);
+            }
+        }
+
+        double pixelCount = camera.imageWidth * camera.imageHeight;
+        return Color(total.r / pixelCount, total.g / pixelCount, total.b / pixelCount);
+    }
+}
+
+TEST_CASE("Lights are found inside of lists, BVHs and transformers") {
+    auto light = std::make_shared<DiffuseLightMaterial>(Color(4, 4, 4));
+    auto white = std::make_shared<LambertianMaterial>(Color(0.73, 0.73, 0.73));
+
+    auto world = HittableList();
+    world.add(std::make_shared<Quad>(Point3(-1, 5, -1), Vec3(2, 0, 0), Vec3(0, 0, 2), light));
+
+    auto list = std::make_shared<HittableList>();
+    list->add(std::make_shared<Sphere>(Point3(-5, 0, 0), 1, light));
+    list->add(std::make_shared<Sphere>(Point3(5, 0, 0), 1, white));
+    world.add(list);
+
+    auto bvhObjects = HittableList();
+    bvhObjects.add(std::make_shared<Quad>(Point3(0, 0, -5), Vec3(1, 0, 0), Vec3(0, 1, 0), light));
+    bvhObjects.add(std::make_shared<Quad>(Point3(0, 0, 5), Vec3(1, 0, 0), Vec3(0, 1, 0), white));
+    world.add(std::make_shared<BvhNode>(bvhObjects));
+
+    std::shared_ptr<Hittable> transformed = std::make_shared<Quad>(Point3(0, 0, 0), Vec3(2, 0, 0), Vec3(0, 2, 0), light);
+    transformed = std::make_shared<RotateYTransformer>(transformed, 30);
+    transformed = std::make_shared<TranslateTransformer>(transformed, Vec3(0, -5, 3));
+    world.add(transformed);
+
+    auto primitives = std::make_shared<PrimitiveList>();
+    primitives->add(Instance(std::make_shared<Sphere>(Point3(0, 0, 0), 0.5, light),
+                             AffineTransform::translate(Vec3(3, 3, 3)) * AffineTransform::rotate_x(45)));
+    // scaled lights can't be sampled, so aren't collected
+    primitives->add(Instance(std::make_shared<Sphere>(Point3(0, 0, 0), 0.5, light),
+                             AffineTransform::translate(Vec3(-3, -3, -3)) * AffineTransform::scale(Vec3(2, 1, 1))));
+    world.add(primitives);
+
+    auto lights = LightList(world);
+    REQUIRE(lights.lights.size() == 5);
+
+    auto origin = Point3(0, 0, 0);
+    for (auto const & sampled : lights.lights) {
+        for (int i = 0; i < 100; i++) {
+            auto direction = sampled->random_direction(origin);
+
+            HitResult result;
+            REQUIRE(sampled->hit(Ray(origin, direction), RAY_LIMITS, result));
+            CHECK(result.material == light.get());
+            CHECK(sampled->pdf_value(origin, direction) > 0);
+        }
+    }
+
+    SECTION("A transformed light is sampled where the transformers put it") {
+        // the lights are in the same order as the world
+        auto const & sampled = lights.lights[3];
+
+        for (int i = 0; i < 100; i++) {
+            auto ray = Ray(origin, sampled->random_direction(origin));
+
+            HitResult expected;
+            HitResult actual;
+            REQUIRE(transformed->hit(ray, RAY_LIMITS, expected));
+            REQUIRE(sampled->hit(ray, RAY_LIMITS, actual));
+            CHECK(actual.t == Approx(expected.t));
+        }
+    }
+}
+
+TEST_CASE("Light pdfs match the directions they pick") {
+    auto light = std::make_shared<DiffuseLightMaterial>(Color(4, 4, 4));
+
+    auto quad = std::make_shared<Quad>(Point3(-1, -1, -1), Vec3(2, 0, 0), Vec3(0, 1.5, 0), light);
+    auto sphere = std::make_shared<Sphere>(Point3(1, 0.5, -2), 1, light);
+    auto instance = std::make_shared<Instance>(quad, AffineTransform::translate(Vec3(0.5, 0, -1)) *
+                                                     AffineTransform::rotate(Vec3(1, 1, 0), 35));
+
+    std::shared_ptr<Hittable> sampled = GENERATE_COPY(std::shared_ptr<Hittable>(quad), std::shared_ptr<Hittable>(sphere),
+                                                      std::shared_ptr<Hittable>(instance));
+
+    auto origin = Point3(0, 0, 0);
+    int const count = 200000;
+
+    // the pdf over every direction, picked uniformly, averages to 1 / (4 pi)
+    double pdfTotal = 0;
+    // and the light covers the fraction of them that hit it
+    int hits = 0;
+    for (int i = 0; i < count; i++) {
+        auto direction = random_unit_vec3();
+        pdfTotal += sampled->pdf_value(origin, direction);
+
+        HitResult result;
+        if (sampled->hit(Ray(origin, direction), RAY_LIMITS, result)) {
+            hits++;
+        }
+    }
+    CHECK(pdfTotal * 4 * PI / count == Approx(1).epsilon(0.03));
+
+    // the average of 1 / pdf over the directions random_direction picks is the solid angle they're picked from,
+    // which is the same solid angle as the uniform directions that hit the light
+    double inversePdfTotal = 0;
+    for (int i = 0; i < count; i++) {
+        inversePdfTotal += 1 / sampled->pdf_value(origin, sampled->random_direction(origin));
+    }
+    double solidAngle = 4 * PI * hits / count;
+    CHECK(inversePdfTotal / count == Approx(solidAngle).epsilon(0.03));
+}
+
+TEST_CASE("Sampling lights directly converges to the same image as only bouncing into them") {
+    auto red = std::make_shared<LambertianMaterial>(Color(0.65, 0.05, 0.05));
+    auto white = std::make_shared<LambertianMaterial>(Color(0.73, 0.73, 0.73));
+    auto green = std::make_shared<LambertianMaterial>(Color(0.12, 0.45, 0.15));
+    auto light = std::make_shared<DiffuseLightMaterial>(Color(4, 4, 4));
+
+    // the cornell box, with a bigger light so that bouncing into it doesn't take too many samples
+    auto world = HittableList();
+    world.add(std::make_shared<Quad>(Point3(555, 0, 0), Vec3(0, 555, 0), Vec3(0, 0, 555), green));
+    world.add(std::make_shared<Quad>(Point3(0, 0, 0), Vec3(0, 555, 0), Vec3(0, 0, 555), red));
+    world.add(std::make_shared<Quad>(Point3(428, 554, 428), Vec3(-300, 0, 0), Vec3(0, 0, -300), light));
+    world.add(std::make_shared<Quad>(Point3(0, 0, 0), Vec3(555, 0, 0), Vec3(0, 0, 555), white));
+    world.add(std::make_shared<Quad>(Point3(555, 555, 555), Vec3(-555, 0, 0), Vec3(0, 0, -555), white));
+    world.add(std::make_shared<Quad>(Point3(0, 0, 555), Vec3(555, 0, 0), Vec3(0, 555, 0), white));
+    world.add(std::make_shared<Sphere>(Point3(278, 120, 278), 120, white));
+    auto worldPointer = std::make_shared<HittableList>(world);
+
+    auto camera = Camera();
+    camera.aspectRatio = 1.0;
+    camera.imageWidth = 16;
+    camera.fieldOfView = 40;
+    camera.cameraOrigin = Point3(278, 278, -800);
+    camera.cameraTarget = Point3(278, 278, 0);
+    camera.aaSamples = 100;
+    camera.maxDepth = 10;
+    camera.backgroundColor = Color(0, 0, 0);
+    camera.initialize();
+
+    seed_random(1);
+    Color bounced = mean_color(worldPointer, camera);
+
+    camera.lights = LightList(world);
+    REQUIRE(camera.lights.lights.size() == 1);
+    seed_random(2);
+    Color sampled = mean_color(worldPointer, camera);
+
+    CHECK(sampled.r == Approx(bounced.r).epsilon(0.05));
+    CHECK(sampled.g == Approx(bounced.g).epsilon(0.05));
+    CHECK(sampled.b == Approx(bounced.b).epsilon(0.05));
+}
@@ -1,2 +1,8 @@
+// stb_image's functions are defined in this file (see image.h)
+#define STB_IMAGE_IMPLEMENTATION
+#include "image.h"
+
 #define CATCH_CONFIG_MAIN
+// catch sizes its signal handling stack with MINSIGSTKSZ, which newer versions of glibc no longer make a constant
+#define CATCH_CONFIG_NO_POSIX_SIGNALS
 #include "catch.hpp"
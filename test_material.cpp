@@ -0,0 +1,129 @@
+#include "catch.hpp"
+
+#include "ray.h"
+#include "material.h"
+#include "material_table.h"
+#include "texture.h"
+#include "random.h"
+
+namespace {
+    // a material only the vtable knows about
+    class CustomMaterial final : public Material {
+        public:
+            virtual bool scatter(Ray const & incomingRay, HitResult const & result, Color & attenuation, Ray & scatteredRay) const override {
+                scatteredRay = Ray(result.point, result.normal + random_unit_vec3(), incomingRay.time);
+                attenuation = Color(0.2, 0.4, 0.6);
+                return true;
+            }
+
+            virtual Color emitted(double const & u, double const & v, Point3 const & /* point */) const override {
+                return Color(u, v, 1);
+            }
+    };
+
+    void check_same(Color const & actual, Color const & expected) {
+        CHECK(actual.r == expected.r);
+        CHECK(actual.g == expected.g);
+        CHECK(actual.b == expected.b);
+    }
+
+    void check_same(Vec3 const & actual, Vec3 const & expected) {
+        CHECK(actual.x == expected.x);
+        CHECK(actual.y == expected.y);
+        CHECK(actual.z == expected.z);
+    }
+}
+
+TEST_CASE("The material dispatchers match calling the material through the vtable") {
+    std::shared_ptr<Material> material = GENERATE(
+        std::shared_ptr<Material>(std::make_shared<LambertianMaterial>(Color(0.5, 0.25, 1.0))),
+        std::shared_ptr<Material>(std::make_shared<MetalMaterial>(Color(0.8, 0.6, 0.2), 0.3)),
+        std::shared_ptr<Material>(std::make_shared<DielectricMaterial>(1.5)),
+        std::shared_ptr<Material>(std::make_shared<DiffuseLightMaterial>(Color(4, 3, 2))),
+        std::shared_ptr<Material>(std::make_shared<IsotropicScatterMaterial>(std::make_shared<SolidColorTexture>(Color(0.9, 0.9, 0.9)))),
+        std::shared_ptr<Material>(std::make_shared<CustomMaterial>()));
+
+    for (int i = 0; i < 100; i++) {
+        auto normal = random_unit_vec3();
+        auto incomingRay = Ray(Point3(0, 0, 0), random_unit_vec3(), random_double());
+
+        HitResult result;
+        result.point = Point3(random_double(-1, 1), random_double(-1, 1), random_double(-1, 1));
+        result.set_face_normal(incomingRay, normal);
+        result.material = material.get();
+        result.t = 1;
+        result.u = random_double();
+        result.v = random_double();
+
+        auto seed = static_cast<uint32_t>(i);
+
+        // scatter
+        Color expectedAttenuation, actualAttenuation;
+        Ray expectedRay, actualRay;
+        seed_random(seed);
+        bool expectedScattered = material->scatter(incomingRay, result, expectedAttenuation, expectedRay);
+        seed_random(seed);
+        bool actualScattered = material_scatter(*material, incomingRay, result, actualAttenuation, actualRay);
+
+        REQUIRE(actualScattered == expectedScattered);
+        if (expectedScattered) {
+            check_same(actualAttenuation, expectedAttenuation);
+            check_same(actualRay.orig, expectedRay.orig);
+            check_same(actualRay.dir, expectedRay.dir);
+            CHECK(actualRay.time == expectedRay.time);
+
+            CHECK(material_scattering_pdf(*material, result, expectedRay.dir) == material->scattering_pdf(result, expectedRay.dir));
+        }
+
+        // emitted
+        check_same(material_emitted(*material, result.u, result.v, result.point),
+                   material->emitted(result.u, result.v, result.point));
+
+        // sample
+        auto u = Sample2D{random_double(), random_double()};
+        ScatterSample expectedSample, actualSample;
+        seed_random(seed);
+        bool expectedSampled = material->sample(incomingRay, result, u, expectedSample);
+        seed_random(seed);
+        bool actualSampled = material_sample(*material, incomingRay, result, u, actualSample);
+
+        REQUIRE(actualSampled == expectedSampled);
+        if (expectedSampled) {
+            check_same(actualSample.direction, expectedSample.direction);
+            check_same(actualSample.value, expectedSample.value);
+            CHECK(actualSample.pdf == expectedSample.pdf);
+            CHECK(actualSample.isSpecular == expectedSample.isSpecular);
+        }
+    }
+}
+
+TEST_CASE("Materials made by a material table stay where they are") {
+    auto table = MaterialTable();
+
+    std::vector<std::shared_ptr<MetalMaterial>> materials;
+    std::vector<MetalMaterial const *> addresses;
+    // several chunks worth, so that the table has to grow a few times
+    for (int i = 0; i < 1000; i++) {
+        auto material = table.make<MetalMaterial>(Color(i, 0, 0), 0.5);
+        materials.push_back(material);
+        addresses.push_back(material.get());
+    }
+
+    CHECK(table.size() == 1000);
+
+    SECTION("Growing the table doesn't move the materials already in it") {
+        for (int i = 0; i < 1000; i++) {
+            REQUIRE(materials[i].get() == addresses[i]);
+            CHECK(materials[i]->albedo.r == i);
+            CHECK(materials[i]->type() == MaterialType::Metal);
+        }
+    }
+
+    SECTION("The materials outlive the table") {
+        table = MaterialTable();
+
+        for (int i = 0; i < 1000; i++) {
+            CHECK(materials[i]->albedo.r == i);
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#include "catch.hpp"
+
+#include <limits>
+
+#include "ray.h"
+#include "sphere.h"
+#include "quad.h"
+#include "hittable_list.h"
+#include "primitive_list.h"
+#include "bvh_node.h"
+#include "instance.h"
+#include "transformer.h"
+#include "random.h"
+
+TEST_CASE("occluded agrees with hit") {
+    auto material = std::make_shared<LambertianMaterial>(Color(0.5, 0.5, 0.5));
+
+    auto scattered = std::make_shared<HittableList>();
+    for (int i = 0; i < 30; i++) {
+        auto center = Point3(random_double(-5, 5), random_double(-5, 5), random_double(-5, 5));
+        scattered->add(std::make_shared<Sphere>(center, center + Vec3(0, random_double(0, 1), 0), random_double(0.2, 1), material));
+    }
+    for (int i = 0; i < 30; i++) {
+        auto corner = Point3(random_double(-5, 5), random_double(-5, 5), random_double(-5, 5));
+        auto u = Vec3(random_double(0, 2), random_double(0, 2), random_double(0, 2));
+        auto v = Vec3(random_double(0, 2), random_double(0, 2), random_double(0, 2));
+        scattered->add(std::make_shared<Quad>(corner, u, v, material));
+    }
+
+    std::shared_ptr<Hittable> box = make_box(Point3(-1, -2, -1), Point3(2, 1, 3), material);
+    std::shared_ptr<Hittable> transformedBox = std::make_shared<TranslateTransformer>(std::make_shared<RotateYTransformer>(box, 40),
+                                                                                       Vec3(1, 0, -2));
+
+    std::shared_ptr<Hittable> hittable = GENERATE_COPY(
+        std::shared_ptr<Hittable>(std::make_shared<Sphere>(Point3(0.5, -0.5, 1), 2, material)),
+        std::shared_ptr<Hittable>(std::make_shared<Sphere>(Point3(-1, 0, 0), Point3(1, 1, 0), 1.5, material)),
+        std::shared_ptr<Hittable>(std::make_shared<Quad>(Point3(-2, -2, 0), Vec3(4, 0, 1), Vec3(0, 3, 0), material)),
+        box,
+        std::shared_ptr<Hittable>(scattered),
+        std::shared_ptr<Hittable>(std::make_shared<PrimitiveList>(*scattered)),
+        std::shared_ptr<Hittable>(std::make_shared<BvhNode>(*scattered)),
+        transformedBox,
+        flatten_transformers(transformedBox),
+        std::shared_ptr<Hittable>(std::make_shared<Instance>(scattered, AffineTransform::rotate(Vec3(1, 2, 3), 70)
+                                                                        * AffineTransform::scale(Vec3(1, 0.5, 2)))));
+
+    int hits = 0;
+    for (int i = 0; i < 2000; i++) {
+        // origins both inside and outside of things, aimed roughly at the middle so that plenty of them hit, with
+        // limits that sometimes stop short of what they'd hit
+        auto origin = Point3(random_double(-8, 8), random_double(-8, 8), random_double(-8, 8));
+        auto target = Point3(random_double(-3, 3), random_double(-3, 3), random_double(-3, 3));
+        auto ray = Ray(origin, (target - origin).unit(), random_double());
+        auto limits = Interval(0.001, (i % 2 == 0) ? std::numeric_limits<double>::infinity() : random_double(0.5, 10));
+
+        HitResult result;
+        bool hit = hittable->hit(ray, limits, result);
+        REQUIRE(hittable->occluded(ray, limits) == hit);
+        if (hit) {
+            hits++;
+        }
+    }
+
+    CHECK(hits > 100);
+    CHECK(hits < 1900);
+}
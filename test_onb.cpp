@@ -0,0 +1,31 @@
+#include "catch.hpp"
+
+#include "onb.h"
+
+TEST_CASE("Onb is orthonormal") {
+    // includes the normal pointing straight down the z axis, which is where the basis flips sign
+    auto direction = GENERATE(Vec3(0, 0, 1), Vec3(0, 0, -1), Vec3(1, 2, 3).unit(), Vec3(-0.5, 0.25, -0.1).unit());
+
+    auto basis = Onb(direction);
+
+    CHECK(basis.w.x == direction.x);
+    CHECK(basis.w.y == direction.y);
+    CHECK(basis.w.z == direction.z);
+
+    CHECK(basis.u.length() == Approx(1));
+    CHECK(basis.v.length() == Approx(1));
+    CHECK(basis.u.dot(basis.v) == Approx(0).margin(1e-12));
+    CHECK(basis.u.dot(basis.w) == Approx(0).margin(1e-12));
+    CHECK(basis.v.dot(basis.w) == Approx(0).margin(1e-12));
+}
+
+TEST_CASE("Onb.local") {
+    auto basis = Onb(Vec3(1, 0, 0));
+
+    // something along the z axis ends up along the direction the basis was built around
+    auto actual = basis.local(Vec3(0, 0, 2));
+
+    CHECK(actual.x == Approx(2));
+    CHECK(actual.y == Approx(0).margin(1e-12));
+    CHECK(actual.z == Approx(0).margin(1e-12));
+}
@@ -0,0 +1,61 @@
+#include "catch.hpp"
+
+#include "perlin.h"
+#include "random.h"
+
+TEST_CASE("Batched Perlin noise matches one point at a time") {
+    auto perlin = Perlin(7);
+
+    // not a multiple of the batch size, so the last batch is partly filled
+    size_t const count = 103;
+    std::vector<Point3> points;
+    for (size_t i = 0; i < count; i++) {
+        points.push_back(Point3(random_double(-50, 50), random_double(-50, 50), random_double(-50, 50)));
+    }
+
+    std::vector<double> batched(count);
+    perlin.noise_batch(points.data(), batched.data(), count);
+
+    for (size_t i = 0; i < count; i++) {
+        CHECK(batched[i] == perlin.noise(points[i]));
+        CHECK(std::fabs(batched[i]) <= 1.0);
+    }
+}
+
+TEST_CASE("Perlin noise is smooth and zero on the lattice") {
+    auto perlin = Perlin();
+
+    // every corner's gradient is dotted with a zero offset at the corner itself
+    CHECK(perlin.noise(Point3(3, -2, 5)) == Approx(0).margin(1e-12));
+
+    Point3 p(1.3, 2.7, -0.4);
+    CHECK(perlin.noise(p + Vec3(1e-6, 0, 0)) == Approx(perlin.noise(p)).margin(1e-5));
+
+    // the same seed gives the same noise
+    CHECK(Perlin(3).noise(p) == Perlin(3).noise(p));
+}
+
+TEST_CASE("Turbulence sums octaves of noise") {
+    auto perlin = Perlin();
+    Point3 p(0.3, 1.7, 2.2);
+
+    double expected = 0;
+    double weight = 1;
+    Point3 octave = p;
+    for (int i = 0; i < 7; i++) {
+        expected += weight * perlin.noise(octave);
+        weight *= 0.5;
+        octave = 2 * octave;
+    }
+
+    CHECK(perlin.turbulence(p) == Approx(std::fabs(expected)));
+}
+
+TEST_CASE("Turbulence depth is clamped to the octaves there's room for") {
+    auto perlin = Perlin(7);
+    Point3 p(0.3, 1.7, 2.2);
+
+    CHECK(perlin.turbulence(p, 0) == 0);
+    CHECK(perlin.turbulence(p, -5) == 0);
+    CHECK(perlin.turbulence(p, 1000) == perlin.turbulence(p, Perlin::MAX_TURBULENCE_DEPTH));
+}
@@ -1,6 +1,8 @@
 #include "catch.hpp"
 
 #include "ray.h"
+#include "hittable_list.h"
+#include "sphere.h"
 #include <iostream>
 
 TEST_CASE("Ray interpolation") {
@@ -14,23 +16,36 @@ TEST_CASE("Ray interpolation") {
 }
 
 TEST_CASE("ray_color") {
-    auto r = Ray(Vec3(0, 0, 0), Vec3(-1.7778, -1, -1));
-
-    Color actual = ray_color(r);
-
-// -0.78258, -0.44020, -0.44020    -> unit vector
-//
-// 0.2799         -> lerp factor
-//
-// 0.7201, 0.7201, 0.7201       -> amount of white
-//
-// 0.13995, 0.19593, 0.2799      -> amount of blue
-//
-// 0.86005, 0.91603, 1          -> final color
-
-    auto expected = Color(0.86005, 0.91603, 1.0);
-
-    CHECK(actual.r == Approx(expected.r));
-    CHECK(actual.g == Approx(expected.g));
-    CHECK(actual.b == Approx(expected.b));
+    auto background = Color(0.6, 0.8, 1.0);
+    auto world = std::make_shared<HittableList>();
+    world->add(std::make_shared<Sphere>(Point3(0, 0, -2), 0.5, std::make_shared<LambertianMaterial>(Color(0.5, 0.25, 1.0))));
+
+    SECTION("A ray that misses everything sees the background") {
+        Color actual = ray_color(Ray(Point3(0, 0, 0), Vec3(0, 1, -1)), world, 50, background);
+
+        CHECK(actual.r == Approx(background.r));
+        CHECK(actual.g == Approx(background.g));
+        CHECK(actual.b == Approx(background.b));
+    }
+
+    SECTION("A ray that hits a diffuse sphere sees the background attenuated by it") {
+        // a bounce off the outside of a lone sphere always leaves it, and with the bounce picked by its cosine
+        // weighted pdf the sample's weight is exactly the albedo, so every bounce gives the same color
+        for (int i = 0; i < 100; i++) {
+            Color actual = ray_color(Ray(Point3(0, 0, 0), Vec3(random_double(-0.1, 0.1), random_double(-0.1, 0.1), -1)),
+                                     world, 50, background);
+
+            CHECK(actual.r == Approx(0.5 * background.r));
+            CHECK(actual.g == Approx(0.25 * background.g));
+            CHECK(actual.b == Approx(1.0 * background.b));
+        }
+    }
+
+    SECTION("A ray with no bounces left after hitting the sphere is black") {
+        Color actual = ray_color(Ray(Point3(0, 0, 0), Vec3(0, 0, -1)), world, 1, background);
+
+        CHECK(actual.r == 0);
+        CHECK(actual.g == 0);
+        CHECK(actual.b == 0);
+    }
 }
@@ -0,0 +1,97 @@
+#include "catch.hpp"
+
+#include "sampler.h"
+#include "camera.h"
+#include "hittable_list.h"
+#include "sphere.h"
+#include <vector>
+
+TEST_CASE("Samplers stay within [0, 1)") {
+    auto type = GENERATE(SamplerType::Independent, SamplerType::Stratified, SamplerType::Sobol, SamplerType::BlueNoise);
+
+    auto sampler = make_sampler(type, 16);
+
+    for (int s = 0; s < 16; s++) {
+        sampler->start_sample(3, 5, s);
+
+        for (int dimension = 0; dimension < 8; dimension++) {
+            double value = sampler->get_1d();
+            Sample2D pair = sampler->get_2d();
+
+            CHECK(value >= 0);
+            CHECK(value < 1);
+            CHECK(pair.x >= 0);
+            CHECK(pair.x < 1);
+            CHECK(pair.y >= 0);
+            CHECK(pair.y < 1);
+        }
+    }
+}
+
+TEST_CASE("Stratified and Sobol samples of a pixel cover every stratum") {
+    auto type = GENERATE(SamplerType::Stratified, SamplerType::Sobol);
+
+    // a 4x4 grid for the 2D dimension
+    auto sampler = make_sampler(type, 16);
+    std::vector<int> samplesPerStratum(16, 0);
+
+    for (int s = 0; s < 16; s++) {
+        sampler->start_sample(7, 2, s);
+        Sample2D pair = sampler->get_2d();
+
+        samplesPerStratum[(static_cast<int>(pair.y * 4) * 4) + static_cast<int>(pair.x * 4)]++;
+    }
+
+    for (int count : samplesPerStratum) {
+        CHECK(count == 1);
+    }
+}
+
+TEST_CASE("permute_index is a permutation") {
+    auto count = GENERATE(1u, 5u, 16u, 100u);
+
+    std::vector<int> seen(count, 0);
+    for (uint32_t i = 0; i < count; i++) {
+        seen[permute_index(i, count, 1234)]++;
+    }
+
+    for (int timesSeen : seen) {
+        CHECK(timesSeen == 1);
+    }
+
+    // there's nothing to permute, but it still needs to return rather than searching forever
+    CHECK(permute_index(0, 0, 1234) == 0);
+}
+
+TEST_CASE("A camera's sampler can be reused for every pixel") {
+    auto type = GENERATE(SamplerType::Independent, SamplerType::Stratified, SamplerType::Sobol, SamplerType::BlueNoise);
+
+    auto world = std::make_shared<HittableList>();
+    world->add(std::make_shared<Sphere>(Point3(0, 0, -2), 0.5, std::make_shared<LambertianMaterial>(Color(0.5, 0.25, 1.0))));
+
+    auto camera = Camera();
+    camera.imageWidth = 8;
+    camera.aspectRatio = 1;
+    camera.cameraOrigin = Point3(0, 0, 0);
+    camera.cameraTarget = Point3(0, 0, -1);
+    camera.fieldOfView = 40;
+    camera.aaSamples = 4;
+    camera.maxDepth = 5;
+    camera.samplerType = type;
+    camera.initialize();
+
+    auto sampler = camera.create_sampler();
+    for (int j = 0; j < camera.imageHeight; j++) {
+        for (int i = 0; i < camera.imageWidth; i++) {
+            // the Independent sampler (and so everything else that picks at random) draws from random_double
+            seed_random(static_cast<uint32_t>((j * camera.imageWidth) + i));
+            Color reused = camera.render_pixel(world, i, j, *sampler);
+            seed_random(static_cast<uint32_t>((j * camera.imageWidth) + i));
+            Color own = camera.render_pixel(world, i, j);
+
+            CHECK(reused.r == own.r);
+            CHECK(reused.g == own.g);
+            CHECK(reused.b == own.b);
+        }
+    }
+}
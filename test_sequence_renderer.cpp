@@ -0,0 +1,137 @@
+#include "catch.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ray.h"
+#include "hittable_list.h"
+#include "sphere.h"
+#include "sequence_renderer.h"
+#include "random.h"
+
+namespace {
+    std::string read_file(std::string const & fileName) {
+        std::ifstream file(fileName);
+        std::stringstream contents;
+        contents << file.rdbuf();
+        return contents.str();
+    }
+
+    std::string frame_file(std::string const & prefix, int frame) {
+        std::ostringstream name;
+        name << prefix << std::setfill('0') << std::setw(3) << frame << ".ppm";
+        return name.str();
+    }
+
+    Camera small_camera() {
+        auto camera = Camera();
+        camera.aspectRatio = 1;
+        camera.imageWidth = 20;
+        camera.fieldOfView = 40;
+        camera.cameraOrigin = Point3(0, 0, 0);
+        camera.cameraTarget = Point3(0, 0, -1);
+        camera.aaSamples = 4;
+        camera.maxDepth = 5;
+        return camera;
+    }
+}
+
+TEST_CASE("A sequence writes every frame once, as set up for that frame") {
+    auto world = std::make_shared<HittableList>();
+
+    int const frameCount = 8;
+    std::vector<int> framesSetUp;
+
+    auto renderer = SequenceRenderer();
+    renderer.frameCount = frameCount;
+    renderer.tileSize = 8;
+    renderer.threadCount = 4;
+    renderer.framesInFlight = 3;
+    renderer.fileNamePrefix = "test_sequence_frame_";
+    renderer.setupFrame = [&](int frame) {
+        framesSetUp.push_back(frame);
+
+        // nothing to hit, so every pixel of the frame is its background, which is different for every frame
+        auto camera = small_camera();
+        camera.backgroundColor = Color(frame / 10.0, 0.5, 1 - (frame / 10.0));
+        return SequenceFrame{camera, world};
+    };
+
+    for (int frame = 0; frame <= frameCount; frame++) {
+        std::remove(frame_file(renderer.fileNamePrefix, frame).c_str());
+    }
+
+    renderer.render();
+
+    REQUIRE(framesSetUp.size() == frameCount);
+    for (int frame = 0; frame < frameCount; frame++) {
+        CHECK(framesSetUp[frame] == frame);
+
+        std::ostringstream expected;
+        expected << "P3\n20 20\n255\n";
+        for (int pixel = 0; pixel < 20 * 20; pixel++) {
+            write_color(expected, Color(frame / 10.0, 0.5, 1 - (frame / 10.0)));
+        }
+
+        auto fileName = frame_file(renderer.fileNamePrefix, frame);
+        CHECK(read_file(fileName) == expected.str());
+        std::remove(fileName.c_str());
+    }
+
+    // and nothing past the last frame
+    CHECK_FALSE(std::ifstream(frame_file(renderer.fileNamePrefix, frameCount)).good());
+}
+
+TEST_CASE("Sequence frames are the same every time they're rendered") {
+    auto world = std::make_shared<HittableList>();
+    world->add(std::make_shared<Sphere>(Point3(0, 0, -2), 0.5, std::make_shared<LambertianMaterial>(Color(0.5, 0.25, 1.0))));
+    world->add(std::make_shared<Sphere>(Point3(0, -100.5, -2), 100, std::make_shared<MetalMaterial>(Color(0.8, 0.8, 0.8), 0.3)));
+
+    auto render = [&](std::string const & prefix) {
+        auto renderer = SequenceRenderer();
+        renderer.frameCount = 2;
+        renderer.tileSize = 8;
+        renderer.threadCount = 3;
+        renderer.fileNamePrefix = prefix;
+        renderer.setupFrame = [&](int) {
+            return SequenceFrame{small_camera(), world};
+        };
+        renderer.render();
+
+        std::vector<std::string> frames;
+        for (int frame = 0; frame < 2; frame++) {
+            frames.push_back(read_file(frame_file(prefix, frame)));
+            std::remove(frame_file(prefix, frame).c_str());
+        }
+        return frames;
+    };
+
+    // whichever threads the tiles end up on, each tile is seeded the same way (see seed_random)
+    auto first = render("test_sequence_first_");
+    auto second = render("test_sequence_second_");
+
+    CHECK(first[0] == second[0]);
+    CHECK(first[1] == second[1]);
+    // but frames are seeded differently, so their noise isn't the same
+    CHECK(first[0] != first[1]);
+}
+
+TEST_CASE("seed_random repeats the same numbers") {
+    seed_random(1234);
+    std::vector<double> first;
+    for (int i = 0; i < 100; i++) {
+        first.push_back(random_double());
+    }
+
+    seed_random(1234);
+    for (int i = 0; i < 100; i++) {
+        REQUIRE(random_double() == first[i]);
+    }
+
+    seed_random(4321);
+    CHECK(random_double() != first[0]);
+}
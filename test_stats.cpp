@@ -0,0 +1,106 @@
+#include "catch.hpp"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "stats.h"
+
+namespace {
+    // every field of the counters set to a different value, starting from first
+    stats::Counters numbered_counters(uint64_t first) {
+        stats::Counters counters{};
+        uint64_t value = first;
+        for (int i = 0; i < stats::MAX_DEPTH; i++) {
+            counters.raysByDepth[i] += value++;
+        }
+        counters.shadowRays += value++;
+        counters.bvhNodesVisited += value++;
+        for (int i = 0; i < stats::PRIMITIVE_COUNT; i++) {
+            counters.primitiveTests[i] += value++;
+            counters.primitiveHits[i] += value++;
+        }
+        for (int i = 0; i < stats::MATERIAL_COUNT; i++) {
+            counters.materialScatters[i] += value++;
+        }
+        return counters;
+    }
+}
+
+TEST_CASE("Counters::add adds up every field") {
+    auto counters = numbered_counters(1);
+    counters.add(numbered_counters(1000));
+
+    // every field was n + (n + 999)
+    auto expected = [](uint64_t n) { return (2 * n) + 999; };
+    uint64_t n = 1;
+    for (int i = 0; i < stats::MAX_DEPTH; i++) {
+        CHECK(counters.raysByDepth[i] == expected(n++));
+    }
+    CHECK(counters.shadowRays == expected(n++));
+    CHECK(counters.bvhNodesVisited == expected(n++));
+    for (int i = 0; i < stats::PRIMITIVE_COUNT; i++) {
+        CHECK(counters.primitiveTests[i] == expected(n++));
+        CHECK(counters.primitiveHits[i] == expected(n++));
+    }
+    for (int i = 0; i < stats::MATERIAL_COUNT; i++) {
+        CHECK(counters.materialScatters[i] == expected(n++));
+    }
+}
+
+#ifdef RAY_TRACER_STATS_ENABLED
+
+TEST_CASE("The totals include what other threads counted, while they run and after they finish") {
+    auto before = stats::totals();
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool counted = false;
+    bool checked = false;
+
+    auto worker = std::thread([&]() {
+        for (int i = 0; i < 10; i++) {
+            stats::count_ray(3);
+        }
+        stats::count_shadow_ray();
+        stats::count_bvh_node();
+        stats::count_bvh_node();
+        stats::count_primitive_test(stats::Primitive::Quad);
+        stats::count_primitive_hit(stats::Primitive::Quad);
+        stats::count_scatter(2);
+
+        // wait for the main thread to check the totals before finishing
+        std::unique_lock<std::mutex> lock(mutex);
+        counted = true;
+        changed.notify_all();
+        changed.wait(lock, [&]() { return checked; });
+    });
+
+    auto check_totals = [&before]() {
+        auto after = stats::totals();
+        CHECK(after.raysByDepth[3] - before.raysByDepth[3] == 10);
+        CHECK(after.rays() - before.rays() == 10);
+        CHECK(after.shadowRays - before.shadowRays == 1);
+        CHECK(after.bvhNodesVisited - before.bvhNodesVisited == 2);
+        CHECK(after.primitiveTests[1] - before.primitiveTests[1] == 1);
+        CHECK(after.primitiveHits[1] - before.primitiveHits[1] == 1);
+        CHECK(after.materialScatters[2] - before.materialScatters[2] == 1);
+    };
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&]() { return counted; });
+
+        // the thread is still running, waiting for this
+        check_totals();
+
+        checked = true;
+        changed.notify_all();
+    }
+
+    worker.join();
+    // once finished, the thread's counts move to the finished totals
+    check_totals();
+}
+
+#endif
@@ -0,0 +1,92 @@
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "catch.hpp"
+#include "texture_cache.h"
+
+TEST_CASE("Cached texture matches the image it was converted from") {
+    auto image = Image("./earthmap.jpg", TexelFormat::Srgb8);
+    REQUIRE(write_tiled_texture(image, "./test_earthmap.rttx"));
+
+    // only room for a few tiles, so most lookups have to page tiles in
+    auto cache = std::make_shared<TextureCache>(64 * 1024);
+    auto texture = CachedImageTexture(cache, "./test_earthmap.rttx");
+
+    for (int i = 0; i < 1000; i++) {
+        double u = random_double();
+        double v = random_double();
+        double footprint = random_double(0, 0.01);
+
+        Color expected = image.trilinear(u, 1 - v, footprint);
+        Color cached = texture.filtered_value(u, v, footprint, Point3(0, 0, 0));
+        CHECK(cached.r == Approx(expected.r));
+        CHECK(cached.g == Approx(expected.g));
+        CHECK(cached.b == Approx(expected.b));
+    }
+
+    auto stats = cache->statistics();
+    CHECK(stats.misses > 0);
+    CHECK(stats.evictions > 0);
+    CHECK(stats.peakResidentBytes <= cache->memoryBudget);
+
+    std::remove("./test_earthmap.rttx");
+}
+
+TEST_CASE("Tiled texture is converted again if the existing file is cut short") {
+    std::string tiledFilename = "./test_earthmap_cut.rttx";
+    REQUIRE(convert_to_tiled_texture("./earthmap.jpg", tiledFilename, TexelFormat::Srgb8));
+    CHECK(tiled_texture_is_current("./earthmap.jpg", tiledFilename, TexelFormat::Srgb8));
+    // asked for in a different format than it was written in
+    CHECK_FALSE(tiled_texture_is_current("./earthmap.jpg", tiledFilename, TexelFormat::Half));
+
+    auto size = std::filesystem::file_size(tiledFilename);
+    std::filesystem::resize_file(tiledFilename, size / 2);
+    CHECK_FALSE(tiled_texture_is_current("./earthmap.jpg", tiledFilename, TexelFormat::Srgb8));
+
+    REQUIRE(convert_to_tiled_texture("./earthmap.jpg", tiledFilename, TexelFormat::Srgb8));
+    CHECK(std::filesystem::file_size(tiledFilename) == size);
+    CHECK(tiled_texture_is_current("./earthmap.jpg", tiledFilename, TexelFormat::Srgb8));
+
+    std::remove(tiledFilename.c_str());
+}
+
+TEST_CASE("Cached textures of different caches don't share tiles") {
+    auto image = Image("./earthmap.jpg", TexelFormat::Srgb8);
+    REQUIRE(write_tiled_texture(image, "./test_earthmap.rttx"));
+
+    // the same file with every texel black
+    {
+        std::ifstream in("./test_earthmap.rttx", std::ios::binary);
+        std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        std::fill(bytes.begin() + sizeof(TiledTextureHeader), bytes.end(), 0);
+        std::ofstream out("./test_black.rttx", std::ios::binary);
+        out.write(bytes.data(), bytes.size());
+    }
+
+    // each cache is made after the last one is destroyed, so it can be given the same address
+    Color earth = image.trilinear(0.5, 0.5, 0);
+    for (auto [filename, expected] : { std::pair("./test_earthmap.rttx", earth), std::pair("./test_black.rttx", Color(0, 0, 0)) }) {
+        auto cache = std::make_shared<TextureCache>(64 * 1024);
+        auto texture = CachedImageTexture(cache, filename);
+        for (int i = 0; i < 2; i++) {
+            Color cached = texture.filtered_value(0.5, 0.5, 0, Point3(0, 0, 0));
+            CHECK(cached.r == Approx(expected.r));
+            CHECK(cached.g == Approx(expected.g));
+            CHECK(cached.b == Approx(expected.b));
+        }
+
+        // each lookup reads 4 texels, and every read counts as a hit or a miss, including the ones answered from a
+        // tile kept from an earlier read
+        auto stats = cache->statistics();
+        CHECK(stats.hits + stats.misses == 8);
+        CHECK(stats.hits > 0);
+    }
+
+    std::remove("./test_earthmap.rttx");
+    std::remove("./test_black.rttx");
+}
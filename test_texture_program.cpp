@@ -0,0 +1,40 @@
+#include "catch.hpp"
+
+#include "random.h"
+#include "texture_program.h"
+
+TEST_CASE("Texture program gives the same colors as the tree it was compiled from") {
+    auto red = std::make_shared<SolidColorTexture>(Color(1, 0, 0));
+    auto blue = std::make_shared<SolidColorTexture>(Color(0, 0, 1));
+    auto inner = std::make_shared<CheckeredTexture>(0.1, red, blue);
+    auto noise = std::make_shared<NoiseTexture>(3);
+    auto middle = std::make_shared<CheckeredTexture>(0.5, inner, noise);
+    auto tree = std::make_shared<CheckeredTexture>(2.0, middle, inner);
+
+    auto compiled = TextureProgram::compile(tree);
+    REQUIRE(compiled->type() == TextureType::Program);
+    // inner is in the tree twice but only compiled once
+    CHECK(static_cast<TextureProgram const &>(*compiled).node_count() == 6);
+
+    for (int i = 0; i < 1000; i++) {
+        Point3 p(random_double(-5, 5), random_double(-5, 5), random_double(-5, 5));
+        Color expected = tree->value(0, 0, p);
+        Color actual = texture_value(*compiled, 0, 0, 0, p);
+        CHECK(actual.r == expected.r);
+        CHECK(actual.g == expected.g);
+        CHECK(actual.b == expected.b);
+    }
+}
+
+TEST_CASE("Texture program folds constant trees") {
+    auto grey = std::make_shared<CheckeredTexture>(1.0, Color(0.5, 0.5, 0.5), Color(0.5, 0.5, 0.5));
+    auto nested = std::make_shared<CheckeredTexture>(0.3, grey, std::make_shared<SolidColorTexture>(Color(0.5, 0.5, 0.5)));
+
+    auto compiled = TextureProgram::compile(nested);
+    REQUIRE(compiled->type() == TextureType::SolidColor);
+    CHECK(compiled->value(0, 0, Point3(1, 2, 3)).g == 0.5);
+
+    // single textures are left alone
+    auto noise = std::make_shared<NoiseTexture>(1);
+    CHECK(TextureProgram::compile(noise) == noise);
+}
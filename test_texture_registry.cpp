@@ -0,0 +1,61 @@
+
+#include <cstdio>
+#include <fstream>
+
+#include "catch.hpp"
+#include "texture_registry.h"
+
+TEST_CASE("Texture registry shares images by path and content") {
+    auto textures = TextureRegistry();
+
+    auto first = textures.image("./earthmap.jpg");
+    // the same file through a different path
+    auto second = textures.image("earthmap.jpg");
+    CHECK(first == second);
+
+    // a copy of the file under another name
+    {
+        std::ifstream source("./earthmap.jpg", std::ios::binary);
+        std::ofstream copy("./test_earthmap_copy.jpg", std::ios::binary);
+        copy << source.rdbuf();
+    }
+    auto copied = textures.image("./test_earthmap_copy.jpg");
+    CHECK(first == copied);
+    std::remove("./test_earthmap_copy.jpg");
+
+    // a different format is a different texture
+    auto floats = textures.image("./earthmap.jpg", TexelFormat::Float);
+    CHECK(first != floats);
+
+    auto stats = textures.statistics();
+    CHECK(stats.imageRequests == 4);
+    CHECK(stats.imagesDecoded == 2);
+    CHECK(stats.sharedByPath == 1);
+    CHECK(stats.sharedByContent == 1);
+}
+
+TEST_CASE("Texture registry interns solid colors") {
+    auto textures = TextureRegistry();
+
+    auto white = textures.solid(Color(0.73, 0.73, 0.73));
+    CHECK(white == textures.solid(Color(0.73, 0.73, 0.73)));
+    CHECK(white != textures.solid(Color(0.73, 0.73, 0.72)));
+
+    CHECK(textures.statistics().solidsCreated == 2);
+}
+
+TEST_CASE("Images decoded in the background match ones decoded in place") {
+    auto textures = TextureRegistry(2);
+
+    auto srgb8 = textures.image("./earthmap.jpg");
+    auto half = textures.image("./earthmap.jpg", TexelFormat::Half);
+    textures.resolve();
+
+    auto expected = Image("./earthmap.jpg", TexelFormat::Half);
+    CHECK(half->image().width == expected.width);
+    CHECK(half->image().level_count() == expected.level_count());
+    CHECK(half->image().color_at(300, 200).g == expected.color_at(300, 200).g);
+    CHECK(srgb8->image().memory_size() * 2 == half->image().memory_size());
+
+    CHECK(textures.statistics().imageBytes == srgb8->image().memory_size() + half->image().memory_size());
+}
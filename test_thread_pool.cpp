@@ -0,0 +1,47 @@
+#include "catch.hpp"
+
+#include <atomic>
+#include <vector>
+
+#include "thread_pool.h"
+
+TEST_CASE("ThreadPool::wait runs every task submitted") {
+    auto pool = ThreadPool(4);
+    REQUIRE(pool.thread_count() == 4);
+
+    int const taskCount = 1000;
+    std::vector<std::atomic<int>> runs(taskCount);
+    for (auto & count : runs) {
+        count = 0;
+    }
+
+    // twice, to check the pool can be waited on again once its queue has emptied
+    for (int round = 1; round <= 2; round++) {
+        for (int i = 0; i < taskCount; i++) {
+            pool.submit([&runs, i]() {
+                runs[i]++;
+            });
+        }
+
+        pool.wait();
+
+        for (int i = 0; i < taskCount; i++) {
+            REQUIRE(runs[i] == round);
+        }
+    }
+}
+
+TEST_CASE("A ThreadPool runs the tasks still queued when it's destroyed") {
+    std::atomic<int> runs(0);
+
+    {
+        auto pool = ThreadPool(2);
+        for (int i = 0; i < 100; i++) {
+            pool.submit([&runs]() {
+                runs++;
+            });
+        }
+    }
+
+    CHECK(runs == 100);
+}
@@ -0,0 +1,88 @@
+#include "catch.hpp"
+
+#include <limits>
+#include <vector>
+
+#include "ray.h"
+#include "hittable_list.h"
+#include "instance.h"
+#include "top_level_bvh.h"
+#include "random.h"
+
+namespace {
+    AffineTransform random_placement() {
+        return AffineTransform::translate(Vec3(random_double(-20, 20), random_double(-20, 20), random_double(-20, 20)))
+               * AffineTransform::rotate(random_unit_vec3(), random_double(0, 360))
+               * AffineTransform::scale(Vec3(random_double(0.5, 2), random_double(0.5, 2), random_double(0.5, 2)));
+    }
+
+    // the flat list of boxes that the top level is meant to be the same as
+    HittableList place_boxes(std::shared_ptr<Hittable> const & box, std::vector<AffineTransform> const & placements) {
+        auto list = HittableList();
+        for (auto const & placement : placements) {
+            list.add(std::make_shared<Instance>(box, placement));
+        }
+        return list;
+    }
+
+    void check_same_hits(Hittable const & actual, Hittable const & expected) {
+        auto rayLimits = Interval(0.001, std::numeric_limits<double>::infinity());
+        int hits = 0;
+
+        for (int i = 0; i < 2000; i++) {
+            auto origin = Point3(random_double(-30, 30), random_double(-30, 30), random_double(-30, 30));
+            auto ray = Ray(origin, random_unit_vec3());
+
+            HitResult expectedResult;
+            HitResult actualResult;
+            bool expectedHit = expected.hit(ray, rayLimits, expectedResult);
+            REQUIRE(actual.hit(ray, rayLimits, actualResult) == expectedHit);
+            CHECK(actual.occluded(ray, rayLimits) == expectedHit);
+            if (expectedHit) {
+                hits++;
+                CHECK(actualResult.t == Approx(expectedResult.t));
+                CHECK(actualResult.normal.x == Approx(expectedResult.normal.x).margin(1e-9));
+                CHECK(actualResult.normal.y == Approx(expectedResult.normal.y).margin(1e-9));
+                CHECK(actualResult.normal.z == Approx(expectedResult.normal.z).margin(1e-9));
+                CHECK(actualResult.material == expectedResult.material);
+            }
+        }
+
+        CHECK(hits > 100);
+    }
+}
+
+TEST_CASE("A top level BVH over instances finds the same hits as a flat list of the instanced boxes") {
+    auto material = std::make_shared<LambertianMaterial>(Color(0.5, 0.5, 0.5));
+    auto boxObjects = make_box(Point3(-1, -1, -1), Point3(1, 2, 1), material);
+    auto bottomLevel = TopLevelBvh::build_bottom_level(*boxObjects);
+
+    int const instanceCount = 50;
+    std::vector<AffineTransform> placements;
+    auto tlas = TopLevelBvh();
+    for (int i = 0; i < instanceCount; i++) {
+        placements.push_back(random_placement());
+        REQUIRE(tlas.add_instance(bottomLevel, placements.back()) == static_cast<size_t>(i));
+    }
+    REQUIRE(tlas.instance_count() == instanceCount);
+
+    SECTION("Before the top level is built") {
+        check_same_hits(tlas, place_boxes(boxObjects, placements));
+    }
+
+    tlas.build();
+
+    SECTION("Once it's built") {
+        check_same_hits(tlas, place_boxes(boxObjects, placements));
+    }
+
+    SECTION("After moving the instances and building it again") {
+        for (int i = 0; i < instanceCount; i++) {
+            placements[i] = random_placement();
+            tlas.set_transform(static_cast<size_t>(i), placements[i]);
+        }
+        tlas.build();
+
+        check_same_hits(tlas, place_boxes(boxObjects, placements));
+    }
+}
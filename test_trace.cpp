@@ -0,0 +1,169 @@
+#include "catch.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "ray.h"
+#include "camera.h"
+#include "hittable_list.h"
+#include "sphere.h"
+#include "trace.h"
+
+namespace {
+    Camera small_camera() {
+        auto camera = Camera();
+        camera.aspectRatio = 1;
+        camera.imageWidth = 8;
+        camera.fieldOfView = 40;
+        camera.cameraOrigin = Point3(0, 0, 0);
+        camera.cameraTarget = Point3(0, 0, -1);
+        camera.aaSamples = 3;
+        camera.maxDepth = 4;
+        camera.initialize();
+        return camera;
+    }
+
+    std::shared_ptr<Hittable> small_world() {
+        auto world = std::make_shared<HittableList>();
+        world->add(std::make_shared<Sphere>(Point3(0, 0, -3), 1, std::make_shared<LambertianMaterial>(Color(0.5, 0.5, 0.5))));
+        return world;
+    }
+
+    void check_same(trace::Record const & actual, trace::Record const & expected) {
+        CHECK(actual.event == expected.event);
+        CHECK(actual.valueCount == expected.valueCount);
+        CHECK(actual.pixelX == expected.pixelX);
+        CHECK(actual.pixelY == expected.pixelY);
+        CHECK(actual.sample == expected.sample);
+        CHECK(std::memcmp(actual.values, expected.values, sizeof(actual.values)) == 0);
+    }
+}
+
+TEST_CASE("A trace region contains the pixels on and inside of its edges") {
+    auto region = trace::Region(2, 3, 4, 5);
+
+    for (int y = 0; y < 8; y++) {
+        for (int x = 0; x < 8; x++) {
+            bool inside = (x >= 2) && (x <= 4) && (y >= 3) && (y <= 5);
+            CHECK(region.contains(x, y) == inside);
+        }
+    }
+
+    SECTION("The default region contains nothing") {
+        auto empty = trace::Region();
+        CHECK_FALSE(empty.contains(0, 0));
+        CHECK_FALSE(empty.contains(-1, -1));
+    }
+
+    SECTION("A single pixel") {
+        auto pixel = trace::Region(6, 1, 6, 1);
+        CHECK(pixel.contains(6, 1));
+        CHECK_FALSE(pixel.contains(5, 1));
+        CHECK_FALSE(pixel.contains(6, 2));
+    }
+}
+
+#if RAY_TRACER_TRACE >= 1
+TEST_CASE("Only the pixels in the captured region are traced") {
+    auto camera = small_camera();
+    auto world = small_world();
+    auto region = trace::Region(2, 5, 3, 6);
+
+    // the records are kept for as long as the program runs, so this only looks at what rendering adds
+    auto count_records = [&region](int & inside, int & outside) {
+        uint64_t dropped = 0;
+        inside = 0;
+        outside = 0;
+        for (trace::Record const & record : trace::collect(dropped)) {
+            (region.contains(record.pixelX, record.pixelY) ? inside : outside)++;
+        }
+    };
+
+    int insideBefore, outsideBefore;
+    count_records(insideBefore, outsideBefore);
+
+    trace::capture(region);
+    for (int j = camera.imageHeight - 1; j >= 0; j--) {
+        for (int i = 0; i < camera.imageWidth; i++) {
+            camera.render_pixel(world, i, j);
+            CHECK(trace::capturing() == region.contains(i, j));
+            trace::end_pixel();
+            CHECK_FALSE(trace::capturing());
+        }
+    }
+    // nothing else is traced after this
+    trace::capture(trace::Region());
+
+    // a TRACE outside of any pixel isn't recorded either
+    TRACE(trace::Level::Pixel, trace::Event::PixelStarted);
+
+    int insideAfter, outsideAfter;
+    count_records(insideAfter, outsideAfter);
+    CHECK(outsideAfter == outsideBefore);
+
+    // every pixel in the region starts once, along with each of its samples
+    uint64_t dropped = 0;
+    int pixelsStarted = 0;
+    int samplesStarted = 0;
+    for (trace::Record const & record : trace::collect(dropped)) {
+        if (!region.contains(record.pixelX, record.pixelY)) {
+            continue;
+        }
+        if (record.event == trace::Event::PixelStarted) {
+            CHECK(record.sample == -1);
+            pixelsStarted++;
+        } else if (record.event == trace::Event::SampleStarted) {
+            CHECK(record.sample >= 0);
+            CHECK(record.sample < camera.aaSamples);
+            samplesStarted++;
+        }
+    }
+    CHECK(insideAfter > insideBefore);
+    CHECK(pixelsStarted >= 4);
+    CHECK(samplesStarted == pixelsStarted * camera.aaSamples);
+}
+
+TEST_CASE("Trace records written to a file are read back the same") {
+    auto camera = small_camera();
+    auto world = small_world();
+
+    trace::capture(trace::Region(4, 4, 4, 4));
+    camera.render_pixel(world, 4, 4);
+    trace::end_pixel();
+    trace::capture(trace::Region());
+
+    uint64_t expectedDropped = 0;
+    std::vector<trace::Record> expected = trace::collect(expectedDropped);
+    REQUIRE_FALSE(expected.empty());
+
+    std::string const fileName = "test_trace_records.bin";
+    REQUIRE(trace::write(fileName));
+
+    uint64_t actualDropped = 1;
+    std::vector<trace::Record> actual;
+    REQUIRE(trace::read(fileName, actual, actualDropped));
+    std::remove(fileName.c_str());
+
+    CHECK(actualDropped == expectedDropped);
+    REQUIRE(actual.size() == expected.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        check_same(actual[i], expected[i]);
+    }
+
+    SECTION("A file that isn't a trace isn't read") {
+        std::string const otherName = "test_trace_other.bin";
+        {
+            std::ofstream other(otherName, std::ios::binary);
+            other << "P3\n8 8\n255\n0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0\n";
+        }
+
+        std::vector<trace::Record> records;
+        uint64_t dropped = 0;
+        CHECK_FALSE(trace::read(otherName, records, dropped));
+        std::remove(otherName.c_str());
+    }
+}
+#endif
@@ -31,3 +31,26 @@ TEST_CASE("Vec3.unit") {
     CHECK(actual.y == (v.y / v.length()));
     CHECK(actual.z == (v.z / v.length()));
 }
+
+TEST_CASE("Vec3.cross") {
+    auto a = Vec3(1.75, -2.5, 4);
+    auto b = Vec3(-3, 0.5, 2);
+
+    auto actual = a.cross(b);
+
+    CHECK(actual.x == Approx(-7));
+    CHECK(actual.y == Approx(-15.5));
+    CHECK(actual.z == Approx(-6.625));
+}
+
+TEST_CASE("dot_vec3s") {
+    Vec3 a[] = { Vec3(1.75, -2.5, 4), Vec3(1, 2, 3), Vec3(0, 0, 0) };
+    Vec3 b[] = { Vec3(-3, 0.5, 2), Vec3(4, 5, 6), Vec3(1, 1, 1) };
+    double actual[3];
+
+    dot_vec3s(a, b, actual, 3);
+
+    for (int i = 0; i < 3; i++) {
+        CHECK(actual[i] == a[i].dot(b[i]));
+    }
+}
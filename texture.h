@@ -1,14 +1,46 @@
 #ifndef TEXTURE_H
 #define TEXTURE_H
 
+#include <memory>
+
 #include "color.h"
 #include "image.h"
+#include "perlin.h"
+
+// which of the built in textures a texture is, so they can be evaluated without going through the vtable,
+// see texture_value and TextureProgram
+enum class TextureType {
+    SolidColor,
+    Checkered,
+    Image,
+    Noise,
+    Turbulence,
+    Marble,
+    Program,
+    // any other texture, which is always evaluated through the vtable
+    Custom
+};
 
 class Texture {
     public:
+        Texture() : _type(TextureType::Custom) { }
         virtual ~Texture() = default;
 
+        TextureType type() const { return this->_type; }
+
         virtual Color value(double u, double v, Point3 const & p) const = 0;
+
+        // the average value over the area around u, v that a ray covers, footprint being the width of that area
+        // in the same units as u and v (see HitResult::uvFootprint). Textures that can change a lot over a small
+        // area (e.g images) should override this, by default it's just the value at u, v
+        virtual Color filtered_value(double u, double v, double footprint, Point3 const & p) const;
+
+    protected:
+        // for the built in textures
+        Texture(TextureType type) : _type(type) { }
+
+    private:
+        TextureType _type;
 };
 
 class SolidColorTexture : public Texture {
@@ -18,6 +50,8 @@ class SolidColorTexture : public Texture {
 
         Color value(double u, double v, Point3 const & p) const override;
 
+        Color const & color() const;
+
     private:
         Color _color;
 };
@@ -29,6 +63,12 @@ class CheckeredTexture : public Texture {
 
         Color value(double u, double v, Point3 const & p) const override;
 
+        Color filtered_value(double u, double v, double footprint, Point3 const & p) const override;
+
+        double invert_scale_factor() const;
+        std::shared_ptr<Texture> const & odd() const;
+        std::shared_ptr<Texture> const & even() const;
+
     private:
         double _invertScaleFactor;
         std::shared_ptr<Texture> _oddPatternTexture;
@@ -37,33 +77,92 @@ class CheckeredTexture : public Texture {
 
 class ImageTexture : public Texture {
     public:
+        // an empty texture, to be filled in later with load (e.g on another thread, see TextureRegistry)
+        ImageTexture();
         ImageTexture(std::string const & filename);
+        ImageTexture(std::string const & filename, TexelFormat format);
+
+        void load(std::string const & filename, TexelFormat format);
 
         Color value(double u, double v, Point3 const & p) const override;
+
+        // trilinear filtering between the image's mipmaps
+        Color filtered_value(double u, double v, double footprint, Point3 const & p) const override;
+
+        Image const & image() const;
     private:
-        Image image;
+        Image _image;
+};
+
+// grey Perlin noise, scale being how many cubes of the noise's lattice there are per unit of the scene.
+// textures are looked up one hit at a time, so this is a single point of noise with nothing to batch it with, unlike
+// the turbulence based textures below whose octaves all go through Perlin::noise_batch together
+class NoiseTexture : public Texture {
+    public:
+        NoiseTexture(double scale, uint32_t seed = 0);
+
+        Color value(double u, double v, Point3 const & p) const override;
+
+    private:
+        Perlin _noise;
+        double _scale;
+};
+
+// grey turbulence, i.e a sum of several octaves of noise, which looks like a camouflage net
+class TurbulenceTexture : public Texture {
+    public:
+        TurbulenceTexture(double scale, uint32_t seed = 0);
+
+        Color value(double u, double v, Point3 const & p) const override;
+
+    private:
+        Perlin _noise;
+        double _scale;
+};
+
+// stripes along z whose phase is shifted by turbulence, which looks like marble
+class MarbleTexture : public Texture {
+    public:
+        MarbleTexture(double scale, uint32_t seed = 0);
+
+        Color value(double u, double v, Point3 const & p) const override;
+
+    private:
+        Perlin _noise;
+        double _scale;
 };
 
 // ------
 
-SolidColorTexture::SolidColorTexture(Color c) : _color(c) { }
+inline Color Texture::filtered_value(double u, double v, double /* footprint */, Point3 const & p) const {
+    return value(u, v, p);
+}
+
+inline SolidColorTexture::SolidColorTexture(Color c) : Texture(TextureType::SolidColor), _color(c) { }
 
-SolidColorTexture::SolidColorTexture(double red, double green, double blue) : _color(Color(red, green, blue)) { }
+inline SolidColorTexture::SolidColorTexture(double red, double green, double blue)
+                                     : Texture(TextureType::SolidColor), _color(Color(red, green, blue)) { }
 
-Color SolidColorTexture::value(double u, double v, Point3 const & p) const {
+inline Color SolidColorTexture::value(double u, double v, Point3 const & p) const {
     return this->_color;
 }
 
+inline Color const & SolidColorTexture::color() const {
+    return this->_color;
+}
 
-CheckeredTexture::CheckeredTexture(double scale, Color const & odd, Color const & even)
-                                   : _invertScaleFactor(1.0 / scale),
+
+inline CheckeredTexture::CheckeredTexture(double scale, Color const & odd, Color const & even)
+                                   : Texture(TextureType::Checkered),
+                                     _invertScaleFactor(1.0 / scale),
                                      _oddPatternTexture(std::make_shared<SolidColorTexture>(odd)),
                                      _evenPatternTexture(std::make_shared<SolidColorTexture>(even)) { }
 
-CheckeredTexture::CheckeredTexture(double scale, std::shared_ptr<Texture> const & odd, std::shared_ptr<Texture> const & even)
-                                   : _invertScaleFactor(1.0 / scale), _oddPatternTexture(odd), _evenPatternTexture(even) { }
+inline CheckeredTexture::CheckeredTexture(double scale, std::shared_ptr<Texture> const & odd, std::shared_ptr<Texture> const & even)
+                                   : Texture(TextureType::Checkered),
+                                     _invertScaleFactor(1.0 / scale), _oddPatternTexture(odd), _evenPatternTexture(even) { }
 
-Color CheckeredTexture::value(double u, double v, Point3 const & p) const {
+inline Color CheckeredTexture::value(double u, double v, Point3 const & p) const {
     auto x = static_cast<int>(std::floor(p.x * this->_invertScaleFactor));
     auto y = static_cast<int>(std::floor(p.y * this->_invertScaleFactor));
     auto z = static_cast<int>(std::floor(p.z * this->_invertScaleFactor));
@@ -73,16 +172,75 @@ Color CheckeredTexture::value(double u, double v, Point3 const & p) const {
     return isEven ? _evenPatternTexture->value(u, v, p) : _oddPatternTexture->value(u, v, p);
 }
 
+// the checkers themselves aren't filtered, only the textures within them
+inline Color CheckeredTexture::filtered_value(double u, double v, double footprint, Point3 const & p) const {
+    auto x = static_cast<int>(std::floor(p.x * this->_invertScaleFactor));
+    auto y = static_cast<int>(std::floor(p.y * this->_invertScaleFactor));
+    auto z = static_cast<int>(std::floor(p.z * this->_invertScaleFactor));
+
+    auto isEven = ((x + y + z) % 2) == 0;
+
+    return isEven ? _evenPatternTexture->filtered_value(u, v, footprint, p)
+                  : _oddPatternTexture->filtered_value(u, v, footprint, p);
+}
+
+inline double CheckeredTexture::invert_scale_factor() const {
+    return this->_invertScaleFactor;
+}
+
+inline std::shared_ptr<Texture> const & CheckeredTexture::odd() const {
+    return this->_oddPatternTexture;
+}
+
+inline std::shared_ptr<Texture> const & CheckeredTexture::even() const {
+    return this->_evenPatternTexture;
+}
+
 
-ImageTexture::ImageTexture(std::string const & filename)
-                                   : image(filename) { }
+inline ImageTexture::ImageTexture() : Texture(TextureType::Image), _image() { }
 
-Color ImageTexture::value(double u, double v, Point3 const & p) const {
+inline ImageTexture::ImageTexture(std::string const & filename)
+                                   : Texture(TextureType::Image), _image(filename) { }
+
+inline ImageTexture::ImageTexture(std::string const & filename, TexelFormat format)
+                                   : Texture(TextureType::Image), _image(filename, format) { }
+
+inline void ImageTexture::load(std::string const & filename, TexelFormat format) {
+    this->_image.load(filename, format);
+}
+
+inline Color ImageTexture::value(double u, double v, Point3 const & p) const {
+    return filtered_value(u, v, 0, p);
+}
+
+inline Color ImageTexture::filtered_value(double u, double v, double footprint, Point3 const & /* p */) const {
     u = Interval(0, 1).clamp(u);
     v = 1.0 - Interval(0, 1).clamp(v); // flip v because image is mapped from top to bottom
 
-    double * const pixel = this->image.color_at(int(u * this->image.width), int(v * this->image.height));
-    return Color(pixel[0], pixel[1], pixel[2]);
+    return this->_image.trilinear(u, v, footprint);
+}
+
+inline Image const & ImageTexture::image() const {
+    return this->_image;
+}
+
+inline NoiseTexture::NoiseTexture(double scale, uint32_t seed) : Texture(TextureType::Noise), _noise(seed), _scale(scale) { }
+
+inline Color NoiseTexture::value(double /* u */, double /* v */, Point3 const & p) const {
+    // noise is -1 to 1, moved to 0 to 1
+    return 0.5 * (1.0 + this->_noise.noise(this->_scale * p)) * Color(1, 1, 1);
+}
+
+inline TurbulenceTexture::TurbulenceTexture(double scale, uint32_t seed) : Texture(TextureType::Turbulence), _noise(seed), _scale(scale) { }
+
+inline Color TurbulenceTexture::value(double /* u */, double /* v */, Point3 const & p) const {
+    return this->_noise.turbulence(this->_scale * p) * Color(1, 1, 1);
+}
+
+inline MarbleTexture::MarbleTexture(double scale, uint32_t seed) : Texture(TextureType::Marble), _noise(seed), _scale(scale) { }
+
+inline Color MarbleTexture::value(double /* u */, double /* v */, Point3 const & p) const {
+    return 0.5 * (1.0 + std::sin((this->_scale * p.z) + (10.0 * this->_noise.turbulence(p)))) * Color(1, 1, 1);
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,605 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "color.h"
+#include "image.h"
+#include "interval.h"
+#include "texture.h"
+
+// textures that are too big to all be in memory at once are converted (once, ahead of time) to a tiled file, which has
+// every mip level of the image split into square tiles that can each be read on their own. A TextureCache then reads
+// tiles in as they're looked up, and drops the least recently used ones to stay within its memory budget.
+//
+// the tiled file is laid out as a TiledTextureHeader, followed by the tiles of each level from the full size image down
+// to the 1x1 one. The tiles of a level are stored row by row, and the texels within a tile row by row. Tiles at the
+// right and bottom edges are padded out to the full tile size so every tile is the same size
+
+// writes every mip level of an image to a tiled file, in the image's format
+bool write_tiled_texture(Image const & image, std::string const & filename);
+
+// loads an image file and writes it to a tiled file, unless the tiled file is already up to date (see
+// tiled_texture_is_current)
+bool convert_to_tiled_texture(std::string const & imageFilename, std::string const & tiledFilename, TexelFormat format);
+
+// whether the tiled file exists, was written after the image was last changed, and is a complete tiled file of an
+// image the same size as it in the format
+bool tiled_texture_is_current(std::string const & imageFilename, std::string const & tiledFilename, TexelFormat format);
+
+class TiledTextureHeader {
+    public:
+        char magic[4] = { 'R', 'T', 'T', 'X' };
+        uint32_t version = 1;
+        int32_t width = 0;
+        int32_t height = 0;
+        uint32_t format = 0;
+        uint32_t levelCount = 0;
+        // the width and height of a tile in texels
+        uint32_t tileSize = 64;
+
+        bool valid() const;
+
+        // whether this is the header of a width x height image in the format, with every mip level down to 1x1 and
+        // the tile size this version writes
+        bool matches(int width, int height, TexelFormat format) const;
+
+        TexelFormat texel_format() const;
+
+        int level_width(int level) const;
+        int level_height(int level) const;
+
+        int tiles_across(int level) const;
+        int tiles_down(int level) const;
+
+        size_t tile_bytes() const;
+
+        // where in the file a tile starts
+        size_t tile_offset(int level, int tileX, int tileY) const;
+
+        // the size of the whole file, header and tiles
+        size_t file_size() const;
+};
+
+// the texels of one tile, in the format of the file they were read from
+class TextureTile {
+    public:
+        std::vector<uint8_t> bytes;
+
+        // the linear value of each component of the texel at x, y within the tile
+        void get(TexelFormat format, uint32_t tileSize, int x, int y, float * linear) const;
+};
+
+// keeps the most recently used tiles of any number of tiled files in memory, up to a budget in bytes.
+// lookups can come from any thread.
+//
+// the budget only covers the tiles the cache itself holds. CachedImageTexture also keeps each thread's last few tiles
+// (see CachedImageTexture::texel), which stay in memory after the cache evicts them, so the memory used can go over
+// the budget by up to 4 tiles per rendering thread
+class TextureCache {
+    public:
+        class Statistics {
+            public:
+                uint64_t hits = 0;
+                uint64_t misses = 0;
+                uint64_t evictions = 0;
+                // how many bytes of tiles are in memory right now, and the most there has been at once
+                size_t residentBytes = 0;
+                size_t peakResidentBytes = 0;
+        };
+
+        TextureCache(size_t memoryBudget);
+
+        TextureCache(TextureCache const &) = delete;
+        TextureCache & operator=(TextureCache const &) = delete;
+
+        // opens a tiled file for looking up its tiles with get_tile, returning its id or -1 if it couldn't be opened.
+        // the header is filled in from the file
+        int open(std::string const & filename, TiledTextureHeader & header);
+
+        // the tile, reading it from the file if it isn't in memory. The returned tile stays valid even after the
+        // cache has evicted it. Returns nullptr if the tile couldn't be read
+        std::shared_ptr<TextureTile const> get_tile(int file, int level, int tileX, int tileY);
+
+        Statistics statistics() const;
+
+        // logs the statistics, meant for the end of a render
+        void report(std::ostream & out) const;
+
+        // lookups answered from a tile that was kept from an earlier get_tile, which are counted as hits
+        void count_recent_tile_hit();
+
+        // a single number for the tile at tileX, tileY in a level of a file
+        static uint64_t tile_key(int file, int level, int tileX, int tileY);
+
+        // unique to this cache for the whole run, unlike its address which a later cache could be given
+        uint64_t id() const;
+
+        size_t memoryBudget;
+
+    private:
+        class TiledFile {
+            public:
+                std::string filename;
+                TiledTextureHeader header;
+                std::ifstream stream;
+                // reads from the same stream can't happen at the same time, but reads from different files can
+                std::mutex streamMutex;
+        };
+
+        class Entry {
+            public:
+                uint64_t key;
+                std::shared_ptr<TextureTile const> tile;
+        };
+
+        uint64_t const _id;
+        mutable std::mutex _mutex;
+        std::vector<std::unique_ptr<TiledFile>> _files;
+        // most recently used at the front
+        std::list<Entry> _leastRecentlyUsed;
+        std::unordered_map<uint64_t, std::list<Entry>::iterator> _entries;
+        Statistics _statistics;
+        // kept apart from the statistics so that counting them doesn't need the lock
+        std::atomic<uint64_t> _recentTileHits{0};
+
+        static uint64_t next_id();
+
+        std::shared_ptr<TextureTile const> read_tile(TiledFile & file, int level, int tileX, int tileY);
+
+        // drops tiles from the back of the list until the cache is within its budget. Expects _mutex to be held
+        void evict();
+};
+
+// an image texture whose texels are looked up through a TextureCache, so only the parts of it that rays actually hit
+// need to be in memory
+class CachedImageTexture : public Texture {
+    public:
+        CachedImageTexture(std::shared_ptr<TextureCache> const & cache, std::string const & tiledFilename);
+
+        Color value(double u, double v, Point3 const & p) const override;
+
+        // trilinear filtering between the mip levels, see Image::trilinear
+        Color filtered_value(double u, double v, double footprint, Point3 const & p) const override;
+
+    private:
+        std::shared_ptr<TextureCache> _cache;
+        TiledTextureHeader _header;
+        int _file;
+
+        // see Image::bilinear
+        Color bilinear(double u, double v, int level) const;
+
+        void texel(int level, int x, int y, float * linear) const;
+
+        // for when the file couldn't be opened, the same as Image's
+        static Color const FALLBACK_COLOR;
+};
+
+// ------
+
+inline bool write_tiled_texture(Image const & image, std::string const & filename) {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file) {
+        std::cerr << "Error writing tiled texture " << filename << std::endl;
+        return false;
+    }
+
+    TiledTextureHeader header;
+    header.width = image.width;
+    header.height = image.height;
+    header.format = static_cast<uint32_t>(image.format());
+    header.levelCount = static_cast<uint32_t>(image.level_count());
+    file.write(reinterpret_cast<char const *>(&header), sizeof(header));
+
+    TexelFormat format = image.format();
+    size_t componentSize = texel_component_size(format);
+    auto tile = std::vector<uint8_t>(header.tile_bytes());
+
+    for (int level = 0; level < image.level_count(); level++) {
+        for (int tileY = 0; tileY < header.tiles_down(level); tileY++) {
+            for (int tileX = 0; tileX < header.tiles_across(level); tileX++) {
+                std::fill(tile.begin(), tile.end(), 0);
+
+                for (uint32_t y = 0; y < header.tileSize; y++) {
+                    for (uint32_t x = 0; x < header.tileSize; x++) {
+                        int imageX = (tileX * static_cast<int>(header.tileSize)) + static_cast<int>(x);
+                        int imageY = (tileY * static_cast<int>(header.tileSize)) + static_cast<int>(y);
+                        if ((imageX >= image.level_width(level)) || (imageY >= image.level_height(level))) {
+                            continue;
+                        }
+
+                        // the image decodes to linear, so encode back to its format. This round trips exactly
+                        Color color = image.color_at(imageX, imageY, level);
+                        float linear[3] = { static_cast<float>(color.r), static_cast<float>(color.g), static_cast<float>(color.b) };
+
+                        uint8_t * texel = tile.data() + ((((y * header.tileSize) + x) * 3) * componentSize);
+                        for (int c = 0; c < 3; c++) {
+                            switch (format) {
+                                case TexelFormat::Srgb8:
+                                    texel[c] = linear_to_srgb8(linear[c]);
+                                    break;
+                                case TexelFormat::Half: {
+                                    uint16_t half = float_to_half(linear[c]);
+                                    std::memcpy(texel + (c * componentSize), &half, componentSize);
+                                    break;
+                                }
+                                case TexelFormat::Float:
+                                    std::memcpy(texel + (c * componentSize), &linear[c], componentSize);
+                                    break;
+                            }
+                        }
+                    }
+                }
+
+                file.write(reinterpret_cast<char const *>(tile.data()), static_cast<std::streamsize>(tile.size()));
+            }
+        }
+    }
+
+    return static_cast<bool>(file);
+}
+
+inline bool convert_to_tiled_texture(std::string const & imageFilename, std::string const & tiledFilename, TexelFormat format) {
+    if (tiled_texture_is_current(imageFilename, tiledFilename, format)) {
+        return true;
+    }
+
+    auto image = Image(imageFilename, format);
+    if (image.level_count() == 0) {
+        return false;
+    }
+
+    std::clog << "Converting " << imageFilename << " to tiled texture " << tiledFilename << "\n";
+    return write_tiled_texture(image, tiledFilename);
+}
+
+inline bool tiled_texture_is_current(std::string const & imageFilename, std::string const & tiledFilename, TexelFormat format) {
+    std::error_code error;
+    auto tiledTime = std::filesystem::last_write_time(tiledFilename, error);
+    if (error) {
+        return false;
+    }
+    auto imageTime = std::filesystem::last_write_time(imageFilename, error);
+    if (error || (imageTime > tiledTime)) {
+        return false;
+    }
+
+    // only reads the image's header, rather than decoding the whole thing
+    int width, height, components;
+    if (!stbi_info(imageFilename.c_str(), &width, &height, &components)) {
+        return false;
+    }
+
+    TiledTextureHeader header;
+    std::ifstream file(tiledFilename, std::ios::binary);
+    file.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (!file || !header.matches(width, height, format)) {
+        return false;
+    }
+
+    // a file that's cut short (e.g from a conversion that was stopped part way through) is missing tiles
+    return std::filesystem::file_size(tiledFilename, error) == header.file_size();
+}
+
+inline bool TiledTextureHeader::valid() const {
+    return (std::memcmp(this->magic, "RTTX", 4) == 0) && (this->version == 1) && (this->width > 0) && (this->height > 0)
+           && (this->format <= static_cast<uint32_t>(TexelFormat::Float)) && (this->levelCount > 0) && (this->tileSize > 0);
+}
+
+inline bool TiledTextureHeader::matches(int width, int height, TexelFormat format) const {
+    if (!valid() || (this->width != width) || (this->height != height) || (texel_format() != format)
+        || (this->tileSize != TiledTextureHeader().tileSize)) {
+        return false;
+    }
+
+    // the last level is 1x1, and the one before it isn't
+    int last = static_cast<int>(this->levelCount) - 1;
+    return (level_width(last) == 1) && (level_height(last) == 1)
+           && ((last == 0) || (level_width(last - 1) > 1) || (level_height(last - 1) > 1));
+}
+
+inline TexelFormat TiledTextureHeader::texel_format() const {
+    return static_cast<TexelFormat>(this->format);
+}
+
+inline int TiledTextureHeader::level_width(int level) const {
+    return std::max(1, this->width >> level);
+}
+
+inline int TiledTextureHeader::level_height(int level) const {
+    return std::max(1, this->height >> level);
+}
+
+inline int TiledTextureHeader::tiles_across(int level) const {
+    return (level_width(level) + static_cast<int>(this->tileSize) - 1) / static_cast<int>(this->tileSize);
+}
+
+inline int TiledTextureHeader::tiles_down(int level) const {
+    return (level_height(level) + static_cast<int>(this->tileSize) - 1) / static_cast<int>(this->tileSize);
+}
+
+inline size_t TiledTextureHeader::tile_bytes() const {
+    return static_cast<size_t>(this->tileSize) * this->tileSize * 3 * texel_component_size(texel_format());
+}
+
+inline size_t TiledTextureHeader::tile_offset(int level, int tileX, int tileY) const {
+    size_t tilesBefore = 0;
+    for (int previous = 0; previous < level; previous++) {
+        tilesBefore += static_cast<size_t>(tiles_across(previous)) * tiles_down(previous);
+    }
+    tilesBefore += (static_cast<size_t>(tileY) * tiles_across(level)) + tileX;
+
+    return sizeof(TiledTextureHeader) + (tilesBefore * tile_bytes());
+}
+
+inline size_t TiledTextureHeader::file_size() const {
+    // where the tiles of the level after the last one would start
+    return tile_offset(static_cast<int>(this->levelCount), 0, 0);
+}
+
+inline void TextureTile::get(TexelFormat format, uint32_t tileSize, int x, int y, float * linear) const {
+    size_t index = ((static_cast<size_t>(y) * tileSize) + x) * 3;
+
+    for (int c = 0; c < 3; c++) {
+        switch (format) {
+            case TexelFormat::Srgb8:
+                linear[c] = decode_component(this->bytes[index + c]);
+                break;
+            case TexelFormat::Half: {
+                uint16_t half;
+                std::memcpy(&half, this->bytes.data() + ((index + c) * sizeof(uint16_t)), sizeof(half));
+                linear[c] = decode_component(half);
+                break;
+            }
+            case TexelFormat::Float:
+                std::memcpy(&linear[c], this->bytes.data() + ((index + c) * sizeof(float)), sizeof(float));
+                break;
+        }
+    }
+}
+
+inline TextureCache::TextureCache(size_t memoryBudget) : memoryBudget(memoryBudget), _id(next_id()) { }
+
+inline int TextureCache::open(std::string const & filename, TiledTextureHeader & header) {
+    auto file = std::make_unique<TiledFile>();
+    file->filename = filename;
+    file->stream.open(filename, std::ios::binary);
+    file->stream.read(reinterpret_cast<char *>(&file->header), sizeof(TiledTextureHeader));
+
+    if (!file->stream || !file->header.valid()) {
+        std::cerr << "Error opening tiled texture " << filename << std::endl;
+        return -1;
+    }
+
+    header = file->header;
+
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    this->_files.push_back(std::move(file));
+    return static_cast<int>(this->_files.size() - 1);
+}
+
+inline std::shared_ptr<TextureTile const> TextureCache::get_tile(int file, int level, int tileX, int tileY) {
+    uint64_t tileKey = tile_key(file, level, tileX, tileY);
+    TiledFile * tiledFile;
+
+    {
+        std::lock_guard<std::mutex> lock(this->_mutex);
+
+        auto found = this->_entries.find(tileKey);
+        if (found != this->_entries.end()) {
+            this->_statistics.hits++;
+            // move it to the front as the most recently used
+            this->_leastRecentlyUsed.splice(this->_leastRecentlyUsed.begin(), this->_leastRecentlyUsed, found->second);
+            return found->second->tile;
+        }
+
+        this->_statistics.misses++;
+        tiledFile = this->_files[file].get();
+    }
+
+    // the cache isn't locked while reading, so other threads can carry on looking up tiles that are in memory
+    auto tile = read_tile(*tiledFile, level, tileX, tileY);
+    if (tile == nullptr) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(this->_mutex);
+
+    // another thread might have read the same tile in the meantime, in which case theirs is kept
+    auto found = this->_entries.find(tileKey);
+    if (found != this->_entries.end()) {
+        return found->second->tile;
+    }
+
+    this->_leastRecentlyUsed.push_front(Entry{tileKey, tile});
+    this->_entries[tileKey] = this->_leastRecentlyUsed.begin();
+    this->_statistics.residentBytes += tile->bytes.size();
+
+    evict();
+    this->_statistics.peakResidentBytes = std::max(this->_statistics.peakResidentBytes, this->_statistics.residentBytes);
+
+    return tile;
+}
+
+inline TextureCache::Statistics TextureCache::statistics() const {
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    Statistics statistics = this->_statistics;
+    statistics.hits += this->_recentTileHits.load(std::memory_order_relaxed);
+    return statistics;
+}
+
+inline void TextureCache::report(std::ostream & out) const {
+    Statistics stats = statistics();
+    uint64_t lookups = stats.hits + stats.misses;
+    double hitRate = (lookups > 0) ? (100.0 * stats.hits) / lookups : 0;
+
+    out << "Texture cache: " << stats.hits << " hits, " << stats.misses << " misses (" << hitRate << "% hit rate), "
+        << stats.evictions << " evictions, " << stats.peakResidentBytes / 1024 << "KB peak of "
+        << this->memoryBudget / 1024 << "KB budget\n";
+}
+
+inline void TextureCache::count_recent_tile_hit() {
+    this->_recentTileHits.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline uint64_t TextureCache::id() const {
+    return this->_id;
+}
+
+inline uint64_t TextureCache::next_id() {
+    static std::atomic<uint64_t> nextId{1};
+    return nextId.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline uint64_t TextureCache::tile_key(int file, int level, int tileX, int tileY) {
+    // 16 bits of file, 8 of level and 20 each of tile x and y, which is plenty for any texture that fits on a disk
+    return (static_cast<uint64_t>(file) << 48) | (static_cast<uint64_t>(level) << 40)
+           | (static_cast<uint64_t>(tileY) << 20) | static_cast<uint64_t>(tileX);
+}
+
+inline std::shared_ptr<TextureTile const> TextureCache::read_tile(TiledFile & file, int level, int tileX, int tileY) {
+    auto tile = std::make_shared<TextureTile>();
+    tile->bytes.resize(file.header.tile_bytes());
+
+    std::lock_guard<std::mutex> lock(file.streamMutex);
+    file.stream.seekg(static_cast<std::streamoff>(file.header.tile_offset(level, tileX, tileY)));
+    file.stream.read(reinterpret_cast<char *>(tile->bytes.data()), static_cast<std::streamsize>(tile->bytes.size()));
+
+    if (!file.stream) {
+        std::cerr << "Error reading tile " << tileX << ", " << tileY << " of level " << level << " from " << file.filename << std::endl;
+        file.stream.clear();
+        return nullptr;
+    }
+
+    return tile;
+}
+
+inline void TextureCache::evict() {
+    // the tile that was just added is never evicted, even if it alone is over the budget
+    while ((this->_statistics.residentBytes > this->memoryBudget) && (this->_leastRecentlyUsed.size() > 1)) {
+        Entry const & oldest = this->_leastRecentlyUsed.back();
+        this->_statistics.residentBytes -= oldest.tile->bytes.size();
+        this->_statistics.evictions++;
+
+        this->_entries.erase(oldest.key);
+        this->_leastRecentlyUsed.pop_back();
+    }
+}
+
+inline Color const CachedImageTexture::FALLBACK_COLOR = Color(255, 0, 0);
+
+inline CachedImageTexture::CachedImageTexture(std::shared_ptr<TextureCache> const & cache, std::string const & tiledFilename)
+                                       : _cache(cache), _header(), _file(cache->open(tiledFilename, this->_header)) { }
+
+inline Color CachedImageTexture::value(double u, double v, Point3 const & p) const {
+    return filtered_value(u, v, 0, p);
+}
+
+inline Color CachedImageTexture::filtered_value(double u, double v, double footprint, Point3 const & /* p */) const {
+    if (this->_file < 0) {
+        return FALLBACK_COLOR;
+    }
+
+    u = Interval(0, 1).clamp(u);
+    v = 1.0 - Interval(0, 1).clamp(v); // flip v because image is mapped from top to bottom
+
+    double level = mip_level(footprint, this->_header.width, this->_header.height, static_cast<int>(this->_header.levelCount));
+
+    int finerLevel = static_cast<int>(level);
+    double coarserWeight = level - finerLevel;
+
+    Color color = bilinear(u, v, finerLevel);
+    if (coarserWeight > 0) {
+        color = ((1 - coarserWeight) * color) + (coarserWeight * bilinear(u, v, finerLevel + 1));
+    }
+
+    return color;
+}
+
+inline Color CachedImageTexture::bilinear(double u, double v, int level) const {
+    int width = this->_header.level_width(level);
+    int height = this->_header.level_height(level);
+
+    // texel centers are at the halves, e.g the first texel covers 0 to 1 so its center is at 0.5
+    double x = (u * width) - 0.5;
+    double y = (v * height) - 0.5;
+
+    int left = static_cast<int>(std::floor(x));
+    int top = static_cast<int>(std::floor(y));
+    float xWeight = static_cast<float>(x - left);
+    float yWeight = static_cast<float>(y - top);
+
+    int right = std::min(left + 1, width - 1);
+    int bottom = std::min(top + 1, height - 1);
+    left = std::max(left, 0);
+    top = std::max(top, 0);
+
+    float topLeft[3], topRight[3], bottomLeft[3], bottomRight[3];
+    texel(level, left, top, topLeft);
+    texel(level, right, top, topRight);
+    texel(level, left, bottom, bottomLeft);
+    texel(level, right, bottom, bottomRight);
+
+    float blended[3];
+    for (int c = 0; c < 3; c++) {
+        float topValue = topLeft[c] + (xWeight * (topRight[c] - topLeft[c]));
+        float bottomValue = bottomLeft[c] + (xWeight * (bottomRight[c] - bottomLeft[c]));
+        blended[c] = topValue + (yWeight * (bottomValue - topValue));
+    }
+
+    return Color(blended[0], blended[1], blended[2]);
+}
+
+inline void CachedImageTexture::texel(int level, int x, int y, float * linear) const {
+    auto tileSize = static_cast<int>(this->_header.tileSize);
+    int tileX = x / tileSize;
+    int tileY = y / tileSize;
+
+    // the 4 texels of a bilinear lookup are nearly always in the same tile, so each thread remembers the last tile it
+    // used for each of a few levels, and only goes to the (locked) cache when it needs a different one.
+    // the cache is remembered by its id rather than its address, since a cache created after this one is destroyed
+    // could be given the same address, and would then be handed this one's tiles
+    class RecentTile {
+        public:
+            // 0 is never the id of a cache
+            uint64_t cacheId = 0;
+            uint64_t key = 0;
+            std::shared_ptr<TextureTile const> tile;
+    };
+    static thread_local RecentTile recentTiles[4];
+
+    // levels 0-3 each get their own slot, which covers the two levels of a trilinear lookup without them fighting over it
+    RecentTile & recent = recentTiles[level & 3];
+    uint64_t tileKey = TextureCache::tile_key(this->_file, level, tileX, tileY);
+
+    if ((recent.cacheId != this->_cache->id()) || (recent.key != tileKey) || (recent.tile == nullptr)) {
+        recent.cacheId = this->_cache->id();
+        recent.key = tileKey;
+        recent.tile = this->_cache->get_tile(this->_file, level, tileX, tileY);
+
+        if (recent.tile == nullptr) {
+            linear[0] = static_cast<float>(FALLBACK_COLOR.r);
+            linear[1] = static_cast<float>(FALLBACK_COLOR.g);
+            linear[2] = static_cast<float>(FALLBACK_COLOR.b);
+            return;
+        }
+    } else {
+        this->_cache->count_recent_tile_hit();
+    }
+
+    recent.tile->get(this->_header.texel_format(), this->_header.tileSize, x - (tileX * tileSize), y - (tileY * tileSize), linear);
+}
+
+#endif
@@ -0,0 +1,227 @@
+#ifndef TEXTURE_PROGRAM_H
+#define TEXTURE_PROGRAM_H
+
+#include <cmath>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "color.h"
+#include "texture.h"
+
+// a tree of textures (e.g checkers of checkers of images) flattened into an array of nodes when the scene is built,
+// so that evaluating it is a loop over the array rather than a virtual call for every texture in the tree.
+// checkers are the only textures made up of other textures, so a program is checker nodes that pick which node to go to
+// next, ending at a leaf node that's either a constant color or one of the other textures.
+// any part of the tree that always gives the same color (e.g a checker whose odd and even textures are the same color)
+// is folded down to a single constant color node
+class TextureProgram : public Texture {
+    public:
+        // the texture to use in place of root: a TextureProgram if root is a tree of textures, a solid color if the
+        // whole tree folds down to one, or root itself if it's a single texture that wouldn't gain anything
+        static std::shared_ptr<Texture> compile(std::shared_ptr<Texture> const & root);
+
+        Color value(double u, double v, Point3 const & p) const override;
+
+        Color filtered_value(double u, double v, double footprint, Point3 const & p) const override;
+
+        // the same as filtered_value, but not virtual, see texture_value
+        Color evaluate(double u, double v, double footprint, Point3 const & p) const;
+
+        size_t node_count() const;
+
+    private:
+        class Node {
+            public:
+                // SolidColor, Checkered or the type of texture
+                TextureType type;
+                // for SolidColor
+                Color color;
+                // for Checkered, the indexes of the nodes for the odd and even squares
+                double invertScaleFactor = 0;
+                int odd = 0;
+                int even = 0;
+                // for any other type
+                Texture const * texture = nullptr;
+        };
+
+        std::vector<Node> _nodes;
+        int _root = 0;
+        // the textures the leaf nodes point to
+        std::vector<std::shared_ptr<Texture>> _textures;
+
+        TextureProgram();
+
+        // adds the nodes for a texture (and everything under it), returning the index of its node. Textures that
+        // appear more than once in the tree only get added once
+        int add(std::shared_ptr<Texture> const & texture, std::unordered_map<Texture const *, int> & added);
+
+        int add_constant(Color const & color);
+};
+
+// the filtered value of any texture, calling the built in textures directly rather than through the vtable
+Color texture_value(Texture const & texture, double u, double v, double footprint, Point3 const & p);
+
+// ------
+
+// the same as static_cast<int>(std::floor(value)), without std::floor, which is a library call unless SSE4.1 is enabled
+inline int floor_to_int(double value) {
+    auto truncated = static_cast<int>(value);
+    return truncated - ((value < truncated) ? 1 : 0);
+}
+
+inline TextureProgram::TextureProgram() : Texture(TextureType::Program) { }
+
+inline std::shared_ptr<Texture> TextureProgram::compile(std::shared_ptr<Texture> const & root) {
+    if ((root == nullptr) || (root->type() != TextureType::Checkered)) {
+        return root;
+    }
+
+    // can't use make_shared with the private constructor
+    auto program = std::shared_ptr<TextureProgram>(new TextureProgram());
+    auto added = std::unordered_map<Texture const *, int>();
+    program->_root = program->add(root, added);
+
+    Node const & rootNode = program->_nodes[program->_root];
+    if (rootNode.type == TextureType::SolidColor) {
+        return std::make_shared<SolidColorTexture>(rootNode.color);
+    }
+
+    return program;
+}
+
+inline Color TextureProgram::value(double u, double v, Point3 const & p) const {
+    return evaluate(u, v, 0, p);
+}
+
+inline Color TextureProgram::filtered_value(double u, double v, double footprint, Point3 const & p) const {
+    return evaluate(u, v, footprint, p);
+}
+
+inline Color TextureProgram::evaluate(double u, double v, double footprint, Point3 const & p) const {
+    Node const * node = &this->_nodes[this->_root];
+
+    while (node->type == TextureType::Checkered) {
+        // the same squares as CheckeredTexture::value
+        int x = floor_to_int(p.x * node->invertScaleFactor);
+        int y = floor_to_int(p.y * node->invertScaleFactor);
+        int z = floor_to_int(p.z * node->invertScaleFactor);
+
+        auto isEven = ((x + y + z) & 1) == 0;
+
+        node = &this->_nodes[isEven ? node->even : node->odd];
+    }
+
+    if (node->type == TextureType::SolidColor) {
+        return node->color;
+    }
+
+    return texture_value(*node->texture, u, v, footprint, p);
+}
+
+inline size_t TextureProgram::node_count() const {
+    return this->_nodes.size();
+}
+
+inline int TextureProgram::add(std::shared_ptr<Texture> const & texture, std::unordered_map<Texture const *, int> & added) {
+    auto found = added.find(texture.get());
+    if (found != added.end()) {
+        return found->second;
+    }
+
+    int index;
+    switch (texture->type()) {
+        case TextureType::SolidColor:
+            index = add_constant(static_cast<SolidColorTexture const &>(*texture).color());
+            break;
+
+        case TextureType::Checkered: {
+            auto const & checkered = static_cast<CheckeredTexture const &>(*texture);
+            int odd = add(checkered.odd(), added);
+            int even = add(checkered.even(), added);
+
+            Node const & oddNode = this->_nodes[odd];
+            Node const & evenNode = this->_nodes[even];
+            bool sameColor = (oddNode.type == TextureType::SolidColor) && (evenNode.type == TextureType::SolidColor)
+                             && (oddNode.color.r == evenNode.color.r) && (oddNode.color.g == evenNode.color.g)
+                             && (oddNode.color.b == evenNode.color.b);
+
+            if (sameColor || (odd == even)) {
+                // it doesn't matter which square a point is in, so the checker can be skipped entirely
+                index = odd;
+                break;
+            }
+
+            Node node;
+            node.type = TextureType::Checkered;
+            node.invertScaleFactor = checkered.invert_scale_factor();
+            node.odd = odd;
+            node.even = even;
+            this->_nodes.push_back(node);
+            index = static_cast<int>(this->_nodes.size() - 1);
+            break;
+        }
+
+        case TextureType::Program: {
+            // a program inside of another tree, its nodes are copied in with their indexes moved along
+            auto const & program = static_cast<TextureProgram const &>(*texture);
+            auto offset = static_cast<int>(this->_nodes.size());
+            for (Node node : program._nodes) {
+                if (node.type == TextureType::Checkered) {
+                    node.odd += offset;
+                    node.even += offset;
+                }
+                this->_nodes.push_back(node);
+            }
+            this->_textures.insert(this->_textures.end(), program._textures.begin(), program._textures.end());
+            index = program._root + offset;
+            break;
+        }
+
+        default: {
+            Node node;
+            node.type = texture->type();
+            node.texture = texture.get();
+            this->_nodes.push_back(node);
+            this->_textures.push_back(texture);
+            index = static_cast<int>(this->_nodes.size() - 1);
+            break;
+        }
+    }
+
+    added[texture.get()] = index;
+    return index;
+}
+
+inline int TextureProgram::add_constant(Color const & color) {
+    Node node;
+    node.type = TextureType::SolidColor;
+    node.color = color;
+    this->_nodes.push_back(node);
+    return static_cast<int>(this->_nodes.size() - 1);
+}
+
+inline Color texture_value(Texture const & texture, double u, double v, double footprint, Point3 const & p) {
+    // calling through the type with the class name qualifying the function skips the vtable
+    switch (texture.type()) {
+        case TextureType::SolidColor:
+            return static_cast<SolidColorTexture const &>(texture).color();
+        case TextureType::Checkered:
+            return static_cast<CheckeredTexture const &>(texture).CheckeredTexture::filtered_value(u, v, footprint, p);
+        case TextureType::Image:
+            return static_cast<ImageTexture const &>(texture).ImageTexture::filtered_value(u, v, footprint, p);
+        case TextureType::Noise:
+            return static_cast<NoiseTexture const &>(texture).NoiseTexture::value(u, v, p);
+        case TextureType::Turbulence:
+            return static_cast<TurbulenceTexture const &>(texture).TurbulenceTexture::value(u, v, p);
+        case TextureType::Marble:
+            return static_cast<MarbleTexture const &>(texture).MarbleTexture::value(u, v, p);
+        case TextureType::Program:
+            return static_cast<TextureProgram const &>(texture).evaluate(u, v, footprint, p);
+        case TextureType::Custom:
+        default:
+            return texture.filtered_value(u, v, footprint, p);
+    }
+}
+
+#endif
@@ -0,0 +1,214 @@
+#ifndef TEXTURE_REGISTRY_H
+#define TEXTURE_REGISTRY_H
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "color.h"
+#include "image.h"
+#include "texture.h"
+#include "thread_pool.h"
+
+// hands out shared textures for a scene, so that asking for the same image file or solid color twice gives back the
+// same texture rather than decoding the file again or allocating another copy of the color.
+// image files are matched first by path, and then by a hash of their contents, so the same file reached through a
+// different path (or copied under a different name) is still only decoded once.
+//
+// images are decoded on a pool of worker threads, so that the rest of the scene (e.g the BVH) can be built while they
+// load, and several images load at once. The textures handed out by image are empty until then, so resolve must be
+// called before rendering with them
+class TextureRegistry {
+    public:
+        class Statistics {
+            public:
+                uint64_t imageRequests = 0;
+                uint64_t imagesDecoded = 0;
+                // requests answered with an existing image because the path matched
+                uint64_t sharedByPath = 0;
+                // requests answered with an existing image because the file's contents matched
+                uint64_t sharedByContent = 0;
+                uint64_t solidRequests = 0;
+                uint64_t solidsCreated = 0;
+                // texel memory of every decoded image, only known once they've been resolved
+                size_t imageBytes = 0;
+        };
+
+        // 0 threads means one per hardware thread
+        TextureRegistry(size_t threadCount = 0);
+
+        TextureRegistry(TextureRegistry const &) = delete;
+        TextureRegistry & operator=(TextureRegistry const &) = delete;
+
+        // the image texture for a file, in its default format (see default_texel_format).
+        // the file starts decoding in the background, the texture can't be used until resolve has been called
+        std::shared_ptr<ImageTexture> image(std::string const & filename);
+        std::shared_ptr<ImageTexture> image(std::string const & filename, TexelFormat format);
+
+        // blocks until every image requested so far has finished decoding
+        void resolve();
+
+        std::shared_ptr<SolidColorTexture> solid(Color const & color);
+
+        Statistics statistics() const;
+
+        void report(std::ostream & out) const;
+
+    private:
+        class ContentKey {
+            public:
+                uint64_t hash;
+                size_t size;
+                TexelFormat format;
+
+                bool operator<(ContentKey const & right) const;
+        };
+
+        mutable std::mutex _mutex;
+        // keyed by the normalized absolute path followed by the format
+        std::unordered_map<std::string, std::shared_ptr<ImageTexture>> _imagesByPath;
+        std::map<ContentKey, std::shared_ptr<ImageTexture>> _imagesByContent;
+        std::map<std::tuple<double, double, double>, std::shared_ptr<SolidColorTexture>> _solids;
+        // every image that's been decoded, or is being decoded, once each
+        std::vector<std::shared_ptr<ImageTexture>> _decodedImages;
+        Statistics _statistics;
+
+        size_t _threadCount;
+        // only started when the first image is requested, so scenes without images don't start any threads
+        std::unique_ptr<ThreadPool> _pool;
+
+        // FNV-1a of the file's bytes, returns false if it couldn't be read
+        static bool hash_file(std::string const & filename, ContentKey & key);
+};
+
+// ------
+
+inline TextureRegistry::TextureRegistry(size_t threadCount) : _threadCount(threadCount) { }
+
+inline std::shared_ptr<ImageTexture> TextureRegistry::image(std::string const & filename) {
+    return image(filename, default_texel_format(filename));
+}
+
+inline std::shared_ptr<ImageTexture> TextureRegistry::image(std::string const & filename, TexelFormat format) {
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    this->_statistics.imageRequests++;
+
+    std::error_code error;
+    auto path = std::filesystem::absolute(filename, error).lexically_normal();
+    std::string pathKey = (error ? filename : path.string()) + "|" + texel_format_name(format);
+
+    auto byPath = this->_imagesByPath.find(pathKey);
+    if (byPath != this->_imagesByPath.end()) {
+        this->_statistics.sharedByPath++;
+        return byPath->second;
+    }
+
+    // hashing the file is much quicker than decoding it
+    ContentKey contentKey{0, 0, format};
+    bool hashed = hash_file(filename, contentKey);
+    if (hashed) {
+        auto byContent = this->_imagesByContent.find(contentKey);
+        if (byContent != this->_imagesByContent.end()) {
+            this->_statistics.sharedByContent++;
+            this->_imagesByPath[pathKey] = byContent->second;
+            return byContent->second;
+        }
+    }
+
+    if (this->_pool == nullptr) {
+        this->_pool = std::make_unique<ThreadPool>(this->_threadCount);
+    }
+
+    auto texture = std::make_shared<ImageTexture>();
+    this->_pool->submit([texture, filename, format]() {
+        texture->load(filename, format);
+    });
+    this->_statistics.imagesDecoded++;
+    this->_decodedImages.push_back(texture);
+
+    this->_imagesByPath[pathKey] = texture;
+    if (hashed) {
+        this->_imagesByContent[contentKey] = texture;
+    }
+
+    return texture;
+}
+
+inline void TextureRegistry::resolve() {
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    if (this->_pool == nullptr) {
+        return;
+    }
+
+    this->_pool->wait();
+
+    this->_statistics.imageBytes = 0;
+    for (auto const & texture : this->_decodedImages) {
+        this->_statistics.imageBytes += texture->image().memory_size();
+    }
+}
+
+inline std::shared_ptr<SolidColorTexture> TextureRegistry::solid(Color const & color) {
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    this->_statistics.solidRequests++;
+
+    auto & texture = this->_solids[std::make_tuple(color.r, color.g, color.b)];
+    if (texture == nullptr) {
+        texture = std::make_shared<SolidColorTexture>(color);
+        this->_statistics.solidsCreated++;
+    }
+
+    return texture;
+}
+
+inline TextureRegistry::Statistics TextureRegistry::statistics() const {
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    return this->_statistics;
+}
+
+inline void TextureRegistry::report(std::ostream & out) const {
+    Statistics stats = statistics();
+
+    out << "Texture registry: " << stats.imageRequests << " image requests, " << stats.imagesDecoded << " decoded ("
+        << stats.imageBytes / 1024 << "KB), " << stats.sharedByPath << " shared by path, " << stats.sharedByContent
+        << " shared by content, " << stats.solidRequests << " solid color requests, " << stats.solidsCreated << " created\n";
+}
+
+inline bool TextureRegistry::ContentKey::operator<(ContentKey const & right) const {
+    return std::tie(this->hash, this->size, this->format) < std::tie(right.hash, right.size, right.format);
+}
+
+inline bool TextureRegistry::hash_file(std::string const & filename, ContentKey & key) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    uint64_t hash = 14695981039346656037ull;
+    size_t size = 0;
+
+    char buffer[64 * 1024];
+    while (file) {
+        file.read(buffer, sizeof(buffer));
+        std::streamsize count = file.gcount();
+        for (std::streamsize i = 0; i < count; i++) {
+            hash ^= static_cast<uint8_t>(buffer[i]);
+            hash *= 1099511628211ull;
+        }
+        size += static_cast<size_t>(count);
+    }
+
+    key.hash = hash;
+    key.size = size;
+    return true;
+}
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// a fixed number of worker threads that run tasks in the order they were submitted
+class ThreadPool {
+    public:
+        // 0 threads means one per hardware thread
+        ThreadPool(size_t threadCount = 0);
+        ~ThreadPool();
+
+        ThreadPool(ThreadPool const &) = delete;
+        ThreadPool & operator=(ThreadPool const &) = delete;
+
+        void submit(std::function<void ()> task);
+
+        // blocks until every task submitted so far has finished running
+        void wait();
+
+        size_t thread_count() const;
+
+    private:
+        std::vector<std::thread> _workers;
+
+        std::mutex _mutex;
+        // signalled when a task is submitted or the pool is shutting down
+        std::condition_variable _taskAvailable;
+        // signalled when the last running task finishes
+        std::condition_variable _allTasksDone;
+
+        std::deque<std::function<void ()>> _tasks;
+        // tasks that have been taken off the queue but haven't finished yet
+        size_t _runningTasks = 0;
+        bool _stopping = false;
+
+        void work();
+};
+
+// ------
+
+inline ThreadPool::ThreadPool(size_t threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::thread::hardware_concurrency();
+    }
+    if (threadCount == 0) {
+        // hardware_concurrency is allowed to return 0 if it can't tell
+        threadCount = 1;
+    }
+
+    for (size_t i = 0; i < threadCount; i++) {
+        this->_workers.emplace_back(&ThreadPool::work, this);
+    }
+}
+
+inline ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(this->_mutex);
+        this->_stopping = true;
+    }
+    this->_taskAvailable.notify_all();
+
+    // any tasks still queued are run before the workers stop
+    for (auto & worker : this->_workers) {
+        worker.join();
+    }
+}
+
+inline void ThreadPool::submit(std::function<void ()> task) {
+    {
+        std::lock_guard<std::mutex> lock(this->_mutex);
+        this->_tasks.push_back(std::move(task));
+    }
+    this->_taskAvailable.notify_one();
+}
+
+inline void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(this->_mutex);
+    this->_allTasksDone.wait(lock, [this]() { return this->_tasks.empty() && (this->_runningTasks == 0); });
+}
+
+inline size_t ThreadPool::thread_count() const {
+    return this->_workers.size();
+}
+
+inline void ThreadPool::work() {
+    while (true) {
+        std::function<void ()> task;
+
+        {
+            std::unique_lock<std::mutex> lock(this->_mutex);
+            this->_taskAvailable.wait(lock, [this]() { return this->_stopping || !this->_tasks.empty(); });
+
+            if (this->_tasks.empty()) {
+                // only possible when stopping
+                return;
+            }
+
+            task = std::move(this->_tasks.front());
+            this->_tasks.pop_front();
+            this->_runningTasks++;
+        }
+
+        task();
+
+        {
+            std::lock_guard<std::mutex> lock(this->_mutex);
+            this->_runningTasks--;
+            if (this->_tasks.empty() && (this->_runningTasks == 0)) {
+                this->_allTasksDone.notify_all();
+            }
+        }
+    }
+}
+
+#endif
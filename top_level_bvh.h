@@ -0,0 +1,105 @@
+#ifndef TOP_LEVEL_BVH_H
+#define TOP_LEVEL_BVH_H
+
+#include <memory>
+
+#include "hittable.h"
+#include "hittable_list.h"
+#include "primitive_list.h"
+#include "bvh_node.h"
+#include "instance.h"
+#include "affine_transform.h"
+
+// the top level of a two level BVH.
+// the bottom level is made up of ordinary BVHs, built once for every unique piece of geometry (e.g a mesh or a
+// group of quads making up a box), while the top level is a BVH over instances of those, each instance being
+// nothing more than a reference to a bottom level BVH and a transform. Copies of the same geometry therefore
+// only cost the memory of an instance, and when only the instances move, only the (much smaller) top level
+// needs rebuilding.
+class TopLevelBvh final : public Hittable {
+    public:
+        TopLevelBvh();
+
+        // builds the bottom level BVH for a group of objects, that can then be instanced any number of times
+        static std::shared_ptr<BvhNode> build_bottom_level(HittableList const & objects);
+
+        // returns the id of the instance, which can be used to move it later on with set_transform.
+        // the top level needs to be re-built after adding instances
+        size_t add_instance(std::shared_ptr<Hittable> const & bottomLevel, AffineTransform const & objectToWorld);
+
+        // the top level needs to be re-built after moving instances
+        void set_transform(size_t instance, AffineTransform const & objectToWorld);
+
+        size_t instance_count() const;
+
+        // re-builds the top level BVH over the current position of all the instances, the bottom level BVHs
+        // they reference are left untouched
+        void build();
+
+        virtual bool hit(Ray const & ray, Interval const & rayLimits, HitResult & result) const override;
+
+        virtual bool occluded(Ray const & ray, Interval const & rayLimits) const override;
+
+        virtual Aabb bounding_box() const override;
+
+    private:
+        std::shared_ptr<PrimitiveList> _instances;
+        std::shared_ptr<BvhNode> _tree;
+};
+
+// ------
+
+inline TopLevelBvh::TopLevelBvh() : _instances(std::make_shared<PrimitiveList>()), _tree() { }
+
+inline std::shared_ptr<BvhNode> TopLevelBvh::build_bottom_level(HittableList const & objects) {
+    return std::make_shared<BvhNode>(objects);
+}
+
+inline size_t TopLevelBvh::add_instance(std::shared_ptr<Hittable> const & bottomLevel, AffineTransform const & objectToWorld) {
+    return this->_instances->add(Instance(bottomLevel, objectToWorld)).index;
+}
+
+inline void TopLevelBvh::set_transform(size_t instance, AffineTransform const & objectToWorld) {
+    this->_instances->instances[instance].set_object_to_world(objectToWorld);
+}
+
+inline size_t TopLevelBvh::instance_count() const {
+    return this->_instances->instances.size();
+}
+
+inline void TopLevelBvh::build() {
+    this->_instances->update_bounding_box();
+
+    if (this->_instances->size() == 0) {
+        this->_tree = nullptr;
+        return;
+    }
+
+    this->_tree = std::make_shared<BvhNode>(std::shared_ptr<PrimitiveList const>(this->_instances));
+}
+
+// the nodes of both levels count themselves (see stats::count_bvh_node) as the ray goes through them, counting here
+// as well would count the root twice
+inline bool TopLevelBvh::hit(Ray const & ray, Interval const & rayLimits, HitResult & result) const {
+    if (!this->_tree) {
+        // hasn't been built yet, so just go through every instance
+        return this->_instances->hit(ray, rayLimits, result);
+    }
+
+    return this->_tree->hit(ray, rayLimits, result);
+}
+
+inline bool TopLevelBvh::occluded(Ray const & ray, Interval const & rayLimits) const {
+    if (!this->_tree) {
+        return this->_instances->occluded(ray, rayLimits);
+    }
+
+    return this->_tree->occluded(ray, rayLimits);
+}
+
+// note that this isn't up to date with any moved instances until the top level is re-built
+inline Aabb TopLevelBvh::bounding_box() const {
+    return this->_tree ? this->_tree->bounding_box() : this->_instances->bounding_box();
+}
+
+#endif
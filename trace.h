@@ -0,0 +1,381 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// tracing for debugging what happens to the rays of a few pixels, e.g why one pixel is black when its neighbours aren't.
+// Rendering with --trace picks the pixels (see main.cpp), and every TRACE inside of them is recorded, along with which
+// pixel and sample it was for, into a buffer of fixed size binary records per thread. They're either printed as text
+// once the render is done or written to a file, which can be printed later on with --print-trace.
+//
+// which TRACEs exist at all is decided at compile time by RAY_TRACER_TRACE, the highest level to include (0 by default,
+// i.e nothing). Anything above it compiles away to nothing, so there's no cost at all when rendering normally, e.g
+//     ./build.sh -DRAY_TRACER_TRACE=3
+#ifndef RAY_TRACER_TRACE
+#define RAY_TRACER_TRACE 0
+#endif
+
+// records the event with up to MAX_VALUES numbers (anything convertible to a double), if the level is compiled in and
+// the pixel being rendered is one being traced. The values aren't evaluated unless they're recorded, e.g
+//     TRACE(trace::Level::Intersection, trace::Event::QuadHit, t, alpha, beta);
+#define TRACE(level, ...) \
+    do { \
+        if constexpr (trace::compiled(level)) { \
+            if (trace::capturing()) { \
+                trace::record(__VA_ARGS__); \
+            } \
+        } \
+    } while (false)
+
+namespace trace {
+    enum class Level {
+        Off,
+        // pixels and their samples
+        Pixel,
+        // rays, what they hit, and how they scatter off of it
+        Ray,
+        // the insides of intersection tests, which is a lot
+        Intersection
+    };
+
+    enum class Event : uint16_t {
+        PixelStarted,
+        SampleStarted,
+        RayTraced,
+        RayMissed,
+        ListHit,
+        AabbSlab,
+        AabbResult,
+        SphereRoot,
+        SphereHit,
+        QuadParallel,
+        QuadOutsideLimits,
+        QuadOutsideBounds,
+        QuadHit,
+        MediumMissed,
+        MediumInside,
+        MediumPassedThrough,
+        LambertianScattered,
+        MetalScattered,
+        ColorWritten
+    };
+
+    int const MAX_VALUES = 6;
+    // per thread, so that tracing too many pixels can't use up all of the memory. Anything after this is dropped
+    size_t const MAX_RECORDS = 1 << 20;
+
+    // what gets stored for each TRACE, which is 64 bytes so that it fills exactly one cache line
+    class Record {
+        public:
+            Event event;
+            uint16_t valueCount;
+            int32_t pixelX;
+            int32_t pixelY;
+            int32_t sample;
+            double values[MAX_VALUES];
+    };
+
+    // the pixels to trace, in the camera's coordinates (i.e y counts up from the bottom of the image), both inclusive
+    class Region {
+        public:
+            int minX = 0;
+            int minY = 0;
+            int maxX = -1;
+            int maxY = -1;
+
+            Region();
+            Region(int minX, int minY, int maxX, int maxY);
+
+            bool contains(int x, int y) const;
+    };
+
+    // whether TRACEs at this level are compiled in
+    constexpr bool compiled(Level level);
+
+    // sets which pixels are traced, which needs doing before rendering starts
+    void capture(Region const & region);
+
+    // whether the current thread is rendering a pixel that's being traced
+    inline bool capturing();
+
+    // called by the camera before it renders a pixel or a sample of it, to start or stop capturing on this thread
+    inline void begin_pixel(int x, int y);
+    inline void begin_sample(int sample);
+    inline void end_pixel();
+
+    template<typename... Values>
+    void record(Event event, Values... values);
+
+    // every thread's records, ordered by pixel the same way the camera renders them, with how many were dropped
+    std::vector<Record> collect(uint64_t & dropped);
+
+    bool write(std::string const & path);
+
+    bool read(std::string const & path, std::vector<Record> & records, uint64_t & dropped);
+
+    void print(std::ostream & out, std::vector<Record> const & records, uint64_t dropped);
+
+    // prints everything that's been recorded so far, or writes it to the path if there is one
+    void finish(std::string const & path);
+}
+
+// ------
+
+namespace trace {
+    // what each event is called, and the names of its values in order
+    class EventInfo {
+        public:
+            char const * name;
+            char const * valueNames[MAX_VALUES];
+    };
+
+    EventInfo const EVENTS[] = {
+        { "pixel started", {} },
+        { "sample started", {} },
+        { "ray traced", { "depth", "dx", "dy", "dz" } },
+        { "ray missed", { "depth" } },
+        { "list hit", { "index", "t", "front face", "nx", "ny", "nz" } },
+        { "aabb slab", { "t0", "t1", "min", "max" } },
+        { "aabb result", { "x", "y", "z" } },
+        { "sphere root", { "root", "min", "max" } },
+        { "sphere hit", { "root number", "t" } },
+        { "quad parallel", { "normal . direction" } },
+        { "quad outside limits", { "t", "min", "max" } },
+        { "quad outside bounds", { "t", "alpha", "beta" } },
+        { "quad hit", { "t", "alpha", "beta" } },
+        { "medium missed", {} },
+        { "medium inside", { "min", "max" } },
+        { "medium passed through", { "scatter distance", "distance inside" } },
+        { "lambertian scattered", { "dx", "dy", "dz" } },
+        { "metal scattered", { "dx", "dy", "dz" } },
+        { "color written", { "r", "g", "b", "R", "G", "B" } }
+    };
+
+    static_assert(sizeof(Record) == 64, "trace records are meant to fill a cache line");
+    static_assert(sizeof(EVENTS) / sizeof(EVENTS[0]) == static_cast<size_t>(Event::ColorWritten) + 1,
+                  "every trace event needs a name");
+
+    char const FILE_MAGIC[8] = { 'R', 'T', 'T', 'R', 'A', 'C', 'E', '1' };
+
+    // the records of one thread, which are kept once the thread finishes
+    class ThreadBuffer {
+        public:
+            std::vector<Record> records;
+            uint64_t dropped = 0;
+
+            ThreadBuffer();
+            ~ThreadBuffer();
+    };
+
+    class Registry {
+        public:
+            std::mutex mutex;
+            std::vector<ThreadBuffer const *> live;
+            std::vector<Record> finished;
+            uint64_t dropped = 0;
+    };
+
+    // only written before rendering starts, so it's safe to read from every thread without locking
+    inline Region captureRegion;
+
+    // trivially constructed so that checking them is as cheap as any other variable, which isn't true of the buffer
+    inline thread_local bool threadCapturing = false;
+    inline thread_local int32_t threadPixelX = 0;
+    inline thread_local int32_t threadPixelY = 0;
+    inline thread_local int32_t threadSample = 0;
+
+    inline Registry & registry() {
+        static Registry registry;
+        return registry;
+    }
+
+    inline ThreadBuffer & local_buffer() {
+        static thread_local ThreadBuffer buffer;
+        return buffer;
+    }
+}
+
+inline trace::Region::Region() { }
+
+inline trace::Region::Region(int minX, int minY, int maxX, int maxY) : minX(minX), minY(minY), maxX(maxX), maxY(maxY) { }
+
+inline bool trace::Region::contains(int x, int y) const {
+    return (x >= this->minX) && (x <= this->maxX) && (y >= this->minY) && (y <= this->maxY);
+}
+
+inline trace::ThreadBuffer::ThreadBuffer() {
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    registry().live.push_back(this);
+}
+
+inline trace::ThreadBuffer::~ThreadBuffer() {
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    auto & live = registry().live;
+    live.erase(std::remove(live.begin(), live.end(), this), live.end());
+    registry().finished.insert(registry().finished.end(), this->records.begin(), this->records.end());
+    registry().dropped += this->dropped;
+}
+
+constexpr bool trace::compiled(Level level) {
+    return static_cast<int>(level) <= RAY_TRACER_TRACE;
+}
+
+inline void trace::capture(Region const & region) {
+    captureRegion = region;
+}
+
+inline bool trace::capturing() {
+    return threadCapturing;
+}
+
+inline void trace::begin_pixel(int x, int y) {
+    if constexpr (compiled(Level::Pixel)) {
+        threadCapturing = captureRegion.contains(x, y);
+        threadPixelX = x;
+        threadPixelY = y;
+        threadSample = -1;
+        TRACE(Level::Pixel, Event::PixelStarted);
+    }
+}
+
+inline void trace::begin_sample(int sample) {
+    if constexpr (compiled(Level::Pixel)) {
+        threadSample = sample;
+        TRACE(Level::Pixel, Event::SampleStarted);
+    }
+}
+
+inline void trace::end_pixel() {
+    if constexpr (compiled(Level::Pixel)) {
+        threadCapturing = false;
+    }
+}
+
+template<typename... Values>
+void trace::record(Event event, Values... values) {
+    static_assert(sizeof...(Values) <= MAX_VALUES, "too many values for one trace record");
+
+    ThreadBuffer & buffer = local_buffer();
+    if (buffer.records.size() >= MAX_RECORDS) {
+        buffer.dropped++;
+        return;
+    }
+
+    Record record{};
+    record.event = event;
+    record.valueCount = static_cast<uint16_t>(sizeof...(Values));
+    record.pixelX = threadPixelX;
+    record.pixelY = threadPixelY;
+    record.sample = threadSample;
+
+    int i = 0;
+    ((record.values[i++] = static_cast<double>(values)), ...);
+
+    buffer.records.push_back(record);
+}
+
+inline std::vector<trace::Record> trace::collect(uint64_t & dropped) {
+    std::lock_guard<std::mutex> lock(registry().mutex);
+
+    std::vector<Record> records = registry().finished;
+    dropped = registry().dropped;
+    for (ThreadBuffer const * buffer : registry().live) {
+        records.insert(records.end(), buffer->records.begin(), buffer->records.end());
+        dropped += buffer->dropped;
+    }
+
+    // each pixel is rendered by a single thread, so a stable sort keeps its records in the order they happened
+    std::stable_sort(records.begin(), records.end(), [](Record const & a, Record const & b) {
+        return (a.pixelY != b.pixelY) ? (a.pixelY > b.pixelY) : (a.pixelX < b.pixelX);
+    });
+    return records;
+}
+
+// the file is FILE_MAGIC, the size of a record, how many records there are and how many were dropped, followed by the
+// records themselves exactly as they are in memory, so it's only meant to be read back on the same kind of machine
+inline bool trace::write(std::string const & path) {
+    uint64_t dropped = 0;
+    std::vector<Record> records = collect(dropped);
+
+    std::ofstream out(path, std::ios::binary);
+    uint64_t recordSize = sizeof(Record);
+    uint64_t count = records.size();
+    out.write(FILE_MAGIC, sizeof(FILE_MAGIC));
+    out.write(reinterpret_cast<char const *>(&recordSize), sizeof(recordSize));
+    out.write(reinterpret_cast<char const *>(&count), sizeof(count));
+    out.write(reinterpret_cast<char const *>(&dropped), sizeof(dropped));
+    out.write(reinterpret_cast<char const *>(records.data()), static_cast<std::streamsize>(count * sizeof(Record)));
+
+    return static_cast<bool>(out);
+}
+
+inline bool trace::read(std::string const & path, std::vector<Record> & records, uint64_t & dropped) {
+    std::ifstream in(path, std::ios::binary);
+
+    char magic[sizeof(FILE_MAGIC)];
+    uint64_t recordSize = 0;
+    uint64_t count = 0;
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char *>(&recordSize), sizeof(recordSize));
+    in.read(reinterpret_cast<char *>(&count), sizeof(count));
+    in.read(reinterpret_cast<char *>(&dropped), sizeof(dropped));
+    if (!in || (memcmp(magic, FILE_MAGIC, sizeof(magic)) != 0) || (recordSize != sizeof(Record))) {
+        return false;
+    }
+
+    records.resize(count);
+    in.read(reinterpret_cast<char *>(records.data()), static_cast<std::streamsize>(count * sizeof(Record)));
+    for (Record const & record : records) {
+        if (static_cast<size_t>(record.event) >= (sizeof(EVENTS) / sizeof(EVENTS[0])) || (record.valueCount > MAX_VALUES)) {
+            return false;
+        }
+    }
+
+    return static_cast<bool>(in);
+}
+
+inline void trace::print(std::ostream & out, std::vector<Record> const & records, uint64_t dropped) {
+    for (Record const & record : records) {
+        EventInfo const & info = EVENTS[static_cast<size_t>(record.event)];
+
+        if (record.event == Event::PixelStarted) {
+            out << "----\n";
+        }
+        out << "pixel " << record.pixelX << " " << record.pixelY;
+        if (record.sample >= 0) {
+            out << " sample " << record.sample;
+        }
+        out << ": " << info.name;
+
+        for (int i = 0; i < record.valueCount; i++) {
+            out << (i == 0 ? " " : ", ") << (info.valueNames[i] ? info.valueNames[i] : "?") << " = " << record.values[i];
+        }
+        out << "\n";
+    }
+
+    if (dropped > 0) {
+        out << dropped << " trace records were dropped, try tracing fewer pixels\n";
+    }
+}
+
+inline void trace::finish(std::string const & path) {
+    if (!path.empty()) {
+        if (!write(path)) {
+            std::cerr << "Couldn't write the trace to " << path << "\n";
+        }
+        return;
+    }
+
+    uint64_t dropped = 0;
+    std::vector<Record> records = collect(dropped);
+    print(std::clog, records, dropped);
+}
+
+#endif
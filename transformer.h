@@ -6,8 +6,19 @@
 #include "vec3.h"
 #include "aabb.h"
 #include "interval.h"
+#include "affine_transform.h"
 #include <memory>
 
+// a hittable that wraps around another hittable to transform it, exposing what its wrapping and how
+// so that chains of transformers can be flattened into a single Instance, see flatten_transformers
+class Transformer : public Hittable {
+    public:
+        virtual std::shared_ptr<Hittable> const & target() const = 0;
+
+        // the transformation that takes the target's coordinates to the coordinates outside of this transformer
+        virtual AffineTransform object_to_world() const = 0;
+};
+
 // wrap around a Hittable to perform a geometric translation on it by a certain amount
 // with this class, you can define Hittables with their dimensions without thinking about their position,
 // and even re-use the same Hittable, but apply different transformations for it in the same scene.
@@ -15,14 +26,22 @@
 // it moves the ray itself in the opposite direction, shoots the ray onto just that object
 // to calculate whether there is an intersection and where, and then reverses the transformation
 // on the intersection point and returns that, so the caller is none the wiser of what happened.
-class TranslateTransformer : public Hittable {
+class TranslateTransformer : public Transformer {
     public:
         TranslateTransformer(std::shared_ptr<Hittable> const & target, Vec3 const & offset);
 
         virtual bool hit(Ray const & ray, Interval const & rayLimits, HitResult & result) const override;
 
+        virtual bool occluded(Ray const & ray, Interval const & rayLimits) const override;
+
+        virtual bool hit_interval(Ray const & ray, Interval const & rayLimits, Interval & inside) const override;
+
         virtual Aabb bounding_box() const override;
 
+        virtual std::shared_ptr<Hittable> const & target() const override;
+
+        virtual AffineTransform object_to_world() const override;
+
     private:
         std::shared_ptr<Hittable> _target;
         Vec3 _offset;
@@ -37,14 +56,22 @@ class TranslateTransformer : public Hittable {
 // it moves the ray itself in the opposite direction, shoots the ray onto just that object
 // to calculate whether there is an intersection and where, and then reverses the transformation
 // on the intersection point and returns that, so the caller is none the wiser of what happened.
-class RotateYTransformer : public Hittable {
+class RotateYTransformer : public Transformer {
     public:
         RotateYTransformer(std::shared_ptr<Hittable> const & target, double angle);
 
         virtual bool hit(Ray const & ray, Interval const & rayLimits, HitResult & result) const override;
 
+        virtual bool occluded(Ray const & ray, Interval const & rayLimits) const override;
+
+        virtual bool hit_interval(Ray const & ray, Interval const & rayLimits, Interval & inside) const override;
+
         virtual Aabb bounding_box() const override;
 
+        virtual std::shared_ptr<Hittable> const & target() const override;
+
+        virtual AffineTransform object_to_world() const override;
+
     private:
         // the sin of the rotation angle, cached for reuse
         double _sinTheta;
@@ -54,14 +81,16 @@ class RotateYTransformer : public Hittable {
         std::shared_ptr<Hittable> _target;
         double _angle;
         Aabb _boundingBox;
+        // rotates the ray the opposite way to the target, into the target's coordinate system
+        Ray to_object_space(Ray const & ray) const;
 };
 
 // ------
-TranslateTransformer::TranslateTransformer(std::shared_ptr<Hittable> const & target, Vec3 const & offset)
+inline TranslateTransformer::TranslateTransformer(std::shared_ptr<Hittable> const & target, Vec3 const & offset)
                                            : _target(target), _offset(offset),
                                              _boundingBox(this->_target->bounding_box() + this->_offset) { }
 
-bool TranslateTransformer::hit(Ray const & ray, Interval const & rayLimits, HitResult & result) const {
+inline bool TranslateTransformer::hit(Ray const & ray, Interval const & rayLimits, HitResult & result) const {
     auto transformedRay = Ray(ray.orig - this->_offset, ray.dir, ray.time);
 
     if (this->_target->hit(transformedRay, rayLimits, result)) {
@@ -73,11 +102,27 @@ bool TranslateTransformer::hit(Ray const & ray, Interval const & rayLimits, HitR
     }
 }
 
-Aabb TranslateTransformer::bounding_box() const {
+inline bool TranslateTransformer::occluded(Ray const & ray, Interval const & rayLimits) const {
+    return this->_target->occluded(Ray(ray.orig - this->_offset, ray.dir, ray.time), rayLimits);
+}
+
+inline bool TranslateTransformer::hit_interval(Ray const & ray, Interval const & rayLimits, Interval & inside) const {
+    return this->_target->hit_interval(Ray(ray.orig - this->_offset, ray.dir, ray.time), rayLimits, inside);
+}
+
+inline Aabb TranslateTransformer::bounding_box() const {
     return this->_boundingBox;
 }
 
-RotateYTransformer::RotateYTransformer(std::shared_ptr<Hittable> const & target, double angle)
+inline std::shared_ptr<Hittable> const & TranslateTransformer::target() const {
+    return this->_target;
+}
+
+inline AffineTransform TranslateTransformer::object_to_world() const {
+    return AffineTransform::translate(this->_offset);
+}
+
+inline RotateYTransformer::RotateYTransformer(std::shared_ptr<Hittable> const & target, double angle)
                                        : _target(target), _angle(angle) {
     double radians = angle * PI / 180.0;
 
@@ -138,7 +183,7 @@ RotateYTransformer::RotateYTransformer(std::shared_ptr<Hittable> const & target,
     this->_boundingBox = Aabb(min, max);
 }
 
-bool RotateYTransformer::hit(Ray const & ray, Interval const & rayLimits, HitResult & result) const {
+inline Ray RotateYTransformer::to_object_space(Ray const & ray) const {
     auto transformedOrigin = ray.orig;
     auto transformedDirection = ray.dir;
 
@@ -148,7 +193,11 @@ bool RotateYTransformer::hit(Ray const & ray, Interval const & rayLimits, HitRes
     transformedDirection.x = (this->_cosTheta * ray.dir.x) - (this->_sinTheta * ray.dir.z);
     transformedDirection.z = (this->_sinTheta * ray.dir.x) + (this->_cosTheta * ray.dir.z);
 
-    auto transformedRay = Ray(transformedOrigin, transformedDirection, ray.time);
+    return Ray(transformedOrigin, transformedDirection, ray.time);
+}
+
+inline bool RotateYTransformer::hit(Ray const & ray, Interval const & rayLimits, HitResult & result) const {
+    auto transformedRay = to_object_space(ray);
 
     if (this->_target->hit(transformedRay, rayLimits, result)) {
         // intersection found, now lets reverse the rotation on the point and normal
@@ -167,8 +216,24 @@ bool RotateYTransformer::hit(Ray const & ray, Interval const & rayLimits, HitRes
     }
 }
 
-Aabb RotateYTransformer::bounding_box() const {
+inline bool RotateYTransformer::occluded(Ray const & ray, Interval const & rayLimits) const {
+    return this->_target->occluded(to_object_space(ray), rayLimits);
+}
+
+inline bool RotateYTransformer::hit_interval(Ray const & ray, Interval const & rayLimits, Interval & inside) const {
+    return this->_target->hit_interval(to_object_space(ray), rayLimits, inside);
+}
+
+inline Aabb RotateYTransformer::bounding_box() const {
     return this->_boundingBox;
 }
 
+inline std::shared_ptr<Hittable> const & RotateYTransformer::target() const {
+    return this->_target;
+}
+
+inline AffineTransform RotateYTransformer::object_to_world() const {
+    return AffineTransform::rotate_y(this->_angle);
+}
+
 #endif
\ No newline at end of file
@@ -1,5 +1,5 @@
 SOURCE=`find . -name test_\*.cpp`
 
-g++ $SOURCE -o test-ray-tracer -std=c++17
+g++ $SOURCE -o test-ray-tracer -std=c++17 -pthread -DRAY_TRACER_STATS -DRAY_TRACER_TRACE=3
 
 ./test-ray-tracer $@
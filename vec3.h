@@ -2,8 +2,11 @@
 #define VEC3_H
 
 #include <cmath>
+#include <cstddef>
 #include <ostream>
 
+#include "simd.h"
+
 double const PI = 3.1415926535897932385;
 
 class Vec3 {
@@ -47,47 +50,66 @@ Vec3 operator*(double left, Vec3 const & right);
 
 std::ostream & operator<<(std::ostream & out, Vec3 const & v);
 
+// batched versions of the operators above that work on count vectors at a time,
+// out may be the same array as one of the inputs
+void add_vec3s(Vec3 const * a, Vec3 const * b, Vec3 * out, size_t count);
+
+void scale_vec3s(Vec3 const * a, double constant, Vec3 * out, size_t count);
+
+void dot_vec3s(Vec3 const * a, Vec3 const * b, double * out, size_t count);
+
+void unit_vec3s(Vec3 const * a, Vec3 * out, size_t count);
+
 using Point3 = Vec3;
 
+// the SIMD kernels treat the x, y and z of a Vec3 as an array of three doubles
+static_assert(sizeof(Vec3) == 3 * sizeof(double), "Vec3 must be made up of exactly three doubles");
+
 // ------
 
-Vec3::Vec3() : x(0), y(0), z(0) { }
+inline Vec3::Vec3() : x(0), y(0), z(0) { }
 
-Vec3::Vec3(double i, double j, double k) : x(i), y(j), z(k) { }
+inline Vec3::Vec3(double i, double j, double k) : x(i), y(j), z(k) { }
 
-Vec3 Vec3::operator+(Vec3 const & right) const {
-    return Vec3(this->x + right.x, this->y + right.y, this->z + right.z);
+inline Vec3 Vec3::operator+(Vec3 const & right) const {
+    Vec3 result;
+    simd::add3(&this->x, &right.x, &result.x);
+    return result;
 }
 
-Vec3 Vec3::operator-() const {
+inline Vec3 Vec3::operator-() const {
     return Vec3(-this->x, -this->y, -this->z);
 }
 
-Vec3 Vec3::operator-(Vec3 const & right) const {
-    return Vec3(this->x - right.x, this->y - right.y, this->z - right.z);
+inline Vec3 Vec3::operator-(Vec3 const & right) const {
+    Vec3 result;
+    simd::sub3(&this->x, &right.x, &result.x);
+    return result;
 }
 
-Vec3 Vec3::operator*(double const constant) const {
-    return Vec3(constant * this->x, constant * this->y, constant * this->z);
+inline Vec3 Vec3::operator*(double const constant) const {
+    Vec3 result;
+    simd::scale3(&this->x, constant, &result.x);
+    return result;
 }
 
-Vec3 Vec3::operator/(double const constant) const {
+inline Vec3 Vec3::operator/(double const constant) const {
     return *this * (1 / constant);
 }
 
-double Vec3::length_squared() const {
-    return (x * x) + (y * y) + (z * z);
+inline double Vec3::length_squared() const {
+    return simd::dot3(&this->x, &this->x);
 }
 
-double Vec3::length() const {
+inline double Vec3::length() const {
     return std::sqrt(this->length_squared());
 }
 
-Vec3 Vec3::unit() const {
+inline Vec3 Vec3::unit() const {
     return *this / this->length();
 }
 
-bool Vec3::is_near_zero() const {
+inline bool Vec3::is_near_zero() const {
     auto const granularity = 1e-8;
     return (fabs(x) < granularity) && (fabs(y) < granularity) && (fabs(z) < granularity);
 }
@@ -95,7 +117,7 @@ bool Vec3::is_near_zero() const {
 // reflects this Vec3 along the normal vector given
 // reflection of a vector v is v - 2(the projection of v onto the normal)
 // which leads to the equation v - 2(v.n)*n
-Vec3 Vec3::reflect(Vec3 const & normal) {
+inline Vec3 Vec3::reflect(Vec3 const & normal) {
     return *this - ((2 * this->dot(normal)) * normal);
 }
 
@@ -107,7 +129,7 @@ Vec3 Vec3::reflect(Vec3 const & normal) {
 // refractiveIndexRatio is the ratio of the refractive index of the outside material (usually air)
 // over the inside material of the inside
 // NOTE: "this" vector must be a unit vector when you use this function on it
-Vec3 Vec3::refract(Vec3 const & normal, double const refractiveIndexRatio) {
+inline Vec3 Vec3::refract(Vec3 const & normal, double const refractiveIndexRatio) {
     Vec3 thisVec = *this;
 
     // the component of the refracted vector that is perpendicular to the normal
@@ -117,24 +139,55 @@ Vec3 Vec3::refract(Vec3 const & normal, double const refractiveIndexRatio) {
     return refractedVectorParallel + refractedVectorPerp;
 }
 
-double Vec3::dot(Vec3 const & right) const {
-    return (this->x * right.x) + (this->y * right.y) + (this->z * right.z);
+inline double Vec3::dot(Vec3 const & right) const {
+    return simd::dot3(&this->x, &right.x);
 }
 
-Vec3 Vec3::cross(Vec3 const & right) const {
-    return Vec3((this->y * right.z) - (this->z * right.y),
-                (this->z * right.x) - (this->x * right.z),
-                (this->x * right.y) - (this->y * right.x));
+inline Vec3 Vec3::cross(Vec3 const & right) const {
+    Vec3 result;
+    simd::cross3(&this->x, &right.x, &result.x);
+    return result;
 }
 
 // specific overload for when constant is on the left hand side of the operator
 // so technically this is an overload for double
-Vec3 operator*(double const left, Vec3 const & right) {
+inline Vec3 operator*(double const left, Vec3 const & right) {
     return right * left;
 }
 
-std::ostream & operator<<(std::ostream & out, Vec3 const & v) {
+inline std::ostream & operator<<(std::ostream & out, Vec3 const & v) {
     return out << v.x << " " << v.y << " " << v.z;
 }
 
+inline void add_vec3s(Vec3 const * a, Vec3 const * b, Vec3 * out, size_t count) {
+    simd::add_batch(&a->x, &b->x, &out->x, count * 3);
+}
+
+inline void scale_vec3s(Vec3 const * a, double constant, Vec3 * out, size_t count) {
+    simd::scale_batch(&a->x, constant, &out->x, count * 3);
+}
+
+inline void dot_vec3s(Vec3 const * a, Vec3 const * b, double * out, size_t count) {
+    // multiply everything in one go then sum up each vector's components, done in chunks so the
+    // products fit on the stack
+    size_t const chunkSize = 64;
+    double products[chunkSize * 3];
+
+    for (size_t start = 0; start < count; start += chunkSize) {
+        size_t chunkCount = (count - start) < chunkSize ? (count - start) : chunkSize;
+
+        simd::mul_batch(&a[start].x, &b[start].x, products, chunkCount * 3);
+
+        for (size_t i = 0; i < chunkCount; i++) {
+            out[start + i] = products[i * 3] + products[(i * 3) + 1] + products[(i * 3) + 2];
+        }
+    }
+}
+
+inline void unit_vec3s(Vec3 const * a, Vec3 * out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        simd::scale3(&a[i].x, 1 / a[i].length(), &out[i].x);
+    }
+}
+
 #endif